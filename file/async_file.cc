@@ -0,0 +1,204 @@
+#include "file/async_file.h"
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "absl/strings/str_format.h"
+#include "absl/time/clock.h"
+#include "file/filesystem.h"
+#include "utils/errno_status.h"
+#include "utils/metrics.h"
+#include "utils/status_macros.h"
+
+namespace file {
+namespace {
+
+utils::Counter* const rejected_ops =
+    utils::MetricsRegistry::Global().GetCounter(
+        "async_file_rejected_total",
+        "Operations AsyncFileIO rejected at its max queue depth.");
+utils::LatencyHistogram* const queue_latency =
+    utils::MetricsRegistry::Global().GetHistogram(
+        "async_file_queue_latency_seconds",
+        "Time AsyncFileIO operations wait for a BlockingIOPool thread.");
+
+}  // namespace
+
+BlockingIOPool::BlockingIOPool(int num_threads)
+    : BlockingIOPool(num_threads, utils::NumaPolicy()) {}
+
+BlockingIOPool::BlockingIOPool(int num_threads,
+                               const utils::NumaPolicy& numa) {
+    for (int i = 0; i < num_threads; i++) {
+        threads_.emplace_back(&BlockingIOPool::WorkLoop, this, numa);
+    }
+}
+
+BlockingIOPool::~BlockingIOPool() {
+    {
+        absl::MutexLock lock(&mu_);
+        stopping_ = true;
+    }
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+void BlockingIOPool::Schedule(Priority priority, std::function<void()> task) {
+    absl::MutexLock lock(&mu_);
+    queues_[priority].push_back(std::move(task));
+}
+
+void BlockingIOPool::WorkLoop(const utils::NumaPolicy& numa) {
+    absl::Status placed = utils::Numa::Get().Apply(numa);
+    if (!placed.ok()) {
+        LOG(ERROR) << placed;
+    }
+    auto has_work = [this]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        for (const auto& queue : queues_) {
+            if (!queue.empty()) {
+                return true;
+            }
+        }
+        return stopping_;
+    };
+    while (true) {
+        std::function<void()> task;
+        {
+            absl::MutexLock lock(&mu_);
+            mu_.Await(absl::Condition(&has_work));
+            for (auto& queue : queues_) {
+                if (!queue.empty()) {
+                    task = std::move(queue.front());
+                    queue.pop_front();
+                    break;
+                }
+            }
+            if (!task) {
+                return;
+            }
+        }
+        task();
+    }
+}
+
+absl::StatusOr<std::unique_ptr<AsyncFileIO>> AsyncFileIO::Create(
+    EPoll* epoll, BlockingIOPool* pool, const Options& options) {
+    int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd < 0) {
+        return utils::ErrnoToStatus(errno);
+    }
+    auto async_io = std::unique_ptr<AsyncFileIO>(new AsyncFileIO(
+        epoll, pool, options, std::make_unique<File>(fd)));
+    RETURN_IF_ERROR(
+        epoll->Add(async_io->event_file_.get(), EPOLLIN, async_io.get()));
+    return async_io;
+}
+
+AsyncFileIO::~AsyncFileIO() {
+    {
+        absl::MutexLock lock(&mu_);
+        auto done = [this]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+            return running_ == 0;
+        };
+        mu_.Await(absl::Condition(&done));
+    }
+    epoll_->DeleteIfExists(event_file_.get()).IgnoreError();
+}
+
+absl::Status AsyncFileIO::SubmitInternal(BlockingIOPool::Priority priority,
+                                         Operation op) {
+    if (queue_depth_ >= options_.max_queue_depth) {
+        rejected_ops->Increment();
+        return absl::ResourceExhaustedError(absl::StrFormat(
+            "%d file operations in flight", queue_depth_));
+    }
+    queue_depth_++;
+    {
+        absl::MutexLock lock(&mu_);
+        running_++;
+    }
+    pool_->Schedule(priority, [this, op = std::move(op),
+                               submitted = absl::Now()]() {
+        queue_latency->Record(absl::Now() - submitted);
+        std::function<void()> callback = op();
+        absl::MutexLock lock(&mu_);
+        // The loop is woken up once per batch of completions. The write is
+        // under the lock, the object may be destroyed once it is released.
+        if (completions_.empty()) {
+            uint64_t one = 1;
+            if (write(event_file_->fd(), &one, sizeof(one)) < 0) {
+                LOG(ERROR) << utils::ErrnoToStatus(errno);
+            }
+        }
+        completions_.push_back(std::move(callback));
+        running_--;
+    });
+    return absl::OkStatus();
+}
+
+absl::Status AsyncFileIO::GetContents(
+    absl::string_view path, BlockingIOPool::Priority priority,
+    std::function<void(absl::StatusOr<std::string>)> done) {
+    return Submit<absl::StatusOr<std::string>>(
+        priority,
+        [path = std::string(path)]() { return file::GetContents(path); },
+        std::move(done));
+}
+
+absl::Status AsyncFileIO::PRead(
+    File* file, size_t count, off_t offset, BlockingIOPool::Priority priority,
+    std::function<void(absl::StatusOr<std::string>)> done) {
+    return Submit<absl::StatusOr<std::string>>(
+        priority,
+        [file, count, offset]() { return file->PRead(count, offset); },
+        std::move(done));
+}
+
+absl::Status AsyncFileIO::PWrite(File* file, std::string data, off_t offset,
+                                 BlockingIOPool::Priority priority,
+                                 std::function<void(absl::Status)> done) {
+    return Submit<absl::Status>(
+        priority,
+        [file, data = std::move(data), offset]() -> absl::Status {
+            size_t written = 0;
+            while (written < data.size()) {
+                ASSIGN_OR_RETURN(
+                    size_t n,
+                    file->PWrite(absl::string_view(data).substr(written),
+                                 offset + written));
+                written += n;
+            }
+            return absl::OkStatus();
+        },
+        std::move(done));
+}
+
+absl::Status AsyncFileIO::DataSync(File* file,
+                                   BlockingIOPool::Priority priority,
+                                   std::function<void(absl::Status)> done) {
+    return Submit<absl::Status>(
+        priority, [file]() { return file->DataSync(); }, std::move(done));
+}
+
+absl::Status AsyncFileIO::ProcessCompletions() {
+    // Cleared before taking the completions, a completion added meanwhile
+    // signals again.
+    uint64_t count;
+    if (read(event_file_->fd(), &count, sizeof(count)) < 0 &&
+        errno != EAGAIN) {
+        return utils::ErrnoToStatus(errno);
+    }
+    std::vector<std::function<void()>> completions;
+    {
+        absl::MutexLock lock(&mu_);
+        completions.swap(completions_);
+    }
+    queue_depth_ -= completions.size();
+    for (auto& completion : completions) {
+        completion();
+    }
+    return absl::OkStatus();
+}
+
+}  // namespace file
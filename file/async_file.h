@@ -0,0 +1,161 @@
+#ifndef TOOLBASE_FILE_ASYNC_FILE_H_
+#define TOOLBASE_FILE_ASYNC_FILE_H_
+
+#include <sys/types.h>
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "file/epoll.h"
+#include "file/file.h"
+#include "utils/numa.h"
+
+namespace file {
+
+// Threads running blocking file operations, shared by the `AsyncFileIO`s
+// of many loops. The number of threads bounds the disk operations in
+// flight. A task of higher priority runs before all the queued tasks of
+// lower priority.
+class BlockingIOPool {
+   public:
+    enum Priority {
+        // e.g. a read a client is waiting for.
+        kHigh = 0,
+        kNormal = 1,
+        // e.g. compactions and prefetches.
+        kLow = 2,
+    };
+    static constexpr int kNumPriorities = 3;
+
+    explicit BlockingIOPool(int num_threads);
+    // The threads apply `numa` when they start, e.g. the node of the disk
+    // controller or of the loops they serve.
+    BlockingIOPool(int num_threads, const utils::NumaPolicy& numa);
+    // Runs the tasks still queued, then joins the threads.
+    ~BlockingIOPool();
+
+    BlockingIOPool(const BlockingIOPool&) = delete;
+    BlockingIOPool& operator=(const BlockingIOPool&) = delete;
+
+    void Schedule(Priority priority, std::function<void()> task);
+
+    int num_threads() const { return threads_.size(); }
+
+   private:
+    void WorkLoop(const utils::NumaPolicy& numa);
+
+    absl::Mutex mu_;
+    std::deque<std::function<void()>> queues_[kNumPriorities]
+        ABSL_GUARDED_BY(mu_);
+    bool stopping_ ABSL_GUARDED_BY(mu_) = false;
+    std::vector<std::thread> threads_;
+};
+
+// Runs blocking file operations of an `EPoll` loop on a `BlockingIOPool`,
+// so that a slow disk does not stall the other files of the loop. The
+// completions are posted back through an eventfd in the epoll: when `Wait`
+// returns it, with this object as `ptr`, the loop calls
+// `ProcessCompletions`, which runs the callbacks on the loop thread.
+// Not thread-safe, all the calls but the operations are on the loop thread.
+// Example:
+//  ASSIGN_OR_RETURN(auto async_io,
+//                   AsyncFileIO::Create(epoll.get(), &pool, {}));
+//  RETURN_IF_ERROR(async_io->GetContents(
+//      path, BlockingIOPool::kHigh,
+//      [](absl::StatusOr<std::string> data) { ... }));
+//  ...
+//  for (const auto& event : *epoll->Wait(...)) {
+//      if (event.ptr == async_io.get()) {
+//          async_io->ProcessCompletions();
+//      }
+//  }
+class AsyncFileIO {
+   public:
+    struct Options {
+        // Operations submitted and not completed yet, past which
+        // submissions return ResourceExhausted. Bounds the memory and the
+        // share of the pool a loop takes.
+        int max_queue_depth = 64;
+    };
+
+    // `epoll` and `pool` should outlive the object.
+    static absl::StatusOr<std::unique_ptr<AsyncFileIO>> Create(
+        EPoll* epoll, BlockingIOPool* pool, const Options& options);
+
+    // Waits for the operations running on the pool, their callbacks are not
+    // called.
+    ~AsyncFileIO();
+
+    // Runs `op` on the pool, then `done` with its result on the loop
+    // thread. Returns ResourceExhausted, without calling `done`, when
+    // `max_queue_depth` operations are in flight.
+    template <typename T>
+    absl::Status Submit(BlockingIOPool::Priority priority,
+                        std::function<T()> op,
+                        std::function<void(T)> done) {
+        return SubmitInternal(
+            priority, [op = std::move(op), done = std::move(done)]() {
+                auto result = std::make_shared<T>(op());
+                return std::function<void()>(
+                    [done, result]() { done(std::move(*result)); });
+            });
+    }
+
+    // Common operations, `file` should outlive them.
+    absl::Status GetContents(
+        absl::string_view path, BlockingIOPool::Priority priority,
+        std::function<void(absl::StatusOr<std::string>)> done);
+    absl::Status PRead(File* file, size_t count, off_t offset,
+                       BlockingIOPool::Priority priority,
+                       std::function<void(absl::StatusOr<std::string>)> done);
+    absl::Status PWrite(File* file, std::string data, off_t offset,
+                        BlockingIOPool::Priority priority,
+                        std::function<void(absl::Status)> done);
+    absl::Status DataSync(File* file, BlockingIOPool::Priority priority,
+                          std::function<void(absl::Status)> done);
+
+    // Runs the callbacks of the completed operations.
+    absl::Status ProcessCompletions();
+
+    // Operations submitted whose callback has not run yet.
+    int queue_depth() const { return queue_depth_; }
+
+   private:
+    // Returns the callback to run on the loop thread.
+    using Operation = std::function<std::function<void()>()>;
+
+    AsyncFileIO(EPoll* epoll, BlockingIOPool* pool, const Options& options,
+                std::unique_ptr<File> event_file)
+        : epoll_(epoll),
+          pool_(pool),
+          options_(options),
+          event_file_(std::move(event_file)) {}
+
+    absl::Status SubmitInternal(BlockingIOPool::Priority priority,
+                                Operation op);
+
+    EPoll* const epoll_;
+    BlockingIOPool* const pool_;
+    const Options options_;
+    std::unique_ptr<File> event_file_;
+    int queue_depth_ = 0;
+
+    absl::Mutex mu_;
+    std::vector<std::function<void()>> completions_ ABSL_GUARDED_BY(mu_);
+    // Operations queued or running on the pool.
+    int running_ ABSL_GUARDED_BY(mu_) = 0;
+};
+
+}  // namespace file
+
+#endif  // TOOLBASE_FILE_ASYNC_FILE_H_
@@ -0,0 +1,78 @@
+#include <fcntl.h>
+
+#include <random>
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "file/async_file.h"
+#include "file/filesystem.h"
+
+namespace file {
+namespace {
+
+constexpr char kFile[] = "/tmp/async_file_benchmark";
+constexpr size_t kFileSize = 64 << 20;
+constexpr size_t kReadSize = 4096;
+
+// Random 4KB reads with `range(0)` reads in flight on a pool of `range(1)`
+// threads, the cost of an offload is a pool handoff and an eventfd
+// round trip per batch of completions.
+void BM_AsyncPRead(benchmark::State& state) {
+    const int depth = state.range(0);
+    if (!PutContents(std::string(kFileSize, 'x'), kFile).ok()) {
+        state.SkipWithError("cannot create the file");
+        return;
+    }
+    auto file = *File::Open(kFile, O_RDONLY);
+    BlockingIOPool pool(state.range(1));
+    auto epoll = *EPoll::Create();
+    AsyncFileIO::Options options;
+    options.max_queue_depth = depth;
+    auto async_io = *AsyncFileIO::Create(epoll.get(), &pool, options);
+
+    std::mt19937_64 rng(42);
+    std::uniform_int_distribution<off_t> offsets(0, kFileSize - kReadSize);
+    int64_t completed = 0;
+    auto done = [&](absl::StatusOr<std::string> data) {
+        benchmark::DoNotOptimize(data);
+        completed++;
+    };
+    for (auto _ : state) {
+        while (async_io->queue_depth() < depth) {
+            async_io->PRead(file.get(), kReadSize, offsets(rng),
+                            BlockingIOPool::kNormal, done)
+                .IgnoreError();
+        }
+        if (!epoll->Wait(1, nullptr).ok() ||
+            !async_io->ProcessCompletions().ok()) {
+            state.SkipWithError("loop failed");
+            break;
+        }
+    }
+    state.SetItemsProcessed(completed);
+    async_io.reset();
+    Unlink(kFile).IgnoreError();
+}
+BENCHMARK(BM_AsyncPRead)
+    ->ArgsProduct({{1, 16, 64}, {1, 4}})
+    ->UseRealTime();
+
+// The same reads on the loop thread, for reference.
+void BM_BlockingPRead(benchmark::State& state) {
+    if (!PutContents(std::string(kFileSize, 'x'), kFile).ok()) {
+        state.SkipWithError("cannot create the file");
+        return;
+    }
+    auto file = *File::Open(kFile, O_RDONLY);
+    std::mt19937_64 rng(42);
+    std::uniform_int_distribution<off_t> offsets(0, kFileSize - kReadSize);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(file->PRead(kReadSize, offsets(rng)));
+    }
+    state.SetItemsProcessed(state.iterations());
+    Unlink(kFile).IgnoreError();
+}
+BENCHMARK(BM_BlockingPRead);
+
+}  // namespace
+}  // namespace file
@@ -0,0 +1,195 @@
+#include "file/async_file.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "absl/synchronization/notification.h"
+#include "file/filesystem.h"
+#include "gtest/gtest.h"
+#include "utils/testing.h"
+
+namespace file {
+namespace {
+
+using ::testing::ElementsAre;
+using ::utils::testing::IsOkAndHolds;
+using ::utils::testing::StatusIs;
+
+static constexpr absl::string_view kFile = "/tmp/test_async_file";
+
+// Runs the loop until `done` returns true.
+void RunUntil(EPoll* epoll, AsyncFileIO* async_io,
+              const std::function<bool()>& done) {
+    const absl::Duration timeout = absl::Seconds(5);
+    while (!done()) {
+        auto events = epoll->Wait(16, &timeout);
+        ASSERT_OK(events);
+        ASSERT_FALSE(events->empty());
+        for (const auto& event : *events) {
+            if (event.ptr == async_io) {
+                ASSERT_OK(async_io->ProcessCompletions());
+            }
+        }
+    }
+}
+
+TEST(AsyncFileIO, Operations) {
+    BlockingIOPool pool(2);
+    auto epoll = *EPoll::Create();
+    auto async_io = *AsyncFileIO::Create(epoll.get(), &pool, {});
+    auto file = *File::Open(kFile, O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+    int done = 0;
+    ASSERT_OK(async_io->PWrite(file.get(), "hello world", 0,
+                               BlockingIOPool::kNormal,
+                               [&](absl::Status status) {
+                                   EXPECT_OK(status);
+                                   done++;
+                               }));
+    RunUntil(epoll.get(), async_io.get(), [&]() { return done == 1; });
+    ASSERT_OK(async_io->DataSync(file.get(), BlockingIOPool::kNormal,
+                                 [&](absl::Status status) {
+                                     EXPECT_OK(status);
+                                     done++;
+                                 }));
+    ASSERT_OK(async_io->PRead(file.get(), 5, 6, BlockingIOPool::kHigh,
+                              [&](absl::StatusOr<std::string> data) {
+                                  EXPECT_THAT(data, IsOkAndHolds("world"));
+                                  done++;
+                              }));
+    ASSERT_OK(async_io->GetContents(
+        kFile, BlockingIOPool::kLow, [&](absl::StatusOr<std::string> data) {
+            EXPECT_THAT(data, IsOkAndHolds("hello world"));
+            done++;
+        }));
+    ASSERT_OK(async_io->GetContents(
+        "/notexists", BlockingIOPool::kLow,
+        [&](absl::StatusOr<std::string> data) {
+            EXPECT_THAT(data, StatusIs(absl::StatusCode::kNotFound));
+            done++;
+        }));
+    EXPECT_EQ(async_io->queue_depth(), 4);
+    RunUntil(epoll.get(), async_io.get(), [&]() { return done == 5; });
+    EXPECT_EQ(async_io->queue_depth(), 0);
+    ASSERT_OK(Unlink(kFile));
+}
+
+TEST(AsyncFileIO, MaxQueueDepth) {
+    BlockingIOPool pool(1);
+    auto epoll = *EPoll::Create();
+    AsyncFileIO::Options options;
+    options.max_queue_depth = 3;
+    auto async_io = *AsyncFileIO::Create(epoll.get(), &pool, options);
+
+    absl::Notification release;
+    int done = 0;
+    for (int i = 0; i < 3; i++) {
+        EXPECT_OK(async_io->Submit<int>(
+            BlockingIOPool::kNormal,
+            [&]() {
+                release.WaitForNotification();
+                return 0;
+            },
+            [&](int) { done++; }));
+    }
+    EXPECT_THAT(async_io->Submit<int>(
+                    BlockingIOPool::kNormal, []() { return 0; },
+                    [](int) { FAIL() << "rejected operations never run"; }),
+                StatusIs(absl::StatusCode::kResourceExhausted));
+
+    release.Notify();
+    RunUntil(epoll.get(), async_io.get(), [&]() { return done == 3; });
+    EXPECT_EQ(async_io->queue_depth(), 0);
+    EXPECT_OK(async_io->Submit<int>(
+        BlockingIOPool::kNormal, []() { return 0; }, [](int) {}));
+}
+
+TEST(BlockingIOPool, Priorities) {
+    BlockingIOPool pool(1);
+    absl::Notification started;
+    absl::Notification release;
+    pool.Schedule(BlockingIOPool::kNormal, [&]() {
+        started.Notify();
+        release.WaitForNotification();
+    });
+    started.WaitForNotification();
+
+    absl::Mutex mu;
+    std::vector<int> order;
+    auto record = [&](int i) {
+        return [&, i]() {
+            absl::MutexLock lock(&mu);
+            order.push_back(i);
+        };
+    };
+    pool.Schedule(BlockingIOPool::kLow, record(1));
+    pool.Schedule(BlockingIOPool::kNormal, record(2));
+    pool.Schedule(BlockingIOPool::kHigh, record(3));
+    pool.Schedule(BlockingIOPool::kLow, record(4));
+    pool.Schedule(BlockingIOPool::kHigh, record(5));
+    release.Notify();
+    auto all_done = [&]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu) {
+        return order.size() == 5;
+    };
+    absl::MutexLock lock(&mu);
+    mu.Await(absl::Condition(&all_done));
+    EXPECT_THAT(order, ElementsAre(3, 5, 2, 1, 4));
+}
+
+TEST(AsyncFileIO, LoopNotBlocked) {
+    BlockingIOPool pool(1);
+    auto epoll = *EPoll::Create();
+    auto async_io = *AsyncFileIO::Create(epoll.get(), &pool, {});
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    File reader(fds[0]);
+    File writer(fds[1]);
+    ASSERT_OK(epoll->Add(&reader, EPOLLIN, &reader));
+
+    // A slow disk.
+    absl::Notification release;
+    bool completed = false;
+    ASSERT_OK(async_io->Submit<int>(
+        BlockingIOPool::kNormal,
+        [&]() {
+            release.WaitForNotification();
+            return 1;
+        },
+        [&](int) { completed = true; }));
+
+    // The other files of the loop are served meanwhile.
+    ASSERT_OK(writer.WriteAll("ping"));
+    const absl::Duration timeout = absl::Seconds(5);
+    auto events = epoll->Wait(16, &timeout);
+    ASSERT_OK(events);
+    ASSERT_EQ(events->size(), 1);
+    EXPECT_EQ((*events)[0].ptr, &reader);
+    EXPECT_FALSE(completed);
+
+    release.Notify();
+    RunUntil(epoll.get(), async_io.get(), [&]() { return completed; });
+}
+
+TEST(AsyncFileIO, DestroyWaitsForRunningOperations) {
+    BlockingIOPool pool(1);
+    auto epoll = *EPoll::Create();
+    auto async_io = *AsyncFileIO::Create(epoll.get(), &pool, {});
+    std::atomic<bool> ran{false};
+    ASSERT_OK(async_io->Submit<int>(
+        BlockingIOPool::kNormal,
+        [&]() {
+            absl::SleepFor(absl::Milliseconds(50));
+            ran = true;
+            return 0;
+        },
+        [](int) { FAIL() << "callbacks do not run after destruction"; }));
+    async_io.reset();
+    EXPECT_TRUE(ran);
+}
+
+}  // namespace
+}  // namespace file
@@ -0,0 +1,309 @@
+#include "file/compressed_stream.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "absl/strings/str_format.h"
+#include "glog/logging.h"
+#include "snappy.h"
+#include "utils/checksum.h"
+#include "utils/errno_status.h"
+#include "utils/status_macros.h"
+
+namespace file {
+namespace {
+
+constexpr size_t kBlockSize = 1 << 16;
+constexpr size_t kChunkHeaderSize = 4;
+constexpr size_t kChecksumSize = 4;
+constexpr absl::string_view kStreamIdentifier("\xff\x06\x00\x00sNaPpY", 10);
+constexpr size_t kReadSize = 256 << 10;
+
+enum ChunkType : uint8_t {
+    kCompressedData = 0x00,
+    kUncompressedData = 0x01,
+    kLastUnskippable = 0x7f,
+    kStreamIdentifierType = 0xff,
+};
+
+uint32_t MaskedCrc32c(absl::string_view data) {
+    uint32_t crc = utils::ComputeCrc32c(data);
+    return ((crc >> 15) | (crc << 17)) + 0xa282ead8;
+}
+
+void EncodeFixed32(char* out, uint32_t value) {
+    out[0] = static_cast<char>(value);
+    out[1] = static_cast<char>(value >> 8);
+    out[2] = static_cast<char>(value >> 16);
+    out[3] = static_cast<char>(value >> 24);
+}
+
+uint32_t DecodeFixed32(const char* in) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(in);
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) |
+           (static_cast<uint32_t>(p[3]) << 24);
+}
+
+// Encodes `input` as one data chunk into `output`, reusing its capacity.
+void EncodeChunk(absl::string_view input, std::string& output) {
+    constexpr size_t kPrefixSize = kChunkHeaderSize + kChecksumSize;
+    output.resize(kPrefixSize + snappy::MaxCompressedLength(input.size()));
+    size_t compressed_size;
+    snappy::RawCompress(input.data(), input.size(), &output[kPrefixSize],
+                        &compressed_size);
+
+    ChunkType type = kCompressedData;
+    if (compressed_size >= input.size() - input.size() / 8) {
+        type = kUncompressedData;
+        output.resize(kPrefixSize);
+        output.append(input.data(), input.size());
+    } else {
+        output.resize(kPrefixSize + compressed_size);
+    }
+
+    // The chunk length is 24 bits, it follows the type byte.
+    EncodeFixed32(&output[0], (output.size() - kChunkHeaderSize) << 8 | type);
+    EncodeFixed32(&output[kChunkHeaderSize], MaskedCrc32c(input));
+}
+
+}  // namespace
+
+CompressedWriter::CompressedWriter(File* file, const Options& options)
+    : file_(file), options_(options) {}
+
+CompressedWriter::CompressedWriter(NonblockingIO* io, const Options& options)
+    : io_(io), options_(options) {}
+
+CompressedWriter::~CompressedWriter() {
+    auto status = Flush();
+    if (!status.ok()) {
+        LOG(ERROR) << status;
+    }
+    // The pool still references the blocks after a failed flush.
+    absl::MutexLock lock(&mu_);
+    for (auto& block : in_flight_) {
+        mu_.Await(absl::Condition(&block->done));
+    }
+}
+
+std::unique_ptr<CompressedWriter::Block> CompressedWriter::NewBlock() {
+    if (free_.empty()) {
+        auto block = std::make_unique<Block>();
+        block->input.reserve(kBlockSize);
+        return block;
+    }
+    auto block = std::move(free_.back());
+    free_.pop_back();
+    block->input.clear();
+    block->done = false;
+    return block;
+}
+
+absl::Status CompressedWriter::Write(absl::string_view data) {
+    while (!data.empty()) {
+        if (!current_) {
+            current_ = NewBlock();
+        }
+        size_t size =
+            std::min(kBlockSize - current_->input.size(), data.size());
+        current_->input.append(data.data(), size);
+        data.remove_prefix(size);
+        if (current_->input.size() == kBlockSize) {
+            RETURN_IF_ERROR(Submit());
+        }
+    }
+    return absl::OkStatus();
+}
+
+absl::Status CompressedWriter::Flush() {
+    if (current_ && !current_->input.empty()) {
+        RETURN_IF_ERROR(Submit());
+    }
+    return Drain(0);
+}
+
+absl::Status CompressedWriter::Submit() {
+    if (options_.pool == nullptr) {
+        EncodeChunk(current_->input, current_->output);
+        RETURN_IF_ERROR(Emit(current_->output));
+        free_.push_back(std::move(current_));
+        return absl::OkStatus();
+    }
+
+    Block* block = current_.get();
+    in_flight_.push_back(std::move(current_));
+    options_.pool->Schedule([this, block]() {
+        EncodeChunk(block->input, block->output);
+        absl::MutexLock lock(&mu_);
+        block->done = true;
+    });
+    return Drain(std::max(options_.max_in_flight, 1));
+}
+
+absl::Status CompressedWriter::Drain(size_t max_in_flight) {
+    while (!in_flight_.empty()) {
+        Block* block = in_flight_.front().get();
+        {
+            absl::MutexLock lock(&mu_);
+            if (!block->done) {
+                if (in_flight_.size() <= max_in_flight) {
+                    break;
+                }
+                mu_.Await(absl::Condition(&block->done));
+            }
+        }
+        RETURN_IF_ERROR(Emit(block->output));
+        free_.push_back(std::move(in_flight_.front()));
+        in_flight_.pop_front();
+    }
+    return absl::OkStatus();
+}
+
+absl::Status CompressedWriter::Emit(absl::string_view chunk) {
+    if (!header_written_) {
+        header_written_ = true;
+        RETURN_IF_ERROR(Emit(kStreamIdentifier));
+    }
+    if (io_) {
+        paused_ = !io_->AppendWriteData(chunk);
+        return absl::OkStatus();
+    }
+    return file_->WriteAll(chunk);
+}
+
+absl::string_view CompressedReader::Buffered() const {
+    if (io_) {
+        return io_->DataToRead();
+    }
+    return absl::string_view(in_).substr(in_pos_);
+}
+
+void CompressedReader::Consume(size_t size) {
+    if (io_) {
+        io_->ConsumeReadData(size);
+        return;
+    }
+    in_pos_ += size;
+}
+
+absl::StatusOr<bool> CompressedReader::Fill(size_t size) {
+    if (Buffered().size() >= size) {
+        return true;
+    }
+    if (io_) {
+        return false;
+    }
+
+    in_.erase(0, in_pos_);
+    in_pos_ = 0;
+    size_t have = in_.size();
+    in_.resize(std::max(size, have + kReadSize));
+    while (have < size) {
+        ssize_t ret = read(file_->fd(), &in_[have], in_.size() - have);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            in_.resize(have);
+            return utils::ErrnoToStatus(errno);
+        }
+        if (ret == 0) {
+            break;
+        }
+        have += ret;
+    }
+    in_.resize(have);
+    return have >= size;
+}
+
+absl::StatusOr<bool> CompressedReader::Read(std::string& out) {
+    const size_t max_chunk_size =
+        kChecksumSize + snappy::MaxCompressedLength(kBlockSize);
+    while (true) {
+        ASSIGN_OR_RETURN(bool has_header, Fill(kChunkHeaderSize));
+        if (!has_header) {
+            if (file_ && !Buffered().empty()) {
+                return absl::DataLossError("Truncated chunk header");
+            }
+            return false;
+        }
+        uint32_t header = DecodeFixed32(Buffered().data());
+        uint8_t type = header & 0xff;
+        size_t length = header >> 8;
+        if (length > max_chunk_size) {
+            return absl::DataLossError(
+                absl::StrFormat("Chunk of %d bytes is too large", length));
+        }
+        ASSIGN_OR_RETURN(bool has_chunk, Fill(kChunkHeaderSize + length));
+        if (!has_chunk) {
+            if (file_) {
+                return absl::DataLossError("Truncated chunk");
+            }
+            return false;
+        }
+
+        bool has_data = false;
+        auto status =
+            Decode(type, Buffered().substr(kChunkHeaderSize, length), out,
+                   has_data);
+        Consume(kChunkHeaderSize + length);
+        RETURN_IF_ERROR(status);
+        if (has_data) {
+            return true;
+        }
+    }
+}
+
+absl::Status CompressedReader::Decode(uint8_t type, absl::string_view chunk,
+                                      std::string& out, bool& has_data) {
+    if (type == kStreamIdentifierType) {
+        if (chunk != kStreamIdentifier.substr(kChunkHeaderSize)) {
+            return absl::DataLossError("Invalid stream identifier");
+        }
+        header_read_ = true;
+        return absl::OkStatus();
+    }
+    if (!header_read_) {
+        return absl::DataLossError("Missing stream identifier");
+    }
+    if (type > kLastUnskippable) {
+        // Padding and skippable chunks.
+        return absl::OkStatus();
+    }
+    if (type != kCompressedData && type != kUncompressedData) {
+        return absl::DataLossError(
+            absl::StrFormat("Unskippable chunk of type %d", type));
+    }
+    if (chunk.size() < kChecksumSize) {
+        return absl::DataLossError("Truncated chunk checksum");
+    }
+    uint32_t crc = DecodeFixed32(chunk.data());
+    chunk.remove_prefix(kChecksumSize);
+
+    if (type == kCompressedData) {
+        size_t length;
+        if (!snappy::GetUncompressedLength(chunk.data(), chunk.size(),
+                                           &length) ||
+            length > kBlockSize) {
+            return absl::DataLossError("Corrupted compressed chunk");
+        }
+        out.resize(length);
+        if (!snappy::RawUncompress(chunk.data(), chunk.size(), &out[0])) {
+            return absl::DataLossError("Corrupted compressed chunk");
+        }
+    } else {
+        if (chunk.size() > kBlockSize) {
+            return absl::DataLossError("Uncompressed chunk is too large");
+        }
+        out.assign(chunk.data(), chunk.size());
+    }
+    if (MaskedCrc32c(out) != crc) {
+        return absl::DataLossError("Chunk checksum mismatch");
+    }
+    has_data = true;
+    return absl::OkStatus();
+}
+
+}  // namespace file
@@ -0,0 +1,140 @@
+#ifndef TOOLBASE_FILE_COMPRESSED_STREAM_H_
+#define TOOLBASE_FILE_COMPRESSED_STREAM_H_
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "file/file.h"
+#include "file/nonblocking.h"
+#include "utils/thread_pool.h"
+
+namespace file {
+
+// Streaming compression in the Snappy framing format
+// (https://github.com/google/snappy/blob/main/framing_format.txt), the data
+// is cut into blocks of 64KB which are compressed independently.
+
+// Compresses data written to a `File` or to the write buffer of a
+// `NonblockingIO`, which must outlive the writer. Blocks are compressed on
+// `Options::pool` when set, and emitted in order.
+// Example:
+//  utils::ThreadPool pool(4);
+//  CompressedWriter::Options options;
+//  options.pool = &pool;
+//  CompressedWriter writer(file.get(), options);
+//  RETURN_IF_ERROR(writer.Write(data));
+//  RETURN_IF_ERROR(writer.Flush());
+class CompressedWriter {
+   public:
+    struct Options {
+        // Compresses in the calling thread if null.
+        utils::ThreadPool* pool = nullptr;
+        // Blocks compressed at once, `Write` waits for the oldest block
+        // beyond it. Memory use is about `max_in_flight` * 140KB.
+        int max_in_flight = 16;
+    };
+
+    CompressedWriter(File* file, const Options& options);
+    // Compressed data is appended to the write buffer of `io`, the caller
+    // keeps calling `TryWriteOnce` as usual.
+    CompressedWriter(NonblockingIO* io, const Options& options);
+    // Flushes, and waits for the blocks in flight.
+    ~CompressedWriter();
+
+    CompressedWriter(const CompressedWriter&) = delete;
+    CompressedWriter& operator=(const CompressedWriter&) = delete;
+
+    absl::Status Write(absl::string_view data);
+
+    // Compresses the buffered partial block and emits all the blocks in
+    // flight.
+    absl::Status Flush();
+
+    // With a `NonblockingIO`, true once a compressed chunk appended by
+    // `Write` or `Flush` paused its writes (see `BackpressureOptions`), until
+    // the write buffer drains: the caller should stop writing meanwhile.
+    bool write_paused() const { return paused_ && io_->write_paused(); }
+
+   private:
+    struct Block {
+        std::string input;
+        // The encoded chunk.
+        std::string output;
+        bool done = false;
+    };
+
+    // Hands the current block to the pool, or compresses it in place.
+    absl::Status Submit();
+    // Emits the compressed blocks at the head of the queue, waits until at
+    // most `max_in_flight` blocks are left.
+    absl::Status Drain(size_t max_in_flight);
+    absl::Status Emit(absl::string_view chunk);
+    std::unique_ptr<Block> NewBlock();
+
+    File* file_ = nullptr;
+    NonblockingIO* io_ = nullptr;
+    const Options options_;
+    bool header_written_ = false;
+    // The last `AppendWriteData` reported backpressure.
+    bool paused_ = false;
+
+    std::unique_ptr<Block> current_;
+    std::deque<std::unique_ptr<Block>> in_flight_;
+    // Blocks reused to keep the scratch buffers allocated.
+    std::vector<std::unique_ptr<Block>> free_;
+
+    // Guards `Block::done` of the blocks in flight.
+    absl::Mutex mu_;
+};
+
+// Decompresses a stream written by `CompressedWriter`, or by any Snappy
+// framing format writer.
+// Example:
+//  CompressedReader reader(file.get());
+//  std::string block;
+//  while (true) {
+//      ASSIGN_OR_RETURN(bool has_data, reader.Read(block));
+//      if (!has_data) break;
+//      ...
+//  }
+class CompressedReader {
+   public:
+    // Reads from `file` with blocking reads.
+    explicit CompressedReader(File* file) : file_(file) {}
+    // Decodes the data in the read buffer of `io`, the caller keeps calling
+    // `TryReadOnce` as usual.
+    explicit CompressedReader(NonblockingIO* io) : io_(io) {}
+
+    // Decodes the next data chunk into `out`, at most 64KB. Returns false if
+    // there is no more data: at the end of a file, or when the read buffer
+    // of a `NonblockingIO` holds no complete chunk. Returns DataLoss on
+    // corrupted data or a file ending in the middle of a chunk.
+    absl::StatusOr<bool> Read(std::string& out);
+
+   private:
+    // Makes `size` bytes available in `in_`, returns false if not possible.
+    absl::StatusOr<bool> Fill(size_t size);
+    absl::string_view Buffered() const;
+    void Consume(size_t size);
+    absl::Status Decode(uint8_t type, absl::string_view chunk,
+                        std::string& out, bool& has_data);
+
+    File* file_ = nullptr;
+    NonblockingIO* io_ = nullptr;
+    bool header_read_ = false;
+
+    // Input buffer for a `File`.
+    std::string in_;
+    size_t in_pos_ = 0;
+};
+
+}  // namespace file
+
+#endif  // TOOLBASE_FILE_COMPRESSED_STREAM_H_
@@ -0,0 +1,38 @@
+#include <fcntl.h>
+
+#include "benchmark/benchmark.h"
+#include "file/compressed_stream.h"
+
+namespace file {
+namespace {
+
+// Compresses 16MB of log-like data to /dev/null with `range(0)` pool
+// threads, 0 compresses in the writing thread.
+void BM_CompressedWrite(benchmark::State& state) {
+    std::string data;
+    for (int i = 0; data.size() < (16 << 20); i++) {
+        data += "2021-10-08 12:00:00.000 INFO request id=" +
+                std::to_string(i * 7919 % 100003) + " status=200\n";
+    }
+    auto file = *File::Open("/dev/null", O_WRONLY);
+    std::unique_ptr<utils::ThreadPool> pool;
+    CompressedWriter::Options options;
+    if (state.range(0) > 0) {
+        pool = std::make_unique<utils::ThreadPool>(state.range(0));
+        options.pool = pool.get();
+    }
+
+    for (auto _ : state) {
+        CompressedWriter writer(file.get(), options);
+        for (size_t pos = 0; pos < data.size(); pos += 4096) {
+            writer.Write(absl::string_view(data).substr(pos, 4096))
+                .IgnoreError();
+        }
+        writer.Flush().IgnoreError();
+    }
+    state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_CompressedWrite)->Arg(0)->Arg(1)->Arg(2)->Arg(4)->UseRealTime();
+
+}  // namespace
+}  // namespace file
@@ -0,0 +1,189 @@
+#include "file/compressed_stream.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "file/filesystem.h"
+#include "gtest/gtest.h"
+#include "utils/testing.h"
+
+namespace file {
+namespace {
+
+using ::utils::testing::IsOkAndHolds;
+using ::utils::testing::StatusIs;
+
+static constexpr absl::string_view kFile = "/tmp/test_compressed_stream";
+
+// Compressible data with some noise, larger than a few blocks.
+std::string TestData(size_t size) {
+    std::string data;
+    uint32_t x = 1;
+    while (data.size() < size) {
+        x = x * 1103515245 + 12345;
+        data.append(x % 64, 'a' + (x >> 16) % 26);
+        data.push_back(static_cast<char>(x >> 8));
+    }
+    data.resize(size);
+    return data;
+}
+
+std::string ReadAll(CompressedReader& reader) {
+    std::string all;
+    std::string block;
+    while (true) {
+        auto has_data = reader.Read(block);
+        EXPECT_OK(has_data);
+        if (!has_data.ok() || !*has_data) {
+            return all;
+        }
+        EXPECT_LE(block.size(), 1 << 16);
+        all.append(block);
+    }
+}
+
+class CompressedStream : public ::testing::Test {
+   protected:
+    void TearDown() override {
+        if (*Exists(kFile)) {
+            ASSERT_OK(Unlink(kFile));
+        }
+    }
+
+    std::string WriteFile(absl::string_view data,
+                          const CompressedWriter::Options& options) {
+        auto file = *File::Open(kFile, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        {
+            CompressedWriter writer(file.get(), options);
+            // Uneven writes, crossing the block boundaries.
+            for (size_t pos = 0; pos < data.size(); pos += 10007) {
+                EXPECT_OK(writer.Write(data.substr(pos, 10007)));
+            }
+            EXPECT_OK(writer.Flush());
+        }
+        if (Stat(kFile)->size() == 0) {
+            return "";
+        }
+        return *GetContents(kFile);
+    }
+};
+
+TEST_F(CompressedStream, FileRoundTrip) {
+    std::string data = TestData(1 << 20);
+    std::string compressed = WriteFile(data, {});
+    EXPECT_EQ(compressed.substr(0, 10),
+              absl::string_view("\xff\x06\x00\x00sNaPpY", 10));
+    EXPECT_LT(compressed.size(), data.size());
+
+    auto file = *File::Open(kFile, O_RDONLY);
+    CompressedReader reader(file.get());
+    EXPECT_EQ(ReadAll(reader), data);
+}
+
+TEST_F(CompressedStream, ParallelCompressionKeepsOrder) {
+    std::string data = TestData(3 << 20);
+    utils::ThreadPool pool(4);
+    CompressedWriter::Options options;
+    options.pool = &pool;
+    options.max_in_flight = 4;
+    // The output is the same as the one compressed serially.
+    EXPECT_EQ(WriteFile(data, options), WriteFile(data, {}));
+
+    auto file = *File::Open(kFile, O_RDONLY);
+    CompressedReader reader(file.get());
+    EXPECT_EQ(ReadAll(reader), data);
+}
+
+TEST_F(CompressedStream, EmptyStream) {
+    EXPECT_EQ(WriteFile("", {}), "");
+    auto file = *File::Open(kFile, O_RDONLY);
+    CompressedReader reader(file.get());
+    std::string block;
+    EXPECT_THAT(reader.Read(block), IsOkAndHolds(false));
+}
+
+TEST_F(CompressedStream, Corruption) {
+    std::string data = TestData(200000);
+    std::string compressed = WriteFile(data, {});
+
+    // Truncated in the middle of a chunk.
+    ASSERT_OK(Unlink(kFile));
+    ASSERT_OK(PutContents(compressed.substr(0, compressed.size() - 1), kFile));
+    {
+        auto file = *File::Open(kFile, O_RDONLY);
+        CompressedReader reader(file.get());
+        std::string block;
+        absl::Status status;
+        while (status.ok()) {
+            auto result = reader.Read(block);
+            status = result.status();
+            ASSERT_TRUE(!result.ok() || *result);
+        }
+        EXPECT_THAT(status, StatusIs(absl::StatusCode::kDataLoss));
+    }
+
+    // A flipped bit in the data of the first chunk.
+    compressed[30] ^= 1;
+    ASSERT_OK(Unlink(kFile));
+    ASSERT_OK(PutContents(compressed, kFile));
+    auto file = *File::Open(kFile, O_RDONLY);
+    CompressedReader reader(file.get());
+    std::string block;
+    EXPECT_THAT(reader.Read(block), StatusIs(absl::StatusCode::kDataLoss));
+}
+
+TEST_F(CompressedStream, NonblockingPipe) {
+    int fds[2];
+    ASSERT_EQ(pipe2(fds, O_NONBLOCK), 0);
+    NonblockingIO out(std::make_unique<File>(fds[1]));
+    NonblockingIO in(std::make_unique<File>(fds[0]));
+    BackpressureOptions backpressure;
+    backpressure.low_watermark = 1 << 10;
+    backpressure.high_watermark = 4 << 10;
+    out.SetBackpressure(backpressure);
+
+    std::string data = TestData(1 << 20);
+    utils::ThreadPool pool(2);
+    CompressedWriter::Options options;
+    options.pool = &pool;
+    CompressedWriter writer(&out, options);
+    CompressedReader reader(&in);
+
+    size_t written = 0;
+    std::string received;
+    std::string block;
+    int pauses = 0;
+    while (received.size() < data.size()) {
+        // Stops writing while the output is paused.
+        if (written < data.size() && !writer.write_paused()) {
+            size_t size = std::min<size_t>(50000, data.size() - written);
+            ASSERT_OK(
+                writer.Write(absl::string_view(data).substr(written, size)));
+            written += size;
+            if (written == data.size()) {
+                ASSERT_OK(writer.Flush());
+            }
+            if (writer.write_paused()) {
+                pauses++;
+            }
+        }
+        if (out.HasDataToWrite()) {
+            ASSERT_OK(out.TryWriteOnce());
+        }
+        ASSERT_OK(in.TryReadOnce(1 << 16));
+        while (true) {
+            auto has_data = reader.Read(block);
+            ASSERT_OK(has_data);
+            if (!*has_data) {
+                break;
+            }
+            received.append(block);
+        }
+    }
+    EXPECT_EQ(received, data);
+    EXPECT_GT(pauses, 0);
+    EXPECT_FALSE(in.HasDataToRead());
+}
+
+}  // namespace
+}  // namespace file
@@ -0,0 +1,270 @@
+#include "file/coro.h"
+
+#include <sys/epoll.h>
+
+#include <algorithm>
+
+#include "utils/status_macros.h"
+
+namespace file {
+namespace internal {
+namespace {
+
+// Frames up to kNumSizeClasses * kSizeClassBytes are pooled, a free list
+// keeps at most kMaxFreeFrames frames.
+constexpr size_t kSizeClassBytes = 64;
+constexpr size_t kNumSizeClasses = 32;
+constexpr int kMaxFreeFrames = 256;
+
+struct FreeFrame {
+    FreeFrame* next;
+};
+
+struct FramePool {
+    ~FramePool();
+
+    FreeFrame* free_lists[kNumSizeClasses] = {};
+    int free_counts[kNumSizeClasses] = {};
+};
+
+// Frames freed while the thread exits, after its pool, go back to malloc.
+thread_local bool pool_destroyed = false;
+thread_local FramePool pool;
+
+FramePool::~FramePool() {
+    pool_destroyed = true;
+    for (FreeFrame* frame : free_lists) {
+        while (frame != nullptr) {
+            FreeFrame* next = frame->next;
+            ::operator delete(frame);
+            frame = next;
+        }
+    }
+}
+
+}  // namespace
+
+void* AllocateFrame(size_t size) {
+    size_t size_class = (size + kSizeClassBytes - 1) / kSizeClassBytes;
+    if (size_class > kNumSizeClasses || pool_destroyed) {
+        return ::operator new(size);
+    }
+    FreeFrame*& head = pool.free_lists[size_class - 1];
+    if (head == nullptr) {
+        return ::operator new(size_class * kSizeClassBytes);
+    }
+    FreeFrame* frame = head;
+    head = frame->next;
+    pool.free_counts[size_class - 1]--;
+    return frame;
+}
+
+void DeallocateFrame(void* frame, size_t size) {
+    size_t size_class = (size + kSizeClassBytes - 1) / kSizeClassBytes;
+    if (size_class > kNumSizeClasses || pool_destroyed ||
+        pool.free_counts[size_class - 1] >= kMaxFreeFrames) {
+        ::operator delete(frame);
+        return;
+    }
+    FreeFrame* free_frame = static_cast<FreeFrame*>(frame);
+    free_frame->next = pool.free_lists[size_class - 1];
+    pool.free_lists[size_class - 1] = free_frame;
+    pool.free_counts[size_class - 1]++;
+}
+
+// The coroutine running a spawned task, which leaves the loop when done.
+struct DetachedTask {
+    struct promise_type : FrameAllocated {
+        struct FinalAwaiter {
+            bool await_ready() noexcept { return false; }
+            void await_suspend(
+                std::coroutine_handle<promise_type> handle) noexcept {
+                handle.promise().loop->tasks_.erase(handle.address());
+                handle.destroy();
+            }
+            void await_resume() noexcept {}
+        };
+
+        DetachedTask get_return_object() {
+            return DetachedTask{
+                std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        FinalAwaiter final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+
+        EventLoop* loop = nullptr;
+    };
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+}  // namespace internal
+
+namespace {
+
+constexpr int kMaxEvents = 256;
+
+thread_local EventLoop* current_loop = nullptr;
+
+internal::DetachedTask RunDetached(Task<> task) { co_await task; }
+
+}  // namespace
+
+EventLoop::~EventLoop() {
+    // Destroying a task destroys the tasks it awaits, which may still use
+    // the loop.
+    absl::flat_hash_set<void*> tasks;
+    tasks.swap(tasks_);
+    for (void* task : tasks) {
+        std::coroutine_handle<>::from_address(task).destroy();
+    }
+}
+
+absl::StatusOr<std::unique_ptr<EventLoop>> EventLoop::Create() {
+    return Create(utils::NumaPolicy());
+}
+
+absl::StatusOr<std::unique_ptr<EventLoop>> EventLoop::Create(
+    const utils::NumaPolicy& numa) {
+    ASSIGN_OR_RETURN(auto epoll, EPoll::Create());
+    return std::unique_ptr<EventLoop>(new EventLoop(std::move(epoll), numa));
+}
+
+EventLoop* EventLoop::Current() { return current_loop; }
+
+void EventLoop::Spawn(Task<> task) {
+    internal::DetachedTask detached = RunDetached(std::move(task));
+    detached.handle.promise().loop = this;
+    tasks_.insert(detached.handle.address());
+    Schedule(detached.handle);
+}
+
+void EventLoop::ScheduleAt(absl::Time deadline,
+                           std::coroutine_handle<> handle) {
+    timers_.push({deadline, timer_sequence_++, handle});
+}
+
+std::optional<absl::Duration> EventLoop::PollTimers() {
+    if (timers_.empty()) {
+        return std::nullopt;
+    }
+    absl::Time now = absl::Now();
+    while (!timers_.empty() && timers_.top().deadline <= now) {
+        ready_.push_back(timers_.top().handle);
+        timers_.pop();
+    }
+    if (timers_.empty()) {
+        return std::nullopt;
+    }
+    // Rounded up, epoll has a millisecond resolution.
+    return absl::Ceil(timers_.top().deadline - now, absl::Milliseconds(1));
+}
+
+absl::Status EventLoop::Run() {
+    RETURN_IF_ERROR(utils::Numa::Get().Apply(numa_));
+    EventLoop* previous_loop = current_loop;
+    current_loop = this;
+    stopped_ = false;
+    absl::Status status;
+    while (!stopped_ && !tasks_.empty()) {
+        while (!ready_.empty() && !stopped_) {
+            std::coroutine_handle<> handle = ready_.front();
+            ready_.pop_front();
+            handle.resume();
+        }
+        if (stopped_ || tasks_.empty()) {
+            break;
+        }
+
+        std::optional<absl::Duration> timeout = PollTimers();
+        if (!ready_.empty()) {
+            timeout = absl::ZeroDuration();
+        }
+        auto events = epoll_->Wait(kMaxEvents, timeout ? &*timeout : nullptr);
+        if (!events.ok()) {
+            status = events.status();
+            break;
+        }
+        // Only schedules the waiters, no task runs before all the events
+        // are handled so none of their registrations can go away.
+        for (const EPollEvent& event : *events) {
+            static_cast<IORegistration*>(event.ptr)->OnEvents(event.events);
+        }
+    }
+    current_loop = previous_loop;
+    return status;
+}
+
+IORegistration::~IORegistration() {
+    auto status = loop_->epoll()->DeleteIfExists(file_);
+    if (!status.ok()) {
+        LOG(ERROR) << status;
+    }
+}
+
+absl::StatusOr<std::unique_ptr<IORegistration>> IORegistration::Create(
+    EventLoop* loop, File* file) {
+    auto registration =
+        std::unique_ptr<IORegistration>(new IORegistration(loop, file));
+    RETURN_IF_ERROR(loop->epoll()->Add(
+        file, EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET, registration.get()));
+    return registration;
+}
+
+void IORegistration::OnEvents(uint32_t events) {
+    const uint32_t failed = EPOLLERR | EPOLLHUP;
+    if ((events & (EPOLLIN | EPOLLRDHUP | failed)) && reader_) {
+        loop_->Schedule(std::exchange(reader_, nullptr));
+    }
+    if ((events & (EPOLLOUT | failed)) && writer_) {
+        loop_->Schedule(std::exchange(writer_, nullptr));
+    }
+}
+
+absl::StatusOr<std::unique_ptr<AsyncIO>> AsyncIO::Create(
+    EventLoop* loop, std::unique_ptr<File> file) {
+    ASSIGN_OR_RETURN(auto io, NonblockingIO::Create(std::move(file)));
+    ASSIGN_OR_RETURN(auto registration,
+                     IORegistration::Create(loop, io->file()));
+    return std::unique_ptr<AsyncIO>(
+        new AsyncIO(std::move(io), std::move(registration)));
+}
+
+Task<absl::StatusOr<std::string>> AsyncIO::Read(size_t count) {
+    while (!io_->HasDataToRead() && !io_->eof()) {
+        CO_ASSIGN_OR_RETURN(size_t read, io_->TryReadOnce(count));
+        if (read == 0 && !io_->eof()) {
+            if (io_->throttled()) {
+                co_await Sleep(io_->throttle_delay());
+            } else {
+                co_await registration_->Readable();
+            }
+        }
+    }
+    absl::string_view data = io_->DataToRead();
+    std::string result(data.substr(0, std::min(count, data.size())));
+    io_->ConsumeReadData(result.size());
+    co_return result;
+}
+
+Task<absl::Status> AsyncIO::WriteAll(absl::string_view data) {
+    if (data.empty()) {
+        co_return absl::OkStatus();
+    }
+    io_->AppendWriteData(data);
+    while (io_->HasDataToWrite()) {
+        CO_ASSIGN_OR_RETURN(size_t written, io_->TryWriteOnce());
+        if (written == 0) {
+            if (io_->throttled()) {
+                co_await Sleep(io_->throttle_delay());
+            } else {
+                co_await registration_->Writable();
+            }
+        }
+    }
+    co_return absl::OkStatus();
+}
+
+}  // namespace file
@@ -0,0 +1,306 @@
+#ifndef TOOLBASE_FILE_CORO_H_
+#define TOOLBASE_FILE_CORO_H_
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "file/epoll.h"
+#include "file/file.h"
+#include "file/nonblocking.h"
+#include "utils/numa.h"
+
+// C++20 coroutines over `EPoll` and `NonblockingIO`, so that a connection
+// can be served by straight-line code while an `EventLoop` multiplexes many
+// of them on a single thread:
+//  file::Task<absl::Status> Echo(std::unique_ptr<file::AsyncIO> conn) {
+//      while (true) {
+//          CO_ASSIGN_OR_RETURN(std::string data, co_await conn->Read(4096));
+//          if (data.empty()) {
+//              co_return absl::OkStatus();
+//          }
+//          CO_RETURN_IF_ERROR(co_await conn->WriteAll(data));
+//      }
+//  }
+// Targets including this header must be built with -std=c++20.
+
+namespace file {
+
+class EventLoop;
+
+namespace internal {
+
+struct DetachedTask;
+
+// Coroutine frames are recycled through per-thread free lists of a few size
+// classes, so a short-lived coroutine per read or write does not go to
+// malloc. Frames may be freed on another thread than the allocating one.
+void* AllocateFrame(size_t size);
+void DeallocateFrame(void* frame, size_t size);
+
+struct FrameAllocated {
+    static void* operator new(size_t size) { return AllocateFrame(size); }
+    static void operator delete(void* frame, size_t size) {
+        DeallocateFrame(frame, size);
+    }
+};
+
+struct PromiseBase : FrameAllocated {
+    // Transfers to the awaiting coroutine when done.
+    struct FinalAwaiter {
+        bool await_ready() noexcept { return false; }
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(
+            std::coroutine_handle<Promise> handle) noexcept {
+            return handle.promise().continuation;
+        }
+        void await_resume() noexcept {}
+    };
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void unhandled_exception() { std::terminate(); }
+
+    std::coroutine_handle<> continuation = std::noop_coroutine();
+};
+
+template <typename T>
+struct Promise : PromiseBase {
+    void return_value(T value) { result.emplace(std::move(value)); }
+    T TakeResult() { return std::move(*result); }
+
+    std::optional<T> result;
+};
+
+template <>
+struct Promise<void> : PromiseBase {
+    void return_void() {}
+    void TakeResult() {}
+};
+
+}  // namespace internal
+
+// A lazily started coroutine producing a `T`, which runs when awaited and
+// resumes its awaiter when done. Awaiting a task is a direct transfer
+// between the two frames, no event loop iteration is involved.
+template <typename T = void>
+class [[nodiscard]] Task {
+   public:
+    struct promise_type : internal::Promise<T> {
+        Task get_return_object() {
+            return Task(
+                std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+    };
+
+    Task(Task&& other) : handle_(std::exchange(other.handle_, nullptr)) {}
+    Task& operator=(Task&& other) {
+        if (this != &other) {
+            if (handle_) {
+                handle_.destroy();
+            }
+            handle_ = std::exchange(other.handle_, nullptr);
+        }
+        return *this;
+    }
+    ~Task() {
+        if (handle_) {
+            handle_.destroy();
+        }
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    bool await_ready() const { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) {
+        handle_.promise().continuation = awaiter;
+        return handle_;
+    }
+    T await_resume() { return handle_.promise().TakeResult(); }
+
+   private:
+    explicit Task(std::coroutine_handle<promise_type> handle)
+        : handle_(handle) {}
+
+    std::coroutine_handle<promise_type> handle_;
+};
+
+// Runs coroutines on the thread calling `Run`: the ready ones first, then
+// the expired timers, then the ones whose file became ready, parked on
+// their `IORegistration`. One loop per thread, the loop is not thread-safe.
+// Example:
+//  ASSIGN_OR_RETURN(auto loop, file::EventLoop::Create());
+//  loop->Spawn(Serve(listener.get()));
+//  RETURN_IF_ERROR(loop->Run());
+class EventLoop {
+   public:
+    ~EventLoop();
+
+    static absl::StatusOr<std::unique_ptr<EventLoop>> Create();
+    // `Run` applies `numa` to its thread first, so that the loop, and the
+    // buffers its tasks allocate, stay on one node.
+    static absl::StatusOr<std::unique_ptr<EventLoop>> Create(
+        const utils::NumaPolicy& numa);
+
+    // Returns the loop running on this thread, nullptr outside of `Run`.
+    static EventLoop* Current();
+
+    EPoll* epoll() { return epoll_.get(); }
+
+    // The loop owns `task`, it starts on the next iteration of `Run`. Tasks
+    // still suspended when the loop is destroyed are destroyed with it.
+    void Spawn(Task<> task);
+
+    // Runs until all the spawned tasks are done or `Stop` is called.
+    absl::Status Run();
+
+    // Makes `Run` return once the running task suspends.
+    void Stop() { stopped_ = true; }
+
+    // Number of spawned tasks not done yet.
+    size_t num_tasks() const { return tasks_.size(); }
+
+    // For awaiters: resumes `handle` on the next iteration, or once
+    // `deadline` has passed.
+    void Schedule(std::coroutine_handle<> handle) { ready_.push_back(handle); }
+    void ScheduleAt(absl::Time deadline, std::coroutine_handle<> handle);
+
+   private:
+    struct Timer {
+        absl::Time deadline;
+        // Keeps the timers of the same deadline in order.
+        uint64_t sequence;
+        std::coroutine_handle<> handle;
+
+        bool operator>(const Timer& other) const {
+            return deadline != other.deadline ? deadline > other.deadline
+                                              : sequence > other.sequence;
+        }
+    };
+
+    friend struct internal::DetachedTask;
+
+    EventLoop(std::unique_ptr<EPoll> epoll, const utils::NumaPolicy& numa)
+        : epoll_(std::move(epoll)), numa_(numa) {}
+
+    // Moves the expired timers to `ready_`, returns how long the loop may
+    // block in epoll, nullopt meaning indefinitely.
+    std::optional<absl::Duration> PollTimers();
+
+    std::unique_ptr<EPoll> epoll_;
+    const utils::NumaPolicy numa_;
+    std::deque<std::coroutine_handle<>> ready_;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>>
+        timers_;
+    uint64_t timer_sequence_ = 0;
+    // Frames of the spawned tasks not done yet.
+    absl::flat_hash_set<void*> tasks_;
+    bool stopped_ = false;
+};
+
+// Suspends the calling coroutine for `duration` on the current loop.
+// Example:
+//  co_await file::Sleep(absl::Milliseconds(10));
+class Sleep {
+   public:
+    explicit Sleep(absl::Duration duration)
+        : deadline_(absl::Now() + duration) {}
+
+    bool await_ready() const { return deadline_ <= absl::Now(); }
+    void await_suspend(std::coroutine_handle<> handle) {
+        EventLoop::Current()->ScheduleAt(deadline_, handle);
+    }
+    void await_resume() {}
+
+   private:
+    absl::Time deadline_;
+};
+
+// The registration of a file in the epoll of a loop, where the coroutines
+// waiting for the file are parked. The file is registered once, edge
+// triggered, so parking costs no syscall: a waiter must have seen EAGAIN
+// before it awaits. One coroutine may wait for reads and one for writes.
+class IORegistration {
+   public:
+    ~IORegistration();
+
+    // `file` should outlive the registration.
+    static absl::StatusOr<std::unique_ptr<IORegistration>> Create(
+        EventLoop* loop, File* file);
+
+    class Awaiter {
+       public:
+        explicit Awaiter(std::coroutine_handle<>* waiter) : waiter_(waiter) {}
+
+        bool await_ready() const { return false; }
+        void await_suspend(std::coroutine_handle<> handle) {
+            *waiter_ = handle;
+        }
+        void await_resume() {}
+
+       private:
+        std::coroutine_handle<>* waiter_;
+    };
+
+    // Resume when the file may be read or written, or has an error.
+    Awaiter Readable() { return Awaiter(&reader_); }
+    Awaiter Writable() { return Awaiter(&writer_); }
+
+    // Schedules the waiters concerned by epoll `events`.
+    void OnEvents(uint32_t events);
+
+   private:
+    IORegistration(EventLoop* loop, File* file) : loop_(loop), file_(file) {}
+
+    EventLoop* loop_;
+    File* file_;
+    std::coroutine_handle<> reader_;
+    std::coroutine_handle<> writer_;
+};
+
+// Reads and writes a nonblocking file from coroutines, e.g. a connection
+// returned by `net::AsyncListener::Accept`.
+class AsyncIO {
+   public:
+    // Sets O_NONBLOCK on `file` and registers it in `loop`.
+    static absl::StatusOr<std::unique_ptr<AsyncIO>> Create(
+        EventLoop* loop, std::unique_ptr<File> file);
+
+    // Waits until data is available and returns up to `count` bytes, an
+    // empty string means eof.
+    Task<absl::StatusOr<std::string>> Read(size_t count);
+
+    // Writes all of `data`, which should stay valid until the task is done.
+    Task<absl::Status> WriteAll(absl::string_view data);
+
+    NonblockingIO* io() { return io_.get(); }
+    File* file() { return io_->file(); }
+
+   private:
+    AsyncIO(std::unique_ptr<NonblockingIO> io,
+            std::unique_ptr<IORegistration> registration)
+        : io_(std::move(io)), registration_(std::move(registration)) {}
+
+    std::unique_ptr<NonblockingIO> io_;
+    // Destroyed before `io_` closes the file.
+    std::unique_ptr<IORegistration> registration_;
+};
+
+}  // namespace file
+
+#endif  // TOOLBASE_FILE_CORO_H_
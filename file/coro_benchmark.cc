@@ -0,0 +1,104 @@
+#include <sys/socket.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "file/coro.h"
+
+namespace file {
+namespace {
+
+constexpr int kRounds = 100;
+constexpr size_t kMessageSize = 64;
+
+// Reads exactly `size` bytes.
+Task<bool> ReadMessage(AsyncIO* io, size_t size) {
+    size_t received = 0;
+    while (received < size) {
+        auto data = co_await io->Read(size - received);
+        if (!data.ok() || data->empty()) {
+            co_return false;
+        }
+        received += data->size();
+    }
+    co_return true;
+}
+
+Task<> Ping(AsyncIO* io, const std::string* message) {
+    for (int i = 0; i < kRounds; i++) {
+        if (!(co_await io->WriteAll(*message)).ok() ||
+            !co_await ReadMessage(io, message->size())) {
+            co_return;
+        }
+    }
+}
+
+Task<> Pong(AsyncIO* io, const std::string* message) {
+    for (int i = 0; i < kRounds; i++) {
+        if (!co_await ReadMessage(io, message->size()) ||
+            !(co_await io->WriteAll(*message)).ok()) {
+            co_return;
+        }
+    }
+}
+
+// `range(0)` connections doing round trips of small messages concurrently
+// on one loop.
+void BM_PingPong(benchmark::State& state) {
+    const int num_connections = state.range(0);
+    auto loop = *EventLoop::Create();
+    std::vector<std::unique_ptr<AsyncIO>> pings;
+    std::vector<std::unique_ptr<AsyncIO>> pongs;
+    for (int i = 0; i < num_connections; i++) {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+            state.SkipWithError("cannot create the sockets");
+            return;
+        }
+        pings.push_back(
+            *AsyncIO::Create(loop.get(), std::make_unique<File>(fds[0])));
+        pongs.push_back(
+            *AsyncIO::Create(loop.get(), std::make_unique<File>(fds[1])));
+    }
+
+    const std::string message(kMessageSize, 'x');
+    for (auto _ : state) {
+        for (int i = 0; i < num_connections; i++) {
+            loop->Spawn(Ping(pings[i].get(), &message));
+            loop->Spawn(Pong(pongs[i].get(), &message));
+        }
+        if (!loop->Run().ok()) {
+            state.SkipWithError("loop failed");
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * num_connections * kRounds);
+}
+BENCHMARK(BM_PingPong)->Arg(1)->Arg(64)->Arg(1024)->UseRealTime();
+
+// Creates and awaits a trivial task, the cost of a pooled frame and of
+// the two transfers.
+Task<int> Identity(int value) { co_return value; }
+
+Task<> AwaitMany(int count, int* sum) {
+    for (int i = 0; i < count; i++) {
+        *sum += co_await Identity(i);
+    }
+}
+
+void BM_AwaitTask(benchmark::State& state) {
+    auto loop = *EventLoop::Create();
+    int sum = 0;
+    for (auto _ : state) {
+        loop->Spawn(AwaitMany(1000, &sum));
+        loop->Run().IgnoreError();
+    }
+    benchmark::DoNotOptimize(sum);
+    state.SetItemsProcessed(state.iterations() * 1000);
+}
+BENCHMARK(BM_AwaitTask);
+
+}  // namespace
+}  // namespace file
@@ -0,0 +1,162 @@
+#include "file/coro.h"
+
+#include <sys/socket.h>
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "utils/status_macros.h"
+#include "utils/testing.h"
+
+namespace file {
+namespace {
+
+Task<int64_t> Add(int64_t a, int64_t b) { co_return a + b; }
+
+Task<int64_t> Sum(int n) {
+    int64_t sum = 0;
+    for (int i = 1; i <= n; i++) {
+        sum = co_await Add(sum, i);
+    }
+    co_return sum;
+}
+
+Task<> StoreSum(int n, int64_t* out) { *out = co_await Sum(n); }
+
+TEST(Coro, Task) {
+    auto loop = EventLoop::Create();
+    EXPECT_OK(loop);
+    int64_t sum = 0;
+    (*loop)->Spawn(StoreSum(1000, &sum));
+    EXPECT_EQ((*loop)->num_tasks(), 1);
+    EXPECT_OK((*loop)->Run());
+    EXPECT_EQ(sum, 500500);
+    EXPECT_EQ((*loop)->num_tasks(), 0);
+    EXPECT_EQ(EventLoop::Current(), nullptr);
+}
+
+Task<> SleepAndAppend(absl::Duration duration, int value,
+                      std::vector<int>* out) {
+    co_await Sleep(duration);
+    out->push_back(value);
+}
+
+TEST(Coro, Sleep) {
+    auto loop = EventLoop::Create();
+    EXPECT_OK(loop);
+    std::vector<int> order;
+    (*loop)->Spawn(SleepAndAppend(absl::Milliseconds(30), 3, &order));
+    (*loop)->Spawn(SleepAndAppend(absl::Milliseconds(10), 1, &order));
+    (*loop)->Spawn(SleepAndAppend(absl::Milliseconds(20), 2, &order));
+    (*loop)->Spawn(SleepAndAppend(absl::ZeroDuration(), 0, &order));
+
+    absl::Time start = absl::Now();
+    EXPECT_OK((*loop)->Run());
+    EXPECT_GE(absl::Now() - start, absl::Milliseconds(30));
+    EXPECT_EQ(order, std::vector<int>({0, 1, 2, 3}));
+}
+
+Task<> Forever(EventLoop* loop, bool* destroyed) {
+    struct Guard {
+        ~Guard() { *destroyed = true; }
+        bool* destroyed;
+    } guard{destroyed};
+    loop->Stop();
+    co_await Sleep(absl::Hours(1));
+}
+
+TEST(Coro, StopAndDestroy) {
+    auto loop = EventLoop::Create();
+    EXPECT_OK(loop);
+    bool destroyed = false;
+    (*loop)->Spawn(Forever(loop->get(), &destroyed));
+    EXPECT_OK((*loop)->Run());
+    EXPECT_EQ((*loop)->num_tasks(), 1);
+    EXPECT_FALSE(destroyed);
+    loop->reset();
+    EXPECT_TRUE(destroyed);
+}
+
+Task<> Echo(AsyncIO* io, absl::Status* status) {
+    while (true) {
+        auto data = co_await io->Read(4096);
+        if (!data.ok() || data->empty()) {
+            *status = data.status();
+            shutdown(io->file()->fd(), SHUT_WR);
+            co_return;
+        }
+        *status = co_await io->WriteAll(*data);
+        if (!status->ok()) {
+            co_return;
+        }
+    }
+}
+
+Task<absl::Status> WriteRequest(AsyncIO* io, std::string request) {
+    CO_RETURN_IF_ERROR(co_await io->WriteAll(request));
+    // Makes the echo end, which then closes its side.
+    shutdown(io->file()->fd(), SHUT_WR);
+    co_return absl::OkStatus();
+}
+
+Task<absl::Status> ReadResponse(AsyncIO* io, std::string* response) {
+    while (true) {
+        CO_ASSIGN_OR_RETURN(std::string data, co_await io->Read(1 << 20));
+        if (data.empty()) {
+            co_return absl::OkStatus();
+        }
+        response->append(data);
+    }
+}
+
+Task<> StoreStatus(Task<absl::Status> task, absl::Status* status) {
+    *status = co_await task;
+}
+
+TEST(Coro, AsyncIO) {
+    auto loop = EventLoop::Create();
+    EXPECT_OK(loop);
+    int fds[2];
+    EXPECT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    auto server = AsyncIO::Create(loop->get(), std::make_unique<File>(fds[0]));
+    auto client = AsyncIO::Create(loop->get(), std::make_unique<File>(fds[1]));
+    EXPECT_OK(server);
+    EXPECT_OK(client);
+
+    // Larger than the socket buffers, so both sides have to wait.
+    std::string request(8 << 20, 'x');
+    for (size_t i = 0; i < request.size(); i += 4096) {
+        request[i] = 'a' + i % 26;
+    }
+    std::string response;
+    absl::Status echo_status = absl::UnknownError("not run");
+    absl::Status write_status = absl::UnknownError("not run");
+    absl::Status read_status = absl::UnknownError("not run");
+    (*loop)->Spawn(Echo(server->get(), &echo_status));
+    // One coroutine writes while the other reads the same connection.
+    (*loop)->Spawn(
+        StoreStatus(WriteRequest(client->get(), request), &write_status));
+    (*loop)->Spawn(
+        StoreStatus(ReadResponse(client->get(), &response), &read_status));
+    EXPECT_OK((*loop)->Run());
+    EXPECT_OK(echo_status);
+    EXPECT_OK(write_status);
+    EXPECT_OK(read_status);
+    EXPECT_EQ(response, request);
+}
+
+TEST(Coro, FramePool) {
+    void* frame = internal::AllocateFrame(100);
+    internal::DeallocateFrame(frame, 100);
+    // Same size class.
+    EXPECT_EQ(internal::AllocateFrame(120), frame);
+    internal::DeallocateFrame(frame, 120);
+
+    void* large = internal::AllocateFrame(1 << 20);
+    EXPECT_NE(large, nullptr);
+    internal::DeallocateFrame(large, 1 << 20);
+}
+
+}  // namespace
+}  // namespace file
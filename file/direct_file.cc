@@ -0,0 +1,416 @@
+#include "file/direct_file.h"
+
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <new>
+#include <numeric>
+
+#include "absl/strings/str_format.h"
+#include "utils/errno_status.h"
+#include "utils/status_macros.h"
+#include "utils/trace.h"
+
+namespace file {
+namespace {
+
+// Used when the kernel does not report the direct IO alignment of a regular
+// file. Every common device has a logical block size dividing it.
+constexpr size_t kDefaultBlockSize = 4096;
+// Memory alignment of the buffers of the own pools.
+constexpr size_t kPageSize = 4096;
+
+bool IsPowerOfTwo(size_t value) {
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+// Returns the alignment direct IO on `fd` requires, for offsets, lengths
+// and memory alike.
+absl::StatusOr<size_t> QueryBlockSize(int fd) {
+#ifdef STATX_DIOALIGN
+    struct statx stx;
+    if (statx(fd, "", AT_EMPTY_PATH, STATX_DIOALIGN, &stx) == 0 &&
+        (stx.stx_mask & STATX_DIOALIGN) != 0) {
+        if (stx.stx_dio_offset_align == 0) {
+            return absl::InvalidArgumentError(
+                "direct IO is not supported by the file system");
+        }
+        return std::max<size_t>(stx.stx_dio_mem_align,
+                                stx.stx_dio_offset_align);
+    }
+#endif
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        return utils::ErrnoToStatus(errno);
+    }
+    if (S_ISBLK(st.st_mode)) {
+        int block_size;
+        if (ioctl(fd, BLKSSZGET, &block_size) != 0) {
+            return utils::ErrnoToStatus(errno);
+        }
+        return static_cast<size_t>(block_size);
+    }
+    return kDefaultBlockSize;
+}
+
+}  // namespace
+
+AlignedBuffer::AlignedBuffer(AlignedBuffer&& other)
+    : pool_(other.pool_), data_(other.data_), size_(other.size_) {
+    other.pool_ = nullptr;
+    other.data_ = nullptr;
+    other.size_ = 0;
+}
+
+AlignedBuffer& AlignedBuffer::operator=(AlignedBuffer&& other) {
+    if (this != &other) {
+        Release();
+        std::swap(pool_, other.pool_);
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+    }
+    return *this;
+}
+
+void AlignedBuffer::Release() {
+    if (data_ != nullptr) {
+        pool_->Release(data_);
+        pool_ = nullptr;
+        data_ = nullptr;
+        size_ = 0;
+    }
+}
+
+AlignedBufferPool::AlignedBufferPool(size_t buffer_size, size_t alignment,
+                                     int max_free_buffers,
+                                     const utils::NumaPolicy& numa)
+    : buffer_size_(buffer_size),
+      alignment_(alignment),
+      max_free_buffers_(max_free_buffers),
+      numa_(numa) {}
+
+AlignedBufferPool::~AlignedBufferPool() {
+    for (uint8_t* data : free_buffers_) {
+        Free(data);
+    }
+}
+
+AlignedBuffer AlignedBufferPool::Acquire() {
+    {
+        absl::MutexLock lock(&mu_);
+        if (!free_buffers_.empty()) {
+            uint8_t* data = free_buffers_.back();
+            free_buffers_.pop_back();
+            return AlignedBuffer(this, data, buffer_size_);
+        }
+    }
+    void* data;
+    if (!numa_.enabled()) {
+        if (posix_memalign(&data, alignment_, buffer_size_) != 0) {
+            throw std::bad_alloc();
+        }
+        return AlignedBuffer(this, static_cast<uint8_t*>(data), buffer_size_);
+    }
+    // Mapped apart from the heap, the bind policy of a freed buffer must not
+    // stay on memory malloc hands to other allocations.
+    auto mapped = utils::Numa::Allocate(MappedSize(), numa_.node);
+    if (!mapped.ok()) {
+        LOG(ERROR) << mapped.status();
+        throw std::bad_alloc();
+    }
+    return AlignedBuffer(this, static_cast<uint8_t*>(*mapped), buffer_size_);
+}
+
+size_t AlignedBufferPool::MappedSize() const {
+    return (buffer_size_ + kPageSize - 1) & ~(kPageSize - 1);
+}
+
+void AlignedBufferPool::Free(uint8_t* data) {
+    if (numa_.enabled()) {
+        utils::Numa::Free(data, MappedSize());
+    } else {
+        free(data);
+    }
+}
+
+void AlignedBufferPool::Release(uint8_t* data) {
+    {
+        absl::MutexLock lock(&mu_);
+        if (static_cast<int>(free_buffers_.size()) < max_free_buffers_) {
+            free_buffers_.push_back(data);
+            return;
+        }
+    }
+    Free(data);
+}
+
+absl::StatusOr<std::unique_ptr<DirectFile>> DirectFile::Open(
+    absl::string_view path, int flags) {
+    return Open(path, flags, 0, Options());
+}
+
+absl::StatusOr<std::unique_ptr<DirectFile>> DirectFile::Open(
+    absl::string_view path, int flags, mode_t mode, const Options& options) {
+    ASSIGN_OR_RETURN(auto file, File::Open(path, flags | O_DIRECT, mode));
+    ASSIGN_OR_RETURN(size_t block_size, QueryBlockSize(file->fd()));
+    if (!IsPowerOfTwo(block_size)) {
+        return absl::InternalError(
+            absl::StrFormat("unexpected block size %d", block_size));
+    }
+
+    std::unique_ptr<AlignedBufferPool> own_pool;
+    AlignedBufferPool* pool = options.pool;
+    if (pool == nullptr) {
+        size_t buffer_size =
+            (std::max(options.buffer_size, block_size) + block_size - 1) &
+            ~(block_size - 1);
+        own_pool = std::make_unique<AlignedBufferPool>(
+            buffer_size, std::max(block_size, kPageSize),
+            options.max_free_buffers, options.numa);
+        pool = own_pool.get();
+    } else if (pool->alignment() % block_size != 0 ||
+               pool->buffer_size() % block_size != 0 ||
+               pool->buffer_size() == 0) {
+        return absl::InvalidArgumentError(absl::StrFormat(
+            "pool alignment %d and buffer size %d must be multiples of the "
+            "block size %d",
+            pool->alignment(), pool->buffer_size(), block_size));
+    }
+
+    struct stat st;
+    if (fstat(file->fd(), &st) != 0) {
+        return utils::ErrnoToStatus(errno);
+    }
+    return std::unique_ptr<DirectFile>(new DirectFile(
+        std::move(file), block_size, st.st_size, std::move(own_pool), pool));
+}
+
+absl::StatusOr<std::string> DirectFile::PRead(size_t count, off_t offset) {
+    std::string out;
+    RETURN_IF_ERROR(PReadTo(out, count, offset));
+    return out;
+}
+
+absl::Status DirectFile::PReadTo(std::string& out, size_t count,
+                                 off_t offset) {
+    utils::TraceSpan span("DirectFile::PRead");
+    out.clear();
+    if (count == 0) {
+        return absl::OkStatus();
+    }
+    out.reserve(count);
+
+    const off_t end = offset + count;
+    const off_t aligned_end = AlignUp(end);
+    AlignedBuffer buffer = pool_->Acquire();
+    for (off_t pos = AlignDown(offset); pos < aligned_end;) {
+        size_t chunk = std::min<size_t>(buffer.size(), aligned_end - pos);
+        ASSIGN_OR_RETURN(size_t n, ReadFully(buffer.data(), chunk, pos));
+        off_t from = std::max(offset, pos);
+        off_t to = std::min<off_t>(end, pos + n);
+        if (from < to) {
+            out.append(reinterpret_cast<const char*>(buffer.data()) +
+                           (from - pos),
+                       to - from);
+        }
+        if (n < chunk) {
+            break;
+        }
+        pos += chunk;
+    }
+    return absl::OkStatus();
+}
+
+absl::Status DirectFile::PReadBatch(absl::Span<const ReadRequest> requests) {
+    std::vector<size_t> order(requests.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return requests[a].offset < requests[b].offset;
+    });
+
+    AlignedBuffer buffer = pool_->Acquire();
+    // Reads the aligned range [start, end) once and serves the requests of
+    // `order[first, last)` from it.
+    auto read_group = [&](size_t first, size_t last, off_t start,
+                          off_t end) -> absl::Status {
+        utils::TraceSpan span("DirectFile::PRead");
+        ASSIGN_OR_RETURN(size_t n, ReadFully(buffer.data(), end - start,
+                                             start));
+        for (size_t i = first; i < last; i++) {
+            const ReadRequest& request = requests[order[i]];
+            request.out->clear();
+            off_t to = std::min<off_t>(request.offset + request.count,
+                                       start + n);
+            if (request.offset < to) {
+                request.out->assign(
+                    reinterpret_cast<const char*>(buffer.data()) +
+                        (request.offset - start),
+                    to - request.offset);
+            }
+        }
+        return absl::OkStatus();
+    };
+
+    const off_t max_group = buffer.size();
+    size_t first = 0;
+    off_t group_start = 0;
+    off_t group_end = 0;
+    for (size_t i = 0; i < order.size(); i++) {
+        const ReadRequest& request = requests[order[i]];
+        off_t start = AlignDown(request.offset);
+        off_t end = AlignUp(request.offset + request.count);
+        if (i > first && start <= group_end &&
+            std::max(group_end, end) - group_start <= max_group) {
+            group_end = std::max(group_end, end);
+            continue;
+        }
+        if (i > first) {
+            RETURN_IF_ERROR(read_group(first, i, group_start, group_end));
+        }
+        if (end - start > max_group) {
+            // Larger than a buffer, read on its own in chunks.
+            RETURN_IF_ERROR(
+                PReadTo(*request.out, request.count, request.offset));
+            first = i + 1;
+            continue;
+        }
+        first = i;
+        group_start = start;
+        group_end = end;
+    }
+    if (first < order.size()) {
+        RETURN_IF_ERROR(
+            read_group(first, order.size(), group_start, group_end));
+    }
+    return absl::OkStatus();
+}
+
+absl::Status DirectFile::PWrite(absl::string_view data, off_t offset) {
+    utils::TraceSpan span("DirectFile::PWrite");
+    if (data.empty()) {
+        return absl::OkStatus();
+    }
+
+    const off_t end = offset + data.size();
+    const off_t aligned_start = AlignDown(offset);
+    const off_t aligned_end = AlignUp(end);
+    ReserveEnd(end);
+    AlignedBuffer buffer = pool_->Acquire();
+    for (off_t pos = aligned_start; pos < aligned_end;) {
+        size_t chunk = std::min<size_t>(buffer.size(), aligned_end - pos);
+        // Partial blocks keep the bytes around the written range, those
+        // past eof read as zeros.
+        if (pos == aligned_start && offset != aligned_start) {
+            ASSIGN_OR_RETURN(size_t n,
+                             ReadFully(buffer.data(), block_size_, pos));
+            memset(buffer.data() + n, 0, block_size_ - n);
+        }
+        const off_t tail = aligned_end - block_size_;
+        if (pos + static_cast<off_t>(chunk) == aligned_end &&
+            end != aligned_end &&
+            (tail != aligned_start || offset == aligned_start)) {
+            uint8_t* block = buffer.data() + (tail - pos);
+            ASSIGN_OR_RETURN(size_t n, ReadFully(block, block_size_, tail));
+            memset(block + n, 0, block_size_ - n);
+        }
+        off_t from = std::max(offset, pos);
+        off_t to = std::min<off_t>(end, pos + chunk);
+        memcpy(buffer.data() + (from - pos), data.data() + (from - offset),
+               to - from);
+        RETURN_IF_ERROR(WriteFully(buffer.data(), chunk, pos));
+        pos += chunk;
+    }
+
+    return FinishWrite(end, aligned_end);
+}
+
+absl::StatusOr<size_t> DirectFile::PReadAligned(uint8_t* data, size_t count,
+                                                off_t offset) {
+    if (!IsAligned(reinterpret_cast<uintptr_t>(data)) || !IsAligned(count) ||
+        !IsAligned(offset)) {
+        return absl::InvalidArgumentError(absl::StrFormat(
+            "direct IO must be aligned to %d bytes", block_size_));
+    }
+    utils::TraceSpan span("DirectFile::PRead");
+    return ReadFully(data, count, offset);
+}
+
+absl::Status DirectFile::PWriteAligned(const uint8_t* data, size_t count,
+                                       off_t offset) {
+    if (!IsAligned(reinterpret_cast<uintptr_t>(data)) || !IsAligned(count) ||
+        !IsAligned(offset)) {
+        return absl::InvalidArgumentError(absl::StrFormat(
+            "direct IO must be aligned to %d bytes", block_size_));
+    }
+    utils::TraceSpan span("DirectFile::PWrite");
+    ReserveEnd(offset + count);
+    RETURN_IF_ERROR(WriteFully(data, count, offset));
+    RETURN_IF_ERROR(FinishWrite(offset + count, offset + count));
+    return absl::OkStatus();
+}
+
+absl::StatusOr<size_t> DirectFile::ReadFully(uint8_t* data, size_t count,
+                                             off_t offset) {
+    size_t done = 0;
+    // A read stopping off a block boundary reached eof, and the next one
+    // would be misaligned.
+    while (done < count && IsAligned(done)) {
+        ssize_t n = pread(file_->fd(), data + done, count - done,
+                          offset + done);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return utils::ErrnoToStatus(errno);
+        }
+        if (n == 0) {
+            break;
+        }
+        done += n;
+    }
+    return done;
+}
+
+absl::Status DirectFile::WriteFully(const uint8_t* data, size_t count,
+                                    off_t offset) {
+    size_t done = 0;
+    while (done < count) {
+        ssize_t n = pwrite(file_->fd(), data + done, count - done,
+                           offset + done);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return utils::ErrnoToStatus(errno);
+        }
+        done += n;
+    }
+    return absl::OkStatus();
+}
+
+void DirectFile::ReserveEnd(off_t end) {
+    absl::MutexLock lock(&size_mu_);
+    reserved_end_ = std::max(reserved_end_, end);
+}
+
+absl::Status DirectFile::FinishWrite(off_t end, off_t aligned_end) {
+    absl::MutexLock lock(&size_mu_);
+    // The last block went past the end of the data, cut the zeros. The
+    // blocks of the other writes stay below `reserved_end_`.
+    if (aligned_end > reserved_end_ &&
+        ftruncate(file_->fd(), reserved_end_) != 0) {
+        return utils::ErrnoToStatus(errno);
+    }
+    if (end > size_.load(std::memory_order_relaxed)) {
+        size_.store(end, std::memory_order_release);
+    }
+    return absl::OkStatus();
+}
+
+}  // namespace file
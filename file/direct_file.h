@@ -0,0 +1,217 @@
+#ifndef TOOLBASE_FILE_DIRECT_FILE_H_
+#define TOOLBASE_FILE_DIRECT_FILE_H_
+
+#include <sys/types.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "file/file.h"
+#include "utils/numa.h"
+
+namespace file {
+
+class AlignedBufferPool;
+
+// A buffer aligned for O_DIRECT IO, which goes back to its pool when
+// destroyed. Move-only.
+class AlignedBuffer {
+   public:
+    AlignedBuffer() = default;
+    ~AlignedBuffer() { Release(); }
+
+    AlignedBuffer(AlignedBuffer&& other);
+    AlignedBuffer& operator=(AlignedBuffer&& other);
+
+    AlignedBuffer(const AlignedBuffer&) = delete;
+    AlignedBuffer& operator=(const AlignedBuffer&) = delete;
+
+    explicit operator bool() const { return data_ != nullptr; }
+    uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+
+    // Returns the buffer to the pool, the buffer becomes empty.
+    void Release();
+
+   private:
+    friend class AlignedBufferPool;
+    AlignedBuffer(AlignedBufferPool* pool, uint8_t* data, size_t size)
+        : pool_(pool), data_(data), size_(size) {}
+
+    AlignedBufferPool* pool_ = nullptr;
+    uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// Recycles buffers of `buffer_size` bytes aligned to `alignment`, so that
+// direct IO does not pay an aligned allocation and the page faults of fresh
+// memory per call. Thread-safe, the pool should outlive its buffers.
+class AlignedBufferPool {
+   public:
+    // `alignment` should be a power of two, `buffer_size` a multiple of it.
+    // At most `max_free_buffers` released buffers are kept. With a `numa`
+    // node, the buffers are mapped on it, e.g. the node of the loop filling
+    // them, and are page aligned: `alignment` should not exceed the page
+    // size.
+    AlignedBufferPool(size_t buffer_size, size_t alignment,
+                      int max_free_buffers,
+                      const utils::NumaPolicy& numa = utils::NumaPolicy());
+    ~AlignedBufferPool();
+
+    AlignedBufferPool(const AlignedBufferPool&) = delete;
+    AlignedBufferPool& operator=(const AlignedBufferPool&) = delete;
+
+    AlignedBuffer Acquire();
+
+    size_t buffer_size() const { return buffer_size_; }
+    size_t alignment() const { return alignment_; }
+
+   private:
+    friend class AlignedBuffer;
+    void Release(uint8_t* data);
+    // Gives back a buffer allocated by `Acquire`.
+    void Free(uint8_t* data);
+    // The whole pages of a buffer mapped on the NUMA node.
+    size_t MappedSize() const;
+
+    const size_t buffer_size_;
+    const size_t alignment_;
+    const int max_free_buffers_;
+    const utils::NumaPolicy numa_;
+    absl::Mutex mu_;
+    std::vector<uint8_t*> free_buffers_ ABSL_GUARDED_BY(mu_);
+};
+
+// A file opened with O_DIRECT, so that its IO bypasses the page cache: no
+// double caching under an application cache and no writeback stalls, at
+// the cost of the alignment rules of direct IO. Offsets, lengths and memory
+// must be multiples of the logical block size of the device, which is
+// queried at open.
+//
+// `PRead`/`PWrite` accept any offset and length, they go through the
+// aligned buffers of a pool and read-modify-write the partial blocks at the
+// head and the tail of a write. `PReadAligned`/`PWriteAligned` skip the
+// copy for callers with aligned buffers, e.g. from `pool()`.
+//
+// Reads are thread-safe, so are writes to different blocks. Writes sharing
+// a block must not run concurrently.
+// Example:
+//  ASSIGN_OR_RETURN(auto file, file::DirectFile::Open(
+//                                  "/data/table", O_RDWR | O_CREAT, 0644,
+//                                  file::DirectFile::Options()));
+//  RETURN_IF_ERROR(file->PWrite(record, offset));
+//  ASSIGN_OR_RETURN(std::string data, file->PRead(record.size(), offset));
+class DirectFile {
+   public:
+    struct Options {
+        // Size of the buffers of the own pool, the most bytes moved per
+        // syscall.
+        size_t buffer_size = 1 << 20;
+        int max_free_buffers = 8;
+        // Not owned, nullptr creates an own pool. The alignment and buffer
+        // size of a shared pool should be multiples of the block size.
+        AlignedBufferPool* pool = nullptr;
+        // Placement of the buffers of the own pool.
+        utils::NumaPolicy numa;
+    };
+
+    struct ReadRequest {
+        off_t offset;
+        size_t count;
+        // Receives the data read, shorter than `count` at eof.
+        std::string* out;
+    };
+
+    // Opens `path` with O_DIRECT added to `flags`. Fails with
+    // InvalidArgument if the file system does not support direct IO.
+    static absl::StatusOr<std::unique_ptr<DirectFile>> Open(
+        absl::string_view path, int flags);
+    static absl::StatusOr<std::unique_ptr<DirectFile>> Open(
+        absl::string_view path, int flags, mode_t mode,
+        const Options& options);
+
+    // The alignment of the offsets, lengths and memory of direct IO.
+    size_t block_size() const { return block_size_; }
+    // The file size, as changed by this object.
+    off_t size() const { return size_.load(std::memory_order_acquire); }
+    File* file() { return file_.get(); }
+    AlignedBufferPool* pool() { return pool_; }
+
+    // Reads up to `count` bytes at `offset`, returns fewer at eof.
+    absl::StatusOr<std::string> PRead(size_t count, off_t offset);
+    absl::Status PReadTo(std::string& out, size_t count, off_t offset);
+
+    // Serves `requests` with as few reads as possible: requests whose
+    // blocks are adjacent or overlap are read together, up to the buffer
+    // size.
+    absl::Status PReadBatch(absl::Span<const ReadRequest> requests);
+
+    // Writes all of `data` at `offset`, extending the file if needed.
+    absl::Status PWrite(absl::string_view data, off_t offset);
+
+    // Direct IO without copy, `data`, `count` and `offset` must be aligned
+    // to `block_size()`. `PReadAligned` returns fewer bytes at eof.
+    absl::StatusOr<size_t> PReadAligned(uint8_t* data, size_t count,
+                                        off_t offset);
+    absl::Status PWriteAligned(const uint8_t* data, size_t count,
+                               off_t offset);
+
+    absl::Status DataSync() { return file_->DataSync(); }
+
+   private:
+    DirectFile(std::unique_ptr<File> file, size_t block_size, off_t size,
+               std::unique_ptr<AlignedBufferPool> own_pool,
+               AlignedBufferPool* pool)
+        : file_(std::move(file)),
+          block_size_(block_size),
+          size_(size),
+          reserved_end_(size),
+          own_pool_(std::move(own_pool)),
+          pool_(pool) {}
+
+    off_t AlignDown(off_t offset) const {
+        return offset & ~static_cast<off_t>(block_size_ - 1);
+    }
+    off_t AlignUp(off_t offset) const {
+        return AlignDown(offset + block_size_ - 1);
+    }
+    bool IsAligned(uint64_t value) const {
+        return (value & (block_size_ - 1)) == 0;
+    }
+
+    // Reads the aligned range [offset, offset + count) into `data`, retries
+    // short reads until eof. Returns the bytes read.
+    absl::StatusOr<size_t> ReadFully(uint8_t* data, size_t count,
+                                     off_t offset);
+    absl::Status WriteFully(const uint8_t* data, size_t count, off_t offset);
+    // Called before a write ending at `end`, so that the concurrent writes
+    // do not cut it when they truncate their padding.
+    void ReserveEnd(off_t end);
+    // Called after a write of [.., end) whose blocks went up to
+    // `aligned_end`: cuts the padding past the reserved ends and grows
+    // `size_` to `end`.
+    absl::Status FinishWrite(off_t end, off_t aligned_end);
+
+    std::unique_ptr<File> file_;
+    const size_t block_size_;
+    std::atomic<off_t> size_;
+    absl::Mutex size_mu_;
+    // The end of the file once the writes started so far are done.
+    off_t reserved_end_ ABSL_GUARDED_BY(size_mu_);
+    std::unique_ptr<AlignedBufferPool> own_pool_;
+    AlignedBufferPool* pool_;
+};
+
+}  // namespace file
+
+#endif  // TOOLBASE_FILE_DIRECT_FILE_H_
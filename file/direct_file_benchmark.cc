@@ -0,0 +1,140 @@
+#include <fcntl.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "file/direct_file.h"
+#include "file/file.h"
+#include "file/filesystem.h"
+
+namespace file {
+namespace {
+
+constexpr char kFile[] = "/tmp/direct_file_benchmark";
+constexpr size_t kFileSize = 64 << 20;
+
+std::unique_ptr<DirectFile> OpenDirectFile(benchmark::State& state) {
+    if (!PutContents(std::string(kFileSize, 'x'), kFile).ok()) {
+        state.SkipWithError("cannot create the file");
+        return nullptr;
+    }
+    auto file = DirectFile::Open(kFile, O_RDWR);
+    if (!file.ok()) {
+        state.SkipWithError("no direct IO on /tmp");
+        return nullptr;
+    }
+    return *std::move(file);
+}
+
+// Random reads of `range(0)` bytes at offsets aligned when `range(1)` is
+// set, which need no head and tail blocks.
+void BM_DirectPRead(benchmark::State& state) {
+    const size_t size = state.range(0);
+    const bool aligned = state.range(1);
+    auto file = OpenDirectFile(state);
+    if (!file) {
+        return;
+    }
+    std::mt19937_64 rng(42);
+    std::uniform_int_distribution<off_t> offsets(0, kFileSize - size - 1);
+    std::string buf;
+    for (auto _ : state) {
+        off_t offset = offsets(rng);
+        if (aligned) {
+            offset &= ~static_cast<off_t>(file->block_size() - 1);
+        }
+        if (!file->PReadTo(buf, size, offset).ok()) {
+            state.SkipWithError("read failed");
+            break;
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * size);
+    Unlink(kFile).IgnoreError();
+}
+BENCHMARK(BM_DirectPRead)
+    ->ArgsProduct({benchmark::CreateRange(512, 1 << 20, 8), {0, 1}});
+
+// The same reads through the page cache, for reference.
+void BM_BufferedPRead(benchmark::State& state) {
+    const size_t size = state.range(0);
+    if (!PutContents(std::string(kFileSize, 'x'), kFile).ok()) {
+        state.SkipWithError("cannot create the file");
+        return;
+    }
+    auto file = *File::Open(kFile, O_RDONLY);
+    std::mt19937_64 rng(42);
+    std::uniform_int_distribution<off_t> offsets(0, kFileSize - size - 1);
+    std::string buf;
+    for (auto _ : state) {
+        if (!file->PReadTo(buf, size, offsets(rng)).ok()) {
+            state.SkipWithError("read failed");
+            break;
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * size);
+    Unlink(kFile).IgnoreError();
+}
+BENCHMARK(BM_BufferedPRead)->RangeMultiplier(8)->Range(512, 1 << 20);
+
+// Unaligned writes of `range(0)` bytes, each pays the read of its head and
+// tail blocks.
+void BM_DirectPWrite(benchmark::State& state) {
+    const size_t size = state.range(0);
+    auto file = OpenDirectFile(state);
+    if (!file) {
+        return;
+    }
+    std::mt19937_64 rng(42);
+    std::uniform_int_distribution<off_t> offsets(0, kFileSize - size - 1);
+    const std::string data(size, 'y');
+    for (auto _ : state) {
+        if (!file->PWrite(data, offsets(rng)).ok()) {
+            state.SkipWithError("write failed");
+            break;
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * size);
+    Unlink(kFile).IgnoreError();
+}
+BENCHMARK(BM_DirectPWrite)->RangeMultiplier(8)->Range(512, 1 << 20);
+
+// 64 records of 100 bytes within 64KB, read one by one when `range(0)` is
+// 0, or as a batch coalesced into one read.
+void BM_PReadBatch(benchmark::State& state) {
+    const bool batch = state.range(0);
+    auto file = OpenDirectFile(state);
+    if (!file) {
+        return;
+    }
+    std::mt19937_64 rng(42);
+    std::uniform_int_distribution<off_t> bases(0, kFileSize - (1 << 16));
+    std::vector<std::string> outs(64);
+    std::vector<DirectFile::ReadRequest> requests(64);
+    for (auto _ : state) {
+        off_t base = bases(rng);
+        for (size_t i = 0; i < requests.size(); i++) {
+            requests[i] = {base + static_cast<off_t>(i * 1000), 100, &outs[i]};
+        }
+        absl::Status status;
+        if (batch) {
+            status = file->PReadBatch(requests);
+        } else {
+            for (const auto& request : requests) {
+                status.Update(file->PReadTo(*request.out, request.count,
+                                            request.offset));
+            }
+        }
+        if (!status.ok()) {
+            state.SkipWithError("read failed");
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * requests.size());
+    Unlink(kFile).IgnoreError();
+}
+BENCHMARK(BM_PReadBatch)->Arg(0)->Arg(1);
+
+}  // namespace
+}  // namespace file
@@ -0,0 +1,257 @@
+#include "file/direct_file.h"
+
+#include <fcntl.h>
+#include <string.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "file/filesystem.h"
+#include "gtest/gtest.h"
+#include "utils/testing.h"
+
+namespace file {
+namespace {
+
+using ::utils::testing::IsOkAndHolds;
+using ::utils::testing::StatusIs;
+
+static constexpr absl::string_view kFile = "/tmp/test_direct_file";
+
+std::string Pattern(size_t size, char seed) {
+    std::string data(size, 0);
+    for (size_t i = 0; i < size; i++) {
+        data[i] = static_cast<char>(seed + i * 7);
+    }
+    return data;
+}
+
+class DirectFile : public ::testing::Test {
+   protected:
+    void SetUp() override {
+        if (*Exists(kFile)) {
+            ASSERT_OK(Unlink(kFile));
+        }
+    }
+    void TearDown() override {
+        if (*Exists(kFile)) {
+            ASSERT_OK(Unlink(kFile));
+        }
+    }
+
+    std::unique_ptr<file::DirectFile> Open(
+        file::DirectFile::Options options = file::DirectFile::Options()) {
+        auto file = file::DirectFile::Open(kFile, O_RDWR | O_CREAT, 0644,
+                                           options);
+        if (absl::IsInvalidArgument(file.status())) {
+            // e.g. tmpfs.
+            return nullptr;
+        }
+        EXPECT_OK(file);
+        return *std::move(file);
+    }
+};
+
+TEST_F(DirectFile, BlockSize) {
+    auto file = Open();
+    if (file == nullptr) {
+        GTEST_SKIP() << "no direct IO on /tmp";
+    }
+    EXPECT_GE(file->block_size(), 512);
+    EXPECT_EQ(file->block_size() & (file->block_size() - 1), 0);
+    EXPECT_EQ(file->size(), 0);
+}
+
+TEST_F(DirectFile, UnalignedRoundTrip) {
+    auto file = Open();
+    if (file == nullptr) {
+        GTEST_SKIP() << "no direct IO on /tmp";
+    }
+    std::string data = Pattern(10000, 'a');
+    ASSERT_OK(file->PWrite(data, 123));
+    EXPECT_EQ(file->size(), 10123);
+    EXPECT_EQ(Stat(kFile)->size(), 10123);
+
+    EXPECT_THAT(file->PRead(10000, 123), IsOkAndHolds(data));
+    EXPECT_THAT(file->PRead(5, 130), IsOkAndHolds(data.substr(7, 5)));
+    EXPECT_THAT(file->PRead(123, 0), IsOkAndHolds(std::string(123, 0)));
+    // Short at eof, empty past it.
+    EXPECT_THAT(file->PRead(100, 10100),
+                IsOkAndHolds(data.substr(10100 - 123)));
+    EXPECT_THAT(file->PRead(100, 20000), IsOkAndHolds(""));
+}
+
+TEST_F(DirectFile, HeadAndTailFixUp) {
+    auto file = Open();
+    if (file == nullptr) {
+        GTEST_SKIP() << "no direct IO on /tmp";
+    }
+    std::string data = Pattern(3 * file->block_size(), 'x');
+    ASSERT_OK(file->PWrite(data, 0));
+
+    // Within one block, then across the boundary of two.
+    ASSERT_OK(file->PWrite("hello", 10));
+    data.replace(10, 5, "hello");
+    const off_t boundary = file->block_size();
+    ASSERT_OK(file->PWrite("world!", boundary - 3));
+    data.replace(boundary - 3, 6, "world!");
+
+    EXPECT_EQ(file->size(), data.size());
+    EXPECT_THAT(file->PRead(data.size(), 0), IsOkAndHolds(data));
+}
+
+TEST_F(DirectFile, UnalignedAppend) {
+    auto file = Open();
+    if (file == nullptr) {
+        GTEST_SKIP() << "no direct IO on /tmp";
+    }
+    std::string expected;
+    for (int i = 0; i < 20; i++) {
+        std::string record = Pattern(100 + i * 37, 'a' + i);
+        ASSERT_OK(file->PWrite(record, file->size()));
+        expected += record;
+        ASSERT_EQ(file->size(), expected.size());
+    }
+    EXPECT_EQ(Stat(kFile)->size(), expected.size());
+    EXPECT_THAT(file->PRead(expected.size() + 10, 0),
+                IsOkAndHolds(expected));
+}
+
+TEST_F(DirectFile, ConcurrentWriters) {
+    auto file = Open();
+    if (file == nullptr) {
+        GTEST_SKIP() << "no direct IO on /tmp";
+    }
+    // A small write at the head truncates its padding while the other
+    // thread extends the file.
+    const std::string tail = Pattern(4096, 't');
+    std::thread head_writer([&]() {
+        for (int i = 0; i < 50; i++) {
+            EXPECT_OK(file->PWrite("hello", 0));
+        }
+    });
+    std::thread tail_writer([&]() { EXPECT_OK(file->PWrite(tail, 65536)); });
+    head_writer.join();
+    tail_writer.join();
+
+    EXPECT_EQ(file->size(), 65536 + 4096);
+    EXPECT_EQ(Stat(kFile)->size(), 65536 + 4096);
+    EXPECT_THAT(file->PRead(5, 0), IsOkAndHolds("hello"));
+    EXPECT_THAT(file->PRead(4096, 65536), IsOkAndHolds(tail));
+}
+
+TEST_F(DirectFile, SmallBuffers) {
+    file::DirectFile::Options options;
+    options.buffer_size = 1;
+    auto file = Open(options);
+    if (file == nullptr) {
+        GTEST_SKIP() << "no direct IO on /tmp";
+    }
+    // Rounded up to a block, the IO goes block by block.
+    EXPECT_EQ(file->pool()->buffer_size(), file->block_size());
+    std::string data = Pattern(5 * file->block_size() + 17, 'q');
+    ASSERT_OK(file->PWrite(data, 31));
+    EXPECT_THAT(file->PRead(data.size(), 31), IsOkAndHolds(data));
+}
+
+TEST_F(DirectFile, PReadBatch) {
+    auto file = Open();
+    if (file == nullptr) {
+        GTEST_SKIP() << "no direct IO on /tmp";
+    }
+    std::string data = Pattern(64 * 1024, 'b');
+    ASSERT_OK(file->PWrite(data, 0));
+
+    std::vector<std::pair<off_t, size_t>> ranges = {
+        {50000, 100}, {10, 20}, {25, 4000}, {60000, 10000}, {0, 0},
+        {8191, 2},    {70000, 5}};
+    std::vector<std::string> outs(ranges.size(), "garbage");
+    std::vector<file::DirectFile::ReadRequest> requests;
+    for (size_t i = 0; i < ranges.size(); i++) {
+        requests.push_back({ranges[i].first, ranges[i].second, &outs[i]});
+    }
+    ASSERT_OK(file->PReadBatch(requests));
+    for (size_t i = 0; i < ranges.size(); i++) {
+        std::string expected =
+            ranges[i].first < static_cast<off_t>(data.size())
+                ? data.substr(ranges[i].first, ranges[i].second)
+                : "";
+        EXPECT_EQ(outs[i], expected) << i;
+    }
+}
+
+TEST_F(DirectFile, AlignedIO) {
+    auto file = Open();
+    if (file == nullptr) {
+        GTEST_SKIP() << "no direct IO on /tmp";
+    }
+    const size_t block_size = file->block_size();
+    AlignedBuffer buffer = file->pool()->Acquire();
+    memset(buffer.data(), 'z', 2 * block_size);
+    ASSERT_OK(file->PWriteAligned(buffer.data(), 2 * block_size, 0));
+    EXPECT_EQ(file->size(), 2 * block_size);
+
+    memset(buffer.data(), 0, 2 * block_size);
+    EXPECT_THAT(file->PReadAligned(buffer.data(), 4 * block_size, 0),
+                IsOkAndHolds(2 * block_size));
+    EXPECT_EQ(std::string(reinterpret_cast<char*>(buffer.data()),
+                          2 * block_size),
+              std::string(2 * block_size, 'z'));
+
+    EXPECT_THAT(file->PWriteAligned(buffer.data() + 1, block_size, 0),
+                StatusIs(absl::StatusCode::kInvalidArgument));
+    EXPECT_THAT(file->PWriteAligned(buffer.data(), block_size - 1, 0),
+                StatusIs(absl::StatusCode::kInvalidArgument));
+    EXPECT_THAT(file->PReadAligned(buffer.data(), block_size, 1),
+                StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST(AlignedBufferPool, Reuse) {
+    AlignedBufferPool pool(8192, 4096, 1);
+    AlignedBuffer first = pool.Acquire();
+    ASSERT_TRUE(first);
+    EXPECT_EQ(first.size(), 8192);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(first.data()) % 4096, 0);
+    uint8_t* data = first.data();
+    first.Release();
+    EXPECT_FALSE(first);
+
+    AlignedBuffer second = pool.Acquire();
+    EXPECT_EQ(second.data(), data);
+    AlignedBuffer third = pool.Acquire();
+    EXPECT_NE(third.data(), data);
+
+    AlignedBuffer moved = std::move(second);
+    EXPECT_FALSE(second);
+    EXPECT_EQ(moved.data(), data);
+}
+
+TEST(AlignedBufferPool, OnNumaNode) {
+    const int node = utils::Numa::Get().nodes()[0].id;
+    AlignedBufferPool pool(1000, 512, 1, utils::NumaPolicy::OnNode(node));
+    AlignedBuffer first = pool.Acquire();
+    AlignedBuffer second = pool.Acquire();
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(first.data()) % 4096, 0);
+    memset(first.data(), 'x', first.size());
+    uint8_t* data = first.data();
+    // Kept, then unmapped by the pool.
+    first.Release();
+    second.Release();
+    AlignedBuffer reused = pool.Acquire();
+    EXPECT_EQ(reused.data(), data);
+    EXPECT_EQ(reused.data()[999], 'x');
+}
+
+TEST(AlignedBufferPool, SharedPoolMustBeAligned) {
+    AlignedBufferPool pool(1000, 8, 1);
+    file::DirectFile::Options options;
+    options.pool = &pool;
+    auto file = file::DirectFile::Open(kFile, O_RDWR | O_CREAT, 0644,
+                                       options);
+    EXPECT_THAT(file, StatusIs(absl::StatusCode::kInvalidArgument));
+    Unlink(kFile).IgnoreError();
+}
+
+}  // namespace
+}  // namespace file
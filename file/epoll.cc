@@ -1,13 +1,25 @@
 #include "file/epoll.h"
 
 #include "absl/strings/str_format.h"
+#include "utils/errno_status.h"
+#include "utils/metrics.h"
+#include "utils/trace.h"
 
 namespace file {
+namespace {
+
+utils::LatencyHistogram* const wait_latency =
+    utils::MetricsRegistry::Global().GetHistogram(
+        "epoll_wait_latency_seconds", "Time blocked in EPoll::Wait.");
+utils::Counter* const wait_events = utils::MetricsRegistry::Global().GetCounter(
+    "epoll_events_total", "Events returned by EPoll::Wait.");
+
+}  // namespace
 
 absl::StatusOr<std::unique_ptr<EPoll>> EPoll::Create() {
     int efd = epoll_create1(0);
     if (efd < 0) {
-        return absl::InternalError(strerror(errno));
+        return utils::ErrnoToStatus(errno);
     }
 
     return std::unique_ptr<EPoll>(new EPoll(efd));
@@ -18,7 +30,7 @@ absl::Status EPoll::Close() {
         efd_ = -1;
         return absl::OkStatus();
     }
-    return absl::InternalError(strerror(errno));
+    return utils::ErrnoToStatus(errno);
 }
 
 absl::Status EPoll::Add(File* file, uint32_t events, void* ptr) {
@@ -31,7 +43,7 @@ absl::Status EPoll::Add(File* file, uint32_t events, void* ptr) {
     event.data.fd = file->fd();
     int ret = epoll_ctl(efd_, EPOLL_CTL_ADD, file->fd(), &event);
     if (ret != 0) {
-        return absl::InternalError(strerror(errno));
+        return utils::ErrnoToStatus(errno);
     }
 
     fd2file_[file->fd()] = file;
@@ -50,7 +62,7 @@ absl::Status EPoll::Modify(File* file, uint32_t events, void* ptr) {
     event.data.fd = file->fd();
     int ret = epoll_ctl(efd_, EPOLL_CTL_MOD, file->fd(), &event);
     if (ret != 0) {
-        return absl::InternalError(strerror(errno));
+        return utils::ErrnoToStatus(errno);
     }
 
     fd2file_[file->fd()] = file;
@@ -74,7 +86,7 @@ absl::Status EPoll::Delete(File* file) {
     }
     int ret = epoll_ctl(efd_, EPOLL_CTL_DEL, file->fd(), NULL);
     if (ret != 0) {
-        return absl::InternalError(strerror(errno));
+        return utils::ErrnoToStatus(errno);
     }
     fd2file_.erase(file->fd());
     fd2ptr_.erase(file->fd());
@@ -101,10 +113,16 @@ absl::StatusOr<std::vector<EPollEvent>> EPoll::Wait(
         timeout_ms = absl::ToInt64Milliseconds(*timeout);
     }
 
-    int ret = epoll_wait(efd_, events.data(), maxevents, timeout_ms);
+    int ret;
+    {
+        utils::TraceSpan span("EPoll::Wait");
+        utils::ScopedLatency latency(wait_latency);
+        ret = epoll_wait(efd_, events.data(), maxevents, timeout_ms);
+    }
     if (ret < 0) {
-        return absl::InternalError(strerror(errno));
+        return utils::ErrnoToStatus(errno);
     }
+    wait_events->Add(ret);
 
     std::vector<EPollEvent> return_events;
     for (int i = 0; i < ret; i++) {
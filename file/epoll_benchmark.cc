@@ -0,0 +1,100 @@
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/time/time.h"
+#include "benchmark/benchmark.h"
+#include "file/epoll.h"
+#include "file/file.h"
+
+namespace file {
+namespace {
+
+// Pipes whose read ends are watched by an EPoll.
+struct Pipes {
+    std::vector<std::unique_ptr<File>> read_ends;
+    std::vector<std::unique_ptr<File>> write_ends;
+};
+
+Pipes CreatePipes(int count) {
+    Pipes pipes;
+    for (int i = 0; i < count; i++) {
+        int fds[2];
+        if (pipe2(fds, O_NONBLOCK | O_CLOEXEC) != 0) {
+            break;
+        }
+        pipes.read_ends.push_back(std::make_unique<File>(fds[0]));
+        pipes.write_ends.push_back(std::make_unique<File>(fds[1]));
+    }
+    return pipes;
+}
+
+// Waits on `range(0)` registered fds of which `range(1)` are readable.
+void BM_Wait(benchmark::State& state) {
+    const int num_fds = state.range(0);
+    const int num_ready = state.range(1);
+    auto epoll = *EPoll::Create();
+    Pipes pipes = CreatePipes(num_fds);
+    if ((int)pipes.read_ends.size() < num_fds) {
+        state.SkipWithError("cannot create the pipes");
+        return;
+    }
+    for (auto& file : pipes.read_ends) {
+        epoll->Add(file.get(), EPOLLIN).IgnoreError();
+    }
+    for (int i = 0; i < num_ready; i++) {
+        pipes.write_ends[i * num_fds / num_ready]->Write("x").IgnoreError();
+    }
+
+    const absl::Duration timeout = absl::ZeroDuration();
+    for (auto _ : state) {
+        auto events = epoll->Wait(num_ready, &timeout);
+        if (!events.ok() || (int)events->size() != num_ready) {
+            state.SkipWithError("unexpected events");
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * num_ready);
+}
+BENCHMARK(BM_Wait)->ArgsProduct({{16, 256, 4096}, {1, 16}});
+
+// Wakes up a thread blocked in `Wait` through a pipe and waits for its
+// answer, the latency of a cross thread wakeup.
+void BM_WakeupRoundTrip(benchmark::State& state) {
+    Pipes pipes = CreatePipes(2);
+    if (pipes.read_ends.size() < 2) {
+        state.SkipWithError("cannot create the pipes");
+        return;
+    }
+    auto ping_epoll = *EPoll::Create();
+    auto pong_epoll = *EPoll::Create();
+    ping_epoll->Add(pipes.read_ends[0].get(), EPOLLIN).IgnoreError();
+    pong_epoll->Add(pipes.read_ends[1].get(), EPOLLIN).IgnoreError();
+
+    std::thread echo([&]() {
+        std::string buf;
+        while (true) {
+            ping_epoll->Wait(1, nullptr).IgnoreError();
+            if (!pipes.read_ends[0]->ReadTo(buf, 1).ok() || buf.empty() ||
+                buf == "q") {
+                return;
+            }
+            pipes.write_ends[1]->Write("x").IgnoreError();
+        }
+    });
+    std::string buf;
+    for (auto _ : state) {
+        pipes.write_ends[0]->Write("x").IgnoreError();
+        pong_epoll->Wait(1, nullptr).IgnoreError();
+        pipes.read_ends[1]->ReadTo(buf, 1).IgnoreError();
+    }
+    pipes.write_ends[0]->Write("q").IgnoreError();
+    echo.join();
+}
+BENCHMARK(BM_WakeupRoundTrip)->UseRealTime();
+
+}  // namespace
+}  // namespace file
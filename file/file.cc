@@ -6,9 +6,29 @@
 #include <string>
 
 #include "absl/strings/str_format.h"
+#include "utils/errno_status.h"
+#include "utils/metrics.h"
 #include "utils/status_macros.h"
+#include "utils/trace.h"
 
 namespace file {
+namespace {
+
+utils::Counter* const read_bytes = utils::MetricsRegistry::Global().GetCounter(
+    "file_read_bytes_total", "Bytes read by File::Read and File::PRead.");
+utils::Counter* const write_bytes =
+    utils::MetricsRegistry::Global().GetCounter(
+        "file_write_bytes_total",
+        "Bytes written by File::Write and File::PWrite.");
+utils::Counter* const write_all_retries =
+    utils::MetricsRegistry::Global().GetCounter(
+        "file_write_all_retries_total",
+        "Short writes File::WriteAll had to complete.");
+utils::LatencyHistogram* const sync_latency =
+    utils::MetricsRegistry::Global().GetHistogram(
+        "file_sync_latency_seconds", "Latency of File::Sync and DataSync.");
+
+}  // namespace
 
 absl::StatusOr<std::unique_ptr<File>> File::Open(absl::string_view path,
                                                  int flags) {
@@ -16,7 +36,7 @@ absl::StatusOr<std::unique_ptr<File>> File::Open(absl::string_view path,
 
     int fd = open(path_str.c_str(), flags);
     if (fd < 0) {
-        return absl::InternalError(strerror(errno));
+        return utils::ErrnoToStatus(errno);
     }
 
     return std::unique_ptr<File>(new File(fd));
@@ -28,7 +48,7 @@ absl::StatusOr<std::unique_ptr<File>> File::Open(absl::string_view path,
 
     int fd = open(path_str.c_str(), flags, mode);
     if (fd < 0) {
-        return absl::InternalError(strerror(errno));
+        return utils::ErrnoToStatus(errno);
     }
 
     return std::unique_ptr<File>(new File(fd));
@@ -39,14 +59,40 @@ absl::Status File::Close() {
         fd_ = -1;
         return absl::OkStatus();
     }
-    return absl::InternalError(strerror(errno));
+    return utils::ErrnoToStatus(errno);
 }
 
 absl::Status File::Sync() {
+    utils::TraceSpan span("File::Sync");
+    utils::ScopedLatency latency(sync_latency);
     if (fsync(fd_) == 0) {
         return absl::OkStatus();
     }
-    return absl::InternalError(strerror(errno));
+    return utils::ErrnoToStatus(errno);
+}
+
+absl::Status File::DataSync() {
+    utils::TraceSpan span("File::DataSync");
+    utils::ScopedLatency latency(sync_latency);
+    if (fdatasync(fd_) == 0) {
+        return absl::OkStatus();
+    }
+    return utils::ErrnoToStatus(errno);
+}
+
+absl::Status File::Allocate(off_t offset, off_t length) {
+    if (fallocate(fd_, FALLOC_FL_KEEP_SIZE, offset, length) == 0) {
+        return absl::OkStatus();
+    }
+    return utils::ErrnoToStatus(errno);
+}
+
+void File::Charge(ssize_t ret) {
+    // The bytes moved, not the requested count: a short read of a large
+    // buffer costs what it read.
+    if (rate_limiter_ != nullptr && ret > 0) {
+        rate_limiter_->Acquire(ret);
+    }
 }
 
 absl::StatusOr<std::string> File::Read(size_t count) {
@@ -62,16 +108,19 @@ absl::Status File::ReadTo(std::string& out, size_t count) {
     }
 
     out.resize(count);
+    utils::TraceSpan span("File::Read");
     ssize_t ret = read(fd_, out.data(), count);
+    Charge(ret);
 
     if (ret == 0) {
         out = std::string();
         return absl::OkStatus();
     }
     if (ret < 0) {
-        return absl::InternalError(strerror(errno));
+        return utils::ErrnoToStatus(errno);
     }
     out.resize(ret);
+    read_bytes->Add(ret);
 
     return absl::OkStatus();
 }
@@ -93,16 +142,19 @@ absl::Status File::PReadTo(std::string& out, size_t count, off_t offset) {
     }
 
     out.resize(count);
+    utils::TraceSpan span("File::PRead");
     ssize_t ret = pread(fd_, out.data(), count, offset);
+    Charge(ret);
 
     if (ret == 0) {
         out = std::string();
         return absl::OkStatus();
     }
     if (ret < 0) {
-        return absl::InternalError(strerror(errno));
+        return utils::ErrnoToStatus(errno);
     }
     out.resize(ret);
+    read_bytes->Add(ret);
 
     return absl::OkStatus();
 }
@@ -117,10 +169,13 @@ absl::StatusOr<size_t> File::Write(const uint8_t* data, size_t count) {
             absl::StrFormat("`count` = %d which should > 0", count));
     }
 
+    utils::TraceSpan span("File::Write");
     ssize_t ret = write(fd_, data, count);
+    Charge(ret);
     if (ret < 0) {
-        return absl::InternalError(strerror(errno));
+        return utils::ErrnoToStatus(errno);
     }
+    write_bytes->Add(ret);
     return ret;
 }
 
@@ -139,10 +194,13 @@ absl::StatusOr<size_t> File::PWrite(const uint8_t* data, size_t count,
             absl::StrFormat("`offset` = %d which should >= 0", offset));
     }
 
+    utils::TraceSpan span("File::PWrite");
     ssize_t ret = pwrite(fd_, data, count, offset);
+    Charge(ret);
     if (ret < 0) {
-        return absl::InternalError(strerror(errno));
+        return utils::ErrnoToStatus(errno);
     }
+    write_bytes->Add(ret);
     return ret;
 }
 
@@ -157,6 +215,9 @@ absl::Status File::WriteAll(const uint8_t* data, size_t count) {
             return absl::InternalError("Write 0 bytes");
         }
         pos += written;
+        if (pos < count) {
+            write_all_retries->Increment();
+        }
     }
     return absl::OkStatus();
 }
@@ -164,7 +225,7 @@ absl::Status File::WriteAll(const uint8_t* data, size_t count) {
 absl::StatusOr<off_t> File::LSeek(off_t offset, int whence) {
     off_t ret = lseek(fd_, offset, whence);
     if (ret < 0) {
-        return absl::InternalError(strerror(errno));
+        return utils::ErrnoToStatus(errno);
     }
     return ret;
 }
@@ -10,6 +10,7 @@
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "glog/logging.h"
+#include "utils/rate_limiter.h"
 
 namespace file {
 
@@ -44,7 +45,21 @@ class File {
 
     absl::Status Close();
 
+    // Throttles the reads and writes, e.g. of a compaction: each call is
+    // charged the bytes it moved and blocks until the limiter admits them.
+    // `limiter` (not owned, nullptr for none) should outlive the file.
+    void set_rate_limiter(utils::RateLimiter* limiter) {
+        rate_limiter_ = limiter;
+    }
+
     absl::Status Sync();
+    // Like `Sync`, but skips the metadata not needed to read the data back,
+    // e.g. the modification time.
+    absl::Status DataSync();
+
+    // Reserves the disk blocks of [offset, offset + length) without changing
+    // the file size, so that later appends do not allocate.
+    absl::Status Allocate(off_t offset, off_t length);
 
     // Reads string from file.
     // Empty string means eof.
@@ -68,7 +83,11 @@ class File {
     absl::StatusOr<off_t> LSeek(off_t offset, int whence);
 
    protected:
+    // Charges the result of a read or write syscall to the rate limiter.
+    void Charge(ssize_t ret);
+
     int fd_;
+    utils::RateLimiter* rate_limiter_ = nullptr;
 };
 
 }  // namespace file
@@ -0,0 +1,114 @@
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "file/file.h"
+#include "file/filesystem.h"
+
+namespace file {
+namespace {
+
+constexpr char kFile[] = "/tmp/file_benchmark";
+// Large enough to not fit the CPU caches, small enough for the page cache.
+constexpr size_t kFileSize = 64 << 20;
+
+// Sequential writes of `range(0)` bytes, the file is rewritten from the
+// start every `kFileSize` bytes.
+void BM_Write(benchmark::State& state) {
+    const size_t size = state.range(0);
+    auto file = *File::Open(kFile, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    std::string data(size, 'x');
+    size_t offset = 0;
+    for (auto _ : state) {
+        if (offset + size > kFileSize) {
+            file->LSeek(0, SEEK_SET).IgnoreError();
+            offset = 0;
+        }
+        if (!file->WriteAll(data).ok()) {
+            state.SkipWithError("write failed");
+            break;
+        }
+        offset += size;
+    }
+    state.SetBytesProcessed(state.iterations() * size);
+    Unlink(kFile).IgnoreError();
+}
+BENCHMARK(BM_Write)->RangeMultiplier(4)->Range(64, 4 << 20);
+
+// Creates a file of `kFileSize` bytes to read from.
+std::unique_ptr<File> OpenFileToRead(benchmark::State& state) {
+    if (!PutContents(std::string(kFileSize, 'x'), kFile).ok()) {
+        state.SkipWithError("cannot create the file");
+        return nullptr;
+    }
+    return *File::Open(kFile, O_RDONLY);
+}
+
+// Sequential reads of `range(0)` bytes from the page cache.
+void BM_Read(benchmark::State& state) {
+    const size_t size = state.range(0);
+    auto file = OpenFileToRead(state);
+    if (!file) {
+        return;
+    }
+    std::string buf;
+    for (auto _ : state) {
+        if (!file->ReadTo(buf, size).ok()) {
+            state.SkipWithError("read failed");
+            break;
+        }
+        if (buf.size() < size) {
+            file->LSeek(0, SEEK_SET).IgnoreError();
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * size);
+    file.reset();
+    Unlink(kFile).IgnoreError();
+}
+BENCHMARK(BM_Read)->RangeMultiplier(4)->Range(64, 4 << 20);
+
+// Random reads of `range(0)` bytes from the page cache.
+void BM_PRead(benchmark::State& state) {
+    const size_t size = state.range(0);
+    auto file = OpenFileToRead(state);
+    if (!file) {
+        return;
+    }
+    std::string buf;
+    uint64_t random = 1;
+    for (auto _ : state) {
+        random = random * 6364136223846793005ull + 1442695040888963407ull;
+        off_t offset = (random >> 16) % (kFileSize - size + 1);
+        if (!file->PReadTo(buf, size, offset).ok()) {
+            state.SkipWithError("read failed");
+            break;
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * size);
+    file.reset();
+    Unlink(kFile).IgnoreError();
+}
+BENCHMARK(BM_PRead)->RangeMultiplier(4)->Range(64, 4 << 20);
+
+// Appends `range(0)` bytes then syncs, `range(1)` selects fdatasync over
+// fsync.
+void BM_WriteSync(benchmark::State& state) {
+    const size_t size = state.range(0);
+    const bool data_sync = state.range(1);
+    auto file = *File::Open(kFile, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    std::string data(size, 'x');
+    for (auto _ : state) {
+        file->WriteAll(data).IgnoreError();
+        auto status = data_sync ? file->DataSync() : file->Sync();
+        if (!status.ok()) {
+            state.SkipWithError("sync failed");
+            break;
+        }
+    }
+    state.SetLabel(data_sync ? "fdatasync" : "fsync");
+    state.SetBytesProcessed(state.iterations() * size);
+    Unlink(kFile).IgnoreError();
+}
+BENCHMARK(BM_WriteSync)->ArgsProduct({{512, 64 << 10}, {0, 1}});
+
+}  // namespace
+}  // namespace file
@@ -2,6 +2,7 @@
 
 #include "file/filesystem.h"
 #include "gtest/gtest.h"
+#include "utils/metrics.h"
 #include "utils/testing.h"
 
 namespace file {
@@ -45,7 +46,7 @@ TEST_F(File, TestAutoClose) {
 
 TEST_F(File, ReadNotExists) {
     EXPECT_THAT(file::File::Open(kFile, O_RDONLY),
-                StatusIs(absl::StatusCode::kInternal));
+                StatusIs(absl::StatusCode::kNotFound));
 }
 
 TEST_F(File, ReadWrite) {
@@ -91,5 +92,66 @@ TEST_F(File, Seek) {
     }
 }
 
+TEST_F(File, AllocateAndDataSync) {
+    auto file = file::File::Open(kFile, O_WRONLY | O_CREAT, 0644);
+    EXPECT_OK(file);
+    EXPECT_OK((*file)->Allocate(0, 1 << 20));
+    // The size is not changed.
+    EXPECT_THAT(Stat(kFile), IsOkAndHolds(::testing::Property(
+                                 &PathStat::size, 0)));
+    EXPECT_THAT((*file)->Write("hello world"), IsOkAndHolds(11));
+    EXPECT_OK((*file)->DataSync());
+    EXPECT_THAT(GetContents(kFile), IsOkAndHolds("hello world"));
+
+    EXPECT_THAT((*file)->Allocate(0, -1),
+                StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST_F(File, Metrics) {
+    auto& registry = utils::MetricsRegistry::Global();
+    utils::Counter* write_bytes = registry.GetCounter("file_write_bytes_total");
+    utils::Counter* read_bytes = registry.GetCounter("file_read_bytes_total");
+    int64_t written = write_bytes->Value();
+    int64_t read = read_bytes->Value();
+
+    utils::SetMetricsEnabled(true);
+    auto file = file::File::Open(kFile, O_RDWR | O_CREAT, 0644);
+    EXPECT_OK(file);
+    EXPECT_OK((*file)->WriteAll("hello world"));
+    EXPECT_THAT((*file)->PRead(5, 0), IsOkAndHolds("hello"));
+    utils::SetMetricsEnabled(false);
+    EXPECT_OK((*file)->WriteAll("!"));
+
+    EXPECT_EQ(write_bytes->Value() - written, 11);
+    EXPECT_EQ(read_bytes->Value() - read, 5);
+}
+
+TEST_F(File, RateLimiter) {
+    utils::RateLimiter::Options options;
+    options.bytes_per_second = 1 << 20;
+    options.burst = absl::Milliseconds(10);
+    utils::RateLimiter limiter(options);
+    auto file = file::File::Open(kFile, O_RDWR | O_CREAT, 0644);
+    EXPECT_OK(file);
+    (*file)->set_rate_limiter(&limiter);
+
+    const absl::Time start = absl::Now();
+    const std::string data(10 << 10, 'x');
+    for (int i = 0; i < 5; i++) {
+        EXPECT_OK((*file)->WriteAll(data));
+    }
+    EXPECT_THAT((*file)->PRead(50 << 10, 0), IsOkAndHolds(std::string(
+                                                 50 << 10, 'x')));
+    // 100KB at 1MB/s, less the burst.
+    EXPECT_GE(absl::Now() - start, absl::Milliseconds(80));
+    EXPECT_EQ(limiter.GetStats().ops, 6);
+    EXPECT_EQ(limiter.GetStats().bytes, 100 << 10);
+
+    // Charged the bytes read, not the size of the buffer.
+    EXPECT_THAT((*file)->PRead(1 << 20, (50 << 10) - 10),
+                IsOkAndHolds(std::string(10, 'x')));
+    EXPECT_EQ(limiter.GetStats().bytes, (100 << 10) + 10);
+}
+
 }  // namespace
 }  // namespace file
@@ -3,12 +3,24 @@
 #include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <utility>
+
 #include "absl/strings/str_format.h"
+#include "absl/synchronization/mutex.h"
 #include "file/file.h"
 #include "file/path.h"
+#include "utils/checksum.h"
+#include "utils/errno_status.h"
 #include "utils/status_macros.h"
+#include "utils/thread_pool.h"
 
 namespace file {
 namespace {
@@ -16,6 +28,138 @@ namespace {
 constexpr absl::string_view kPathSelf = ".";
 constexpr absl::string_view kPathParent = "..";
 
+// Bytes moved per copy_file_range or sendfile call, small enough for a
+// copy to be interruptible.
+constexpr size_t kCopyChunkSize = 1 << 30;
+// Bytes per call when the copy is rate limited, small enough for the
+// limiter to pace it smoothly.
+constexpr size_t kThrottledCopyChunkSize = 1 << 20;
+
+// Whether `error_number` means the file systems do not support a way of
+// copying, so that the next one should be tried.
+bool IsCopyUnsupported(int error_number) {
+    return error_number == EOPNOTSUPP || error_number == ENOTTY ||
+           error_number == ENOSYS || error_number == EXDEV ||
+           error_number == EINVAL;
+}
+
+// Copies `count` bytes at `offset` of `from` to the same offset of `to`.
+// Sets `use_sendfile` once copy_file_range turns out unsupported. Each chunk
+// is charged to `limiter` once moved, a retry or a fallback costs nothing.
+absl::Status CopyRange(int from, int to, off_t offset, off_t count,
+                       utils::RateLimiter* limiter, bool& use_sendfile) {
+    const off_t end = offset + count;
+    const off_t chunk_size =
+        limiter != nullptr ? kThrottledCopyChunkSize : kCopyChunkSize;
+    while (offset < end && !use_sendfile) {
+        loff_t in_offset = offset;
+        loff_t out_offset = offset;
+        const off_t chunk = std::min(end - offset, chunk_size);
+        ssize_t n = copy_file_range(from, &in_offset, to, &out_offset,
+                                    chunk, 0);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (!IsCopyUnsupported(errno)) {
+                return utils::ErrnoToStatus(errno);
+            }
+            use_sendfile = true;
+            break;
+        }
+        if (n == 0) {
+            // The source was truncated meanwhile.
+            return absl::OkStatus();
+        }
+        if (limiter != nullptr) {
+            limiter->Acquire(n);
+        }
+        offset += n;
+    }
+    if (offset < end && lseek(to, offset, SEEK_SET) < 0) {
+        return utils::ErrnoToStatus(errno);
+    }
+    while (offset < end) {
+        const off_t chunk = std::min(end - offset, chunk_size);
+        ssize_t n = sendfile(to, from, &offset, chunk);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return utils::ErrnoToStatus(errno);
+        }
+        if (n == 0) {
+            return absl::OkStatus();
+        }
+        if (limiter != nullptr) {
+            limiter->Acquire(n);
+        }
+    }
+    return absl::OkStatus();
+}
+
+// Copies the data ranges of `from` to `to`, skipping the holes.
+absl::Status CopyData(int from, int to, off_t size,
+                      utils::RateLimiter* limiter) {
+    bool use_sendfile = false;
+    off_t offset = 0;
+    while (offset < size) {
+        off_t data = lseek(from, offset, SEEK_DATA);
+        if (data < 0) {
+            if (errno == ENXIO) {
+                // Only a hole up to the end.
+                break;
+            }
+            if (errno != EINVAL) {
+                return utils::ErrnoToStatus(errno);
+            }
+            // No hole detection, all is data.
+            data = offset;
+        }
+        off_t hole = data < size ? lseek(from, data, SEEK_HOLE) : size;
+        if (hole < 0) {
+            hole = size;
+        }
+        hole = std::min(hole, size);
+        RETURN_IF_ERROR(
+            CopyRange(from, to, data, hole - data, limiter, use_sendfile));
+        offset = hole;
+    }
+    return absl::OkStatus();
+}
+
+// Lists the entries under `from`, recursively, as paths relative to it.
+// Directories come before their entries.
+absl::Status ListTree(absl::string_view from, absl::string_view relative,
+                      std::vector<std::pair<std::string, PathStat>>& out) {
+    ASSIGN_OR_RETURN(auto entries, ListDirectory(PathJoin(from, relative)));
+    std::sort(entries.begin(), entries.end());
+    for (const auto& entry : entries) {
+        std::string path = relative.empty() ? entry : PathJoin(relative, entry);
+        ASSIGN_OR_RETURN(auto stat, LStat(PathJoin(from, path)));
+        out.emplace_back(path, stat);
+        if (stat.IsDirectory()) {
+            RETURN_IF_ERROR(ListTree(from, path, out));
+        }
+    }
+    return absl::OkStatus();
+}
+
+absl::Status CopySymlink(absl::string_view from, absl::string_view to) {
+    std::string from_str(from);
+    std::string target(PATH_MAX, '\0');
+    ssize_t n = readlink(from_str.c_str(), &target[0], target.size());
+    if (n < 0) {
+        return utils::ErrnoToStatus(errno);
+    }
+    target.resize(n);
+    std::string to_str(to);
+    if (symlink(target.c_str(), to_str.c_str()) != 0) {
+        return utils::ErrnoToStatus(errno);
+    }
+    return absl::OkStatus();
+}
+
 }  // namespace
 
 absl::StatusOr<PathStat> Stat(absl::string_view path) {
@@ -24,7 +168,7 @@ absl::StatusOr<PathStat> Stat(absl::string_view path) {
     if (stat(path_str.c_str(), &s) == 0) {
         return PathStat(s);
     } else {
-        return absl::InternalError(strerror(errno));
+        return utils::ErrnoToStatus(errno);
     }
 }
 
@@ -34,7 +178,7 @@ absl::StatusOr<PathStat> LStat(absl::string_view path) {
     if (lstat(path_str.c_str(), &s) == 0) {
         return PathStat(s);
     } else {
-        return absl::InternalError(strerror(errno));
+        return utils::ErrnoToStatus(errno);
     }
 }
 
@@ -45,7 +189,7 @@ absl::StatusOr<bool> Exists(absl::string_view path) {
     } else if (errno == ENOENT) {
         return false;
     } else {
-        return absl::InternalError(strerror(errno));
+        return utils::ErrnoToStatus(errno);
     }
 }
 
@@ -53,10 +197,10 @@ absl::Status CreateFile(absl::string_view path, mode_t mode) {
     std::string path_str = std::string(path);
     int fd = open(path_str.c_str(), O_CREAT | O_EXCL | O_WRONLY, mode);
     if (fd < 0) {
-        return absl::InternalError(strerror(errno));
+        return utils::ErrnoToStatus(errno);
     }
     if (close(fd) != 0) {
-        return absl::InternalError(strerror(errno));
+        return utils::ErrnoToStatus(errno);
     }
     return absl::OkStatus();
 }
@@ -66,7 +210,7 @@ absl::Status Chmod(absl::string_view path, mode_t mode) {
     if (chmod(path_str.c_str(), mode) == 0) {
         return absl::OkStatus();
     } else {
-        return absl::InternalError(strerror(errno));
+        return utils::ErrnoToStatus(errno);
     }
 }
 
@@ -75,7 +219,7 @@ absl::Status Unlink(absl::string_view path) {
     if (unlink(path_str.c_str()) == 0) {
         return absl::OkStatus();
     } else {
-        return absl::InternalError(strerror(errno));
+        return utils::ErrnoToStatus(errno);
     }
 }
 
@@ -84,7 +228,7 @@ absl::Status Rmdir(absl::string_view path) {
     if (rmdir(path_str.c_str()) == 0) {
         return absl::OkStatus();
     } else {
-        return absl::InternalError(strerror(errno));
+        return utils::ErrnoToStatus(errno);
     }
 }
 
@@ -93,7 +237,7 @@ absl::Status Mkdir(absl::string_view path, mode_t mode) {
     if (mkdir(path_str.c_str(), mode) == 0) {
         return absl::OkStatus();
     } else {
-        return absl::InternalError(strerror(errno));
+        return utils::ErrnoToStatus(errno);
     }
 }
 
@@ -103,7 +247,7 @@ absl::Status Rename(absl::string_view oldpath, absl::string_view newpath) {
     if (rename(oldpath_str.c_str(), newpath_str.c_str()) == 0) {
         return absl::OkStatus();
     } else {
-        return absl::InternalError(strerror(errno));
+        return utils::ErrnoToStatus(errno);
     }
 }
 
@@ -111,7 +255,7 @@ absl::StatusOr<std::vector<std::string>> ListDirectory(absl::string_view path) {
     std::string path_str = std::string(path);
     DIR* d = opendir(path_str.c_str());
     if (d == NULL) {
-        return absl::InternalError(strerror(errno));
+        return utils::ErrnoToStatus(errno);
     }
     std::vector<std::string> entries;
     while (true) {
@@ -119,7 +263,7 @@ absl::StatusOr<std::vector<std::string>> ListDirectory(absl::string_view path) {
         struct dirent* dir = readdir(d);
         if (dir == NULL) {
             if (errno != 0) {
-                return absl::InternalError(strerror(errno));
+                return utils::ErrnoToStatus(errno);
             }
             break;
         }
@@ -128,12 +272,13 @@ absl::StatusOr<std::vector<std::string>> ListDirectory(absl::string_view path) {
         }
     }
     if (closedir(d) != 0) {
-        return absl::InternalError(strerror(errno));
+        return utils::ErrnoToStatus(errno);
     }
     return entries;
 }
 
-absl::Status RmTree(absl::string_view path) {
+absl::Status RmTree(absl::string_view path,
+                    utils::RateLimiter* limiter) {
     ASSIGN_OR_RETURN(bool path_exists, Exists(path));
     if (!path_exists) {
         return absl::OkStatus();
@@ -143,11 +288,17 @@ absl::Status RmTree(absl::string_view path) {
         std::string subpath = PathJoin(path, entry);
         ASSIGN_OR_RETURN(auto stat, Stat(subpath));
         if (stat.IsDirectory()) {
-            RETURN_IF_ERROR(RmTree(subpath));
+            RETURN_IF_ERROR(RmTree(subpath, limiter));
         } else {
+            if (limiter != nullptr) {
+                limiter->Acquire(0);
+            }
             RETURN_IF_ERROR(Unlink(subpath));
         }
     }
+    if (limiter != nullptr) {
+        limiter->Acquire(0);
+    }
     RETURN_IF_ERROR(Rmdir(path));
 
     return absl::OkStatus();
@@ -179,8 +330,8 @@ absl::Status PutContents(const uint8_t* data, size_t count,
         ASSIGN_OR_RETURN(size_t size, file->Write(data, count));
         if (size == 0) {
             return absl::InternalError(absl::StrFormat(
-                "Put contents error: wrote only %d bytes, errno = %s", size,
-                strerror(errno)));
+                "Put contents error: wrote only %d bytes, errno = %d", size,
+                errno));
         }
         count -= size;
         data += size;
@@ -188,4 +339,145 @@ absl::Status PutContents(const uint8_t* data, size_t count,
     return absl::OkStatus();
 }
 
+absl::StatusOr<uint32_t> ChecksumFile(absl::string_view path,
+                                      int parallelism) {
+    ASSIGN_OR_RETURN(auto file, File::Open(path, O_RDONLY));
+    struct stat s;
+    if (fstat(file->fd(), &s) != 0) {
+        return utils::ErrnoToStatus(errno);
+    }
+    if (s.st_size == 0) {
+        return 0;
+    }
+
+    void* data =
+        mmap(nullptr, s.st_size, PROT_READ, MAP_PRIVATE, file->fd(), 0);
+    if (data == MAP_FAILED) {
+        return utils::ErrnoToStatus(errno);
+    }
+    // Every thread reads its chunk sequentially.
+    madvise(data, s.st_size, MADV_SEQUENTIAL);
+    madvise(data, s.st_size, MADV_WILLNEED);
+    uint32_t crc = utils::ComputeCrc32cParallel(data, s.st_size, parallelism);
+    munmap(data, s.st_size);
+    return crc;
+}
+
+absl::Status CopyFile(absl::string_view from, absl::string_view to,
+                      const CopyOptions& options) {
+    ASSIGN_OR_RETURN(auto in, File::Open(from, O_RDONLY));
+    struct stat s;
+    if (fstat(in->fd(), &s) != 0) {
+        return utils::ErrnoToStatus(errno);
+    }
+    if (!S_ISREG(s.st_mode)) {
+        return absl::InvalidArgumentError(
+            absl::StrFormat("%s is not a regular file", from));
+    }
+    // Truncating `to` would destroy the source if they are the same file.
+    struct stat to_stat;
+    const std::string to_str(to);
+    if (stat(to_str.c_str(), &to_stat) == 0 && to_stat.st_dev == s.st_dev &&
+        to_stat.st_ino == s.st_ino) {
+        return absl::InvalidArgumentError(
+            absl::StrFormat("%s and %s are the same file", from, to));
+    }
+    ASSIGN_OR_RETURN(auto out, File::Open(to, O_WRONLY | O_CREAT | O_TRUNC,
+                                          s.st_mode & 07777));
+    // The mode of an existing file is kept by open.
+    if (fchmod(out->fd(), s.st_mode & 07777) != 0) {
+        return utils::ErrnoToStatus(errno);
+    }
+
+    if (options.reflink) {
+        if (options.rate_limiter != nullptr) {
+            options.rate_limiter->Acquire(0);
+        }
+        if (ioctl(out->fd(), FICLONE, in->fd()) == 0) {
+            return out->Close();
+        }
+        if (!IsCopyUnsupported(errno)) {
+            return utils::ErrnoToStatus(errno);
+        }
+    }
+    RETURN_IF_ERROR(
+        CopyData(in->fd(), out->fd(), s.st_size, options.rate_limiter));
+    // Extends the copy over a trailing hole.
+    if (ftruncate(out->fd(), s.st_size) != 0) {
+        return utils::ErrnoToStatus(errno);
+    }
+    return out->Close();
+}
+
+absl::Status CopyTree(absl::string_view from, absl::string_view to,
+                      const CopyOptions& options) {
+    ASSIGN_OR_RETURN(auto root, Stat(from));
+    if (!root.IsDirectory()) {
+        return absl::InvalidArgumentError(
+            absl::StrFormat("%s is not a directory", from));
+    }
+    std::vector<std::pair<std::string, PathStat>> entries;
+    RETURN_IF_ERROR(ListTree(from, "", entries));
+
+    // Creates the directories and links first, the files are then copied
+    // concurrently. The created directories stay writable by the owner until
+    // their files are copied, as with `cp -a`, then get the source modes
+    // from the bottom up.
+    std::vector<std::pair<std::string, mode_t>> created_directories;
+    ASSIGN_OR_RETURN(bool exists, Exists(to));
+    if (!exists) {
+        RETURN_IF_ERROR(Mkdir(to, root.mode() | S_IRWXU));
+        created_directories.emplace_back(std::string(to), root.mode());
+    }
+    std::vector<std::string> files;
+    for (const auto& [path, stat] : entries) {
+        std::string target = PathJoin(to, path);
+        if (options.rate_limiter != nullptr && !stat.IsFile()) {
+            options.rate_limiter->Acquire(0);
+        }
+        if (stat.IsDirectory()) {
+            ASSIGN_OR_RETURN(bool target_exists, Exists(target));
+            if (!target_exists) {
+                RETURN_IF_ERROR(Mkdir(target, stat.mode() | S_IRWXU));
+                created_directories.emplace_back(target, stat.mode());
+            }
+        } else if (stat.IsLink()) {
+            RETURN_IF_ERROR(CopySymlink(PathJoin(from, path), target));
+        } else if (stat.IsFile()) {
+            files.push_back(path);
+        } else {
+            return absl::InvalidArgumentError(absl::StrFormat(
+                "cannot copy %s, not a file, directory or link",
+                PathJoin(from, path)));
+        }
+    }
+
+    absl::Mutex mu;
+    absl::Status status;
+    {
+        utils::ThreadPool pool(
+            std::max(1, std::min<int>(options.parallelism, files.size())));
+        for (const auto& path : files) {
+            pool.Schedule([&, path]() {
+                {
+                    absl::MutexLock lock(&mu);
+                    if (!status.ok()) {
+                        return;
+                    }
+                }
+                absl::Status copied = CopyFile(PathJoin(from, path),
+                                               PathJoin(to, path), options);
+                absl::MutexLock lock(&mu);
+                status.Update(copied);
+            });
+        }
+    }
+    // A directory is listed before its entries.
+    for (auto it = created_directories.rbegin();
+         it != created_directories.rend(); ++it) {
+        status.Update(Chmod(it->first, it->second));
+    }
+    return status;
+}
+
 }  // namespace file
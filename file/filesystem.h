@@ -9,6 +9,7 @@
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "utils/rate_limiter.h"
 
 namespace file {
 
@@ -54,7 +55,9 @@ absl::Status Rename(absl::string_view oldpath, absl::string_view newpath);
 absl::StatusOr<std::vector<std::string>> ListDirectory(absl::string_view path);
 
 // Removes all the sub items of `path`. Will return ok if `path` not exists.
-absl::Status RmTree(absl::string_view path);
+// Each removal is an operation of `limiter` if not nullptr.
+absl::Status RmTree(absl::string_view path,
+                    utils::RateLimiter* limiter = nullptr);
 
 absl::StatusOr<std::string> GetContents(absl::string_view path);
 absl::Status GetContents(std::string& out, absl::string_view path);
@@ -63,6 +66,39 @@ absl::Status PutContents(absl::string_view data, absl::string_view path);
 absl::Status PutContents(const uint8_t* data, size_t count,
                          absl::string_view path);
 
+// Returns the CRC32C of the contents of `path`. The file is mapped and its
+// chunks are checksummed by `parallelism` threads.
+absl::StatusOr<uint32_t> ChecksumFile(absl::string_view path,
+                                      int parallelism = 1);
+
+struct CopyOptions {
+    // Shares the blocks of the source instead of copying them (FICLONE) on
+    // file systems with copy-on-write, e.g. btrfs and XFS. The copy takes
+    // no space and constant time.
+    bool reflink = true;
+    // Files copied concurrently by `CopyTree`.
+    int parallelism = 8;
+    // Caps the copy, not owned, nullptr for none. The data is charged by
+    // chunks of 1MB, a reflink, a directory or a link is an operation of no
+    // bytes.
+    utils::RateLimiter* rate_limiter = nullptr;
+};
+
+// Copies the regular file `from` to `to` with its mode, `to` is created or
+// truncated, InvalidArgument if it is `from` itself. The data never goes
+// through user space: a reflink if possible, else copy_file_range of each
+// data range, falling back to sendfile across file systems which do not
+// support it. Holes are kept, a sparse file stays sparse.
+absl::Status CopyFile(absl::string_view from, absl::string_view to,
+                      const CopyOptions& options = CopyOptions());
+
+// Copies the directory `from` to `to` recursively, `to` is created if not
+// exists. Files are copied as by `CopyFile`, symbolic links are recreated,
+// other file types return InvalidArgument. The created directories get the
+// modes of the source once filled, read-only ones included.
+absl::Status CopyTree(absl::string_view from, absl::string_view to,
+                      const CopyOptions& options = CopyOptions());
+
 }  // namespace file
 
 #endif  // TOOLBASE_FILE_FILESYSTEM_H_
\ No newline at end of file
@@ -0,0 +1,135 @@
+#include <string>
+
+#include "absl/strings/str_cat.h"
+#include "benchmark/benchmark.h"
+#include "file/filesystem.h"
+
+namespace file {
+namespace {
+
+constexpr char kRoot[] = "/tmp/filesystem_benchmark";
+
+// Creates `width`^`depth` files in a tree of `depth` levels under `path`.
+bool CreateTree(const std::string& path, int width, int depth) {
+    if (!Mkdir(path, 0755).ok()) {
+        return false;
+    }
+    for (int i = 0; i < width; i++) {
+        std::string child = absl::StrCat(path, "/", i);
+        bool ok = depth > 1 ? CreateTree(child, width, depth - 1)
+                            : CreateFile(child, 0644).ok();
+        if (!ok) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Lists a directory of `range(0)` entries.
+void BM_ListDirectory(benchmark::State& state) {
+    const int num_entries = state.range(0);
+    RmTree(kRoot).IgnoreError();
+    if (!CreateTree(kRoot, num_entries, 1)) {
+        state.SkipWithError("cannot create the tree");
+        return;
+    }
+    for (auto _ : state) {
+        auto entries = ListDirectory(kRoot);
+        if (!entries.ok() || (int)entries->size() != num_entries) {
+            state.SkipWithError("unexpected entries");
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * num_entries);
+    RmTree(kRoot).IgnoreError();
+}
+BENCHMARK(BM_ListDirectory)->RangeMultiplier(8)->Range(8, 32768);
+
+// Removes a tree of `range(0)`^`range(1)` files.
+void BM_RmTree(benchmark::State& state) {
+    const int width = state.range(0);
+    const int depth = state.range(1);
+    int num_files = 1;
+    for (int i = 0; i < depth; i++) {
+        num_files *= width;
+    }
+    RmTree(kRoot).IgnoreError();
+    for (auto _ : state) {
+        state.PauseTiming();
+        if (!CreateTree(kRoot, width, depth)) {
+            state.SkipWithError("cannot create the tree");
+            break;
+        }
+        state.ResumeTiming();
+        if (!RmTree(kRoot).ok()) {
+            state.SkipWithError("rmtree failed");
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * num_files);
+}
+BENCHMARK(BM_RmTree)->Args({1000, 1})->Args({10, 3})->Args({4, 6});
+
+// Stats an existing path.
+void BM_Stat(benchmark::State& state) {
+    PutContents("x", kRoot).IgnoreError();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(Stat(kRoot));
+    }
+    Unlink(kRoot).IgnoreError();
+}
+BENCHMARK(BM_Stat);
+
+// Writes then reads back a whole file of `range(0)` bytes.
+void BM_PutGetContents(benchmark::State& state) {
+    const size_t size = state.range(0);
+    std::string data(size, 'x');
+    for (auto _ : state) {
+        Unlink(kRoot).IgnoreError();
+        if (!PutContents(data, kRoot).ok() || !GetContents(kRoot).ok()) {
+            state.SkipWithError("io failed");
+            break;
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * size * 2);
+    Unlink(kRoot).IgnoreError();
+}
+BENCHMARK(BM_PutGetContents)->RangeMultiplier(16)->Range(64, 16 << 20);
+
+// Copies a file of `range(0)` bytes with `CopyFile` (`range(1)` = 1) or
+// through memory with GetContents + PutContents. The copies are new files:
+// ext4 writes back a truncated file on close.
+void BM_CopyFile(benchmark::State& state) {
+    const size_t size = state.range(0);
+    const bool copy_file = state.range(1);
+    const std::string to = std::string(kRoot) + ".copy";
+    if (!PutContents(std::string(size, 'x'), kRoot).ok()) {
+        state.SkipWithError("cannot create the file");
+        return;
+    }
+    for (auto _ : state) {
+        state.PauseTiming();
+        Unlink(to).IgnoreError();
+        state.ResumeTiming();
+        absl::Status status;
+        if (copy_file) {
+            status = CopyFile(kRoot, to);
+        } else {
+            auto data = GetContents(kRoot);
+            status = data.ok() ? PutContents(*data, to) : data.status();
+        }
+        if (!status.ok()) {
+            state.SkipWithError("copy failed");
+            break;
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * size);
+    Unlink(kRoot).IgnoreError();
+    Unlink(to).IgnoreError();
+}
+BENCHMARK(BM_CopyFile)
+    ->ArgsProduct({{64 << 10, 16 << 20, 256 << 20}, {0, 1}})
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace file
@@ -1,7 +1,14 @@
 #include "file/filesystem.h"
 
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "file/file.h"
 #include "file/path.h"
 #include "gtest/gtest.h"
+#include "utils/checksum.h"
 #include "utils/testing.h"
 
 namespace file {
@@ -14,7 +21,7 @@ using ::utils::testing::IsOkAndHolds;
 using ::utils::testing::StatusIs;
 
 TEST(Stat, FileNotExists) {
-    EXPECT_THAT(Stat("/notexists"), StatusIs(absl::StatusCode::kInternal));
+    EXPECT_THAT(Stat("/notexists"), StatusIs(absl::StatusCode::kNotFound));
 }
 
 TEST(Stat, TestFile) {
@@ -38,7 +45,7 @@ TEST(Stat, TestFilePermossion) {
 }
 
 TEST(LStat, FileNotExists) {
-    EXPECT_THAT(LStat("/notexists"), StatusIs(absl::StatusCode::kInternal));
+    EXPECT_THAT(LStat("/notexists"), StatusIs(absl::StatusCode::kNotFound));
 }
 
 TEST(LStat, TestFile) {
@@ -82,7 +89,7 @@ TEST(CreateFile, TestCreateFile) {
     }
     EXPECT_OK(CreateFile(kFile, S_IRWXU));
     EXPECT_THAT(CreateFile(kFile, S_IRWXU),
-                StatusIs(absl::StatusCode::kInternal));
+                StatusIs(absl::StatusCode::kAlreadyExists));
     EXPECT_THAT(Exists(kFile), IsOkAndHolds(true));
     EXPECT_EQ(Stat(kFile)->mode() & S_IRWXU, S_IRWXU);
     EXPECT_EQ(Stat(kFile)->mode() & S_IRWXG, 0);
@@ -92,7 +99,7 @@ TEST(CreateFile, TestCreateFile) {
 
 TEST(Chmod, FileNotExists) {
     EXPECT_THAT(Chmod("/notexists", S_IRUSR | S_IWUSR),
-                StatusIs(absl::StatusCode::kInternal));
+                StatusIs(absl::StatusCode::kNotFound));
 }
 
 TEST(Chmod, TestChmod) {
@@ -150,7 +157,7 @@ TEST(Rename, Rename) {
 
 TEST(Rename, RenameNotExistsFile) {
     EXPECT_THAT(Rename("/notexists", "/notexists_new"),
-                StatusIs(absl::StatusCode::kInternal));
+                StatusIs(absl::StatusCode::kNotFound));
 }
 
 TEST(Rename, RenameToExistsFile) {
@@ -192,7 +199,7 @@ TEST(ListDirectory, ListDirectory) {
 
 TEST(ListDirectory, PathNotExists) {
     EXPECT_THAT(ListDirectory("/notexists"),
-                StatusIs(absl::StatusCode::kInternal));
+                StatusIs(absl::StatusCode::kNotFound));
 }
 
 TEST(RmTree, PathNotExists) { EXPECT_OK(RmTree("/notexists")); }
@@ -224,12 +231,198 @@ TEST(GetPutContents, GetPutContents) {
 
 TEST(GetContents, FileNotExists) {
     EXPECT_THAT(GetContents("/notexists"),
-                StatusIs(absl::StatusCode::kInternal));
+                StatusIs(absl::StatusCode::kNotFound));
 }
 
 TEST(PutContents, PathNotExists) {
     EXPECT_THAT(PutContents("data", "/notexists/file"),
-                StatusIs(absl::StatusCode::kInternal));
+                StatusIs(absl::StatusCode::kNotFound));
+}
+
+TEST(ChecksumFile, ChecksumFile) {
+    constexpr absl::string_view kFile = "/tmp/test_checksum_file";
+    std::string data(3 << 20, '\0');
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = static_cast<char>(i * 31 + (i >> 12));
+    }
+    ASSERT_OK(PutContents(data, kFile));
+    for (int parallelism : {1, 4}) {
+        EXPECT_THAT(ChecksumFile(kFile, parallelism),
+                    IsOkAndHolds(utils::ComputeCrc32c(data)));
+    }
+
+    ASSERT_OK(Unlink(kFile));
+
+    ASSERT_OK(CreateFile(kFile, 0644));
+    EXPECT_THAT(ChecksumFile(kFile), IsOkAndHolds(0));
+    ASSERT_OK(Unlink(kFile));
+
+    EXPECT_THAT(ChecksumFile("/notexists"),
+                StatusIs(absl::StatusCode::kNotFound));
+}
+
+TEST(CopyFile, CopyFile) {
+    constexpr absl::string_view kFrom = "/tmp/test_copy_file_from";
+    constexpr absl::string_view kTo = "/tmp/test_copy_file_to";
+    std::string data(5 << 20, '\0');
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = static_cast<char>(i * 13 + (i >> 10));
+    }
+    ASSERT_OK(PutContents(data, kFrom));
+    ASSERT_OK(Chmod(kFrom, 0640));
+    ASSERT_OK(PutContents("longer old contents to truncate", kTo));
+    for (bool reflink : {true, false}) {
+        CopyOptions options;
+        options.reflink = reflink;
+        EXPECT_OK(CopyFile(kFrom, kTo, options));
+        EXPECT_THAT(GetContents(kTo), IsOkAndHolds(data));
+        EXPECT_EQ(Stat(kTo)->mode(), 0640);
+    }
+
+    ASSERT_OK(Unlink(kFrom));
+    ASSERT_OK(CreateFile(kFrom, 0644));
+    EXPECT_OK(CopyFile(kFrom, kTo));
+    EXPECT_EQ(Stat(kTo)->size(), 0);
+
+    // Onto itself or a hard link of it, the source is kept.
+    ASSERT_OK(PutContents("source", kFrom));
+    EXPECT_THAT(CopyFile(kFrom, kFrom),
+                StatusIs(absl::StatusCode::kInvalidArgument));
+    ASSERT_OK(Unlink(kTo));
+    ASSERT_EQ(link(std::string(kFrom).c_str(), std::string(kTo).c_str()), 0);
+    EXPECT_THAT(CopyFile(kFrom, kTo),
+                StatusIs(absl::StatusCode::kInvalidArgument));
+    EXPECT_THAT(GetContents(kFrom), IsOkAndHolds("source"));
+
+    ASSERT_OK(Unlink(kFrom));
+    ASSERT_OK(Unlink(kTo));
+    EXPECT_THAT(CopyFile("/notexists", kTo),
+                StatusIs(absl::StatusCode::kNotFound));
+    EXPECT_THAT(CopyFile("/tmp", kTo),
+                StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST(CopyFile, KeepsHoles) {
+    constexpr absl::string_view kFrom = "/tmp/test_copy_sparse_from";
+    constexpr absl::string_view kTo = "/tmp/test_copy_sparse_to";
+    constexpr off_t kSize = 256 << 20;
+    {
+        auto file = *File::Open(kFrom, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        ASSERT_OK(file->PWrite("head", 0));
+        ASSERT_OK(file->PWrite("middle", kSize / 2));
+        ASSERT_EQ(ftruncate(file->fd(), kSize), 0);
+    }
+    CopyOptions options;
+    options.reflink = false;
+    ASSERT_OK(CopyFile(kFrom, kTo, options));
+
+    struct stat s;
+    ASSERT_EQ(stat(std::string(kTo).c_str(), &s), 0);
+    EXPECT_EQ(s.st_size, kSize);
+    // A few blocks, not 256MB.
+    EXPECT_LT(s.st_blocks * 512, 1 << 20);
+    auto file = *File::Open(kTo, O_RDONLY);
+    EXPECT_THAT(file->PRead(4, 0), IsOkAndHolds("head"));
+    EXPECT_THAT(file->PRead(8, kSize / 2 - 2),
+                IsOkAndHolds(std::string("\0\0middle", 8)));
+    EXPECT_THAT(file->PRead(4, kSize - 4),
+                IsOkAndHolds(std::string(4, '\0')));
+    ASSERT_OK(Unlink(kFrom));
+    ASSERT_OK(Unlink(kTo));
+}
+
+TEST(CopyTree, CopyTree) {
+    constexpr absl::string_view kFrom = "/tmp/test_copy_tree_from";
+    constexpr absl::string_view kTo = "/tmp/test_copy_tree_to";
+    ASSERT_OK(RmTree(kFrom));
+    ASSERT_OK(RmTree(kTo));
+    ASSERT_OK(Mkdir(kFrom, 0755));
+    ASSERT_OK(Mkdir(PathJoin(kFrom, "sub"), 0700));
+    ASSERT_OK(Mkdir(PathJoin(kFrom, "sub/empty"), 0755));
+    for (int i = 0; i < 20; i++) {
+        ASSERT_OK(PutContents(std::string((i + 1) * 1000, 'a' + i),
+                              PathJoin(kFrom, "sub", std::to_string(i))));
+    }
+    ASSERT_OK(PutContents("top", PathJoin(kFrom, "top")));
+    ASSERT_EQ(symlink("sub/1", PathJoin(kFrom, "link").c_str()), 0);
+
+    ASSERT_OK(CopyTree(kFrom, kTo));
+    EXPECT_EQ(Stat(PathJoin(kTo, "sub"))->mode(), 0700);
+    EXPECT_TRUE(Stat(PathJoin(kTo, "sub/empty"))->IsDirectory());
+    for (int i = 0; i < 20; i++) {
+        EXPECT_THAT(GetContents(PathJoin(kTo, "sub", std::to_string(i))),
+                    IsOkAndHolds(std::string((i + 1) * 1000, 'a' + i)));
+    }
+    EXPECT_THAT(GetContents(PathJoin(kTo, "top")), IsOkAndHolds("top"));
+    EXPECT_TRUE(LStat(PathJoin(kTo, "link"))->IsLink());
+    EXPECT_THAT(GetContents(PathJoin(kTo, "link")),
+                IsOkAndHolds(std::string(2000, 'b')));
+
+    EXPECT_THAT(CopyTree(PathJoin(kFrom, "top"), kTo),
+                StatusIs(absl::StatusCode::kInvalidArgument));
+    ASSERT_OK(RmTree(kFrom));
+    ASSERT_OK(RmTree(kTo));
+}
+
+TEST(CopyTree, ReadOnlyDirectories) {
+    constexpr absl::string_view kFrom = "/tmp/test_copy_tree_readonly_from";
+    constexpr absl::string_view kTo = "/tmp/test_copy_tree_readonly_to";
+    ASSERT_OK(RmTree(kFrom));
+    ASSERT_OK(RmTree(kTo));
+    ASSERT_OK(Mkdir(kFrom, 0755));
+    ASSERT_OK(Mkdir(PathJoin(kFrom, "sub"), 0755));
+    ASSERT_OK(PutContents("weights", PathJoin(kFrom, "sub/model")));
+    ASSERT_OK(Chmod(PathJoin(kFrom, "sub"), 0555));
+    ASSERT_OK(Chmod(kFrom, 0555));
+
+    // Root writes into read-only directories, copies as another user.
+    const bool as_root = geteuid() == 0;
+    if (as_root) {
+        ASSERT_EQ(seteuid(65534), 0);
+    }
+    absl::Status copied = CopyTree(kFrom, kTo);
+    if (as_root) {
+        ASSERT_EQ(seteuid(0), 0);
+    }
+    EXPECT_OK(copied);
+    EXPECT_THAT(GetContents(PathJoin(kTo, "sub/model")),
+                IsOkAndHolds("weights"));
+    EXPECT_EQ(Stat(PathJoin(kTo, "sub"))->mode(), 0555);
+    EXPECT_EQ(Stat(kTo)->mode(), 0555);
+
+    for (absl::string_view root : {kFrom, kTo}) {
+        ASSERT_OK(Chmod(root, 0755));
+        ASSERT_OK(Chmod(PathJoin(root, "sub"), 0755));
+    }
+    ASSERT_OK(RmTree(kFrom));
+    ASSERT_OK(RmTree(kTo));
+}
+
+TEST(CopyTree, RateLimiter) {
+    constexpr absl::string_view kFrom = "/tmp/test_copy_tree_limited_from";
+    constexpr absl::string_view kTo = "/tmp/test_copy_tree_limited_to";
+    ASSERT_OK(RmTree(kFrom));
+    ASSERT_OK(RmTree(kTo));
+    ASSERT_OK(Mkdir(kFrom, 0755));
+    ASSERT_OK(Mkdir(PathJoin(kFrom, "sub"), 0755));
+    ASSERT_OK(PutContents(std::string(3 << 20, 'a'), PathJoin(kFrom, "a")));
+    ASSERT_OK(PutContents("b", PathJoin(kFrom, "sub/b")));
+
+    // Counts without limiting.
+    utils::RateLimiter limiter({});
+    CopyOptions options;
+    options.reflink = false;
+    options.rate_limiter = &limiter;
+    ASSERT_OK(CopyTree(kFrom, kTo, options));
+    EXPECT_THAT(GetContents(PathJoin(kTo, "sub/b")), IsOkAndHolds("b"));
+    // A chunk of 1MB at a time, and the directory.
+    EXPECT_EQ(limiter.GetStats().ops, 5);
+    EXPECT_EQ(limiter.GetStats().bytes, (3 << 20) + 1);
+
+    // Two files and two directories.
+    ASSERT_OK(RmTree(kTo, &limiter));
+    EXPECT_EQ(limiter.GetStats().ops, 9);
+    ASSERT_OK(RmTree(kFrom));
 }
 
 }  // namespace
@@ -2,28 +2,163 @@
 
 #include <fcntl.h>
 
+#include <algorithm>
 #include <vector>
 
+#include "utils/errno_status.h"
+#include "utils/metrics.h"
+
 namespace file {
+namespace {
+
+utils::Counter* const read_bytes = utils::MetricsRegistry::Global().GetCounter(
+    "nonblocking_read_bytes_total", "Bytes read by NonblockingIO.");
+utils::Counter* const write_bytes =
+    utils::MetricsRegistry::Global().GetCounter(
+        "nonblocking_write_bytes_total", "Bytes written by NonblockingIO.");
+utils::Gauge* const write_buffer_bytes =
+    utils::MetricsRegistry::Global().GetGauge(
+        "nonblocking_write_buffer_bytes",
+        "Bytes in the write buffers of all the NonblockingIOs.");
+utils::Counter* const write_pauses =
+    utils::MetricsRegistry::Global().GetCounter(
+        "nonblocking_write_pauses_total",
+        "Times NonblockingIO paused its producer on backpressure.");
+utils::Counter* const would_block = utils::MetricsRegistry::Global().GetCounter(
+    "nonblocking_would_block_total",
+    "NonblockingIO reads and writes returning EAGAIN.");
+// The `IOLatencyStats` of all the NonblockingIOs recording them.
+utils::LatencyHistogram* const time_to_flush =
+    utils::MetricsRegistry::Global().GetHistogram(
+        "nonblocking_time_to_flush_seconds",
+        "Time from NonblockingIO::AppendWriteData until the data was "
+        "written, of the NonblockingIOs with latency stats enabled.");
+utils::LatencyHistogram* const time_in_buffer =
+    utils::MetricsRegistry::Global().GetHistogram(
+        "nonblocking_time_in_buffer_seconds",
+        "Time from data read by NonblockingIO until it was consumed, of "
+        "the NonblockingIOs with latency stats enabled.");
+
+}  // namespace
 
 absl::StatusOr<std::unique_ptr<NonblockingIO>> NonblockingIO::Create(
     std::unique_ptr<File> file) {
     int flags = fcntl(file->fd(), F_GETFL, 0);
     if (flags == -1) {
-        return absl::InternalError(strerror(errno));
+        return utils::ErrnoToStatus(errno);
     }
     flags = flags | O_NONBLOCK;
     int ret = fcntl(file->fd(), F_SETFL, flags);
     if (ret == -1) {
-        return absl::InternalError(strerror(errno));
+        return utils::ErrnoToStatus(errno);
     }
     return std::unique_ptr<NonblockingIO>(new NonblockingIO(std::move(file)));
 }
 
-void NonblockingIO::AppendWriteData(absl::string_view data) {
+NonblockingIO::~NonblockingIO() {
+    write_buffer_bytes->Add(-static_cast<int64_t>(write_buf_.size()));
+    if (backpressure_.budget != nullptr) {
+        backpressure_.budget->Release(charged_);
+    }
+}
+
+void NonblockingIO::SetBackpressure(BackpressureOptions options) {
+    if (backpressure_.budget != nullptr) {
+        backpressure_.budget->Release(charged_);
+    }
+    backpressure_ = std::move(options);
+    charged_ = 0;
+    if (backpressure_.budget != nullptr) {
+        charged_ = write_buf_.size();
+        backpressure_.budget->Charge(charged_);
+    }
+    UpdatePaused();
+}
+
+void NonblockingIO::UpdatePaused() {
+    const size_t size = write_buf_.size();
+    if (!paused_) {
+        // The budget does not hold a connection with little buffered, it
+        // would have nothing to drain to resume.
+        if (size > backpressure_.high_watermark ||
+            (size > backpressure_.low_watermark &&
+             backpressure_.budget != nullptr &&
+             backpressure_.budget->exceeded())) {
+            paused_ = true;
+            write_pauses->Increment();
+            if (backpressure_.on_pause) {
+                backpressure_.on_pause();
+            }
+        }
+    } else if (size <= backpressure_.low_watermark) {
+        paused_ = false;
+        if (backpressure_.on_resume) {
+            backpressure_.on_resume();
+        }
+    }
+}
+
+void NonblockingIO::SetRateLimiters(utils::RateLimiter* read_limiter,
+                                    utils::RateLimiter* write_limiter) {
+    read_limiter_ = read_limiter;
+    write_limiter_ = write_limiter;
+}
+
+size_t NonblockingIO::Admit(utils::RateLimiter* limiter, size_t count) {
+    throttled_ = false;
+    if (limiter == nullptr) {
+        return count;
+    }
+    size_t available = limiter->AvailableBytes();
+    if (available == 0) {
+        throttled_ = true;
+        throttle_delay_ = limiter->TimeUntilAvailable();
+        limiter->RecordThrottled(throttle_delay_);
+        return 0;
+    }
+    return std::min(count, available);
+}
+
+namespace {
+
+// Records the latency of all the marks whose end offset <= `offset` into
+// `histogram`, and into `total` while metrics are enabled.
+void PopMarks(std::deque<std::pair<uint64_t, absl::Time>>& marks,
+              uint64_t offset, utils::LatencyHistogram& histogram,
+              utils::LatencyHistogram* total) {
+    if (marks.empty() || marks.front().first > offset) {
+        return;
+    }
+    absl::Time now = absl::Now();
+    const bool metrics = utils::MetricsEnabled();
+    while (!marks.empty() && marks.front().first <= offset) {
+        absl::Duration latency = now - marks.front().second;
+        histogram.Record(latency);
+        if (metrics) {
+            total->Record(latency);
+        }
+        marks.pop_front();
+    }
+}
+
+}  // namespace
+
+bool NonblockingIO::AppendWriteData(absl::string_view data) {
     size_t old_size = write_buf_.size();
     write_buf_.resize(write_buf_.size() + data.size());
     memmove(write_buf_.data() + old_size, data.data(), data.size());
+    write_buffer_bytes->Add(data.size());
+    if (backpressure_.budget != nullptr) {
+        backpressure_.budget->Charge(data.size());
+        charged_ += data.size();
+    }
+
+    if (stats_ && !data.empty()) {
+        write_appended_ += data.size();
+        write_marks_.emplace_back(write_appended_, absl::Now());
+    }
+    UpdatePaused();
+    return !paused_;
 }
 
 absl::StatusOr<size_t> NonblockingIO::TryWriteOnce() {
@@ -31,36 +166,84 @@ absl::StatusOr<size_t> NonblockingIO::TryWriteOnce() {
         return absl::InternalError("No data to write");
     }
 
-    ssize_t ret = write(file_->fd(), write_buf_.data(), write_buf_.size());
+    const size_t count = Admit(write_limiter_, write_buf_.size());
+    if (count == 0) {
+        return 0;
+    }
+    ssize_t ret = write(file_->fd(), write_buf_.data(), count);
     if (ret < 0) {
         if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            would_block->Increment();
             return 0;
         }
-        return absl::InternalError(strerror(errno));
+        return utils::ErrnoToStatus(errno);
+    }
+    write_bytes->Add(ret);
+    if (write_limiter_ != nullptr) {
+        write_limiter_->Reserve(ret);
     }
     size_t new_size = write_buf_.size() - ret;
     memmove(write_buf_.data(), write_buf_.data() + ret, new_size);
     write_buf_.resize(new_size);
+    write_buffer_bytes->Add(-ret);
+    if (backpressure_.budget != nullptr) {
+        backpressure_.budget->Release(ret);
+        charged_ -= ret;
+    }
+
+    if (stats_) {
+        write_flushed_ += ret;
+        PopMarks(write_marks_, write_flushed_, stats_->time_to_flush,
+                 time_to_flush);
+    }
+    if (paused_) {
+        UpdatePaused();
+    }
     return ret;
 }
 
 absl::StatusOr<size_t> NonblockingIO::TryReadOnce(size_t count) {
+    if (count > 0) {
+        count = Admit(read_limiter_, count);
+        if (count == 0) {
+            return 0;
+        }
+    }
     std::vector<uint8_t> buf(count);
     ssize_t ret = read(file_->fd(), buf.data(), count);
     if (ret < 0) {
         if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            would_block->Increment();
             return 0;
         }
-        return absl::InternalError(strerror(errno));
+        return utils::ErrnoToStatus(errno);
+    }
+    if (ret == 0 && count > 0) {
+        eof_ = true;
+    }
+    read_bytes->Add(ret);
+    if (read_limiter_ != nullptr && ret > 0) {
+        read_limiter_->Reserve(ret);
     }
     size_t old_size = read_buf_.size();
     size_t new_size = read_buf_.size() + ret;
     read_buf_.resize(new_size);
     memmove(read_buf_.data() + old_size, buf.data(), ret);
+
+    if (stats_ && ret > 0) {
+        read_received_ += ret;
+        read_marks_.emplace_back(read_received_, absl::Now());
+    }
     return ret;
 }
 
 void NonblockingIO::ConsumeReadData(size_t bytes) {
+    if (stats_) {
+        read_consumed_ += std::min(bytes, read_buf_.size());
+        PopMarks(read_marks_, read_consumed_, stats_->time_in_buffer,
+                 time_in_buffer);
+    }
+
     if (bytes >= read_buf_.size()) {
         read_buf_.clear();
         return;
@@ -72,4 +255,16 @@ void NonblockingIO::ConsumeReadData(size_t bytes) {
     read_buf_.resize(new_size);
 }
 
-}  // namespace file
\ No newline at end of file
+void NonblockingIO::EnableLatencyStats() {
+    if (stats_) {
+        return;
+    }
+    stats_ = std::make_unique<IOLatencyStats>();
+    // Data already buffered is counted in the offsets, but has no mark.
+    write_appended_ = write_buf_.size();
+    write_flushed_ = 0;
+    read_received_ = read_buf_.size();
+    read_consumed_ = 0;
+}
+
+}  // namespace file
@@ -1,15 +1,76 @@
 #ifndef TOOLBASE_FILE_NONBLOCKING_H_
 #define TOOLBASE_FILE_NONBLOCKING_H_
 
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <limits>
 #include <memory>
 #include <string>
+#include <utility>
 
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
 #include "file/file.h"
+#include "utils/histogram.h"
+#include "utils/rate_limiter.h"
 
 namespace file {
 
+// Latency of the data passing through the buffers of a `NonblockingIO`.
+struct IOLatencyStats {
+    // Time from `AppendWriteData` until the data was written to the file.
+    utils::LatencyHistogram time_to_flush;
+    // Time from data read from the file until it was consumed by
+    // `ConsumeReadData`.
+    utils::LatencyHistogram time_in_buffer;
+};
+
+// Memory for the write buffers of many `NonblockingIO`s, e.g. one instance
+// for all the connections of a process. The buffers are charged even past
+// the limit, exceeding it makes the connections with more than their low
+// watermark buffered report backpressure. Thread-safe.
+class BufferBudget {
+   public:
+    explicit BufferBudget(size_t limit) : limit_(limit) {}
+
+    BufferBudget(const BufferBudget&) = delete;
+    BufferBudget& operator=(const BufferBudget&) = delete;
+
+    void Charge(size_t bytes) {
+        used_.fetch_add(bytes, std::memory_order_relaxed);
+    }
+    void Release(size_t bytes) {
+        used_.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+    bool exceeded() const {
+        return used_.load(std::memory_order_relaxed) > limit_;
+    }
+
+    size_t used() const { return used_.load(std::memory_order_relaxed); }
+    size_t limit() const { return limit_; }
+
+   private:
+    const size_t limit_;
+    std::atomic<size_t> used_{0};
+};
+
+// Bounds the write buffer of a `NonblockingIO`. Past `high_watermark`
+// bytes buffered, or when the budget is exceeded, the connection is paused:
+// `AppendWriteData` returns false and `on_pause` is called, the producer
+// should stop, e.g. stop reading the upstream connection. Once the buffer
+// drains to `low_watermark` bytes, `on_resume` is called.
+struct BackpressureOptions {
+    size_t low_watermark = 0;
+    size_t high_watermark = std::numeric_limits<size_t>::max();
+    // Not owned, shared by many connections, nullptr means no budget.
+    BufferBudget* budget = nullptr;
+    std::function<void()> on_pause;
+    std::function<void()> on_resume;
+};
+
 // A class to handle nonblocking IO operations.
 // For write(some_data):
 //  1. Copy some_data to the memory buffer
@@ -31,9 +92,13 @@ namespace file {
 //  }
 class NonblockingIO {
    public:
+    // Wraps a `file` which is already in O_NONBLOCK mode, e.g. opened with
+    // O_NONBLOCK or accepted by `net::NetSocket::AcceptMany`.
     explicit NonblockingIO(std::unique_ptr<File> file)
         : file_(std::move(file)) {}
+    ~NonblockingIO();
 
+    // Sets O_NONBLOCK on `file` and wraps it.
     static absl::StatusOr<std::unique_ptr<NonblockingIO>> Create(
         std::unique_ptr<File> file);
 
@@ -41,31 +106,93 @@ class NonblockingIO {
     File* file() { return file_.get(); }
 
     // Appends data to write buffer, this call will not perform write.
-    void AppendWriteData(absl::string_view data);
+    // Returns false if the writes are paused by the backpressure options,
+    // the data is buffered anyway.
+    bool AppendWriteData(absl::string_view data);
 
     // Performs a write, returns the number of written bytes.
-    // Returns 0 means need wait.
+    // Returns 0 means need wait, see `throttled`.
     absl::StatusOr<size_t> TryWriteOnce();
 
     bool HasDataToWrite() { return !write_buf_.empty(); }
 
+    // Bytes waiting in the write buffer.
+    size_t write_buffer_size() const { return write_buf_.size(); }
+
+    // The data already buffered is charged to the new budget.
+    void SetBackpressure(BackpressureOptions options);
+
+    // True from a pause until the write buffer drains to the low watermark.
+    bool write_paused() const { return paused_; }
+
     // Performs a read, returns the number of read bytes.
     // `count` means the max number of bytes read in this call.
-    // Returns 0 means need wait.
+    // Returns 0 means need wait, see `throttled`.
     absl::StatusOr<size_t> TryReadOnce(size_t count);
 
     bool HasDataToRead() { return !read_buf_.empty(); }
 
+    // True once a read reached the end of the file, i.e. `TryReadOnce`
+    // returned 0 because the peer closed rather than because it needs wait.
+    bool eof() const { return eof_; }
+
     // Returns a view of read buffer, the view will be valid until next call of
     // `TryReadOnce` or `ConsumeReadData`.
     absl::string_view DataToRead() { return read_buf_; }
 
     void ConsumeReadData(size_t bytes);
 
+    // Caps the reads and the writes, the limiters (not owned, nullptr for
+    // none, may be the same) should outlive the object. A read or a write
+    // moves at most what its limiter admits, when it admits nothing the call
+    // returns 0 without a syscall and `throttled` is true: the caller should
+    // retry after `throttle_delay`, the file may never report ready.
+    void SetRateLimiters(utils::RateLimiter* read_limiter,
+                         utils::RateLimiter* write_limiter);
+
+    // Whether the last `TryReadOnce` or `TryWriteOnce` was throttled.
+    bool throttled() const { return throttled_; }
+    absl::Duration throttle_delay() const { return throttle_delay_; }
+
+    // Starts recording `IOLatencyStats`, which costs a clock read per call
+    // of the buffer operations. Only data appended or read afterwards is
+    // recorded. While metrics are enabled, the latencies are also added to
+    // the "nonblocking_time_to_flush_seconds" and
+    // "nonblocking_time_in_buffer_seconds" histograms of the global
+    // `MetricsRegistry`.
+    void EnableLatencyStats();
+
+    // Returns nullptr if latency stats are not enabled.
+    const IOLatencyStats* latency_stats() const { return stats_.get(); }
+
    private:
+    // Calls the callbacks when the buffer crosses the watermarks.
+    void UpdatePaused();
+    // Returns the bytes of `count` `limiter` admits now, sets `throttled_`.
+    size_t Admit(utils::RateLimiter* limiter, size_t count);
+
     std::unique_ptr<File> file_;
+    BackpressureOptions backpressure_;
+    bool paused_ = false;
+    // Bytes of `write_buf_` charged to the budget.
+    size_t charged_ = 0;
+    utils::RateLimiter* read_limiter_ = nullptr;
+    utils::RateLimiter* write_limiter_ = nullptr;
+    bool throttled_ = false;
+    absl::Duration throttle_delay_;
     std::string write_buf_;
     std::string read_buf_;
+    bool eof_ = false;
+
+    // Latency tracking, the deques hold (end offset, time) of every chunk
+    // entered the buffers, offsets count all bytes since stats enabled.
+    std::unique_ptr<IOLatencyStats> stats_;
+    std::deque<std::pair<uint64_t, absl::Time>> write_marks_;
+    std::deque<std::pair<uint64_t, absl::Time>> read_marks_;
+    uint64_t write_appended_ = 0;
+    uint64_t write_flushed_ = 0;
+    uint64_t read_received_ = 0;
+    uint64_t read_consumed_ = 0;
 };
 
 }  // namespace file
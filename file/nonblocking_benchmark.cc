@@ -0,0 +1,89 @@
+#include <sys/socket.h>
+
+#include <memory>
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "file/file.h"
+#include "file/nonblocking.h"
+
+namespace file {
+namespace {
+
+// Both ends of a nonblocking stream socket pair.
+struct Pair {
+    std::unique_ptr<NonblockingIO> writer;
+    std::unique_ptr<NonblockingIO> reader;
+};
+
+Pair CreatePair(benchmark::State& state) {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) != 0) {
+        state.SkipWithError("cannot create the socket pair");
+        return {};
+    }
+    return {*NonblockingIO::Create(std::make_unique<File>(fds[0])),
+            *NonblockingIO::Create(std::make_unique<File>(fds[1]))};
+}
+
+// Moves `range(0)` byte messages through NonblockingIO buffers on both
+// ends, in the same thread: append, flush, read, consume.
+void BM_Transfer(benchmark::State& state) {
+    const size_t size = state.range(0);
+    const bool stats = state.range(1);
+    Pair pair = CreatePair(state);
+    if (!pair.writer) {
+        return;
+    }
+    if (stats) {
+        pair.writer->EnableLatencyStats();
+        pair.reader->EnableLatencyStats();
+    }
+    std::string message(size, 'x');
+    for (auto _ : state) {
+        pair.writer->AppendWriteData(message);
+        size_t received = 0;
+        while (received < size) {
+            if (pair.writer->HasDataToWrite() &&
+                !pair.writer->TryWriteOnce().ok()) {
+                state.SkipWithError("write failed");
+                return;
+            }
+            auto ret = pair.reader->TryReadOnce(64 << 10);
+            if (!ret.ok()) {
+                state.SkipWithError("read failed");
+                return;
+            }
+            received += *ret;
+            pair.reader->ConsumeReadData(*ret);
+        }
+    }
+    state.SetLabel(stats ? "latency_stats" : "");
+    state.SetBytesProcessed(state.iterations() * size);
+}
+BENCHMARK(BM_Transfer)->ArgsProduct({{64, 1024, 64 << 10, 1 << 20}, {0, 1}});
+
+// Appends many small messages before a single flush, the buffering cost.
+void BM_AppendSmall(benchmark::State& state) {
+    const size_t size = state.range(0);
+    Pair pair = CreatePair(state);
+    if (!pair.writer) {
+        return;
+    }
+    std::string message(size, 'x');
+    for (auto _ : state) {
+        for (int i = 0; i < 64; i++) {
+            pair.writer->AppendWriteData(message);
+        }
+        while (pair.writer->HasDataToWrite()) {
+            pair.writer->TryWriteOnce().IgnoreError();
+            pair.reader->TryReadOnce(64 << 10).IgnoreError();
+            pair.reader->ConsumeReadData(pair.reader->DataToRead().size());
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * size * 64);
+}
+BENCHMARK(BM_AppendSmall)->Arg(16)->Arg(256);
+
+}  // namespace
+}  // namespace file
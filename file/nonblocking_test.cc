@@ -2,7 +2,11 @@
 
 #include <unistd.h>
 
+#include <memory>
+#include <string>
+
 #include "gtest/gtest.h"
+#include "utils/metrics.h"
 #include "utils/testing.h"
 
 namespace file {
@@ -52,5 +56,151 @@ TEST(NonblockingIO, NonblockingIO) {
     EXPECT_THAT((*read_io)->TryReadOnce(1024), IsOkAndHolds(0));
 }
 
+TEST(NonblockingIO, LatencyStats) {
+    int pipefd[2];
+    EXPECT_EQ(pipe(pipefd), 0);
+    auto read_io = NonblockingIO::Create(std::make_unique<File>(pipefd[0]));
+    auto write_io = NonblockingIO::Create(std::make_unique<File>(pipefd[1]));
+    EXPECT_OK(read_io);
+    EXPECT_OK(write_io);
+    EXPECT_EQ((*write_io)->latency_stats(), nullptr);
+    auto& registry = utils::MetricsRegistry::Global();
+    utils::LatencyHistogram* time_to_flush =
+        registry.GetHistogram("nonblocking_time_to_flush_seconds");
+    utils::LatencyHistogram* time_in_buffer =
+        registry.GetHistogram("nonblocking_time_in_buffer_seconds");
+    uint64_t flushed = time_to_flush->Count();
+    uint64_t consumed = time_in_buffer->Count();
+    utils::SetMetricsEnabled(true);
+
+    (*write_io)->AppendWriteData("not tracked");
+    (*write_io)->EnableLatencyStats();
+    (*read_io)->EnableLatencyStats();
+    (*write_io)->AppendWriteData("hello");
+    (*write_io)->AppendWriteData("world");
+    EXPECT_THAT((*write_io)->TryWriteOnce(), IsOkAndHolds(21));
+    EXPECT_EQ((*write_io)->latency_stats()->time_to_flush.Count(), 2);
+
+    EXPECT_THAT((*read_io)->TryReadOnce(1024), IsOkAndHolds(21));
+    (*read_io)->ConsumeReadData(20);
+    EXPECT_EQ((*read_io)->latency_stats()->time_in_buffer.Count(), 0);
+    (*read_io)->ConsumeReadData(1);
+    EXPECT_EQ((*read_io)->latency_stats()->time_in_buffer.Count(), 1);
+    utils::SetMetricsEnabled(false);
+
+    // Aggregated into the registered histograms.
+    EXPECT_EQ(time_to_flush->Count() - flushed, 2);
+    EXPECT_EQ(time_in_buffer->Count() - consumed, 1);
+}
+
+TEST(NonblockingIO, Eof) {
+    int pipefd[2];
+    EXPECT_EQ(pipe(pipefd), 0);
+    auto read_io = NonblockingIO::Create(std::make_unique<File>(pipefd[0]));
+    EXPECT_OK(read_io);
+    EXPECT_THAT((*read_io)->TryReadOnce(1024), IsOkAndHolds(0));
+    EXPECT_FALSE((*read_io)->eof());
+
+    EXPECT_EQ(close(pipefd[1]), 0);
+    EXPECT_THAT((*read_io)->TryReadOnce(1024), IsOkAndHolds(0));
+    EXPECT_TRUE((*read_io)->eof());
+}
+
+TEST(NonblockingIO, Watermarks) {
+    int pipefd[2];
+    ASSERT_EQ(pipe(pipefd), 0);
+    File reader(pipefd[0]);
+    auto write_io = *NonblockingIO::Create(std::make_unique<File>(pipefd[1]));
+    int pauses = 0;
+    int resumes = 0;
+    BackpressureOptions options;
+    options.low_watermark = 100;
+    options.high_watermark = 1000;
+    options.on_pause = [&]() { pauses++; };
+    options.on_resume = [&]() { resumes++; };
+    write_io->SetBackpressure(options);
+
+    EXPECT_TRUE(write_io->AppendWriteData(std::string(1000, 'x')));
+    EXPECT_FALSE(write_io->AppendWriteData("y"));
+    EXPECT_FALSE(write_io->AppendWriteData("z"));
+    EXPECT_TRUE(write_io->write_paused());
+    EXPECT_EQ(pauses, 1);
+
+    // The pipe takes it all, the buffer drains below the low watermark.
+    EXPECT_THAT(write_io->TryWriteOnce(), IsOkAndHolds(1002));
+    EXPECT_FALSE(write_io->write_paused());
+    EXPECT_EQ(resumes, 1);
+    EXPECT_TRUE(write_io->AppendWriteData("again"));
+    EXPECT_EQ(pauses, 1);
+}
+
+TEST(NonblockingIO, BufferBudget) {
+    BufferBudget budget(1000);
+    int fds[2][2];
+    std::unique_ptr<NonblockingIO> ios[2];
+    for (int i = 0; i < 2; i++) {
+        ASSERT_EQ(pipe(fds[i]), 0);
+        ios[i] = *NonblockingIO::Create(std::make_unique<File>(fds[i][1]));
+        BackpressureOptions options;
+        options.low_watermark = 10;
+        options.budget = &budget;
+        ios[i]->SetBackpressure(options);
+    }
+
+    // A slow peer fills the budget.
+    EXPECT_TRUE(ios[0]->AppendWriteData(std::string(1000, 'x')));
+    EXPECT_FALSE(ios[0]->AppendWriteData("x"));
+    EXPECT_EQ(budget.used(), 1001);
+    // A healthy peer with little buffered keeps going.
+    EXPECT_TRUE(ios[1]->AppendWriteData("hello"));
+    EXPECT_FALSE(ios[1]->AppendWriteData(std::string(100, 'y')));
+
+    EXPECT_THAT(ios[1]->TryWriteOnce(), IsOkAndHolds(105));
+    EXPECT_FALSE(ios[1]->write_paused());
+    EXPECT_EQ(budget.used(), 1001);
+    // Destroying a connection gives its buffer back.
+    ios[0].reset();
+    EXPECT_EQ(budget.used(), 0);
+    EXPECT_TRUE(ios[1]->AppendWriteData(std::string(500, 'z')));
+    ios[1].reset();
+    EXPECT_EQ(budget.used(), 0);
+    for (int i = 0; i < 2; i++) {
+        close(fds[i][0]);
+    }
+}
+
+TEST(NonblockingIO, RateLimiters) {
+    int pipefd[2];
+    ASSERT_EQ(pipe(pipefd), 0);
+    auto read_io = *NonblockingIO::Create(std::make_unique<File>(pipefd[0]));
+    auto write_io = *NonblockingIO::Create(std::make_unique<File>(pipefd[1]));
+    // Bursts of 100 bytes, refilled slowly enough for the test.
+    utils::RateLimiter::Options options;
+    options.bytes_per_second = 10;
+    options.burst = absl::Seconds(10);
+    utils::RateLimiter read_limiter(options);
+    utils::RateLimiter write_limiter(options);
+    read_io->SetRateLimiters(&read_limiter, nullptr);
+    write_io->SetRateLimiters(nullptr, &write_limiter);
+
+    write_io->AppendWriteData(std::string(150, 'x'));
+    EXPECT_THAT(write_io->TryWriteOnce(), IsOkAndHolds(100));
+    EXPECT_FALSE(write_io->throttled());
+    EXPECT_THAT(write_io->TryWriteOnce(), IsOkAndHolds(0));
+    EXPECT_TRUE(write_io->throttled());
+    EXPECT_GT(write_io->throttle_delay(), absl::ZeroDuration());
+    EXPECT_EQ(write_io->write_buffer_size(), 50);
+
+    EXPECT_THAT(read_io->TryReadOnce(60), IsOkAndHolds(60));
+    EXPECT_THAT(read_io->TryReadOnce(60), IsOkAndHolds(40));
+    EXPECT_THAT(read_io->TryReadOnce(60), IsOkAndHolds(0));
+    EXPECT_TRUE(read_io->throttled());
+    EXPECT_FALSE(read_io->eof());
+
+    EXPECT_EQ(write_limiter.GetStats().bytes, 100);
+    EXPECT_EQ(write_limiter.GetStats().throttled_ops, 1);
+    EXPECT_EQ(read_limiter.GetStats().ops, 2);
+}
+
 }  // namespace
 }  // namespace file
@@ -0,0 +1,549 @@
+#include "file/record.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <thread>
+
+#include "absl/strings/str_format.h"
+#include "crc32c/crc32c.h"
+#include "glog/logging.h"
+#include "snappy.h"
+#include "utils/errno_status.h"
+#include "utils/status_macros.h"
+
+namespace file {
+
+namespace {
+
+constexpr uint32_t kBlockMagic = 0x42524254;  // "TBRB"
+constexpr size_t kBlockHeaderSize = 28;
+constexpr size_t kRecordHeaderSize = 8;
+// Together with `block_size` < 2GB, the sizes of a block fit in 32 bits.
+constexpr size_t kMaxRecordSize = (1u << 31) - kRecordHeaderSize;
+
+enum Compression : uint8_t {
+    kNoCompression = 0,
+    kSnappyCompression = 1,
+};
+
+void EncodeFixed32(char* out, uint32_t value) {
+    out[0] = static_cast<char>(value);
+    out[1] = static_cast<char>(value >> 8);
+    out[2] = static_cast<char>(value >> 16);
+    out[3] = static_cast<char>(value >> 24);
+}
+
+uint32_t DecodeFixed32(const char* in) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(in);
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) |
+           (static_cast<uint32_t>(p[3]) << 24);
+}
+
+// Encodes the records of a block into the header and payload written to the
+// file. The payload is stored uncompressed if compression does not pay off.
+std::string EncodeBlock(const std::string& raw, uint32_t num_records,
+                        bool compress) {
+    std::string out;
+    Compression compression = kNoCompression;
+    if (compress) {
+        out.resize(kBlockHeaderSize + snappy::MaxCompressedLength(raw.size()));
+        size_t compressed_size;
+        snappy::RawCompress(raw.data(), raw.size(), &out[kBlockHeaderSize],
+                            &compressed_size);
+        if (compressed_size < raw.size() - raw.size() / 8) {
+            out.resize(kBlockHeaderSize + compressed_size);
+            compression = kSnappyCompression;
+        }
+    }
+    if (compression == kNoCompression) {
+        out.resize(kBlockHeaderSize);
+        out.append(raw);
+    }
+
+    size_t stored_size = out.size() - kBlockHeaderSize;
+    char* header = out.data();
+    EncodeFixed32(header, kBlockMagic);
+    header[4] = compression;
+    header[5] = header[6] = header[7] = 0;
+    EncodeFixed32(header + 8, stored_size);
+    EncodeFixed32(header + 12, raw.size());
+    EncodeFixed32(header + 16, num_records);
+    EncodeFixed32(header + 20,
+                  crc32c::Crc32c(header + kBlockHeaderSize, stored_size));
+    EncodeFixed32(header + 24, crc32c::Crc32c(header, 24));
+    return out;
+}
+
+// Reads `count` bytes at `offset`, fewer only at the end of the file.
+absl::Status PReadFull(File* file, std::string& out, size_t count,
+                       off_t offset) {
+    out.resize(count);
+    size_t pos = 0;
+    while (pos < count) {
+        ssize_t ret = pread(file->fd(), &out[pos], count - pos, offset + pos);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return utils::ErrnoToStatus(errno);
+        }
+        if (ret == 0) {
+            break;
+        }
+        pos += ret;
+    }
+    out.resize(pos);
+    return absl::OkStatus();
+}
+
+// Parses the record at `pos` of the decoded block `raw` and moves `pos`
+// past it.
+absl::Status ParseRecord(absl::string_view raw, size_t& pos, bool verify,
+                         std::string& out) {
+    if (raw.size() - pos < kRecordHeaderSize) {
+        return absl::DataLossError(
+            absl::StrFormat("Truncated record header at %d", pos));
+    }
+    uint32_t length = DecodeFixed32(raw.data() + pos);
+    uint32_t crc = DecodeFixed32(raw.data() + pos + 4);
+    if (raw.size() - pos - kRecordHeaderSize < length) {
+        return absl::DataLossError(
+            absl::StrFormat("Truncated record of %d bytes at %d", length, pos));
+    }
+    const char* data = raw.data() + pos + kRecordHeaderSize;
+    if (verify && crc32c::Crc32c(data, length) != crc) {
+        return absl::DataLossError(
+            absl::StrFormat("Record checksum mismatch at %d", pos));
+    }
+    out.assign(data, length);
+    pos += kRecordHeaderSize + length;
+    return absl::OkStatus();
+}
+
+}  // namespace
+
+RecordWriter::~RecordWriter() {
+    if (file_->fd() >= 0) {
+        auto status = Close();
+        if (!status.ok()) {
+            LOG(ERROR) << status;
+        }
+    }
+}
+
+absl::StatusOr<std::unique_ptr<RecordWriter>> RecordWriter::Open(
+    absl::string_view path, const Options& options) {
+    ASSIGN_OR_RETURN(auto file,
+                     File::Open(path, O_WRONLY | O_CREAT | O_APPEND, 0644));
+    return std::make_unique<RecordWriter>(std::move(file), options);
+}
+
+absl::Status RecordWriter::Append(absl::string_view record) {
+    if (record.size() > kMaxRecordSize) {
+        return absl::InvalidArgumentError(
+            absl::StrFormat("Record of %d bytes is too large", record.size()));
+    }
+
+    std::string raw;
+    uint32_t num_records;
+    uint64_t seq;
+    {
+        absl::MutexLock lock(&mu_);
+        RETURN_IF_ERROR(status_);
+        char header[kRecordHeaderSize];
+        EncodeFixed32(header, record.size());
+        EncodeFixed32(header + 4, crc32c::Crc32c(record.data(), record.size()));
+        block_.append(header, kRecordHeaderSize);
+        block_.append(record.data(), record.size());
+        block_records_++;
+        if (block_.size() < options_.block_size) {
+            return absl::OkStatus();
+        }
+        seq = TakeBlock(raw, num_records);
+    }
+    return WriteBlock(seq, raw, num_records);
+}
+
+uint64_t RecordWriter::TakeBlock(std::string& raw, uint32_t& num_records) {
+    raw.swap(block_);
+    block_.clear();
+    block_.reserve(options_.block_size + kRecordHeaderSize);
+    num_records = block_records_;
+    block_records_ = 0;
+    return next_seq_++;
+}
+
+absl::Status RecordWriter::WriteBlock(uint64_t seq, const std::string& raw,
+                                      uint32_t num_records) {
+    // Compression runs concurrently in the appending threads, only the write
+    // is ordered.
+    std::string block = EncodeBlock(raw, num_records, options_.compress);
+
+    // Only the thread of the next block passes, it writes without holding
+    // the lock so that other threads keep appending.
+    auto is_next = [this, seq]() { return written_seq_ == seq; };
+    mu_.LockWhen(absl::Condition(&is_next));
+    absl::Status status = status_;
+    mu_.Unlock();
+
+    if (status.ok()) {
+        status = file_->WriteAll(block);
+    }
+
+    absl::MutexLock lock(&mu_);
+    if (status_.ok()) {
+        status_ = status;
+    }
+    written_seq_++;
+    return status_;
+}
+
+absl::Status RecordWriter::Flush() {
+    std::string raw;
+    uint32_t num_records;
+    uint64_t seq;
+    {
+        absl::MutexLock lock(&mu_);
+        RETURN_IF_ERROR(status_);
+        if (block_.empty()) {
+            // Waits for the blocks taken by other threads.
+            uint64_t target = next_seq_;
+            auto written = [this, target]() { return written_seq_ >= target; };
+            mu_.Await(absl::Condition(&written));
+            return status_;
+        }
+        seq = TakeBlock(raw, num_records);
+    }
+    RETURN_IF_ERROR(WriteBlock(seq, raw, num_records));
+
+    absl::MutexLock lock(&mu_);
+    auto written = [this, seq]() { return written_seq_ > seq; };
+    mu_.Await(absl::Condition(&written));
+    return status_;
+}
+
+absl::Status RecordWriter::Sync() {
+    RETURN_IF_ERROR(Flush());
+    uint64_t target;
+    {
+        absl::MutexLock lock(&mu_);
+        target = written_seq_;
+    }
+
+    // Callers queue up here while an fsync is in progress, the next fsync
+    // covers all of them.
+    absl::MutexLock lock(&sync_mu_);
+    if (synced_seq_ >= target) {
+        return absl::OkStatus();
+    }
+    {
+        absl::MutexLock lock(&mu_);
+        target = written_seq_;
+    }
+    if (fdatasync(file_->fd()) != 0) {
+        return utils::ErrnoToStatus(errno);
+    }
+    synced_seq_ = target;
+    return absl::OkStatus();
+}
+
+absl::Status RecordWriter::Close() {
+    RETURN_IF_ERROR(Flush());
+    return file_->Close();
+}
+
+absl::StatusOr<std::unique_ptr<RecordReader>> RecordReader::Open(
+    absl::string_view path, const Options& options) {
+    ASSIGN_OR_RETURN(auto file, File::Open(path, O_RDONLY));
+    return std::make_unique<RecordReader>(std::move(file), options);
+}
+
+absl::StatusOr<off_t> RecordReader::FileSize() {
+    struct stat st;
+    if (fstat(file_->fd(), &st) != 0) {
+        return utils::ErrnoToStatus(errno);
+    }
+    return st.st_size;
+}
+
+absl::StatusOr<bool> RecordReader::ReadBlockHeader(off_t offset,
+                                                   BlockInfo& info) {
+    std::string header;
+    RETURN_IF_ERROR(PReadFull(file_.get(), header, kBlockHeaderSize, offset));
+    if (header.size() < kBlockHeaderSize) {
+        return false;
+    }
+    if (DecodeFixed32(header.data()) != kBlockMagic ||
+        DecodeFixed32(header.data() + 24) !=
+            crc32c::Crc32c(header.data(), 24) ||
+        static_cast<uint8_t>(header[4]) > kSnappyCompression) {
+        return absl::DataLossError(
+            absl::StrFormat("Corrupted block header at offset %d", offset));
+    }
+    info.offset = offset;
+    info.stored_size = DecodeFixed32(header.data() + 8);
+    info.raw_size = DecodeFixed32(header.data() + 12);
+    info.num_records = DecodeFixed32(header.data() + 16);
+
+    ASSIGN_OR_RETURN(off_t size, FileSize());
+    return offset + static_cast<off_t>(kBlockHeaderSize + info.stored_size) <=
+           size;
+}
+
+absl::StatusOr<bool> RecordReader::NextBlock(off_t offset, BlockInfo& info) {
+    auto header = ReadBlockHeader(offset, info);
+    if (header.ok() || !absl::IsDataLoss(header.status())) {
+        return header;
+    }
+    BlockInfo next;
+    ASSIGN_OR_RETURN(bool found, FindNextBlock(offset + 1, next));
+    if (!found) {
+        return false;
+    }
+    if (!options_.skip_corrupted_blocks) {
+        return header.status();
+    }
+    LOG(WARNING) << "Skipping corrupted data from " << offset << " to "
+                 << next.offset;
+    info = next;
+    return true;
+}
+
+absl::StatusOr<bool> RecordReader::FindNextBlock(off_t offset,
+                                                 BlockInfo& info) {
+    constexpr size_t kChunkSize = 64 << 10;
+    char magic[4];
+    EncodeFixed32(magic, kBlockMagic);
+
+    std::string chunk;
+    while (true) {
+        // Chunks overlap by 3 bytes, so that a magic split between two chunks
+        // is found.
+        RETURN_IF_ERROR(PReadFull(file_.get(), chunk, kChunkSize, offset));
+        if (chunk.size() < sizeof(magic)) {
+            return false;
+        }
+        absl::string_view view(chunk);
+        for (size_t pos = view.find(absl::string_view(magic, sizeof(magic)));
+             pos != absl::string_view::npos;
+             pos = view.find(absl::string_view(magic, sizeof(magic)),
+                             pos + 1)) {
+            auto header = ReadBlockHeader(offset + pos, info);
+            if (header.ok() && *header) {
+                return true;
+            }
+            if (!header.ok() && !absl::IsDataLoss(header.status())) {
+                return header.status();
+            }
+        }
+        offset += chunk.size() - (sizeof(magic) - 1);
+    }
+}
+
+absl::Status RecordReader::ReadBlock(const BlockInfo& info, std::string& raw) {
+    std::string stored;
+    RETURN_IF_ERROR(PReadFull(file_.get(), stored, info.stored_size,
+                              info.offset + kBlockHeaderSize));
+    std::string header;
+    RETURN_IF_ERROR(
+        PReadFull(file_.get(), header, kBlockHeaderSize, info.offset));
+    if (stored.size() < info.stored_size ||
+        header.size() < kBlockHeaderSize) {
+        return absl::DataLossError(
+            absl::StrFormat("Truncated block at offset %d", info.offset));
+    }
+    if (options_.verify_checksums &&
+        crc32c::Crc32c(stored.data(), stored.size()) !=
+            DecodeFixed32(header.data() + 20)) {
+        return absl::DataLossError(absl::StrFormat(
+            "Block checksum mismatch at offset %d", info.offset));
+    }
+
+    if (header[4] == kSnappyCompression) {
+        size_t length;
+        if (!snappy::GetUncompressedLength(stored.data(), stored.size(),
+                                           &length) ||
+            length != info.raw_size) {
+            return absl::DataLossError(absl::StrFormat(
+                "Corrupted compressed block at offset %d", info.offset));
+        }
+        raw.resize(length);
+        if (!snappy::RawUncompress(stored.data(), stored.size(), raw.data())) {
+            return absl::DataLossError(absl::StrFormat(
+                "Corrupted compressed block at offset %d", info.offset));
+        }
+    } else {
+        if (stored.size() != info.raw_size) {
+            return absl::DataLossError(absl::StrFormat(
+                "Block size mismatch at offset %d", info.offset));
+        }
+        raw = std::move(stored);
+    }
+    return absl::OkStatus();
+}
+
+absl::StatusOr<bool> RecordReader::ReadRecord(std::string& out) {
+    while (true) {
+        ASSIGN_OR_RETURN(bool has_block, FillBlock());
+        if (!has_block) {
+            return false;
+        }
+        auto status =
+            ParseRecord(block_, block_pos_, options_.verify_checksums, out);
+        if (status.ok()) {
+            return true;
+        }
+        // The records after a corrupted one cannot be located, drops the
+        // rest of the block.
+        block_pos_ = block_.size();
+        if (!options_.skip_corrupted_blocks) {
+            return status;
+        }
+        LOG(WARNING) << status;
+    }
+}
+
+absl::StatusOr<bool> RecordReader::FillBlock() {
+    while (block_pos_ >= block_.size()) {
+        BlockInfo info;
+        ASSIGN_OR_RETURN(bool found, NextBlock(offset_, info));
+        if (!found) {
+            return false;
+        }
+        auto status = ReadBlock(info, block_);
+        if (!status.ok()) {
+            block_.clear();
+            if (!absl::IsDataLoss(status)) {
+                return status;
+            }
+            // A corrupted last block is a torn write.
+            BlockInfo next;
+            ASSIGN_OR_RETURN(bool more, FindNextBlock(info.offset + 1, next));
+            if (!more) {
+                return false;
+            }
+            if (!options_.skip_corrupted_blocks) {
+                return status;
+            }
+            LOG(WARNING) << status;
+            offset_ = next.offset;
+            continue;
+        }
+        offset_ = info.offset + kBlockHeaderSize + info.stored_size;
+        valid_end_ = offset_;
+        block_pos_ = 0;
+    }
+    return true;
+}
+
+absl::StatusOr<std::vector<RecordReader::BlockInfo>>
+RecordReader::ReadBlockIndex() {
+    std::vector<BlockInfo> index;
+    off_t offset = 0;
+    while (true) {
+        BlockInfo info;
+        ASSIGN_OR_RETURN(bool found, NextBlock(offset, info));
+        if (!found) {
+            break;
+        }
+        index.push_back(info);
+        offset = info.offset + kBlockHeaderSize + info.stored_size;
+    }
+    valid_end_ = offset;
+    index_ = index;
+    return index;
+}
+
+absl::Status RecordReader::SeekToBlock(size_t index) {
+    if (!index_.ok()) {
+        RETURN_IF_ERROR(ReadBlockIndex());
+    }
+    if (index >= index_->size()) {
+        return absl::OutOfRangeError(absl::StrFormat(
+            "Block %d of %d blocks", index, index_->size()));
+    }
+    offset_ = (*index_)[index].offset;
+    block_.clear();
+    block_pos_ = 0;
+    return absl::OkStatus();
+}
+
+absl::StatusOr<std::vector<std::string>> RecordReader::ReadAllParallel(
+    int parallelism) {
+    ASSIGN_OR_RETURN(auto index, ReadBlockIndex());
+
+    std::vector<std::vector<std::string>> blocks(index.size());
+    std::vector<absl::Status> statuses(index.size());
+    std::atomic<size_t> next{0};
+    auto decode = [&]() {
+        std::string raw;
+        for (size_t i = next++; i < index.size(); i = next++) {
+            statuses[i] = ReadBlock(index[i], raw);
+            if (!statuses[i].ok()) {
+                continue;
+            }
+            size_t pos = 0;
+            blocks[i].resize(index[i].num_records);
+            for (auto& record : blocks[i]) {
+                statuses[i] = ParseRecord(raw, pos, options_.verify_checksums,
+                                          record);
+                if (!statuses[i].ok()) {
+                    break;
+                }
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int i = 1; i < parallelism; i++) {
+        threads.emplace_back(decode);
+    }
+    decode();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    std::vector<std::string> records;
+    for (size_t i = 0; i < index.size(); i++) {
+        if (!statuses[i].ok()) {
+            if (!absl::IsDataLoss(statuses[i])) {
+                return statuses[i];
+            }
+            // A corrupted last block is a torn write.
+            if (i + 1 == index.size()) {
+                valid_end_ = index[i].offset;
+                break;
+            }
+            if (!options_.skip_corrupted_blocks) {
+                return statuses[i];
+            }
+            LOG(WARNING) << statuses[i];
+            continue;
+        }
+        for (auto& record : blocks[i]) {
+            records.push_back(std::move(record));
+        }
+    }
+    return records;
+}
+
+absl::StatusOr<off_t> RecoverRecordFile(absl::string_view path) {
+    ASSIGN_OR_RETURN(auto reader, RecordReader::Open(path, {}));
+    std::string record;
+    while (true) {
+        ASSIGN_OR_RETURN(bool has_record, reader->ReadRecord(record));
+        if (!has_record) {
+            break;
+        }
+    }
+    std::string path_str(path);
+    if (truncate(path_str.c_str(), reader->valid_end()) != 0) {
+        return utils::ErrnoToStatus(errno);
+    }
+    return reader->valid_end();
+}
+
+}  // namespace file
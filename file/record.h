@@ -0,0 +1,183 @@
+#ifndef TOOLBASE_FILE_RECORD_H_
+#define TOOLBASE_FILE_RECORD_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "file/file.h"
+
+namespace file {
+
+// Record files are append-only logs of binary records.
+//
+// The file is a sequence of blocks, each block holds up to
+// `RecordWriter::Options::block_size` bytes of records (a larger record gets
+// a block of its own) and is optionally Snappy compressed. Blocks are not
+// padded to a fixed size on disk: a compressed block takes only its
+// compressed size, and a flushed partial block its records. Seeking walks
+// the block headers instead (`ReadBlockIndex`):
+//  block header (28 bytes, little endian):
+//   magic u32 | compression u8 | reserved u8[3] | stored_size u32 |
+//   raw_size u32 | num_records u32 | payload_crc u32 | header_crc u32
+//  payload: `stored_size` bytes, which decompress to `raw_size` bytes of
+//   records: length u32 | crc32c(data) u32 | data
+// The header CRC lets readers walk the blocks by reading headers only, the
+// payload CRC and the per record CRC detect corruption.
+
+// Writes records, `Append` can be called from many threads. Blocks are
+// compressed by the appending threads in parallel and written in order with
+// one write per block; concurrent `Sync` calls share one fsync.
+// Example:
+//  ASSIGN_OR_RETURN(auto writer, RecordWriter::Open("/log", {}));
+//  RETURN_IF_ERROR(writer->Append("event"));
+//  RETURN_IF_ERROR(writer->Sync());
+class RecordWriter {
+   public:
+    struct Options {
+        // Records are buffered until the block has `block_size` bytes, must
+        // be less than 2GB.
+        size_t block_size = 64 << 10;
+        bool compress = true;
+    };
+
+    RecordWriter(std::unique_ptr<File> file, const Options& options)
+        : file_(std::move(file)), options_(options) {}
+    ~RecordWriter();
+
+    // Opens `path` for appending, creates it if not exists.
+    static absl::StatusOr<std::unique_ptr<RecordWriter>> Open(
+        absl::string_view path, const Options& options);
+
+    // Buffers a record, writes the current block once it is full. Records
+    // are up to 2GB.
+    absl::Status Append(absl::string_view record);
+
+    // Writes the buffered records as a (possibly partial) block.
+    absl::Status Flush();
+
+    // Flushes and fsyncs, a call returns after all records appended before
+    // it are durable.
+    absl::Status Sync();
+
+    absl::Status Close();
+
+   private:
+    // Takes the current block out for writing, returns its sequence number.
+    uint64_t TakeBlock(std::string& raw, uint32_t& num_records)
+        ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+    // Encodes and writes a taken block, waiting for earlier blocks first.
+    absl::Status WriteBlock(uint64_t seq, const std::string& raw,
+                            uint32_t num_records);
+
+    std::unique_ptr<File> file_;
+    const Options options_;
+
+    absl::Mutex mu_;
+    std::string block_ ABSL_GUARDED_BY(mu_);
+    uint32_t block_records_ ABSL_GUARDED_BY(mu_) = 0;
+    // Sequence number of the next taken block.
+    uint64_t next_seq_ ABSL_GUARDED_BY(mu_) = 0;
+    // Blocks with sequence < `written_seq_` have been written.
+    uint64_t written_seq_ ABSL_GUARDED_BY(mu_) = 0;
+    // The first write error, the writer is unusable afterwards.
+    absl::Status status_ ABSL_GUARDED_BY(mu_);
+
+    absl::Mutex sync_mu_ ABSL_ACQUIRED_BEFORE(mu_);
+    uint64_t synced_seq_ ABSL_GUARDED_BY(sync_mu_) = 0;
+};
+
+// Reads record files.
+// Example:
+//  ASSIGN_OR_RETURN(auto reader, RecordReader::Open("/log", {}));
+//  std::string record;
+//  while (true) {
+//      ASSIGN_OR_RETURN(bool has_record, reader->ReadRecord(record));
+//      if (!has_record) break;
+//      ...
+//  }
+class RecordReader {
+   public:
+    struct Options {
+        bool verify_checksums = true;
+        // Skips corrupted blocks in the middle of the file by scanning for
+        // the next valid block header, instead of returning DataLoss.
+        bool skip_corrupted_blocks = false;
+    };
+
+    struct BlockInfo {
+        off_t offset;
+        uint32_t stored_size;
+        uint32_t raw_size;
+        uint32_t num_records;
+    };
+
+    RecordReader(std::unique_ptr<File> file, const Options& options)
+        : file_(std::move(file)), options_(options) {}
+
+    static absl::StatusOr<std::unique_ptr<RecordReader>> Open(
+        absl::string_view path, const Options& options);
+
+    // Reads the next record into `out`, returns false at the end of the
+    // valid data. A torn block at the tail of the file is treated as the end.
+    absl::StatusOr<bool> ReadRecord(std::string& out);
+
+    // Walks the block headers, from the start of the file, without reading
+    // the payloads. Stops at a torn or corrupted tail.
+    absl::StatusOr<std::vector<BlockInfo>> ReadBlockIndex();
+
+    // Positions the reader at the start of block `index` of
+    // `ReadBlockIndex()`.
+    absl::Status SeekToBlock(size_t index);
+
+    // Decodes all the blocks with `parallelism` threads, returns the records
+    // in file order.
+    absl::StatusOr<std::vector<std::string>> ReadAllParallel(int parallelism);
+
+    // The end offset of the last valid block seen by `ReadBlockIndex` or
+    // `ReadRecord`, a writer recovering a torn file truncates to it.
+    off_t valid_end() const { return valid_end_; }
+
+   private:
+    // Reads and validates the block header at `offset`. Returns false if
+    // the file ends before the end of the block, DataLoss if the header is
+    // corrupted.
+    absl::StatusOr<bool> ReadBlockHeader(off_t offset, BlockInfo& info);
+    // Like `ReadBlockHeader`, but a corrupted header not followed by any
+    // valid block is a torn tail and returns false, and with
+    // `skip_corrupted_blocks` the following valid block is returned.
+    absl::StatusOr<bool> NextBlock(off_t offset, BlockInfo& info);
+    // Finds the first valid block header at or after `offset`.
+    absl::StatusOr<bool> FindNextBlock(off_t offset, BlockInfo& info);
+    // Reads, verifies and decompresses the block payload.
+    absl::Status ReadBlock(const BlockInfo& info, std::string& raw);
+    // Reads the next block into `block_` once its records are consumed,
+    // returns false at the end of the valid data.
+    absl::StatusOr<bool> FillBlock();
+    absl::StatusOr<off_t> FileSize();
+
+    std::unique_ptr<File> file_;
+    const Options options_;
+
+    // The sequential read position.
+    off_t offset_ = 0;
+    std::string block_;
+    size_t block_pos_ = 0;
+    off_t valid_end_ = 0;
+    absl::StatusOr<std::vector<BlockInfo>> index_ =
+        absl::FailedPreconditionError("Block index not read");
+};
+
+// Truncates the torn tail of the record file at `path`, so that a writer can
+// continue appending. Returns the new size.
+absl::StatusOr<off_t> RecoverRecordFile(absl::string_view path);
+
+}  // namespace file
+
+#endif  // TOOLBASE_FILE_RECORD_H_
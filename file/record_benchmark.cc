@@ -0,0 +1,81 @@
+#include <thread>
+
+#include "benchmark/benchmark.h"
+#include "file/filesystem.h"
+#include "file/record.h"
+
+namespace file {
+namespace {
+
+constexpr absl::string_view kFile = "/tmp/record_benchmark";
+
+// Appends 10000 records of `range(0)` bytes from each of `range(2)`
+// threads per iteration.
+void BM_RecordAppend(benchmark::State& state) {
+    constexpr int kRecords = 10000;
+    const int num_threads = state.range(2);
+    RecordWriter::Options options;
+    options.compress = state.range(1);
+    auto writer = *RecordWriter::Open(kFile, options);
+
+    std::string record(state.range(0), 'x');
+    for (auto _ : state) {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < num_threads; t++) {
+            threads.emplace_back([&]() {
+                for (int i = 0; i < kRecords; i++) {
+                    writer->Append(record).IgnoreError();
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * num_threads * kRecords);
+    state.SetBytesProcessed(state.iterations() * num_threads * kRecords *
+                            record.size());
+
+    writer->Close().IgnoreError();
+    Unlink(kFile).IgnoreError();
+}
+BENCHMARK(BM_RecordAppend)
+    ->ArgsProduct({{64, 1024}, {0, 1}, {1, 4}})
+    ->UseRealTime();
+
+void BM_RecordRead(benchmark::State& state) {
+    {
+        auto writer = *RecordWriter::Open(kFile, {});
+        std::string record(state.range(0), 'x');
+        for (int i = 0; i < (64 << 20) / state.range(0); i++) {
+            writer->Append(record).IgnoreError();
+        }
+    }
+
+    size_t bytes = 0;
+    for (auto _ : state) {
+        auto reader = *RecordReader::Open(kFile, {});
+        if (state.range(1) == 0) {
+            std::string record;
+            while (*reader->ReadRecord(record)) {
+                bytes += record.size();
+            }
+        } else {
+            auto records = reader->ReadAllParallel(state.range(1));
+            if (!records.ok()) {
+                state.SkipWithError("cannot read the records");
+                break;
+            }
+            for (const auto& record : *records) {
+                bytes += record.size();
+            }
+        }
+    }
+    state.SetBytesProcessed(bytes);
+    Unlink(kFile).IgnoreError();
+}
+// The second argument is the parallelism, 0 reads sequentially.
+BENCHMARK(BM_RecordRead)->ArgsProduct({{64, 1024}, {0, 4}})->UseRealTime();
+
+}  // namespace
+}  // namespace file
@@ -0,0 +1,251 @@
+#include "file/record.h"
+
+#include <thread>
+
+#include "absl/strings/str_cat.h"
+#include "file/filesystem.h"
+#include "gtest/gtest.h"
+#include "utils/testing.h"
+
+namespace file {
+namespace {
+
+using ::testing::ElementsAreArray;
+using ::testing::SizeIs;
+using ::utils::testing::IsOkAndHolds;
+using ::utils::testing::StatusIs;
+
+static constexpr absl::string_view kFile = "/tmp/test_record_file";
+
+class Record : public ::testing::Test {
+   protected:
+    void SetUp() override {
+        if (*Exists(kFile)) {
+            ASSERT_OK(Unlink(kFile));
+        }
+    }
+    void TearDown() override {
+        if (*Exists(kFile)) {
+            ASSERT_OK(Unlink(kFile));
+        }
+    }
+
+    // Writes `count` records to blocks of 1KB.
+    std::vector<std::string> WriteRecords(int count, bool compress) {
+        RecordWriter::Options options;
+        options.block_size = 1024;
+        options.compress = compress;
+        auto writer = RecordWriter::Open(kFile, options);
+        EXPECT_OK(writer);
+
+        std::vector<std::string> records;
+        for (int i = 0; i < count; i++) {
+            records.push_back(std::string(i % 100, 'a' + i % 26) +
+                              absl::StrCat(i));
+            EXPECT_OK((*writer)->Append(records.back()));
+        }
+        EXPECT_OK((*writer)->Close());
+        return records;
+    }
+
+    std::vector<std::string> ReadRecords(const RecordReader::Options& options) {
+        auto reader = RecordReader::Open(kFile, options);
+        EXPECT_OK(reader);
+        std::vector<std::string> records;
+        std::string record;
+        while (*(*reader)->ReadRecord(record)) {
+            records.push_back(record);
+        }
+        return records;
+    }
+
+    void CorruptByte(off_t offset) {
+        auto file = *File::Open(kFile, O_RDWR);
+        auto byte = *file->PRead(1, offset);
+        byte[0] ^= 0x55;
+        EXPECT_OK(file->PWrite(byte, offset));
+    }
+};
+
+TEST_F(Record, WriteRead) {
+    for (bool compress : {false, true}) {
+        SetUp();
+        auto records = WriteRecords(1000, compress);
+        EXPECT_THAT(ReadRecords({}), ElementsAreArray(records));
+    }
+}
+
+TEST_F(Record, EmptyRecords) {
+    auto writer = *RecordWriter::Open(kFile, {});
+    EXPECT_OK(writer->Append(""));
+    EXPECT_OK(writer->Append("x"));
+    EXPECT_OK(writer->Append(""));
+    EXPECT_OK(writer->Flush());
+    EXPECT_THAT(ReadRecords({}), ElementsAreArray({"", "x", ""}));
+}
+
+TEST_F(Record, AppendToExisting) {
+    auto records = WriteRecords(10, true);
+    auto more = WriteRecords(10, true);
+    records.insert(records.end(), more.begin(), more.end());
+    EXPECT_THAT(ReadRecords({}), ElementsAreArray(records));
+}
+
+TEST_F(Record, ConcurrentAppend) {
+    constexpr int kThreads = 4;
+    constexpr int kRecords = 5000;
+    {
+        RecordWriter::Options options;
+        options.block_size = 4096;
+        auto writer = *RecordWriter::Open(kFile, options);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < kThreads; t++) {
+            threads.emplace_back([&writer, t]() {
+                for (int i = 0; i < kRecords; i++) {
+                    ASSERT_OK(writer->Append(absl::StrCat(t, ":", i)));
+                    if (i % 1000 == 0) {
+                        ASSERT_OK(writer->Sync());
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+    // Records of every thread are in order.
+    auto records = ReadRecords({});
+    ASSERT_THAT(records, SizeIs(kThreads * kRecords));
+    std::vector<int> next(kThreads, 0);
+    for (const auto& record : records) {
+        int t = record[0] - '0';
+        ASSERT_EQ(record, absl::StrCat(t, ":", next[t]));
+        next[t]++;
+    }
+}
+
+TEST_F(Record, BlockIndexAndSeek) {
+    auto records = WriteRecords(1000, true);
+    auto reader = *RecordReader::Open(kFile, {});
+    auto index = reader->ReadBlockIndex();
+    ASSERT_OK(index);
+    ASSERT_GT(index->size(), 10);
+
+    size_t first = 0;
+    for (size_t i = 0; i < 5; i++) {
+        first += (*index)[i].num_records;
+    }
+    EXPECT_OK(reader->SeekToBlock(5));
+    std::string record;
+    EXPECT_THAT(reader->ReadRecord(record), IsOkAndHolds(true));
+    EXPECT_EQ(record, records[first]);
+
+    EXPECT_THAT(reader->SeekToBlock(index->size()),
+                StatusIs(absl::StatusCode::kOutOfRange));
+}
+
+TEST_F(Record, ReadAllParallel) {
+    auto records = WriteRecords(5000, true);
+    auto reader = *RecordReader::Open(kFile, {});
+    EXPECT_THAT(reader->ReadAllParallel(4),
+                IsOkAndHolds(ElementsAreArray(records)));
+}
+
+TEST_F(Record, TornTail) {
+    auto records = WriteRecords(1000, false);
+    auto size = Stat(kFile)->size();
+    auto index = *(*RecordReader::Open(kFile, {}))->ReadBlockIndex();
+    const auto& last = index.back();
+    std::vector<std::string> complete(records.begin(),
+                                      records.end() - last.num_records);
+
+    // Cuts the last block in its payload.
+    ASSERT_EQ(truncate(std::string(kFile).c_str(), size - 10), 0);
+    EXPECT_THAT(ReadRecords({}), ElementsAreArray(complete));
+    auto reader = *RecordReader::Open(kFile, {});
+    EXPECT_THAT(reader->ReadAllParallel(2),
+                IsOkAndHolds(ElementsAreArray(complete)));
+
+    // Recovers and appends again.
+    EXPECT_THAT(RecoverRecordFile(kFile), IsOkAndHolds(last.offset));
+    auto writer = *RecordWriter::Open(kFile, {});
+    EXPECT_OK(writer->Append("after recovery"));
+    EXPECT_OK(writer->Close());
+    complete.push_back("after recovery");
+    EXPECT_THAT(ReadRecords({}), ElementsAreArray(complete));
+}
+
+TEST_F(Record, CorruptedLastBlockIsTorn) {
+    auto records = WriteRecords(1000, true);
+    auto index = *(*RecordReader::Open(kFile, {}))->ReadBlockIndex();
+    CorruptByte(index.back().offset + 30);
+    EXPECT_THAT(ReadRecords({}),
+                SizeIs(records.size() - index.back().num_records));
+}
+
+TEST_F(Record, CorruptedMiddleBlock) {
+    auto records = WriteRecords(1000, true);
+    auto index = *(*RecordReader::Open(kFile, {}))->ReadBlockIndex();
+    CorruptByte(index[3].offset + 30);
+
+    auto reader = *RecordReader::Open(kFile, {});
+    std::string record;
+    absl::Status status;
+    while (true) {
+        auto result = reader->ReadRecord(record);
+        if (!result.ok()) {
+            status = result.status();
+            break;
+        }
+        ASSERT_TRUE(*result);
+    }
+    EXPECT_THAT(status, StatusIs(absl::StatusCode::kDataLoss));
+    EXPECT_THAT(RecoverRecordFile(kFile),
+                StatusIs(absl::StatusCode::kDataLoss));
+
+    // Skips the corrupted block, and a corrupted header.
+    CorruptByte(index[6].offset + 8);
+    RecordReader::Options options;
+    options.skip_corrupted_blocks = true;
+    EXPECT_THAT(ReadRecords(options),
+                SizeIs(records.size() - index[3].num_records -
+                       index[6].num_records));
+}
+
+TEST_F(Record, CorruptedRecord) {
+    auto records = WriteRecords(1000, false);
+    auto index = *(*RecordReader::Open(kFile, {}))->ReadBlockIndex();
+    // The high byte of the length of the first record of the block, the
+    // block checksum is not verified.
+    CorruptByte(index[3].offset + 28 + 3);
+    RecordReader::Options options;
+    options.verify_checksums = false;
+
+    // The error is returned once, the reader goes on with the next block.
+    auto reader = *RecordReader::Open(kFile, options);
+    std::string record;
+    int num_records = 0;
+    int num_errors = 0;
+    while (true) {
+        auto result = reader->ReadRecord(record);
+        if (!result.ok()) {
+            EXPECT_THAT(result, StatusIs(absl::StatusCode::kDataLoss));
+            num_errors++;
+            continue;
+        }
+        if (!*result) {
+            break;
+        }
+        num_records++;
+    }
+    EXPECT_EQ(num_errors, 1);
+    EXPECT_EQ(num_records, records.size() - index[3].num_records);
+
+    options.skip_corrupted_blocks = true;
+    EXPECT_THAT(ReadRecords(options),
+                SizeIs(records.size() - index[3].num_records));
+}
+
+}  // namespace
+}  // namespace file
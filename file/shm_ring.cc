@@ -0,0 +1,374 @@
+#include "file/shm_ring.h"
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+
+#include "absl/strings/str_format.h"
+#include "utils/errno_status.h"
+#include "utils/status_macros.h"
+
+namespace file {
+namespace {
+
+constexpr uint64_t kMagic = 0x676e6952206d6853;  // "Shm Ring"
+constexpr size_t kHeaderAreaSize = 4096;
+constexpr int kMinSpins = 16;
+
+// A frame header word is 0 until the frame is published, then
+// (payload length << 2) | kFramePadding? | kFrameReady.
+constexpr uint64_t kFrameReady = 1;
+constexpr uint64_t kFramePadding = 2;
+
+size_t RoundUp8(size_t n) { return (n + 7) & ~size_t(7); }
+
+inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+}  // namespace
+
+// Lives at the start of the shared mapping, the indices are on their own
+// cache lines so producers and the consumer do not false share.
+struct ShmRing::Header {
+    uint64_t magic;
+    uint64_t capacity;
+    uint32_t mode;
+
+    // Producers reserve space by advancing `tail`.
+    alignas(64) std::atomic<uint64_t> tail;
+    // The consumer frees space by advancing `head`.
+    alignas(64) std::atomic<uint64_t> head;
+    alignas(64) std::atomic<uint32_t> consumer_waiting;
+    std::atomic<uint32_t> producers_waiting;
+};
+static_assert(sizeof(std::atomic<uint64_t>) == 8, "atomic must be lock-free");
+
+ShmRing::ShmRing(std::unique_ptr<File> memory, std::unique_ptr<File> data_event,
+                 std::unique_ptr<File> space_event, void* mapping,
+                 size_t mapping_size, int max_spins)
+    : memory_(std::move(memory)),
+      data_event_(std::move(data_event)),
+      space_event_(std::move(space_event)),
+      mapping_(mapping),
+      mapping_size_(mapping_size),
+      header_((Header*)mapping),
+      data_((char*)mapping + kHeaderAreaSize),
+      capacity_(header_->capacity),
+      multi_producer_(header_->mode == (uint32_t)Mode::kMultiProducer),
+      max_spins_(std::max(max_spins, 0)),
+      read_spins_(std::min(kMinSpins, max_spins_)),
+      write_spins_(std::min(kMinSpins, max_spins_)) {}
+
+ShmRing::~ShmRing() { munmap(mapping_, mapping_size_); }
+
+absl::StatusOr<std::unique_ptr<ShmRing>> ShmRing::Create(
+    const Options& options) {
+    if (options.capacity < 64 ||
+        (options.capacity & (options.capacity - 1)) != 0) {
+        return absl::InvalidArgumentError(absl::StrFormat(
+            "`capacity` = %d should be a power of two >= 64",
+            options.capacity));
+    }
+
+    int memfd = memfd_create("shm_ring", MFD_CLOEXEC);
+    if (memfd < 0) {
+        return utils::ErrnoToStatus(errno);
+    }
+    auto memory = std::make_unique<File>(memfd);
+    size_t mapping_size = kHeaderAreaSize + options.capacity;
+    if (ftruncate(memfd, mapping_size) != 0) {
+        return utils::ErrnoToStatus(errno);
+    }
+
+    int data_efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (data_efd < 0) {
+        return utils::ErrnoToStatus(errno);
+    }
+    auto data_event = std::make_unique<File>(data_efd);
+    int space_efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (space_efd < 0) {
+        return utils::ErrnoToStatus(errno);
+    }
+    auto space_event = std::make_unique<File>(space_efd);
+
+    void* mapping = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, memfd, 0);
+    if (mapping == MAP_FAILED) {
+        return utils::ErrnoToStatus(errno);
+    }
+    // The memfd is zero filled, so all frame headers start unpublished.
+    Header* header = new (mapping) Header();
+    header->magic = kMagic;
+    header->capacity = options.capacity;
+    header->mode = (uint32_t)options.mode;
+
+    return std::unique_ptr<ShmRing>(
+        new ShmRing(std::move(memory), std::move(data_event),
+                    std::move(space_event), mapping, mapping_size,
+                    options.max_spins));
+}
+
+absl::StatusOr<std::unique_ptr<ShmRing>> ShmRing::Attach(
+    std::unique_ptr<File> memory, std::unique_ptr<File> data_event,
+    std::unique_ptr<File> space_event, int max_spins) {
+    struct stat st;
+    if (fstat(memory->fd(), &st) != 0) {
+        return utils::ErrnoToStatus(errno);
+    }
+    size_t mapping_size = st.st_size;
+    if (mapping_size <= kHeaderAreaSize) {
+        return absl::InvalidArgumentError(
+            absl::StrFormat("Memory size %d is too small", mapping_size));
+    }
+
+    void* mapping = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, memory->fd(), 0);
+    if (mapping == MAP_FAILED) {
+        return utils::ErrnoToStatus(errno);
+    }
+    const Header* header = (const Header*)mapping;
+    if (header->magic != kMagic ||
+        header->capacity != mapping_size - kHeaderAreaSize) {
+        munmap(mapping, mapping_size);
+        return absl::InvalidArgumentError("Memory is not a ShmRing");
+    }
+
+    return std::unique_ptr<ShmRing>(
+        new ShmRing(std::move(memory), std::move(data_event),
+                    std::move(space_event), mapping, mapping_size, max_spins));
+}
+
+std::atomic<uint64_t>* ShmRing::FrameHeader(uint64_t pos) {
+    return (std::atomic<uint64_t>*)(data_ + (pos & (capacity_ - 1)));
+}
+
+bool ShmRing::Reserve(uint64_t pos, uint64_t size) {
+    if (multi_producer_) {
+        return header_->tail.compare_exchange_weak(pos, pos + size,
+                                                   std::memory_order_relaxed);
+    }
+    header_->tail.store(pos + size, std::memory_order_relaxed);
+    return true;
+}
+
+void ShmRing::PublishPadding(uint64_t pos, size_t to_end) {
+    uint64_t word = ((to_end - kFrameHeaderSize) << 2) | kFramePadding |
+                    kFrameReady;
+    FrameHeader(pos)->store(word, std::memory_order_release);
+}
+
+absl::StatusOr<bool> ShmRing::TryWrite(absl::string_view message) {
+    if (message.size() > max_message_size()) {
+        return absl::InvalidArgumentError(
+            absl::StrFormat("Message size %d exceeds the max message size %d",
+                            message.size(), max_message_size()));
+    }
+    const uint64_t frame_size = kFrameHeaderSize + RoundUp8(message.size());
+
+    uint64_t pos;
+    while (true) {
+        pos = header_->tail.load(std::memory_order_relaxed);
+        uint64_t head = header_->head.load(std::memory_order_acquire);
+        if (head > pos) {
+            // `pos` is stale, the consumer already read past it: the
+            // differences below would wrap around.
+            continue;
+        }
+        size_t to_end = capacity_ - (pos & (capacity_ - 1));
+        if (frame_size > to_end) {
+            // The frame does not fit before the end of the data area, pads
+            // the rest and retries from the start.
+            if (pos + to_end - head > capacity_) {
+                return false;
+            }
+            if (Reserve(pos, to_end)) {
+                PublishPadding(pos, to_end);
+            }
+            continue;
+        }
+        if (pos + frame_size - head > capacity_) {
+            return false;
+        }
+        if (Reserve(pos, frame_size)) {
+            break;
+        }
+    }
+
+    memcpy(data_ + (pos & (capacity_ - 1)) + kFrameHeaderSize, message.data(),
+           message.size());
+    FrameHeader(pos)->store((message.size() << 2) | kFrameReady,
+                            std::memory_order_release);
+
+    // Pairs with the fence in `PrepareWait`, either the consumer sees the
+    // frame or we see it waiting.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (header_->consumer_waiting.load(std::memory_order_relaxed) != 0) {
+        RETURN_IF_ERROR(Notify(data_event_.get()));
+    }
+    return true;
+}
+
+absl::StatusOr<bool> ShmRing::TryRead(std::string& out) {
+    while (true) {
+        uint64_t pos = header_->head.load(std::memory_order_relaxed);
+        std::atomic<uint64_t>* frame = FrameHeader(pos);
+        uint64_t word = frame->load(std::memory_order_acquire);
+        if (word == 0) {
+            return false;
+        }
+
+        size_t length = word >> 2;
+        char* payload = (char*)frame + kFrameHeaderSize;
+        if ((word & kFramePadding) == 0) {
+            out.assign(payload, length);
+        }
+        // Producers expect unpublished frames to be zero, wherever the next
+        // frame headers will land.
+        frame->store(0, std::memory_order_relaxed);
+        memset(payload, 0, RoundUp8(length));
+        header_->head.store(pos + kFrameHeaderSize + RoundUp8(length),
+                            std::memory_order_release);
+
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (header_->producers_waiting.load(std::memory_order_relaxed) != 0) {
+            RETURN_IF_ERROR(Notify(space_event_.get()));
+        }
+        if ((word & kFramePadding) == 0) {
+            return true;
+        }
+    }
+}
+
+absl::Status ShmRing::Write(absl::string_view message,
+                            const absl::Duration* timeout) {
+    absl::Time deadline = timeout == nullptr ? absl::InfiniteFuture()
+                                             : absl::Now() + *timeout;
+    int spins = write_spins_.load(std::memory_order_relaxed);
+    for (int i = 0; i < spins; i++) {
+        ASSIGN_OR_RETURN(bool written, TryWrite(message));
+        if (written) {
+            write_spins_.store(std::min(spins * 2, max_spins_),
+                               std::memory_order_relaxed);
+            return absl::OkStatus();
+        }
+        CpuRelax();
+    }
+    write_spins_.store(std::max(spins / 2, std::min(kMinSpins, max_spins_)),
+                       std::memory_order_relaxed);
+
+    header_->producers_waiting.fetch_add(1, std::memory_order_seq_cst);
+    absl::Status status;
+    while (true) {
+        auto written = TryWrite(message);
+        if (!written.ok() || *written) {
+            status = written.status();
+            break;
+        }
+        status = WaitEvent(space_event_.get(), deadline);
+        if (!status.ok()) {
+            break;
+        }
+    }
+    header_->producers_waiting.fetch_sub(1, std::memory_order_relaxed);
+    return status;
+}
+
+absl::Status ShmRing::Read(std::string& out, const absl::Duration* timeout) {
+    absl::Time deadline = timeout == nullptr ? absl::InfiniteFuture()
+                                             : absl::Now() + *timeout;
+    int spins = read_spins_.load(std::memory_order_relaxed);
+    for (int i = 0; i < spins; i++) {
+        ASSIGN_OR_RETURN(bool read, TryRead(out));
+        if (read) {
+            read_spins_.store(std::min(spins * 2, max_spins_),
+                              std::memory_order_relaxed);
+            return absl::OkStatus();
+        }
+        CpuRelax();
+    }
+    read_spins_.store(std::max(spins / 2, std::min(kMinSpins, max_spins_)),
+                      std::memory_order_relaxed);
+
+    while (true) {
+        // A padding frame makes `PrepareWait` return false too, `TryRead`
+        // skips it and may still find nothing.
+        ASSIGN_OR_RETURN(bool read, TryRead(out));
+        if (read) {
+            return absl::OkStatus();
+        }
+        if (PrepareWait()) {
+            absl::Status status = WaitEvent(data_event_.get(), deadline);
+            RETURN_IF_ERROR(FinishWait());
+            RETURN_IF_ERROR(status);
+        }
+    }
+}
+
+bool ShmRing::PrepareWait() {
+    header_->consumer_waiting.store(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    uint64_t pos = header_->head.load(std::memory_order_relaxed);
+    if (FrameHeader(pos)->load(std::memory_order_acquire) != 0) {
+        header_->consumer_waiting.store(0, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+absl::Status ShmRing::FinishWait() {
+    header_->consumer_waiting.store(0, std::memory_order_relaxed);
+    uint64_t value;
+    if (read(data_event_->fd(), &value, sizeof(value)) < 0 &&
+        errno != EAGAIN) {
+        return utils::ErrnoToStatus(errno);
+    }
+    return absl::OkStatus();
+}
+
+absl::Status ShmRing::Notify(File* event) {
+    uint64_t value = 1;
+    if (write(event->fd(), &value, sizeof(value)) < 0 && errno != EAGAIN) {
+        return utils::ErrnoToStatus(errno);
+    }
+    return absl::OkStatus();
+}
+
+absl::Status ShmRing::WaitEvent(File* event, absl::Time deadline) {
+    int timeout_ms = -1;
+    if (deadline != absl::InfiniteFuture()) {
+        absl::Duration left = deadline - absl::Now();
+        if (left <= absl::ZeroDuration()) {
+            return absl::DeadlineExceededError("ShmRing wait timed out");
+        }
+        timeout_ms =
+            absl::ToInt64Milliseconds(absl::Ceil(left, absl::Milliseconds(1)));
+    }
+
+    struct pollfd pfd;
+    pfd.fd = event->fd();
+    pfd.events = POLLIN;
+    int ret = poll(&pfd, 1, timeout_ms);
+    if (ret < 0 && errno != EINTR) {
+        return utils::ErrnoToStatus(errno);
+    }
+    if (event == space_event_.get() && ret > 0) {
+        // The consumer signals on every read while producers wait, a
+        // producer missing a wakeup drained by another one still has a
+        // non-empty ring whose next read wakes it.
+        uint64_t value;
+        if (read(event->fd(), &value, sizeof(value)) < 0 && errno != EAGAIN) {
+            return utils::ErrnoToStatus(errno);
+        }
+    }
+    return absl::OkStatus();
+}
+
+}  // namespace file
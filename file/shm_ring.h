@@ -0,0 +1,135 @@
+#ifndef TOOLBASE_FILE_SHM_RING_H_
+#define TOOLBASE_FILE_SHM_RING_H_
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "file/file.h"
+
+namespace file {
+
+// A lock-free ring buffer of framed messages in a shared memory mapping, for
+// passing messages between processes on the same host without syscalls on
+// the fast path.
+// There is always a single consumer, producers can be single (SPSC) or
+// multiple (MPSC). Blocking calls spin first and then park on an eventfd,
+// the eventfds are only written when the other side is parked.
+//
+// The ring is made of three files: the memfd memory and two eventfds. They
+// can be passed to another process (e.g. with `net::NetSocket::SendFds`),
+// which then uses `ShmRing::Attach`.
+//
+// Example:
+//  ASSIGN_OR_RETURN(auto ring, ShmRing::Create(ShmRing::Options()));
+//  // Producer
+//  RETURN_IF_ERROR(ring->Write("hello world", nullptr));
+//  // Consumer
+//  std::string message;
+//  RETURN_IF_ERROR(ring->Read(message, nullptr));
+//
+// EPoll integration on the consumer side:
+//  epoll->Add(ring->data_event(), EPOLLIN);
+//  while (true) {
+//      while (*ring->TryRead(message)) { ... }
+//      if (ring->PrepareWait()) {
+//          epoll->Wait(...);  // Wakes up on EPOLLIN of `data_event()`.
+//          RETURN_IF_ERROR(ring->FinishWait());
+//      }
+//  }
+class ShmRing {
+   public:
+    enum class Mode {
+        kSingleProducer = 0,
+        kMultiProducer = 1,
+    };
+
+    struct Options {
+        // Size of the data area in bytes, must be a power of two.
+        size_t capacity = 1 << 20;
+        Mode mode = Mode::kSingleProducer;
+        // Upper bound of the adaptive spinning before blocking.
+        int max_spins = 4096;
+    };
+
+    ~ShmRing();
+
+    static absl::StatusOr<std::unique_ptr<ShmRing>> Create(
+        const Options& options);
+
+    // Attaches to a ring created by another process, `memory`, `data_event`
+    // and `space_event` are the files returned by the accessors below.
+    static absl::StatusOr<std::unique_ptr<ShmRing>> Attach(
+        std::unique_ptr<File> memory, std::unique_ptr<File> data_event,
+        std::unique_ptr<File> space_event, int max_spins = 4096);
+
+    File* memory_file() { return memory_.get(); }
+    // Readable when messages were written while the consumer was waiting.
+    File* data_event() { return data_event_.get(); }
+    // Readable when space was freed while a producer was waiting.
+    File* space_event() { return space_event_.get(); }
+
+    size_t capacity() const { return capacity_; }
+    size_t max_message_size() const { return capacity_ - kFrameHeaderSize; }
+
+    // Producer side.
+    // Returns false if there is not enough space for `message`.
+    absl::StatusOr<bool> TryWrite(absl::string_view message);
+    // Waits until there is enough space, `timeout` = nullptr means blocks
+    // indefinitely. Returns DeadlineExceeded if timed out.
+    absl::Status Write(absl::string_view message,
+                       const absl::Duration* timeout);
+
+    // Consumer side, must be called from one thread at a time.
+    // Returns false if there is no message.
+    absl::StatusOr<bool> TryRead(std::string& out);
+    // Waits until there is a message, `timeout` = nullptr means blocks
+    // indefinitely. Returns DeadlineExceeded if timed out.
+    absl::Status Read(std::string& out, const absl::Duration* timeout);
+
+    // Asks producers to signal `data_event()`. Returns false if a message
+    // is already available and the consumer should not wait.
+    bool PrepareWait();
+    // Resets `data_event()` after the consumer woke up.
+    absl::Status FinishWait();
+
+   private:
+    static constexpr size_t kFrameHeaderSize = 8;
+    struct Header;
+
+    ShmRing(std::unique_ptr<File> memory, std::unique_ptr<File> data_event,
+            std::unique_ptr<File> space_event, void* mapping,
+            size_t mapping_size, int max_spins);
+
+    std::atomic<uint64_t>* FrameHeader(uint64_t pos);
+    // Moves the tail from `pos` by `size` bytes, returns false if another
+    // producer moved it first.
+    bool Reserve(uint64_t pos, uint64_t size);
+    // Publishes a padding frame from `pos` to the end of the data area.
+    void PublishPadding(uint64_t pos, size_t to_end);
+    absl::Status Notify(File* event);
+    // Blocks on `event` until readable or deadline.
+    absl::Status WaitEvent(File* event, absl::Time deadline);
+
+    std::unique_ptr<File> memory_;
+    std::unique_ptr<File> data_event_;
+    std::unique_ptr<File> space_event_;
+    void* mapping_;
+    size_t mapping_size_;
+    Header* header_;
+    char* data_;
+    size_t capacity_;
+    bool multi_producer_;
+    int max_spins_;
+    // Spins before blocking, adapted to how often spinning succeeds.
+    std::atomic<int> read_spins_;
+    std::atomic<int> write_spins_;
+};
+
+}  // namespace file
+
+#endif  // TOOLBASE_FILE_SHM_RING_H_
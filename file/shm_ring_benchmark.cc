@@ -0,0 +1,112 @@
+#include <thread>
+
+#include "benchmark/benchmark.h"
+#include "file/shm_ring.h"
+#include "net/net.h"
+
+namespace file {
+namespace {
+
+// Round trip of a `message_size` message through a pair of rings, the echo
+// side runs in another thread, which exercises the same paths as another
+// process.
+void BM_ShmRingRoundTrip(benchmark::State& state) {
+    const size_t message_size = state.range(0);
+    auto request_ring = *ShmRing::Create(ShmRing::Options());
+    auto response_ring = *ShmRing::Create(ShmRing::Options());
+
+    std::thread echo([&]() {
+        std::string message;
+        while (request_ring->Read(message, nullptr).ok() && !message.empty()) {
+            response_ring->Write(message, nullptr).IgnoreError();
+        }
+    });
+
+    std::string request(message_size, 'x');
+    std::string response;
+    for (auto _ : state) {
+        request_ring->Write(request, nullptr).IgnoreError();
+        response_ring->Read(response, nullptr).IgnoreError();
+    }
+    state.SetBytesProcessed(state.iterations() * message_size * 2);
+
+    // An empty message stops the echo thread.
+    request_ring->Write("", nullptr).IgnoreError();
+    echo.join();
+}
+BENCHMARK(BM_ShmRingRoundTrip)->Arg(64)->Arg(4096)->UseRealTime();
+
+// The same round trip through a unix domain SOCK_SEQPACKET socket pair.
+void BM_UnixSocketRoundTrip(benchmark::State& state) {
+    const size_t message_size = state.range(0);
+    auto pair = *net::SocketPair(AF_UNIX, SOCK_SEQPACKET, 0);
+    auto& [client, server] = pair;
+
+    std::thread echo([&server = server]() {
+        std::string message;
+        while (server->RecvTo(message, 1 << 16, 0).ok() && !message.empty()) {
+            server->Send(message, 0).IgnoreError();
+        }
+    });
+
+    std::string request(message_size, 'x');
+    std::string response;
+    for (auto _ : state) {
+        client->Send(request, 0).IgnoreError();
+        client->RecvTo(response, 1 << 16, 0).IgnoreError();
+    }
+    state.SetBytesProcessed(state.iterations() * message_size * 2);
+
+    shutdown(client->fd(), SHUT_RDWR);
+    echo.join();
+}
+BENCHMARK(BM_UnixSocketRoundTrip)->Arg(64)->Arg(4096)->UseRealTime();
+
+// One way message rate, the consumer drains in another thread.
+void BM_ShmRingThroughput(benchmark::State& state) {
+    const size_t message_size = state.range(0);
+    auto ring = *ShmRing::Create(ShmRing::Options());
+
+    std::thread consumer([&]() {
+        std::string message;
+        while (ring->Read(message, nullptr).ok() && !message.empty()) {
+        }
+    });
+
+    std::string message(message_size, 'x');
+    for (auto _ : state) {
+        ring->Write(message, nullptr).IgnoreError();
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * message_size);
+
+    ring->Write("", nullptr).IgnoreError();
+    consumer.join();
+}
+BENCHMARK(BM_ShmRingThroughput)->Arg(64)->Arg(4096)->UseRealTime();
+
+void BM_UnixSocketThroughput(benchmark::State& state) {
+    const size_t message_size = state.range(0);
+    auto pair = *net::SocketPair(AF_UNIX, SOCK_SEQPACKET, 0);
+    auto& [client, server] = pair;
+
+    std::thread consumer([&server = server]() {
+        std::string message;
+        while (server->RecvTo(message, 1 << 16, 0).ok() && !message.empty()) {
+        }
+    });
+
+    std::string message(message_size, 'x');
+    for (auto _ : state) {
+        client->Send(message, 0).IgnoreError();
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * message_size);
+
+    shutdown(client->fd(), SHUT_RDWR);
+    consumer.join();
+}
+BENCHMARK(BM_UnixSocketThroughput)->Arg(64)->Arg(4096)->UseRealTime();
+
+}  // namespace
+}  // namespace file
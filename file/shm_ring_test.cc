@@ -0,0 +1,243 @@
+#include "file/shm_ring.h"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <thread>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "file/epoll.h"
+#include "gtest/gtest.h"
+#include "utils/testing.h"
+
+namespace file {
+namespace {
+
+using ::utils::testing::IsOkAndHolds;
+using ::utils::testing::StatusIs;
+
+ShmRing::Options SmallRing(ShmRing::Mode mode) {
+    ShmRing::Options options;
+    options.capacity = 256;
+    options.mode = mode;
+    return options;
+}
+
+TEST(ShmRing, InvalidCapacity) {
+    ShmRing::Options options;
+    options.capacity = 1000;
+    EXPECT_THAT(ShmRing::Create(options),
+                StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST(ShmRing, TryWriteRead) {
+    auto ring = ShmRing::Create(SmallRing(ShmRing::Mode::kSingleProducer));
+    EXPECT_OK(ring);
+
+    std::string out;
+    EXPECT_THAT((*ring)->TryRead(out), IsOkAndHolds(false));
+    EXPECT_THAT((*ring)->TryWrite("hello"), IsOkAndHolds(true));
+    EXPECT_THAT((*ring)->TryWrite(""), IsOkAndHolds(true));
+    EXPECT_THAT((*ring)->TryRead(out), IsOkAndHolds(true));
+    EXPECT_EQ(out, "hello");
+    EXPECT_THAT((*ring)->TryRead(out), IsOkAndHolds(true));
+    EXPECT_EQ(out, "");
+    EXPECT_THAT((*ring)->TryRead(out), IsOkAndHolds(false));
+
+    EXPECT_THAT((*ring)->TryWrite(std::string(249, 'x')),
+                StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST(ShmRing, FullAndWrapAround) {
+    auto ring = ShmRing::Create(SmallRing(ShmRing::Mode::kSingleProducer));
+    EXPECT_OK(ring);
+
+    // Frames of 8 + 56 bytes, the 5th one does not fit.
+    std::string message(50, 'a');
+    for (int i = 0; i < 4; i++) {
+        EXPECT_THAT((*ring)->TryWrite(message), IsOkAndHolds(true));
+    }
+    EXPECT_THAT((*ring)->TryWrite(message), IsOkAndHolds(false));
+
+    // Goes around the ring many times with sizes not dividing the capacity,
+    // refilling the ring after every partial drain.
+    std::string out;
+    int written = 4;
+    int read = 0;
+    auto expected = [](int i) {
+        return i < 4 ? std::string(50, 'a') : std::string(i % 97, 'a' + i % 26);
+    };
+    for (int round = 0; round < 200; round++) {
+        for (int i = 0; i < 2 && read < written; i++, read++) {
+            ASSERT_THAT((*ring)->TryRead(out), IsOkAndHolds(true));
+            ASSERT_EQ(out, expected(read));
+        }
+        while (true) {
+            auto result = (*ring)->TryWrite(expected(written));
+            ASSERT_OK(result);
+            if (!*result) {
+                break;
+            }
+            written++;
+        }
+    }
+    EXPECT_GT(written, 300);
+    for (; read < written; read++) {
+        ASSERT_THAT((*ring)->TryRead(out), IsOkAndHolds(true));
+        ASSERT_EQ(out, expected(read));
+    }
+
+    // A message as large as the ring, it only fits once the consumer passed
+    // the padding written before it.
+    std::string largest((*ring)->max_message_size(), 'z');
+    EXPECT_THAT((*ring)->TryWrite(largest), IsOkAndHolds(false));
+    EXPECT_THAT((*ring)->TryRead(out), IsOkAndHolds(false));
+    EXPECT_THAT((*ring)->TryWrite(largest), IsOkAndHolds(true));
+    EXPECT_THAT((*ring)->TryRead(out), IsOkAndHolds(true));
+    EXPECT_EQ(out, largest);
+}
+
+TEST(ShmRing, BlockingTimeout) {
+    auto ring = ShmRing::Create(SmallRing(ShmRing::Mode::kSingleProducer));
+    EXPECT_OK(ring);
+
+    std::string out;
+    auto timeout = absl::Milliseconds(10);
+    EXPECT_THAT((*ring)->Read(out, &timeout),
+                StatusIs(absl::StatusCode::kDeadlineExceeded));
+
+    std::string message(130, 'a');
+    EXPECT_OK((*ring)->Write(message, &timeout));
+    EXPECT_THAT((*ring)->Write(message, &timeout),
+                StatusIs(absl::StatusCode::kDeadlineExceeded));
+}
+
+TEST(ShmRing, MultiProducer) {
+    auto ring = ShmRing::Create(SmallRing(ShmRing::Mode::kMultiProducer));
+    EXPECT_OK(ring);
+
+    constexpr int kProducers = 4;
+    constexpr int kMessages = 10000;
+    std::vector<std::thread> producers;
+    for (int p = 0; p < kProducers; p++) {
+        producers.emplace_back([&ring, p]() {
+            for (int i = 0; i < kMessages; i++) {
+                ASSERT_OK((*ring)->Write(absl::StrCat(p, ":", i), nullptr));
+            }
+        });
+    }
+
+    // Messages of every producer arrive in order.
+    std::vector<int> next(kProducers, 0);
+    std::string out;
+    for (int i = 0; i < kProducers * kMessages; i++) {
+        ASSERT_OK((*ring)->Read(out, nullptr));
+        int p = out[0] - '0';
+        ASSERT_EQ(out, absl::StrCat(p, ":", next[p]));
+        next[p]++;
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    EXPECT_THAT((*ring)->TryRead(out), IsOkAndHolds(false));
+}
+
+TEST(ShmRing, MultiProducerStress) {
+    auto ring = ShmRing::Create(SmallRing(ShmRing::Mode::kMultiProducer));
+    EXPECT_OK(ring);
+
+    // The consumer drains as fast as it can, so that the producers often
+    // load a tail the head has already passed. None of them may block on a
+    // ring it wrongly sees full.
+    constexpr int kProducers = 8;
+    constexpr int kMessages = 20000;
+    std::vector<std::thread> producers;
+    for (int p = 0; p < kProducers; p++) {
+        producers.emplace_back([&ring, p]() {
+            const auto timeout = absl::Seconds(10);
+            for (int i = 0; i < kMessages; i++) {
+                ASSERT_OK((*ring)->Write(absl::StrCat(p, ":", i), &timeout));
+            }
+        });
+    }
+
+    std::vector<int> next(kProducers, 0);
+    std::string out;
+    for (int read = 0; read < kProducers * kMessages;) {
+        auto ok = (*ring)->TryRead(out);
+        ASSERT_OK(ok);
+        if (!*ok) {
+            continue;
+        }
+        int p = out[0] - '0';
+        ASSERT_EQ(out, absl::StrCat(p, ":", next[p]));
+        next[p]++;
+        read++;
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+}
+
+TEST(ShmRing, EPoll) {
+    auto ring = ShmRing::Create(SmallRing(ShmRing::Mode::kSingleProducer));
+    EXPECT_OK(ring);
+    auto epoll = *EPoll::Create();
+    EXPECT_OK(epoll->Add((*ring)->data_event(), EPOLLIN));
+
+    auto nowait = absl::Milliseconds(0);
+    EXPECT_TRUE((*ring)->PrepareWait());
+    EXPECT_THAT(epoll->Wait(16, &nowait), IsOkAndHolds(::testing::IsEmpty()));
+
+    EXPECT_THAT((*ring)->TryWrite("hello"), IsOkAndHolds(true));
+    EXPECT_THAT(epoll->Wait(16, &nowait), IsOkAndHolds(::testing::SizeIs(1)));
+    EXPECT_OK((*ring)->FinishWait());
+    EXPECT_FALSE((*ring)->PrepareWait());
+
+    std::string out;
+    EXPECT_THAT((*ring)->TryRead(out), IsOkAndHolds(true));
+    EXPECT_EQ(out, "hello");
+
+    // Producers do not signal if the consumer is not waiting.
+    EXPECT_THAT((*ring)->TryWrite("world"), IsOkAndHolds(true));
+    EXPECT_THAT(epoll->Wait(16, &nowait), IsOkAndHolds(::testing::IsEmpty()));
+}
+
+TEST(ShmRing, CrossProcess) {
+    auto ring = ShmRing::Create(SmallRing(ShmRing::Mode::kSingleProducer));
+    ASSERT_OK(ring);
+
+    pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+    if (pid == 0) {
+        // Attaches through duplicated descriptors, as a process receiving
+        // them with SCM_RIGHTS would.
+        auto child = ShmRing::Attach(
+            std::make_unique<File>(dup((*ring)->memory_file()->fd())),
+            std::make_unique<File>(dup((*ring)->data_event()->fd())),
+            std::make_unique<File>(dup((*ring)->space_event()->fd())));
+        if (!child.ok()) {
+            _exit(1);
+        }
+        for (int i = 0; i < 1000; i++) {
+            if (!(*child)->Write(absl::StrCat("message ", i), nullptr).ok()) {
+                _exit(2);
+            }
+        }
+        _exit(0);
+    }
+
+    std::string out;
+    for (int i = 0; i < 1000; i++) {
+        ASSERT_OK((*ring)->Read(out, nullptr));
+        EXPECT_EQ(out, absl::StrCat("message ", i));
+    }
+    int status;
+    ASSERT_EQ(waitpid(pid, &status, 0), pid);
+    EXPECT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 0);
+}
+
+}  // namespace
+}  // namespace file
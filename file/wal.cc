@@ -0,0 +1,347 @@
+#include "file/wal.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <utility>
+
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/strip.h"
+#include "file/filesystem.h"
+#include "file/path.h"
+#include "utils/checksum.h"
+#include "utils/errno_status.h"
+#include "utils/metrics.h"
+#include "utils/status_macros.h"
+#include "utils/trace.h"
+
+namespace file {
+namespace {
+
+constexpr absl::string_view kSegmentSuffix = ".wal";
+constexpr size_t kHeaderSize = 8;
+constexpr size_t kMaxRecordSize = (1ull << 32) - 1;
+// Bytes read per read by `WalReader`.
+constexpr size_t kReadSize = 1 << 20;
+
+utils::Counter* const wal_records = utils::MetricsRegistry::Global().GetCounter(
+    "wal_records_total", "Records made durable by WalWriter.");
+utils::Counter* const wal_batches = utils::MetricsRegistry::Global().GetCounter(
+    "wal_batches_total",
+    "Batches written and synced by WalWriter, records per batch is the "
+    "group commit factor.");
+
+void EncodeFixed32(char* out, uint32_t value) {
+    out[0] = static_cast<char>(value);
+    out[1] = static_cast<char>(value >> 8);
+    out[2] = static_cast<char>(value >> 16);
+    out[3] = static_cast<char>(value >> 24);
+}
+
+uint32_t DecodeFixed32(const char* in) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(in);
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) |
+           (static_cast<uint32_t>(p[3]) << 24);
+}
+
+uint32_t RecordCrc(const char* length, absl::string_view data) {
+    utils::Crc32c crc;
+    crc.Update(length, 4);
+    crc.Update(data);
+    return crc.value();
+}
+
+void AppendRecord(std::string& out, absl::string_view record) {
+    char header[kHeaderSize];
+    EncodeFixed32(header, record.size());
+    EncodeFixed32(header + 4, RecordCrc(header, record));
+    out.append(header, kHeaderSize);
+    out.append(record.data(), record.size());
+}
+
+std::string SegmentPath(absl::string_view dir, uint64_t segment) {
+    return PathJoin(dir, absl::StrFormat("%020d%s", segment, kSegmentSuffix));
+}
+
+// Returns the numbers of the segments in `dir`, ascending.
+absl::StatusOr<std::vector<uint64_t>> ListSegments(absl::string_view dir) {
+    ASSIGN_OR_RETURN(auto entries, ListDirectory(dir));
+    std::vector<uint64_t> segments;
+    for (absl::string_view entry : entries) {
+        uint64_t segment;
+        if (absl::ConsumeSuffix(&entry, kSegmentSuffix) &&
+            absl::SimpleAtoi(entry, &segment)) {
+            segments.push_back(segment);
+        }
+    }
+    std::sort(segments.begin(), segments.end());
+    return segments;
+}
+
+// Makes the creation of the files in `dir` durable.
+absl::Status SyncDirectory(absl::string_view dir) {
+    ASSIGN_OR_RETURN(auto file, File::Open(dir, O_RDONLY | O_DIRECTORY));
+    return file->Sync();
+}
+
+// Cuts `file` at `size` and makes it durable, before any later segment is
+// created: a crash must not leave an old tail in front of newer segments.
+absl::Status TruncateSegment(File& file, off_t size) {
+    if (ftruncate(file.fd(), size) != 0) {
+        return utils::ErrnoToStatus(errno);
+    }
+    return file.Sync();
+}
+
+absl::StatusOr<std::unique_ptr<File>> CreateSegment(absl::string_view dir,
+                                                    uint64_t segment,
+                                                    size_t size) {
+    ASSIGN_OR_RETURN(auto file, File::Open(SegmentPath(dir, segment),
+                                           O_WRONLY | O_CREAT | O_EXCL, 0644));
+    absl::Status status = file->Allocate(0, size);
+    // Preallocation is an optimization, some file systems do not have it.
+    if (!status.ok() && !absl::IsUnimplemented(status)) {
+        return status;
+    }
+    RETURN_IF_ERROR(SyncDirectory(dir));
+    return file;
+}
+
+}  // namespace
+
+absl::StatusOr<std::unique_ptr<WalWriter>> WalWriter::Open(
+    absl::string_view dir, const Options& options) {
+    ASSIGN_OR_RETURN(bool exists, Exists(dir));
+    if (!exists) {
+        RETURN_IF_ERROR(Mkdir(dir, 0755));
+    }
+    ASSIGN_OR_RETURN(auto segments, ListSegments(dir));
+    uint64_t segment = 1;
+    if (!segments.empty()) {
+        // Finds the end of the valid records of the last segment, the
+        // records after a torn one were never acknowledged.
+        std::string path = SegmentPath(dir, segments.back());
+        WalReader reader({path});
+        std::string record;
+        while (true) {
+            ASSIGN_OR_RETURN(bool has_record, reader.ReadRecord(record));
+            if (!has_record) {
+                break;
+            }
+        }
+        segment = segments.back() + 1;
+        if (reader.valid_end() == 0) {
+            RETURN_IF_ERROR(Unlink(path));
+            segment--;
+        } else {
+            ASSIGN_OR_RETURN(auto file, File::Open(path, O_WRONLY));
+            RETURN_IF_ERROR(TruncateSegment(*file, reader.valid_end()));
+            RETURN_IF_ERROR(file->Close());
+        }
+    }
+    ASSIGN_OR_RETURN(auto file,
+                     CreateSegment(dir, segment, options.segment_size));
+    return std::unique_ptr<WalWriter>(
+        new WalWriter(std::string(dir), options, segment, std::move(file)));
+}
+
+WalWriter::WalWriter(std::string dir, const Options& options,
+                     uint64_t segment, std::unique_ptr<File> file)
+    : dir_(std::move(dir)),
+      options_(options),
+      segment_(segment),
+      file_(std::move(file)) {
+    writer_ = std::thread(&WalWriter::WriteLoop, this);
+}
+
+WalWriter::~WalWriter() { Close().IgnoreError(); }
+
+std::future<absl::Status> WalWriter::Append(absl::string_view record) {
+    std::promise<absl::Status> done;
+    auto future = done.get_future();
+    if (record.size() > kMaxRecordSize) {
+        done.set_value(absl::InvalidArgumentError(
+            absl::StrFormat("record of %d bytes is too large", record.size())));
+        return future;
+    }
+    absl::MutexLock lock(&mu_);
+    if (closing_) {
+        done.set_value(absl::FailedPreconditionError("WalWriter is closed"));
+        return future;
+    }
+    if (pending_.empty() ||
+        pending_.back().data.size() >= options_.max_batch_bytes) {
+        pending_.emplace_back();
+        pending_.back().start = absl::Now();
+    }
+    Batch& batch = pending_.back();
+    AppendRecord(batch.data, record);
+    batch.done.push_back(std::move(done));
+    return future;
+}
+
+absl::Status WalWriter::Close() {
+    {
+        absl::MutexLock lock(&mu_);
+        if (closing_) {
+            return absl::OkStatus();
+        }
+        closing_ = true;
+    }
+    writer_.join();
+    RETURN_IF_ERROR(status_);
+    // Gives back the preallocated space past the records.
+    RETURN_IF_ERROR(TruncateSegment(*file_, offset_));
+    return file_->Close();
+}
+
+void WalWriter::WriteLoop() {
+    auto has_work = [this]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        return !pending_.empty() || closing_;
+    };
+    auto batch_ready = [this]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        return pending_.size() > 1 ||
+               pending_.front().data.size() >= options_.max_batch_bytes ||
+               closing_;
+    };
+    while (true) {
+        Batch batch;
+        {
+            absl::MutexLock lock(&mu_);
+            mu_.Await(absl::Condition(&has_work));
+            if (pending_.empty()) {
+                return;
+            }
+            if (options_.max_delay > absl::ZeroDuration()) {
+                mu_.AwaitWithDeadline(
+                    absl::Condition(&batch_ready),
+                    pending_.front().start + options_.max_delay);
+            }
+            batch = std::move(pending_.front());
+            pending_.pop_front();
+        }
+
+        if (status_.ok()) {
+            status_ = WriteBatch(batch.data);
+        }
+        if (status_.ok()) {
+            wal_records->Add(batch.done.size());
+            wal_batches->Increment();
+        }
+        for (auto& done : batch.done) {
+            done.set_value(status_);
+        }
+    }
+}
+
+absl::Status WalWriter::WriteBatch(const std::string& data) {
+    utils::TraceSpan span("WalWriter::WriteBatch");
+    if (offset_ > 0 && offset_ + data.size() > options_.segment_size) {
+        RETURN_IF_ERROR(RollSegment());
+    }
+    RETURN_IF_ERROR(file_->WriteAll(data));
+    offset_ += data.size();
+    return file_->DataSync();
+}
+
+absl::Status WalWriter::RollSegment() {
+    // The records of the segment are synced already, its new size is
+    // synced before the next segment exists.
+    RETURN_IF_ERROR(TruncateSegment(*file_, offset_));
+    RETURN_IF_ERROR(file_->Close());
+    ASSIGN_OR_RETURN(file_,
+                     CreateSegment(dir_, segment_ + 1, options_.segment_size));
+    segment_++;
+    offset_ = 0;
+    return absl::OkStatus();
+}
+
+absl::StatusOr<std::unique_ptr<WalReader>> WalReader::Open(
+    absl::string_view dir) {
+    ASSIGN_OR_RETURN(auto segments, ListSegments(dir));
+    std::vector<std::string> paths;
+    for (uint64_t segment : segments) {
+        paths.push_back(SegmentPath(dir, segment));
+    }
+    return std::make_unique<WalReader>(std::move(paths));
+}
+
+absl::StatusOr<bool> WalReader::ReadRecord(std::string& out) {
+    while (true) {
+        if (file_ == nullptr) {
+            if (next_segment_ == segments_.size()) {
+                return false;
+            }
+            const std::string& path = segments_[next_segment_++];
+            ASSIGN_OR_RETURN(file_, File::Open(path, O_RDONLY));
+            ASSIGN_OR_RETURN(PathStat stat, Stat(path));
+            file_size_ = stat.size();
+            buffer_.clear();
+            pos_ = 0;
+            valid_end_ = 0;
+        }
+        ASSIGN_OR_RETURN(bool has_record, ReadFromSegment(out));
+        if (has_record) {
+            return true;
+        }
+        if (valid_end_ != file_size_ && next_segment_ < segments_.size()) {
+            return absl::DataLossError(
+                absl::StrFormat("corrupted record in %s at offset %d",
+                                segments_[next_segment_ - 1], valid_end_));
+        }
+        if (next_segment_ == segments_.size()) {
+            // Keeps `valid_end()` of the last segment.
+            return false;
+        }
+        file_.reset();
+    }
+}
+
+absl::StatusOr<bool> WalReader::ReadFromSegment(std::string& out) {
+    ASSIGN_OR_RETURN(bool has_header, Fill(kHeaderSize));
+    if (!has_header) {
+        return false;
+    }
+    const char* header = buffer_.data() + pos_;
+    const uint32_t length = DecodeFixed32(header);
+    if (valid_end_ + static_cast<off_t>(kHeaderSize + length) > file_size_) {
+        return false;
+    }
+    ASSIGN_OR_RETURN(bool has_data, Fill(kHeaderSize + length));
+    if (!has_data) {
+        return false;
+    }
+    // `Fill` may have moved the buffer.
+    header = buffer_.data() + pos_;
+    absl::string_view data(header + kHeaderSize, length);
+    if (DecodeFixed32(header + 4) != RecordCrc(header, data)) {
+        return false;
+    }
+    out.assign(data.data(), data.size());
+    pos_ += kHeaderSize + length;
+    valid_end_ += kHeaderSize + length;
+    return true;
+}
+
+absl::StatusOr<bool> WalReader::Fill(size_t count) {
+    if (buffer_.size() - pos_ >= count) {
+        return true;
+    }
+    buffer_.erase(0, pos_);
+    pos_ = 0;
+    std::string chunk;
+    while (buffer_.size() < count) {
+        RETURN_IF_ERROR(file_->ReadTo(
+            chunk, std::max(count - buffer_.size(), kReadSize)));
+        if (chunk.empty()) {
+            return false;
+        }
+        buffer_.append(chunk);
+    }
+    return true;
+}
+
+}  // namespace file
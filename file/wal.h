@@ -0,0 +1,148 @@
+#ifndef TOOLBASE_FILE_WAL_H_
+#define TOOLBASE_FILE_WAL_H_
+
+#include <sys/types.h>
+
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "file/file.h"
+
+namespace file {
+
+// A write-ahead log is a directory of segment files named by increasing
+// numbers ("00000000000000000001.wal", ...), read in that order. A segment
+// is a sequence of records:
+//  length u32 | crc32c(length, data) u32 | data
+// in little endian. The CRC covers the length, so that a zeroed or torn
+// tail never decodes as a record.
+
+// Appends records durably, `Append` can be called from many threads.
+// Appends are gathered into batches, one writer thread writes each batch
+// with one write and one fdatasync (group commit), so the syncs per second
+// of the disk bound the batches, not the records.
+// Example:
+//  ASSIGN_OR_RETURN(auto wal, WalWriter::Open("/data/wal", {}));
+//  std::future<absl::Status> done = wal->Append("event");
+//  ...
+//  RETURN_IF_ERROR(done.get());  // "event" is durable.
+class WalWriter {
+   public:
+    struct Options {
+        // How long a batch waits for more appends before its write. Zero
+        // writes as soon as the previous sync is done, batching the appends
+        // which arrived during it: the lowest latency, and batches grow with
+        // the load anyway.
+        absl::Duration max_delay = absl::ZeroDuration();
+        // A batch is closed, and written without waiting for `max_delay`,
+        // once it reaches `max_batch_bytes`. Bounds the bytes of one write.
+        size_t max_batch_bytes = 1 << 20;
+        // Writes go to a new segment once a segment would exceed
+        // `segment_size` bytes. The space of a segment is preallocated, so
+        // that syncs do not allocate blocks.
+        size_t segment_size = 64 << 20;
+    };
+
+    // Opens the log in `dir`, creates it if not exists. The torn tail of
+    // the last segment is truncated, and appends go to a new segment.
+    static absl::StatusOr<std::unique_ptr<WalWriter>> Open(
+        absl::string_view dir, const Options& options);
+
+    // Closes the writer, waiting for the pending appends.
+    ~WalWriter();
+
+    // Queues `record`, the future is set once it is durable, or to the
+    // error which failed its batch. The writer is unusable after an error.
+    std::future<absl::Status> Append(absl::string_view record);
+
+    // Writes the pending appends and closes the current segment.
+    absl::Status Close();
+
+   private:
+    struct Batch {
+        std::string data;
+        std::vector<std::promise<absl::Status>> done;
+        // The time of the first append.
+        absl::Time start;
+    };
+
+    WalWriter(std::string dir, const Options& options, uint64_t segment,
+              std::unique_ptr<File> file);
+
+    void WriteLoop();
+    // Writes and syncs a batch, rolling the segment first if needed.
+    absl::Status WriteBatch(const std::string& data);
+    absl::Status RollSegment();
+
+    const std::string dir_;
+    const Options options_;
+
+    // Only used by the writer thread once started.
+    uint64_t segment_;
+    std::unique_ptr<File> file_;
+    off_t offset_ = 0;
+    // The first error, fails all the following batches.
+    absl::Status status_;
+
+    absl::Mutex mu_;
+    std::deque<Batch> pending_ ABSL_GUARDED_BY(mu_);
+    bool closing_ ABSL_GUARDED_BY(mu_) = false;
+    std::thread writer_;
+};
+
+// Reads the records of a log in order.
+// Example:
+//  ASSIGN_OR_RETURN(auto reader, WalReader::Open("/data/wal"));
+//  std::string record;
+//  while (true) {
+//      ASSIGN_OR_RETURN(bool has_record, reader->ReadRecord(record));
+//      if (!has_record) break;
+//      ...
+//  }
+class WalReader {
+   public:
+    // Reads the segment files `segments`, in order.
+    explicit WalReader(std::vector<std::string> segments)
+        : segments_(std::move(segments)) {}
+
+    static absl::StatusOr<std::unique_ptr<WalReader>> Open(
+        absl::string_view dir);
+
+    // Reads the next record into `out`, returns false at the end of the
+    // log. An invalid record ends the last segment, as a torn write does;
+    // in an earlier segment it is corruption and returns DataLoss.
+    absl::StatusOr<bool> ReadRecord(std::string& out);
+
+    // The end offset of the last valid record read in the current segment.
+    off_t valid_end() const { return valid_end_; }
+
+   private:
+    // Returns false at the end of the valid records of the segment.
+    absl::StatusOr<bool> ReadFromSegment(std::string& out);
+    // Buffers at least `count` bytes after `pos_`, returns false if the
+    // segment ends before.
+    absl::StatusOr<bool> Fill(size_t count);
+
+    const std::vector<std::string> segments_;
+    size_t next_segment_ = 0;
+    std::unique_ptr<File> file_;
+    off_t file_size_ = 0;
+    std::string buffer_;
+    size_t pos_ = 0;
+    off_t valid_end_ = 0;
+};
+
+}  // namespace file
+
+#endif  // TOOLBASE_FILE_WAL_H_
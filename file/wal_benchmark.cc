@@ -0,0 +1,59 @@
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "file/filesystem.h"
+#include "file/wal.h"
+
+namespace file {
+namespace {
+
+constexpr char kDir[] = "/tmp/wal_benchmark";
+constexpr int kAppends = 2000;
+
+// `kAppends` durable appends of 100 bytes from each of `range(0)` threads,
+// waiting for each append (`range(1)` = 0) or keeping all of them in
+// flight. The throughput is the group commit factor times the syncs per
+// second of the disk, File::WriteAll + File::DataSync per record gets the
+// syncs per second alone (see BM_WriteSync of file_benchmark).
+void BM_DurableAppend(benchmark::State& state) {
+    const int num_threads = state.range(0);
+    const bool pipelined = state.range(1);
+    RmTree(kDir).IgnoreError();
+    auto writer = *WalWriter::Open(kDir, {});
+
+    const std::string record(100, 'x');
+    for (auto _ : state) {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < num_threads; t++) {
+            threads.emplace_back([&]() {
+                std::vector<std::future<absl::Status>> futures;
+                for (int i = 0; i < kAppends; i++) {
+                    if (pipelined) {
+                        futures.push_back(writer->Append(record));
+                    } else {
+                        writer->Append(record).get().IgnoreError();
+                    }
+                }
+                for (auto& future : futures) {
+                    future.get().IgnoreError();
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * num_threads * kAppends);
+
+    writer.reset();
+    RmTree(kDir).IgnoreError();
+}
+BENCHMARK(BM_DurableAppend)
+    ->ArgsProduct({{1, 16, 64}, {0, 1}})
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace file
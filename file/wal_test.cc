@@ -0,0 +1,181 @@
+#include "file/wal.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/strings/str_format.h"
+#include "file/filesystem.h"
+#include "file/path.h"
+#include "gtest/gtest.h"
+#include "utils/status_macros.h"
+#include "utils/testing.h"
+
+namespace file {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+using ::testing::SizeIs;
+using ::utils::testing::IsOkAndHolds;
+using ::utils::testing::StatusIs;
+
+static constexpr absl::string_view kDir = "/tmp/test_wal";
+
+absl::StatusOr<std::vector<std::string>> ReadAll() {
+    ASSIGN_OR_RETURN(auto reader, WalReader::Open(kDir));
+    std::vector<std::string> records;
+    std::string record;
+    while (true) {
+        ASSIGN_OR_RETURN(bool has_record, reader->ReadRecord(record));
+        if (!has_record) {
+            return records;
+        }
+        records.push_back(record);
+    }
+}
+
+class Wal : public ::testing::Test {
+   protected:
+    void SetUp() override {
+        ASSERT_OK(RmTree(kDir));
+    }
+    void TearDown() override {
+        ASSERT_OK(RmTree(kDir));
+    }
+};
+
+TEST_F(Wal, AppendAndRead) {
+    auto writer = WalWriter::Open(kDir, {});
+    ASSERT_OK(writer);
+    auto first = (*writer)->Append("hello");
+    auto second = (*writer)->Append("");
+    auto third = (*writer)->Append(std::string(100000, 'x'));
+    EXPECT_OK(first.get());
+    EXPECT_OK(second.get());
+    EXPECT_OK(third.get());
+    // Durable records are readable before the writer is closed.
+    EXPECT_THAT(ReadAll(), IsOkAndHolds(ElementsAre(
+                               "hello", "", std::string(100000, 'x'))));
+
+    EXPECT_OK((*writer)->Close());
+    EXPECT_THAT((*writer)->Append("late").get(),
+                StatusIs(absl::StatusCode::kFailedPrecondition));
+}
+
+TEST_F(Wal, ConcurrentAppends) {
+    constexpr int kThreads = 8;
+    constexpr int kRecords = 500;
+    WalWriter::Options options;
+    options.max_delay = absl::Milliseconds(1);
+    options.max_batch_bytes = 4096;
+    auto writer = *WalWriter::Open(kDir, options);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; t++) {
+        threads.emplace_back([&, t]() {
+            std::vector<std::future<absl::Status>> futures;
+            for (int i = 0; i < kRecords; i++) {
+                futures.push_back(
+                    writer->Append(absl::StrFormat("%d/%04d", t, i)));
+            }
+            for (auto& future : futures) {
+                EXPECT_OK(future.get());
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_OK(writer->Close());
+
+    auto records = ReadAll();
+    ASSERT_OK(records);
+    ASSERT_THAT(*records, SizeIs(kThreads * kRecords));
+    // The records of each thread keep their order.
+    std::vector<int> next(kThreads, 0);
+    for (const auto& record : *records) {
+        int t = record[0] - '0';
+        EXPECT_EQ(record, absl::StrFormat("%d/%04d", t, next[t]));
+        next[t]++;
+    }
+}
+
+TEST_F(Wal, SegmentRolling) {
+    WalWriter::Options options;
+    options.segment_size = 1000;
+    auto writer = *WalWriter::Open(kDir, options);
+    std::vector<std::string> expected;
+    for (int i = 0; i < 50; i++) {
+        expected.push_back(std::string(100, 'a' + i % 26));
+        ASSERT_OK(writer->Append(expected.back()).get());
+    }
+    EXPECT_OK(writer->Close());
+
+    auto entries = *ListDirectory(kDir);
+    EXPECT_GT(entries.size(), 5);
+    for (const auto& entry : entries) {
+        EXPECT_LE(Stat(PathJoin(kDir, entry))->size(), 1000);
+    }
+    EXPECT_THAT(ReadAll(), IsOkAndHolds(expected));
+}
+
+TEST_F(Wal, RecoverTornTail) {
+    {
+        auto writer = *WalWriter::Open(kDir, {});
+        ASSERT_OK(writer->Append("one").get());
+        ASSERT_OK(writer->Append("two").get());
+    }
+    // A crash in the middle of a write leaves a partial record.
+    auto entries = *ListDirectory(kDir);
+    ASSERT_THAT(entries, SizeIs(1));
+    std::string path = PathJoin(kDir, entries[0]);
+    {
+        auto file = *File::Open(path, O_WRONLY | O_APPEND);
+        ASSERT_OK(file->WriteAll(std::string("\x10\0\0\0garbage", 11)));
+    }
+    EXPECT_THAT(ReadAll(), IsOkAndHolds(ElementsAre("one", "two")));
+
+    {
+        auto writer = *WalWriter::Open(kDir, {});
+        ASSERT_OK(writer->Append("three").get());
+    }
+    EXPECT_THAT(ReadAll(), IsOkAndHolds(ElementsAre("one", "two", "three")));
+}
+
+TEST_F(Wal, CorruptedSegment) {
+    WalWriter::Options options;
+    options.segment_size = 100;
+    {
+        auto writer = *WalWriter::Open(kDir, options);
+        for (int i = 0; i < 3; i++) {
+            ASSERT_OK(writer->Append(std::string(80, 'x')).get());
+        }
+    }
+    auto entries = *ListDirectory(kDir);
+    std::sort(entries.begin(), entries.end());
+    ASSERT_THAT(entries, SizeIs(3));
+    {
+        auto file = *File::Open(PathJoin(kDir, entries[0]), O_WRONLY);
+        ASSERT_OK(file->PWrite("y", 20));
+    }
+    EXPECT_THAT(ReadAll(), StatusIs(absl::StatusCode::kDataLoss));
+}
+
+TEST_F(Wal, ReopenEmpty) {
+    for (int i = 0; i < 3; i++) {
+        auto writer = WalWriter::Open(kDir, {});
+        ASSERT_OK(writer);
+        EXPECT_OK((*writer)->Close());
+    }
+    // The empty segments are reused.
+    EXPECT_THAT(ListDirectory(kDir), IsOkAndHolds(SizeIs(1)));
+    EXPECT_THAT(ReadAll(), IsOkAndHolds(IsEmpty()));
+}
+
+}  // namespace
+}  // namespace file
@@ -0,0 +1,430 @@
+#include "kv/env.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "absl/strings/match.h"
+#include "absl/strings/str_format.h"
+#include "absl/time/clock.h"
+#include "file/file.h"
+#include "file/filesystem.h"
+#include "utils/errno_status.h"
+
+namespace kv {
+namespace {
+
+using ::leveldb::Slice;
+
+leveldb::Status PosixError(const std::string& context, int error) {
+    absl::Status status = utils::ErrnoToStatus(error);
+    leveldb::Slice message(status.message().data(), status.message().size());
+    if (absl::IsNotFound(status)) {
+        return leveldb::Status::NotFound(context, message);
+    }
+    return leveldb::Status::IOError(context, message);
+}
+
+class SequentialFileImpl : public leveldb::SequentialFile {
+   public:
+    SequentialFileImpl(std::unique_ptr<file::File> file, std::string filename,
+                       IOCounters* counters)
+        : file_(std::move(file)),
+          filename_(std::move(filename)),
+          counters_(counters) {}
+
+    leveldb::Status Read(size_t n, Slice* result, char* scratch) override {
+        while (true) {
+            ssize_t ret = read(file_->fd(), scratch, n);
+            if (ret < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                *result = Slice(scratch, 0);
+                return PosixError(filename_, errno);
+            }
+            counters_->sequential_reads++;
+            counters_->sequential_read_bytes += ret;
+            *result = Slice(scratch, ret);
+            return leveldb::Status::OK();
+        }
+    }
+
+    leveldb::Status Skip(uint64_t n) override {
+        auto status = file_->LSeek(n, SEEK_CUR);
+        return status.ok() ? leveldb::Status::OK()
+                           : ToLevelDBStatus(status.status(), filename_);
+    }
+
+   private:
+    std::unique_ptr<file::File> file_;
+    const std::string filename_;
+    IOCounters* counters_;
+};
+
+class PReadRandomAccessFile : public leveldb::RandomAccessFile {
+   public:
+    PReadRandomAccessFile(std::unique_ptr<file::File> file,
+                          std::string filename, IOCounters* counters)
+        : file_(std::move(file)),
+          filename_(std::move(filename)),
+          counters_(counters) {}
+
+    leveldb::Status Read(uint64_t offset, size_t n, Slice* result,
+                         char* scratch) const override {
+        ssize_t ret = pread(file_->fd(), scratch, n, offset);
+        if (ret < 0) {
+            *result = Slice(scratch, 0);
+            return PosixError(filename_, errno);
+        }
+        counters_->random_reads++;
+        counters_->random_read_bytes += ret;
+        *result = Slice(scratch, ret);
+        return leveldb::Status::OK();
+    }
+
+   private:
+    std::unique_ptr<file::File> file_;
+    const std::string filename_;
+    IOCounters* counters_;
+};
+
+// Table files are immutable once written, reads are served from a read-only
+// mapping without copies.
+class MmapReadableFile : public leveldb::RandomAccessFile {
+   public:
+    MmapReadableFile(std::string filename, char* base, size_t length,
+                     std::atomic<int>* mmaps_left, IOCounters* counters)
+        : filename_(std::move(filename)),
+          base_(base),
+          length_(length),
+          mmaps_left_(mmaps_left),
+          counters_(counters) {}
+
+    ~MmapReadableFile() override {
+        munmap(base_, length_);
+        (*mmaps_left_)++;
+    }
+
+    leveldb::Status Read(uint64_t offset, size_t n, Slice* result,
+                         char* scratch) const override {
+        if (offset + n > length_) {
+            *result = Slice();
+            return PosixError(filename_, EINVAL);
+        }
+        counters_->random_reads++;
+        counters_->mmap_reads++;
+        counters_->random_read_bytes += n;
+        *result = Slice(base_ + offset, n);
+        return leveldb::Status::OK();
+    }
+
+   private:
+    const std::string filename_;
+    char* const base_;
+    const size_t length_;
+    std::atomic<int>* mmaps_left_;
+    IOCounters* counters_;
+};
+
+class WritableFileImpl : public leveldb::WritableFile {
+   public:
+    WritableFileImpl(std::unique_ptr<file::File> file, std::string filename,
+                     off_t size, const ToolbaseEnv::Options& options,
+                     IOCounters* counters)
+        : file_(std::move(file)),
+          filename_(std::move(filename)),
+          size_(size),
+          allocated_(size),
+          buffer_size_(options.write_buffer_size),
+          counters_(counters) {
+        size_t slash = filename_.rfind('/');
+        dirname_ =
+            slash == std::string::npos ? "." : filename_.substr(0, slash);
+        absl::string_view basename(filename_);
+        basename.remove_prefix(slash == std::string::npos ? 0 : slash + 1);
+        is_manifest_ = absl::StartsWith(basename, "MANIFEST");
+        if (absl::EndsWith(basename, ".log")) {
+            preallocation_size_ = options.log_preallocation_size;
+        }
+        buffer_.reserve(buffer_size_);
+    }
+
+    ~WritableFileImpl() override {
+        if (file_->fd() >= 0) {
+            Close();
+        }
+    }
+
+    leveldb::Status Append(const Slice& data) override {
+        counters_->appends++;
+        if (buffer_.size() + data.size() <= buffer_size_) {
+            buffer_.append(data.data(), data.size());
+            return leveldb::Status::OK();
+        }
+        leveldb::Status status = FlushBuffer();
+        if (!status.ok()) {
+            return status;
+        }
+        if (data.size() <= buffer_size_) {
+            buffer_.append(data.data(), data.size());
+            return leveldb::Status::OK();
+        }
+        return WriteUnbuffered(absl::string_view(data.data(), data.size()));
+    }
+
+    leveldb::Status Close() override {
+        leveldb::Status status = FlushBuffer();
+        // Releases the blocks preallocated beyond the end.
+        if (allocated_ > size_ && ftruncate(file_->fd(), size_) != 0 &&
+            status.ok()) {
+            status = PosixError(filename_, errno);
+        }
+        auto close_status = file_->Close();
+        if (!close_status.ok() && status.ok()) {
+            status = ToLevelDBStatus(close_status, filename_);
+        }
+        return status;
+    }
+
+    leveldb::Status Flush() override { return FlushBuffer(); }
+
+    leveldb::Status Sync() override {
+        leveldb::Status status = FlushBuffer();
+        if (!status.ok()) {
+            return status;
+        }
+        // A new manifest is only found through the directory entry.
+        if (is_manifest_) {
+            auto dir = file::File::Open(dirname_, O_RDONLY | O_DIRECTORY);
+            if (!dir.ok()) {
+                return ToLevelDBStatus(dir.status(), dirname_);
+            }
+            auto dir_status = (*dir)->Sync();
+            if (!dir_status.ok()) {
+                return ToLevelDBStatus(dir_status, dirname_);
+            }
+        }
+        absl::Time start = absl::Now();
+        auto sync_status = file_->DataSync();
+        counters_->syncs++;
+        counters_->sync_latency.Record(absl::Now() - start);
+        return ToLevelDBStatus(sync_status, filename_);
+    }
+
+   private:
+    leveldb::Status FlushBuffer() {
+        leveldb::Status status = WriteUnbuffered(buffer_);
+        buffer_.clear();
+        return status;
+    }
+
+    leveldb::Status WriteUnbuffered(absl::string_view data) {
+        if (data.empty()) {
+            return leveldb::Status::OK();
+        }
+        Preallocate(data.size());
+        auto status = file_->WriteAll(data);
+        if (!status.ok()) {
+            return ToLevelDBStatus(status, filename_);
+        }
+        counters_->writes++;
+        counters_->write_bytes += data.size();
+        size_ += data.size();
+        return leveldb::Status::OK();
+    }
+
+    void Preallocate(size_t size) {
+        const off_t end = size_ + static_cast<off_t>(size);
+        if (preallocation_size_ == 0 || end <= allocated_) {
+            return;
+        }
+        off_t length = (end - allocated_ + preallocation_size_ - 1) /
+                       preallocation_size_ * preallocation_size_;
+        if (file_->Allocate(allocated_, length).ok()) {
+            counters_->preallocations++;
+            allocated_ += length;
+        } else {
+            // e.g. the filesystem does not support it.
+            preallocation_size_ = 0;
+        }
+    }
+
+    std::unique_ptr<file::File> file_;
+    const std::string filename_;
+    std::string dirname_;
+    bool is_manifest_;
+    off_t size_;
+    off_t allocated_;
+    size_t preallocation_size_ = 0;
+    const size_t buffer_size_;
+    std::string buffer_;
+    IOCounters* counters_;
+};
+
+}  // namespace
+
+std::string IOCounters::ToString() const {
+    return absl::StrFormat(
+        "sequential_reads %d\nsequential_read_bytes %d\nrandom_reads %d\n"
+        "random_read_bytes %d\nmmap_reads %d\nappends %d\nwrites %d\n"
+        "write_bytes %d\nsyncs %d\npreallocations %d\nopened_files %d\n"
+        "removed_files %d\nrenamed_files %d\nscheduled_jobs %d\n"
+        "sync_latency %s\n",
+        sequential_reads.load(), sequential_read_bytes.load(),
+        random_reads.load(), random_read_bytes.load(), mmap_reads.load(),
+        appends.load(), writes.load(), write_bytes.load(), syncs.load(),
+        preallocations.load(), opened_files.load(), removed_files.load(),
+        renamed_files.load(), scheduled_jobs.load(), sync_latency.ToString());
+}
+
+leveldb::Status ToLevelDBStatus(const absl::Status& status,
+                                const std::string& context) {
+    if (status.ok()) {
+        return leveldb::Status::OK();
+    }
+    if (absl::IsNotFound(status)) {
+        return leveldb::Status::NotFound(context, status.ToString());
+    }
+    return leveldb::Status::IOError(context, status.ToString());
+}
+
+ToolbaseEnv::ToolbaseEnv(const Options& options)
+    : leveldb::EnvWrapper(leveldb::Env::Default()),
+      options_(options),
+      mmaps_left_(options.use_mmap_reads ? options.max_mmaps : 0),
+      background_pool_(options.background_pool) {
+    if (background_pool_ == nullptr) {
+        own_pool_ = std::make_unique<utils::ThreadPool>(1);
+        background_pool_ = own_pool_.get();
+    }
+}
+
+ToolbaseEnv::~ToolbaseEnv() = default;
+
+leveldb::Status ToolbaseEnv::NewSequentialFile(
+    const std::string& fname, leveldb::SequentialFile** result) {
+    auto file = file::File::Open(fname, O_RDONLY | O_CLOEXEC);
+    if (!file.ok()) {
+        *result = nullptr;
+        return ToLevelDBStatus(file.status(), fname);
+    }
+    counters_.opened_files++;
+    *result = new SequentialFileImpl(std::move(*file), fname, &counters_);
+    return leveldb::Status::OK();
+}
+
+leveldb::Status ToolbaseEnv::NewRandomAccessFile(
+    const std::string& fname, leveldb::RandomAccessFile** result) {
+    *result = nullptr;
+    auto file = file::File::Open(fname, O_RDONLY | O_CLOEXEC);
+    if (!file.ok()) {
+        return ToLevelDBStatus(file.status(), fname);
+    }
+    counters_.opened_files++;
+
+    if (mmaps_left_.fetch_sub(1) > 0) {
+        struct stat st;
+        if (fstat((*file)->fd(), &st) != 0) {
+            mmaps_left_++;
+            return PosixError(fname, errno);
+        }
+        // The mapping stays valid after the file is closed.
+        void* base = st.st_size == 0
+                         ? MAP_FAILED
+                         : mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED,
+                                (*file)->fd(), 0);
+        if (base != MAP_FAILED) {
+            *result =
+                new MmapReadableFile(fname, static_cast<char*>(base),
+                                     st.st_size, &mmaps_left_, &counters_);
+            return leveldb::Status::OK();
+        }
+    }
+    mmaps_left_++;
+    *result = new PReadRandomAccessFile(std::move(*file), fname, &counters_);
+    return leveldb::Status::OK();
+}
+
+leveldb::Status ToolbaseEnv::NewWritableFile(const std::string& fname,
+                                             int flags,
+                                             leveldb::WritableFile** result) {
+    *result = nullptr;
+    auto file = file::File::Open(fname, flags | O_WRONLY | O_CREAT | O_CLOEXEC,
+                                 0644);
+    if (!file.ok()) {
+        return ToLevelDBStatus(file.status(), fname);
+    }
+    auto size = (*file)->LSeek(0, SEEK_END);
+    if (!size.ok()) {
+        return ToLevelDBStatus(size.status(), fname);
+    }
+    counters_.opened_files++;
+    *result = new WritableFileImpl(std::move(*file), fname, *size, options_,
+                                   &counters_);
+    return leveldb::Status::OK();
+}
+
+leveldb::Status ToolbaseEnv::NewWritableFile(const std::string& fname,
+                                             leveldb::WritableFile** result) {
+    return NewWritableFile(fname, O_TRUNC, result);
+}
+
+leveldb::Status ToolbaseEnv::NewAppendableFile(const std::string& fname,
+                                               leveldb::WritableFile** result) {
+    return NewWritableFile(fname, O_APPEND, result);
+}
+
+bool ToolbaseEnv::FileExists(const std::string& fname) {
+    auto exists = file::Exists(fname);
+    return exists.ok() && *exists;
+}
+
+leveldb::Status ToolbaseEnv::GetChildren(const std::string& dir,
+                                         std::vector<std::string>* result) {
+    auto children = file::ListDirectory(dir);
+    if (!children.ok()) {
+        result->clear();
+        return ToLevelDBStatus(children.status(), dir);
+    }
+    *result = std::move(*children);
+    return leveldb::Status::OK();
+}
+
+leveldb::Status ToolbaseEnv::RemoveFile(const std::string& fname) {
+    counters_.removed_files++;
+    return ToLevelDBStatus(file::Unlink(fname), fname);
+}
+
+leveldb::Status ToolbaseEnv::CreateDir(const std::string& dirname) {
+    return ToLevelDBStatus(file::Mkdir(dirname, 0755), dirname);
+}
+
+leveldb::Status ToolbaseEnv::RemoveDir(const std::string& dirname) {
+    return ToLevelDBStatus(file::Rmdir(dirname), dirname);
+}
+
+leveldb::Status ToolbaseEnv::GetFileSize(const std::string& fname,
+                                         uint64_t* file_size) {
+    auto stat = file::Stat(fname);
+    if (!stat.ok()) {
+        *file_size = 0;
+        return ToLevelDBStatus(stat.status(), fname);
+    }
+    *file_size = stat->size();
+    return leveldb::Status::OK();
+}
+
+leveldb::Status ToolbaseEnv::RenameFile(const std::string& src,
+                                        const std::string& target) {
+    counters_.renamed_files++;
+    return ToLevelDBStatus(file::Rename(src, target), src);
+}
+
+void ToolbaseEnv::Schedule(void (*function)(void* arg), void* arg) {
+    counters_.scheduled_jobs++;
+    background_pool_->Schedule([function, arg]() { function(arg); });
+}
+
+}  // namespace kv
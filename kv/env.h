@@ -0,0 +1,113 @@
+#ifndef TOOLBASE_KV_ENV_H_
+#define TOOLBASE_KV_ENV_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "leveldb/env.h"
+#include "utils/histogram.h"
+#include "utils/thread_pool.h"
+
+namespace kv {
+
+// Counters of the IO done by the files of a `ToolbaseEnv`.
+struct IOCounters {
+    std::atomic<uint64_t> sequential_reads{0};
+    std::atomic<uint64_t> sequential_read_bytes{0};
+    // Reads of the table files, including the ones served by a mapping.
+    std::atomic<uint64_t> random_reads{0};
+    std::atomic<uint64_t> random_read_bytes{0};
+    std::atomic<uint64_t> mmap_reads{0};
+    // `Append` calls and the write syscalls they are buffered into.
+    std::atomic<uint64_t> appends{0};
+    std::atomic<uint64_t> writes{0};
+    std::atomic<uint64_t> write_bytes{0};
+    std::atomic<uint64_t> syncs{0};
+    std::atomic<uint64_t> preallocations{0};
+    std::atomic<uint64_t> opened_files{0};
+    std::atomic<uint64_t> removed_files{0};
+    std::atomic<uint64_t> renamed_files{0};
+    std::atomic<uint64_t> scheduled_jobs{0};
+    utils::LatencyHistogram sync_latency;
+
+    // Returns one line per counter, e.g. "random_reads 1234".
+    std::string ToString() const;
+};
+
+// Converts to the leveldb status, NotFound is kept and the other errors are
+// IO errors about `context`.
+leveldb::Status ToLevelDBStatus(const absl::Status& status,
+                                const std::string& context);
+
+// A leveldb Env doing the file IO with `file::File`, so that the IO of the
+// embedded databases is counted and tuned like the rest of the stack:
+//  - table files are read through read-only mappings, up to `max_mmaps`,
+//  - log files are preallocated in steps of `log_preallocation_size`,
+//  - writes are buffered into `write_buffer_size` writes,
+//  - background compactions run on a pluggable thread pool.
+// Locks, loggers and the clock are the ones of `leveldb::Env::Default()`.
+// The env must outlive the databases using it.
+// Example:
+//  kv::ToolbaseEnv env(kv::ToolbaseEnv::Options{});
+//  kv::Options options;
+//  options.env = &env;
+//  ASSIGN_OR_RETURN(auto store, kv::Store::Open("/data/db", options));
+//  LOG(INFO) << env.counters().ToString();
+class ToolbaseEnv : public leveldb::EnvWrapper {
+   public:
+    struct Options {
+        bool use_mmap_reads = true;
+        int max_mmaps = 1000;
+        // 0 disables the preallocation.
+        size_t log_preallocation_size = 4 << 20;
+        size_t write_buffer_size = 64 << 10;
+        // Not owned, nullptr runs the background jobs on an own thread.
+        utils::ThreadPool* background_pool = nullptr;
+    };
+
+    explicit ToolbaseEnv(const Options& options);
+    ~ToolbaseEnv() override;
+
+    const IOCounters& counters() const { return counters_; }
+
+    leveldb::Status NewSequentialFile(
+        const std::string& fname, leveldb::SequentialFile** result) override;
+    leveldb::Status NewRandomAccessFile(
+        const std::string& fname, leveldb::RandomAccessFile** result) override;
+    leveldb::Status NewWritableFile(const std::string& fname,
+                                    leveldb::WritableFile** result) override;
+    leveldb::Status NewAppendableFile(const std::string& fname,
+                                      leveldb::WritableFile** result) override;
+
+    bool FileExists(const std::string& fname) override;
+    leveldb::Status GetChildren(const std::string& dir,
+                                std::vector<std::string>* result) override;
+    leveldb::Status RemoveFile(const std::string& fname) override;
+    leveldb::Status CreateDir(const std::string& dirname) override;
+    leveldb::Status RemoveDir(const std::string& dirname) override;
+    leveldb::Status GetFileSize(const std::string& fname,
+                                uint64_t* file_size) override;
+    leveldb::Status RenameFile(const std::string& src,
+                               const std::string& target) override;
+
+    void Schedule(void (*function)(void* arg), void* arg) override;
+
+   private:
+    leveldb::Status NewWritableFile(const std::string& fname, int flags,
+                                    leveldb::WritableFile** result);
+
+    const Options options_;
+    IOCounters counters_;
+    // Mappings left before falling back to pread.
+    std::atomic<int> mmaps_left_;
+    std::unique_ptr<utils::ThreadPool> own_pool_;
+    utils::ThreadPool* background_pool_;
+};
+
+}  // namespace kv
+
+#endif  // TOOLBASE_KV_ENV_H_
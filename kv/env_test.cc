@@ -0,0 +1,131 @@
+#include "kv/env.h"
+
+#include <memory>
+#include <string>
+
+#include "absl/strings/str_format.h"
+#include "absl/synchronization/notification.h"
+#include "file/filesystem.h"
+#include "gtest/gtest.h"
+#include "kv/store.h"
+#include "utils/testing.h"
+
+namespace kv {
+namespace {
+
+using ::testing::UnorderedElementsAre;
+
+class ToolbaseEnv : public ::testing::Test {
+   protected:
+    void SetUp() override {
+        path_ = absl::StrFormat(
+            "/tmp/test_kv_env_%s",
+            ::testing::UnitTest::GetInstance()->current_test_info()->name());
+        ASSERT_OK(file::RmTree(path_));
+        ASSERT_TRUE(env_.CreateDir(path_).ok());
+    }
+    void TearDown() override { ASSERT_OK(file::RmTree(path_)); }
+
+    void WriteFile(const std::string& fname, const std::string& data) {
+        leveldb::WritableFile* file;
+        ASSERT_TRUE(env_.NewWritableFile(fname, &file).ok());
+        std::unique_ptr<leveldb::WritableFile> guard(file);
+        ASSERT_TRUE(file->Append(data).ok());
+        ASSERT_TRUE(file->Sync().ok());
+        ASSERT_TRUE(file->Close().ok());
+    }
+
+    std::string path_;
+    kv::ToolbaseEnv env_{kv::ToolbaseEnv::Options{}};
+};
+
+TEST_F(ToolbaseEnv, SequentialFile) {
+    std::string fname = path_ + "/000001.log";
+    WriteFile(fname, "hello world");
+
+    leveldb::SequentialFile* file;
+    ASSERT_TRUE(env_.NewSequentialFile(fname, &file).ok());
+    std::unique_ptr<leveldb::SequentialFile> guard(file);
+    char scratch[16];
+    leveldb::Slice result;
+    ASSERT_TRUE(file->Skip(6).ok());
+    ASSERT_TRUE(file->Read(sizeof(scratch), &result, scratch).ok());
+    EXPECT_EQ(result.ToString(), "world");
+    ASSERT_TRUE(file->Read(sizeof(scratch), &result, scratch).ok());
+    EXPECT_TRUE(result.empty());
+
+    // The preallocated tail is released on close.
+    uint64_t size;
+    ASSERT_TRUE(env_.GetFileSize(fname, &size).ok());
+    EXPECT_EQ(size, 11);
+    EXPECT_GE(env_.counters().syncs, 1);
+    EXPECT_EQ(env_.counters().sync_latency.Count(), env_.counters().syncs);
+}
+
+TEST_F(ToolbaseEnv, RandomAccessFile) {
+    std::string fname = path_ + "/000002.ldb";
+    WriteFile(fname, "0123456789");
+
+    for (int max_mmaps : {1, 0}) {
+        kv::ToolbaseEnv::Options options;
+        options.max_mmaps = max_mmaps;
+        kv::ToolbaseEnv env(options);
+        leveldb::RandomAccessFile* file;
+        ASSERT_TRUE(env.NewRandomAccessFile(fname, &file).ok());
+        std::unique_ptr<leveldb::RandomAccessFile> guard(file);
+        char scratch[16];
+        leveldb::Slice result;
+        ASSERT_TRUE(file->Read(3, 4, &result, scratch).ok());
+        EXPECT_EQ(result.ToString(), "3456");
+        EXPECT_EQ(env.counters().random_reads, 1);
+        EXPECT_EQ(env.counters().mmap_reads, max_mmaps);
+    }
+}
+
+TEST_F(ToolbaseEnv, AppendableFile) {
+    std::string fname = path_ + "/LOG";
+    WriteFile(fname, "abc");
+    leveldb::WritableFile* file;
+    ASSERT_TRUE(env_.NewAppendableFile(fname, &file).ok());
+    std::unique_ptr<leveldb::WritableFile> guard(file);
+    ASSERT_TRUE(file->Append("def").ok());
+    ASSERT_TRUE(file->Close().ok());
+    EXPECT_THAT(file::GetContents(fname),
+                utils::testing::IsOkAndHolds("abcdef"));
+    EXPECT_EQ(env_.counters().appends, 2);
+}
+
+TEST_F(ToolbaseEnv, FileOperations) {
+    WriteFile(path_ + "/a", "a");
+    ASSERT_TRUE(env_.RenameFile(path_ + "/a", path_ + "/b").ok());
+    EXPECT_FALSE(env_.FileExists(path_ + "/a"));
+    EXPECT_TRUE(env_.FileExists(path_ + "/b"));
+    std::vector<std::string> children;
+    ASSERT_TRUE(env_.GetChildren(path_, &children).ok());
+    EXPECT_THAT(children, UnorderedElementsAre("b"));
+    ASSERT_TRUE(env_.RemoveFile(path_ + "/b").ok());
+    EXPECT_FALSE(env_.GetChildren(path_ + "/missing", &children).ok());
+    EXPECT_EQ(env_.counters().renamed_files, 1);
+    EXPECT_EQ(env_.counters().removed_files, 1);
+}
+
+TEST_F(ToolbaseEnv, Schedule) {
+    absl::Notification done;
+    env_.Schedule(
+        [](void* arg) { static_cast<absl::Notification*>(arg)->Notify(); },
+        &done);
+    done.WaitForNotification();
+    EXPECT_EQ(env_.counters().scheduled_jobs, 1);
+}
+
+TEST_F(ToolbaseEnv, Store) {
+    Options options;
+    options.env = &env_;
+    auto store = kv::Store::Open(path_ + "/db", options);
+    ASSERT_OK(store);
+    ASSERT_OK((*store)->Put("key", "value"));
+    EXPECT_THAT((*store)->Get("key"), utils::testing::IsOkAndHolds("value"));
+}
+
+}  // namespace
+}  // namespace kv
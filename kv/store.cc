@@ -0,0 +1,284 @@
+#include "kv/store.h"
+
+#include <atomic>
+#include <vector>
+
+#include "leveldb/iterator.h"
+#include "leveldb/options.h"
+#include "utils/status_macros.h"
+
+namespace kv {
+namespace {
+
+leveldb::Slice ToSlice(absl::string_view s) {
+    return leveldb::Slice(s.data(), s.size());
+}
+
+absl::string_view ToStringView(const leveldb::Slice& s) {
+    return absl::string_view(s.data(), s.size());
+}
+
+// Loads 8 bytes of `key` from `pos` as a big endian integer, missing bytes
+// are zeros.
+uint64_t LoadKeyBytes(absl::string_view key, size_t pos) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < 8; i++) {
+        uint8_t byte = pos + i < key.size() ? key[pos + i] : 0;
+        value = value << 8 | byte;
+    }
+    return value;
+}
+
+}  // namespace
+
+absl::Status FromLevelDBStatus(const leveldb::Status& status) {
+    if (status.ok()) {
+        return absl::OkStatus();
+    }
+    if (status.IsNotFound()) {
+        return absl::NotFoundError(status.ToString());
+    }
+    if (status.IsCorruption()) {
+        return absl::DataLossError(status.ToString());
+    }
+    if (status.IsNotSupportedError()) {
+        return absl::UnimplementedError(status.ToString());
+    }
+    if (status.IsInvalidArgument()) {
+        return absl::InvalidArgumentError(status.ToString());
+    }
+    return absl::InternalError(status.ToString());
+}
+
+Store::Store(const Options& options, std::unique_ptr<leveldb::Cache> cache,
+             std::unique_ptr<const leveldb::FilterPolicy> filter_policy,
+             std::unique_ptr<leveldb::DB> db)
+    : options_(options),
+      cache_(std::move(cache)),
+      filter_policy_(std::move(filter_policy)),
+      db_(std::move(db)),
+      read_pool_(options.read_threads) {
+    writer_ = std::thread(&Store::WriteLoop, this);
+}
+
+Store::~Store() {
+    {
+        absl::MutexLock lock(&mu_);
+        stopping_ = true;
+    }
+    writer_.join();
+}
+
+absl::StatusOr<std::unique_ptr<Store>> Store::Open(absl::string_view path,
+                                                   const Options& options) {
+    leveldb::Options db_options;
+    db_options.create_if_missing = options.create_if_missing;
+    db_options.write_buffer_size = options.write_buffer_size;
+    db_options.max_open_files = options.max_open_files;
+    if (options.env) {
+        db_options.env = options.env;
+    }
+
+    std::unique_ptr<leveldb::Cache> cache;
+    if (options.block_cache_size > 0) {
+        cache.reset(leveldb::NewLRUCache(options.block_cache_size));
+        db_options.block_cache = cache.get();
+    }
+    std::unique_ptr<const leveldb::FilterPolicy> filter_policy;
+    if (options.bloom_bits_per_key > 0) {
+        filter_policy.reset(
+            leveldb::NewBloomFilterPolicy(options.bloom_bits_per_key));
+        db_options.filter_policy = filter_policy.get();
+    }
+
+    leveldb::DB* db;
+    RETURN_IF_ERROR(FromLevelDBStatus(
+        leveldb::DB::Open(db_options, std::string(path), &db)));
+    return std::unique_ptr<Store>(new Store(options, std::move(cache),
+                                            std::move(filter_policy),
+                                            std::unique_ptr<leveldb::DB>(db)));
+}
+
+absl::Status Store::Put(absl::string_view key, absl::string_view value) {
+    return PutAsync(key, value).get();
+}
+
+absl::Status Store::Delete(absl::string_view key) {
+    leveldb::WriteBatch batch;
+    batch.Delete(ToSlice(key));
+    return Write(std::move(batch));
+}
+
+absl::Status Store::Write(leveldb::WriteBatch batch) {
+    return WriteAsync(std::move(batch)).get();
+}
+
+std::future<absl::Status> Store::PutAsync(absl::string_view key,
+                                          absl::string_view value) {
+    leveldb::WriteBatch batch;
+    batch.Put(ToSlice(key), ToSlice(value));
+    return WriteAsync(std::move(batch));
+}
+
+std::future<absl::Status> Store::WriteAsync(leveldb::WriteBatch batch) {
+    auto write = std::make_unique<PendingWrite>();
+    write->batch = std::move(batch);
+    auto future = write->done.get_future();
+    absl::MutexLock lock(&mu_);
+    pending_.push_back(std::move(write));
+    return future;
+}
+
+void Store::WriteLoop() {
+    auto has_work = [this]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        return !pending_.empty() || stopping_;
+    };
+    leveldb::WriteBatch group_batch;
+    while (true) {
+        // Takes all the pending writes up to `max_group_commit_bytes`, the
+        // writes arriving meanwhile form the next group.
+        std::vector<std::unique_ptr<PendingWrite>> group;
+        {
+            absl::MutexLock lock(&mu_);
+            mu_.Await(absl::Condition(&has_work));
+            if (pending_.empty()) {
+                return;
+            }
+            size_t bytes = 0;
+            while (!pending_.empty()) {
+                size_t size = pending_.front()->batch.ApproximateSize();
+                if (!group.empty() &&
+                    bytes + size > options_.max_group_commit_bytes) {
+                    break;
+                }
+                bytes += size;
+                group.push_back(std::move(pending_.front()));
+                pending_.pop_front();
+            }
+        }
+
+        leveldb::WriteBatch* batch = &group.front()->batch;
+        if (group.size() > 1) {
+            group_batch.Clear();
+            for (const auto& write : group) {
+                group_batch.Append(write->batch);
+            }
+            batch = &group_batch;
+        }
+        leveldb::WriteOptions write_options;
+        write_options.sync = options_.sync;
+        absl::Status status =
+            FromLevelDBStatus(db_->Write(write_options, batch));
+        for (auto& write : group) {
+            write->done.set_value(status);
+        }
+    }
+}
+
+absl::StatusOr<std::string> Store::Get(absl::string_view key) {
+    std::string value;
+    RETURN_IF_ERROR(FromLevelDBStatus(
+        db_->Get(leveldb::ReadOptions(), ToSlice(key), &value)));
+    return value;
+}
+
+std::future<absl::StatusOr<std::string>> Store::GetAsync(
+    absl::string_view key) {
+    auto promise =
+        std::make_shared<std::promise<absl::StatusOr<std::string>>>();
+    auto future = promise->get_future();
+    read_pool_.Schedule([this, promise, key = std::string(key)]() {
+        promise->set_value(Get(key));
+    });
+    return future;
+}
+
+absl::Status Store::Scan(absl::string_view start, absl::string_view limit,
+                         const ScanCallback& callback) {
+    return ScanRange(leveldb::ReadOptions(), start, limit, callback);
+}
+
+absl::Status Store::ScanRange(const leveldb::ReadOptions& read_options,
+                              absl::string_view start, absl::string_view limit,
+                              const ScanCallback& callback) {
+    std::unique_ptr<leveldb::Iterator> it(db_->NewIterator(read_options));
+    for (it->Seek(ToSlice(start)); it->Valid(); it->Next()) {
+        absl::string_view key = ToStringView(it->key());
+        if (!limit.empty() && key >= limit) {
+            break;
+        }
+        callback(key, ToStringView(it->value()));
+    }
+    return FromLevelDBStatus(it->status());
+}
+
+std::vector<std::string> Store::SplitRange(absl::string_view start,
+                                           absl::string_view limit,
+                                           int count) {
+    size_t prefix = 0;
+    while (prefix < start.size() && prefix < limit.size() &&
+           start[prefix] == limit[prefix]) {
+        prefix++;
+    }
+    uint64_t low = LoadKeyBytes(start, prefix);
+    uint64_t high = limit.empty() ? ~0ull : LoadKeyBytes(limit, prefix);
+
+    std::vector<std::string> splits;
+    for (int i = 1; i < count && low < high; i++) {
+        uint64_t value =
+            low + static_cast<uint64_t>(static_cast<unsigned __int128>(
+                                            high - low) *
+                                        i / count);
+        std::string key(start.substr(0, prefix));
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            key.push_back(static_cast<char>(value >> shift));
+        }
+        if (key > start && (limit.empty() || key < limit) &&
+            (splits.empty() || key > splits.back())) {
+            splits.push_back(std::move(key));
+        }
+    }
+    return splits;
+}
+
+absl::Status Store::ParallelScan(absl::string_view start,
+                                 absl::string_view limit, int parallelism,
+                                 const ScanCallback& callback) {
+    // More ranges than threads, so that threads finishing a sparse range
+    // take over the remaining ones.
+    std::vector<std::string> bounds = {std::string(start)};
+    for (auto& split : SplitRange(start, limit, parallelism * 8)) {
+        bounds.push_back(std::move(split));
+    }
+    bounds.push_back(std::string(limit));
+
+    leveldb::ReadOptions read_options;
+    read_options.snapshot = db_->GetSnapshot();
+    // Bulk scans would evict the hot blocks of point reads.
+    read_options.fill_cache = false;
+    const size_t num_ranges = bounds.size() - 1;
+    std::vector<absl::Status> statuses(num_ranges);
+    std::atomic<size_t> next{0};
+    auto scan = [&]() {
+        for (size_t i = next++; i < num_ranges; i = next++) {
+            statuses[i] =
+                ScanRange(read_options, bounds[i], bounds[i + 1], callback);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int i = 1; i < parallelism; i++) {
+        threads.emplace_back(scan);
+    }
+    scan();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    db_->ReleaseSnapshot(read_options.snapshot);
+
+    for (const auto& status : statuses) {
+        RETURN_IF_ERROR(status);
+    }
+    return absl::OkStatus();
+}
+
+}  // namespace kv
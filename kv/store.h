@@ -0,0 +1,134 @@
+#ifndef TOOLBASE_KV_STORE_H_
+#define TOOLBASE_KV_STORE_H_
+
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "leveldb/cache.h"
+#include "leveldb/db.h"
+#include "leveldb/filter_policy.h"
+#include "leveldb/options.h"
+#include "leveldb/write_batch.h"
+#include "utils/thread_pool.h"
+
+namespace kv {
+
+struct Options {
+    bool create_if_missing = true;
+
+    // Size of the LRU cache of uncompressed blocks, 0 uses the 8MB default
+    // of leveldb.
+    size_t block_cache_size = 64 << 20;
+    // Bits per key of the bloom filters, 0 disables the filters.
+    int bloom_bits_per_key = 10;
+    // Size of the memtable, larger values speed up bulk loads.
+    size_t write_buffer_size = 64 << 20;
+    int max_open_files = 1000;
+
+    // Syncs the log once per group commit.
+    bool sync = false;
+    // Upper bound of the batches merged into one group commit.
+    size_t max_group_commit_bytes = 4 << 20;
+    // Threads of the pool running the async reads.
+    int read_threads = 4;
+
+    // Not owned, nullptr uses `leveldb::Env::Default()`.
+    leveldb::Env* env = nullptr;
+};
+
+// Converts a leveldb status to the canonical codes.
+absl::Status FromLevelDBStatus(const leveldb::Status& status);
+
+// A key-value store over leveldb.
+// Writes from all threads go through one writer thread, which merges the
+// pending batches into a single leveldb write (and a single log sync), the
+// async calls return futures. Reads run on a pool of `read_threads`.
+// Example:
+//  ASSIGN_OR_RETURN(auto store, Store::Open("/data/db", kv::Options()));
+//  RETURN_IF_ERROR(store->Put("key", "value"));
+//  auto value = store->GetAsync("key");
+//  ASSIGN_OR_RETURN(std::string v, value.get());
+class Store {
+   public:
+    ~Store();
+
+    static absl::StatusOr<std::unique_ptr<Store>> Open(absl::string_view path,
+                                                       const Options& options);
+
+    absl::Status Put(absl::string_view key, absl::string_view value);
+    absl::Status Delete(absl::string_view key);
+    // Applies `batch` atomically.
+    absl::Status Write(leveldb::WriteBatch batch);
+
+    std::future<absl::Status> PutAsync(absl::string_view key,
+                                       absl::string_view value);
+    std::future<absl::Status> WriteAsync(leveldb::WriteBatch batch);
+
+    // Returns NotFound if `key` does not exist.
+    absl::StatusOr<std::string> Get(absl::string_view key);
+    std::future<absl::StatusOr<std::string>> GetAsync(absl::string_view key);
+
+    using ScanCallback =
+        std::function<void(absl::string_view key, absl::string_view value)>;
+
+    // Calls `callback` on the keys in [`start`, `limit`) in order, an empty
+    // `limit` means no upper bound.
+    absl::Status Scan(absl::string_view start, absl::string_view limit,
+                      const ScanCallback& callback);
+
+    // Like `Scan`, but the range is split into sub ranges scanned by
+    // `parallelism` threads on a consistent snapshot. `callback` is called
+    // concurrently, in key order within each sub range only.
+    absl::Status ParallelScan(absl::string_view start, absl::string_view limit,
+                              int parallelism, const ScanCallback& callback);
+
+    // Splits [`start`, `limit`) into `count` sub ranges by interpolating the
+    // key bytes following their common prefix, returns the `count` - 1
+    // ascending split keys (fewer when the range is too narrow).
+    static std::vector<std::string> SplitRange(absl::string_view start,
+                                               absl::string_view limit,
+                                               int count);
+
+    leveldb::DB* db() { return db_.get(); }
+
+   private:
+    struct PendingWrite {
+        leveldb::WriteBatch batch;
+        std::promise<absl::Status> done;
+    };
+
+    Store(const Options& options, std::unique_ptr<leveldb::Cache> cache,
+          std::unique_ptr<const leveldb::FilterPolicy> filter_policy,
+          std::unique_ptr<leveldb::DB> db);
+
+    void WriteLoop();
+    absl::Status ScanRange(const leveldb::ReadOptions& read_options,
+                           absl::string_view start, absl::string_view limit,
+                           const ScanCallback& callback);
+
+    const Options options_;
+    // Declared before `db_`, which uses them until deleted.
+    std::unique_ptr<leveldb::Cache> cache_;
+    std::unique_ptr<const leveldb::FilterPolicy> filter_policy_;
+    std::unique_ptr<leveldb::DB> db_;
+
+    absl::Mutex mu_;
+    std::deque<std::unique_ptr<PendingWrite>> pending_ ABSL_GUARDED_BY(mu_);
+    bool stopping_ ABSL_GUARDED_BY(mu_) = false;
+    std::thread writer_;
+
+    utils::ThreadPool read_pool_;
+};
+
+}  // namespace kv
+
+#endif  // TOOLBASE_KV_STORE_H_
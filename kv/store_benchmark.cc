@@ -0,0 +1,56 @@
+#include <thread>
+#include <vector>
+
+#include "absl/strings/str_format.h"
+#include "benchmark/benchmark.h"
+#include "file/filesystem.h"
+#include "kv/store.h"
+
+namespace kv {
+namespace {
+
+constexpr absl::string_view kPath = "/tmp/kv_store_benchmark";
+
+// Puts 10000 keys from each of `range(0)` threads per iteration, waiting for
+// every put (`range(1)` = 0) or for all the async puts at the end.
+void BM_StorePut(benchmark::State& state) {
+    constexpr int kPuts = 10000;
+    const int num_threads = state.range(0);
+    const bool async = state.range(1);
+    file::RmTree(kPath).IgnoreError();
+    auto store = *Store::Open(kPath, Options());
+
+    std::string value(100, 'x');
+    for (auto _ : state) {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < num_threads; t++) {
+            threads.emplace_back([&, t]() {
+                std::vector<std::future<absl::Status>> futures;
+                for (int i = 0; i < kPuts; i++) {
+                    std::string key = absl::StrFormat("%d/%08d", t, i);
+                    if (async) {
+                        futures.push_back(store->PutAsync(key, value));
+                    } else {
+                        store->Put(key, value).IgnoreError();
+                    }
+                }
+                for (auto& future : futures) {
+                    future.get().IgnoreError();
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * num_threads * kPuts);
+
+    store.reset();
+    file::RmTree(kPath).IgnoreError();
+}
+BENCHMARK(BM_StorePut)
+    ->ArgsProduct({{1, 4, 16}, {0, 1}})
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace kv
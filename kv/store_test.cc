@@ -0,0 +1,141 @@
+#include "kv/store.h"
+
+#include <atomic>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/synchronization/mutex.h"
+#include "file/filesystem.h"
+#include "gtest/gtest.h"
+#include "utils/testing.h"
+
+namespace kv {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::Pair;
+using ::utils::testing::IsOkAndHolds;
+using ::utils::testing::StatusIs;
+
+class Store : public ::testing::Test {
+   protected:
+    void SetUp() override {
+        path_ = absl::StrFormat(
+            "/tmp/test_kv_store_%s",
+            ::testing::UnitTest::GetInstance()->current_test_info()->name());
+        ASSERT_OK(file::RmTree(path_));
+        auto store = kv::Store::Open(path_, Options());
+        ASSERT_OK(store);
+        store_ = std::move(*store);
+    }
+    void TearDown() override {
+        store_.reset();
+        ASSERT_OK(file::RmTree(path_));
+    }
+
+    std::string path_;
+    std::unique_ptr<kv::Store> store_;
+};
+
+TEST_F(Store, PutGetDelete) {
+    EXPECT_THAT(store_->Get("key"), StatusIs(absl::StatusCode::kNotFound));
+    EXPECT_OK(store_->Put("key", "value"));
+    EXPECT_THAT(store_->Get("key"), IsOkAndHolds("value"));
+    EXPECT_THAT(store_->GetAsync("key").get(), IsOkAndHolds("value"));
+    EXPECT_OK(store_->Delete("key"));
+    EXPECT_THAT(store_->GetAsync("key").get(),
+                StatusIs(absl::StatusCode::kNotFound));
+
+    leveldb::WriteBatch batch;
+    batch.Put("a", "1");
+    batch.Put("b", "2");
+    EXPECT_OK(store_->Write(std::move(batch)));
+    EXPECT_THAT(store_->Get("b"), IsOkAndHolds("2"));
+}
+
+TEST_F(Store, ConcurrentAsyncWrites) {
+    constexpr int kThreads = 8;
+    constexpr int kWrites = 1000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; t++) {
+        threads.emplace_back([this, t]() {
+            std::vector<std::future<absl::Status>> futures;
+            for (int i = 0; i < kWrites; i++) {
+                futures.push_back(store_->PutAsync(
+                    absl::StrFormat("%d/%05d", t, i), absl::StrCat(i)));
+            }
+            for (auto& future : futures) {
+                EXPECT_OK(future.get());
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    int count = 0;
+    EXPECT_OK(store_->Scan("", "", [&count](absl::string_view key,
+                                            absl::string_view value) {
+        count++;
+    }));
+    EXPECT_EQ(count, kThreads * kWrites);
+    EXPECT_THAT(store_->Get("7/00999"), IsOkAndHolds("999"));
+}
+
+TEST_F(Store, Scan) {
+    for (auto key : {"a", "b", "ba", "c", "d"}) {
+        ASSERT_OK(store_->Put(key, std::string(key) + "!"));
+    }
+    std::vector<std::pair<std::string, std::string>> items;
+    EXPECT_OK(store_->Scan("b", "d", [&items](absl::string_view key,
+                                              absl::string_view value) {
+        items.emplace_back(key, value);
+    }));
+    EXPECT_THAT(items, ElementsAre(Pair("b", "b!"), Pair("ba", "ba!"),
+                                   Pair("c", "c!")));
+}
+
+TEST(SplitRange, Splits) {
+    auto splits = kv::Store::SplitRange("user:0000", "user:9999", 4);
+    ASSERT_EQ(splits.size(), 3);
+    std::string previous = "user:0000";
+    for (const auto& split : splits) {
+        EXPECT_GT(split, previous);
+        EXPECT_LT(split, "user:9999");
+        EXPECT_EQ(split.substr(0, 5), "user:");
+        previous = split;
+    }
+
+    EXPECT_EQ(kv::Store::SplitRange("", "", 8).size(), 7);
+    EXPECT_TRUE(kv::Store::SplitRange("a", "a\x01", 8).size() <= 7);
+    EXPECT_TRUE(kv::Store::SplitRange("a", "a", 8).empty());
+}
+
+TEST_F(Store, ParallelScan) {
+    leveldb::WriteBatch batch;
+    for (int i = 0; i < 10000; i++) {
+        batch.Put(absl::StrFormat("key%06d", i * 7), "v");
+    }
+    ASSERT_OK(store_->Write(std::move(batch)));
+
+    for (int parallelism : {1, 4}) {
+        absl::Mutex mu;
+        std::set<std::string> keys;
+        EXPECT_OK(store_->ParallelScan(
+            "key001000", "key050000", parallelism,
+            [&](absl::string_view key, absl::string_view value) {
+                absl::MutexLock lock(&mu);
+                EXPECT_TRUE(keys.insert(std::string(key)).second);
+            }));
+        // Keys 1001..49994 which are multiples of 7.
+        EXPECT_EQ(keys.size(), 49994 / 7 - 1000 / 7);
+        EXPECT_EQ(*keys.begin(), "key001001");
+        EXPECT_EQ(*keys.rbegin(), "key049994");
+    }
+}
+
+}  // namespace
+}  // namespace kv
@@ -0,0 +1,44 @@
+#include "net/async_listener.h"
+
+#include <fcntl.h>
+
+#include "utils/errno_status.h"
+#include "utils/status_macros.h"
+
+namespace net {
+namespace {
+
+// Connections accepted per accept4 loop.
+constexpr int kAcceptBatch = 64;
+
+}  // namespace
+
+absl::StatusOr<std::unique_ptr<AsyncListener>> AsyncListener::Create(
+    file::EventLoop* loop, std::unique_ptr<NetSocket> socket) {
+    int flags = fcntl(socket->fd(), F_GETFL, 0);
+    if (flags == -1 || fcntl(socket->fd(), F_SETFL, flags | O_NONBLOCK) == -1) {
+        return utils::ErrnoToStatus(errno);
+    }
+    ASSIGN_OR_RETURN(auto registration,
+                     file::IORegistration::Create(loop, socket.get()));
+    return std::unique_ptr<AsyncListener>(
+        new AsyncListener(loop, std::move(socket), std::move(registration)));
+}
+
+file::Task<absl::StatusOr<std::unique_ptr<file::AsyncIO>>>
+AsyncListener::Accept() {
+    while (pending_.empty()) {
+        CO_ASSIGN_OR_RETURN(auto sockets, socket_->AcceptMany(kAcceptBatch));
+        if (sockets.empty()) {
+            co_await registration_->Readable();
+        }
+        for (auto& socket : sockets) {
+            pending_.push_back(std::move(socket));
+        }
+    }
+    std::unique_ptr<NetSocket> socket = std::move(pending_.front());
+    pending_.pop_front();
+    co_return file::AsyncIO::Create(loop_, std::move(socket));
+}
+
+}  // namespace net
@@ -0,0 +1,55 @@
+#ifndef TOOLBASE_NET_ASYNC_LISTENER_H_
+#define TOOLBASE_NET_ASYNC_LISTENER_H_
+
+#include <deque>
+#include <memory>
+
+#include "absl/status/statusor.h"
+#include "file/coro.h"
+#include "net/net.h"
+
+namespace net {
+
+// Accepts the connections of a listening socket from coroutines, see
+// file/coro.h. Pending connections are drained in batches, the extra ones
+// are kept for the next calls. One coroutine may wait in `Accept` at a time.
+// Example:
+//  file::Task<> Serve(file::EventLoop* loop, net::AsyncListener* listener) {
+//      while (true) {
+//          auto conn = co_await listener->Accept();
+//          if (!conn.ok()) {
+//              LOG(ERROR) << conn.status();
+//              co_return;
+//          }
+//          loop->Spawn(Handle(std::move(*conn)));
+//      }
+//  }
+class AsyncListener {
+   public:
+    // `socket` should be bound and listening.
+    static absl::StatusOr<std::unique_ptr<AsyncListener>> Create(
+        file::EventLoop* loop, std::unique_ptr<NetSocket> socket);
+
+    // Returns the next connection, whose `file()` is the accepted
+    // `NetSocket`.
+    file::Task<absl::StatusOr<std::unique_ptr<file::AsyncIO>>> Accept();
+
+    NetSocket* socket() { return socket_.get(); }
+
+   private:
+    AsyncListener(file::EventLoop* loop, std::unique_ptr<NetSocket> socket,
+                  std::unique_ptr<file::IORegistration> registration)
+        : loop_(loop),
+          socket_(std::move(socket)),
+          registration_(std::move(registration)) {}
+
+    file::EventLoop* loop_;
+    std::unique_ptr<NetSocket> socket_;
+    // Destroyed before `socket_` is closed.
+    std::unique_ptr<file::IORegistration> registration_;
+    std::deque<std::unique_ptr<NetSocket>> pending_;
+};
+
+}  // namespace net
+
+#endif  // TOOLBASE_NET_ASYNC_LISTENER_H_
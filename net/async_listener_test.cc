@@ -0,0 +1,98 @@
+#include "net/async_listener.h"
+
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "gtest/gtest.h"
+#include "utils/status_macros.h"
+#include "utils/testing.h"
+
+namespace net {
+namespace {
+
+using ::utils::testing::IsOkAndHolds;
+
+constexpr int kNumClients = 32;
+
+file::Task<> Echo(std::unique_ptr<file::AsyncIO> conn) {
+    while (true) {
+        auto data = co_await conn->Read(4096);
+        if (!data.ok() || data->empty()) {
+            co_return;
+        }
+        if (!(co_await conn->WriteAll(*data)).ok()) {
+            co_return;
+        }
+    }
+}
+
+file::Task<> Serve(file::EventLoop* loop, AsyncListener* listener,
+                   absl::Status* status) {
+    for (int i = 0; i < kNumClients; i++) {
+        auto conn = co_await listener->Accept();
+        if (!conn.ok()) {
+            *status = conn.status();
+            co_return;
+        }
+        auto* socket = static_cast<NetSocket*>((*conn)->file());
+        EXPECT_THAT(socket->remote_addr().ip(), IsOkAndHolds("127.0.0.1"));
+        loop->Spawn(Echo(std::move(*conn)));
+    }
+}
+
+// Owns the connection, closing it when done ends the echo.
+file::Task<> Client(std::unique_ptr<file::AsyncIO> conn, std::string request,
+                    std::string* response, absl::Status* status) {
+    *status = co_await conn->WriteAll(request);
+    while (status->ok() && response->size() < request.size()) {
+        auto data = co_await conn->Read(4096);
+        if (!data.ok()) {
+            *status = data.status();
+        } else if (data->empty()) {
+            *status = absl::InternalError("unexpected eof");
+        }
+        response->append(data.value_or(""));
+    }
+}
+
+TEST(AsyncListener, Echo) {
+    auto loop = file::EventLoop::Create();
+    EXPECT_OK(loop);
+    SocketOptions options;
+    options.reuse_addr = true;
+    auto server = Socket(AF_INET, SOCK_STREAM, 0, options);
+    EXPECT_OK(server);
+    auto addr = *SocketAddr::NewIPv4("127.0.0.1", 62791);
+    EXPECT_OK((*server)->Bind(addr));
+    EXPECT_OK((*server)->Listen(kNumClients));
+    auto listener = AsyncListener::Create(loop->get(), std::move(*server));
+    EXPECT_OK(listener);
+
+    absl::Status serve_status;
+    (*loop)->Spawn(Serve(loop->get(), listener->get(), &serve_status));
+
+    std::vector<std::string> requests(kNumClients);
+    std::vector<std::string> responses(kNumClients);
+    std::vector<absl::Status> statuses(kNumClients);
+    for (int i = 0; i < kNumClients; i++) {
+        auto client = Socket(AF_INET, SOCK_STREAM, 0);
+        EXPECT_OK(client);
+        EXPECT_OK((*client)->Connect(addr));
+        auto conn = file::AsyncIO::Create(loop->get(), std::move(*client));
+        EXPECT_OK(conn);
+        requests[i] = absl::StrCat("hello ", i, std::string(i * 1000, 'x'));
+        (*loop)->Spawn(Client(std::move(*conn), requests[i], &responses[i],
+                              &statuses[i]));
+    }
+
+    EXPECT_OK((*loop)->Run());
+    EXPECT_OK(serve_status);
+    for (int i = 0; i < kNumClients; i++) {
+        EXPECT_OK(statuses[i]);
+        EXPECT_EQ(responses[i], requests[i]);
+    }
+}
+
+}  // namespace
+}  // namespace net
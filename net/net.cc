@@ -1,9 +1,27 @@
 #include "net/net.h"
 
+#include <linux/errqueue.h>
+#include <stddef.h>
+
 #include "absl/strings/str_format.h"
+#include "utils/errno_status.h"
+#include "utils/metrics.h"
 #include "utils/status_macros.h"
+#include "utils/trace.h"
 
 namespace net {
+namespace {
+
+utils::Counter *const send_bytes = utils::MetricsRegistry::Global().GetCounter(
+    "net_send_bytes_total", "Bytes sent by NetSocket::Send and SendTo.");
+utils::Counter *const recv_bytes = utils::MetricsRegistry::Global().GetCounter(
+    "net_recv_bytes_total", "Bytes received by NetSocket::Recv and RecvFrom.");
+utils::Counter *const accepted = utils::MetricsRegistry::Global().GetCounter(
+    "net_accepted_total", "Connections accepted by NetSocket.");
+utils::Counter *const connects = utils::MetricsRegistry::Global().GetCounter(
+    "net_connects_total", "Successful NetSocket::Connect calls.");
+
+}  // namespace
 
 absl::StatusOr<std::string> SocketAddr::ip() const {
     // buf size should be large than INET6_ADDRSTRLEN = 48
@@ -14,7 +32,7 @@ absl::StatusOr<std::string> SocketAddr::ip() const {
         const struct sockaddr_in *addr_v4 = (struct sockaddr_in *)(&addr_);
         if (inet_ntop(AF_INET, &addr_v4->sin_addr, buf, sizeof(buf) - 1) ==
             NULL) {
-            return absl::InternalError(strerror(errno));
+            return utils::ErrnoToStatus(errno);
         } else {
             return buf;
         }
@@ -22,12 +40,17 @@ absl::StatusOr<std::string> SocketAddr::ip() const {
         const struct sockaddr_in6 *addr_v6 = (struct sockaddr_in6 *)(&addr_);
         if (inet_ntop(AF_INET6, &addr_v6->sin6_addr, buf, sizeof(buf) - 1) ==
             NULL) {
-            return absl::InternalError(strerror(errno));
+            return utils::ErrnoToStatus(errno);
         } else {
             return buf;
         }
     } else if (addr_.ss_family == AF_UNIX) {
         const struct sockaddr_un *addr_un = (struct sockaddr_un *)(&addr_);
+        if (IsAbstractUnix()) {
+            size_t name_len = len_ - offsetof(struct sockaddr_un, sun_path) - 1;
+            return absl::StrCat(
+                "@", absl::string_view(addr_un->sun_path + 1, name_len));
+        }
         return addr_un->sun_path;
     } else {
         return absl::UnimplementedError(absl::StrFormat(
@@ -82,7 +105,7 @@ absl::StatusOr<SocketAddr> SocketAddr::NewIPv4(absl::string_view ip,
         return absl::InvalidArgumentError(
             absl::StrFormat("Cannot parse ipv4 from `%s`", ip));
     } else {
-        return absl::InternalError(strerror(errno));
+        return utils::ErrnoToStatus(errno);
     }
 }
 absl::StatusOr<SocketAddr> SocketAddr::NewIPv6(absl::string_view ip,
@@ -102,7 +125,7 @@ absl::StatusOr<SocketAddr> SocketAddr::NewIPv6(absl::string_view ip,
         return absl::InvalidArgumentError(
             absl::StrFormat("Cannot parse ipv6 from `%s`", ip));
     } else {
-        return absl::InternalError(strerror(errno));
+        return utils::ErrnoToStatus(errno);
     }
 }
 absl::StatusOr<SocketAddr> SocketAddr::NewUnix(absl::string_view path) {
@@ -119,20 +142,112 @@ absl::StatusOr<SocketAddr> SocketAddr::NewUnix(absl::string_view path) {
 
     return SocketAddr(addr);
 }
+absl::StatusOr<SocketAddr> SocketAddr::NewAbstractUnix(absl::string_view name) {
+    struct sockaddr_storage addr;
+    memset(&addr, 0, sizeof(addr));
+
+    struct sockaddr_un *addr_un = (struct sockaddr_un *)&addr;
+    addr_un->sun_family = AF_UNIX;
+    // The leading '\0' marks the abstract namespace.
+    if (name.length() + 1 > sizeof(addr_un->sun_path)) {
+        return absl::InvalidArgumentError(
+            absl::StrFormat("Name `%s` is too long for unix sockt", name));
+    }
+    memcpy(addr_un->sun_path + 1, name.data(), name.length());
+
+    return SocketAddr(addr, offsetof(struct sockaddr_un, sun_path) + 1 +
+                                name.length());
+}
 
 absl::StatusOr<std::unique_ptr<NetSocket>> Socket(int domain, int type,
                                                   int protocol) {
     int fd = socket(domain, type, protocol);
     if (fd < 0) {
-        return absl::InternalError(strerror(errno));
+        return utils::ErrnoToStatus(errno);
     }
     return std::unique_ptr<NetSocket>(new NetSocket(fd));
 }
 
+absl::StatusOr<
+    std::pair<std::unique_ptr<NetSocket>, std::unique_ptr<NetSocket>>>
+SocketPair(int domain, int type, int protocol) {
+    int fds[2];
+    if (socketpair(domain, type, protocol, fds) != 0) {
+        return utils::ErrnoToStatus(errno);
+    }
+    return std::make_pair(std::unique_ptr<NetSocket>(new NetSocket(fds[0])),
+                          std::unique_ptr<NetSocket>(new NetSocket(fds[1])));
+}
+
+absl::StatusOr<std::unique_ptr<NetSocket>> Socket(
+    int domain, int type, int protocol, const SocketOptions &options) {
+    ASSIGN_OR_RETURN(auto socket, Socket(domain, type, protocol));
+    RETURN_IF_ERROR(socket->ApplyOptions(options));
+    return std::move(socket);
+}
+
+SocketOptions SocketOptions::LowLatency() {
+    SocketOptions options;
+    options.no_delay = true;
+    options.quick_ack = true;
+    return options;
+}
+
+SocketOptions SocketOptions::BulkThroughput() {
+    SocketOptions options;
+    options.no_delay = false;
+    options.send_buffer_size = 4 << 20;
+    options.recv_buffer_size = 4 << 20;
+    return options;
+}
+
+absl::Status NetSocket::ApplyOptions(const SocketOptions &options) {
+    if (options.reuse_addr.value_or(false)) {
+        RETURN_IF_ERROR(SetReuseAddr());
+    }
+    if (options.reuse_port.value_or(false)) {
+        RETURN_IF_ERROR(SetReusePort());
+    }
+    if (options.send_buffer_size.has_value()) {
+        RETURN_IF_ERROR(SetSendBufferSize(*options.send_buffer_size));
+    }
+    if (options.recv_buffer_size.has_value()) {
+        RETURN_IF_ERROR(SetRecvBufferSize(*options.recv_buffer_size));
+    }
+    if (options.fast_open_queue.has_value()) {
+        RETURN_IF_ERROR(SetFastOpen(*options.fast_open_queue));
+    }
+    if (options.fast_open_connect.has_value()) {
+        RETURN_IF_ERROR(SetFastOpenConnect(*options.fast_open_connect));
+    }
+    if (options.defer_accept_secs.has_value()) {
+        RETURN_IF_ERROR(SetDeferAccept(*options.defer_accept_secs));
+    }
+    RETURN_IF_ERROR(ApplyConnectionOptions(options));
+    options_ = options;
+    return absl::OkStatus();
+}
+
+absl::Status NetSocket::ApplyConnectionOptions(const SocketOptions &options) {
+    if (options.no_delay.has_value()) {
+        RETURN_IF_ERROR(SetNoDelay(*options.no_delay));
+    }
+    if (options.quick_ack.has_value()) {
+        RETURN_IF_ERROR(SetQuickAck(*options.quick_ack));
+    }
+    if (options.busy_poll_us.has_value()) {
+        RETURN_IF_ERROR(SetBusyPoll(*options.busy_poll_us));
+    }
+    if (options.zero_copy.has_value()) {
+        RETURN_IF_ERROR(SetZeroCopy(*options.zero_copy));
+    }
+    return absl::OkStatus();
+}
+
 absl::Status NetSocket::Bind(const SocketAddr &addr) {
     int ret = bind(fd_, addr.addr(), addr.len());
     if (ret != 0) {
-        return absl::InternalError(strerror(errno));
+        return utils::ErrnoToStatus(errno);
     }
     bound_addr_ = addr;
     return absl::OkStatus();
@@ -141,28 +256,81 @@ absl::Status NetSocket::Bind(const SocketAddr &addr) {
 absl::Status NetSocket::Listen(int backlog) {
     int ret = listen(fd_, backlog);
     if (ret != 0) {
-        return absl::InternalError(strerror(errno));
+        return utils::ErrnoToStatus(errno);
     }
     return absl::OkStatus();
 }
 
 absl::StatusOr<std::unique_ptr<NetSocket>> NetSocket::Accept() {
     struct sockaddr_storage addr;
-    socklen_t len = bound_addr_.len();
+    socklen_t len = sizeof(addr);
+    utils::TraceSpan span("NetSocket::Accept");
     int fd = accept(fd_, (struct sockaddr *)&addr, &len);
     if (fd < 0) {
-        return absl::InternalError(strerror(errno));
+        return utils::ErrnoToStatus(errno);
+    }
+    return NewAcceptedSocket(fd, addr, len);
+}
+
+absl::StatusOr<std::vector<std::unique_ptr<NetSocket>>> NetSocket::AcceptMany(
+    int max) {
+    if (max <= 0) {
+        return absl::InvalidArgumentError(
+            absl::StrFormat("`max` = %d which should > 0", max));
+    }
+
+    utils::TraceSpan span("NetSocket::AcceptMany");
+    std::vector<std::unique_ptr<NetSocket>> sockets;
+    while ((int)sockets.size() < max) {
+        struct sockaddr_storage addr;
+        socklen_t len = sizeof(addr);
+        int fd = accept4(fd_, (struct sockaddr *)&addr, &len,
+                         SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK ||
+                !sockets.empty()) {
+                // Keeps the accepted sockets, a persistent error (e.g.
+                // EMFILE) will be reported by the next call.
+                break;
+            }
+            return utils::ErrnoToStatus(errno);
+        }
+        auto socket = NewAcceptedSocket(fd, addr, len);
+        if (!socket.ok()) {
+            // The failed socket is closed, the batch kept as above.
+            if (!sockets.empty()) {
+                break;
+            }
+            return socket.status();
+        }
+        sockets.push_back(*std::move(socket));
     }
+    return sockets;
+}
+
+absl::StatusOr<std::unique_ptr<NetSocket>> NetSocket::NewAcceptedSocket(
+    int fd, const struct sockaddr_storage &addr, socklen_t len) {
+    accepted->Increment();
     auto socket = std::unique_ptr<NetSocket>(new NetSocket(fd));
-    socket->SetRemoteAddr(SocketAddr(addr));
+    socket->SetRemoteAddr(SocketAddr(addr, len));
     socket->SetLocalAddr(bound_addr_);
+    RETURN_IF_ERROR(socket->ApplyConnectionOptions(options_));
+    socket->options_ = options_;
     return std::move(socket);
 }
 
 absl::Status NetSocket::Connect(const SocketAddr &addr) {
+    utils::TraceSpan span("NetSocket::Connect");
     int ret = connect(fd_, addr.addr(), addr.len());
     if (ret != 0) {
-        return absl::InternalError(strerror(errno));
+        return utils::ErrnoToStatus(errno);
+    }
+    connects->Increment();
+    if (options_.quick_ack.has_value()) {
+        RETURN_IF_ERROR(SetQuickAck(*options_.quick_ack));
     }
     return absl::OkStatus();
 }
@@ -179,11 +347,259 @@ absl::StatusOr<size_t> NetSocket::Send(const uint8_t *data, size_t count,
 
     ssize_t ret = send(fd_, data, count, flags);
     if (ret < 0) {
-        return absl::InternalError(strerror(errno));
+        return utils::ErrnoToStatus(errno);
+    }
+    send_bytes->Add(ret);
+    return ret;
+}
+
+absl::StatusOr<ZeroCopySend> NetSocket::SendZeroCopy(absl::string_view data,
+                                                     int flags) {
+    if (!zero_copy_) {
+        return absl::FailedPreconditionError("SO_ZEROCOPY is not enabled");
+    }
+    ASSIGN_OR_RETURN(size_t bytes,
+                     Send((const uint8_t *)data.data(), data.length(),
+                          flags | MSG_ZEROCOPY));
+    // Every successful MSG_ZEROCOPY send consumes one id, even if the kernel
+    // ends up copying the data.
+    ZeroCopySend sent;
+    sent.bytes = bytes;
+    sent.id = zerocopy_next_id_++;
+    return sent;
+}
+
+absl::StatusOr<size_t> NetSocket::SendFds(absl::string_view data,
+                                          const std::vector<int> &fds,
+                                          int flags) {
+    if (data.empty()) {
+        return absl::InvalidArgumentError("`data` should not be empty");
+    }
+    if (fds.empty() || fds.size() > kMaxFdsPerMessage) {
+        return absl::InvalidArgumentError(absl::StrFormat(
+            "`fds` has %d descriptors which should be in [1, %d]", fds.size(),
+            kMaxFdsPerMessage));
+    }
+
+    struct iovec iov;
+    iov.iov_base = (void *)data.data();
+    iov.iov_len = data.length();
+    std::vector<char> control(CMSG_SPACE(sizeof(int) * fds.size()));
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.data();
+    msg.msg_controllen = control.size();
+
+    struct cmsghdr *cm = CMSG_FIRSTHDR(&msg);
+    cm->cmsg_level = SOL_SOCKET;
+    cm->cmsg_type = SCM_RIGHTS;
+    cm->cmsg_len = CMSG_LEN(sizeof(int) * fds.size());
+    memcpy(CMSG_DATA(cm), fds.data(), sizeof(int) * fds.size());
+
+    ssize_t ret = sendmsg(fd_, &msg, flags);
+    if (ret < 0) {
+        return utils::ErrnoToStatus(errno);
     }
     return ret;
 }
 
+absl::StatusOr<ReceivedFds> NetSocket::RecvFds(size_t count, size_t max_fds,
+                                               int flags) {
+    if (count <= 0) {
+        return absl::InvalidArgumentError(
+            absl::StrFormat("`count` = %d which should > 0", count));
+    }
+    if (max_fds <= 0 || max_fds > kMaxFdsPerMessage) {
+        return absl::InvalidArgumentError(absl::StrFormat(
+            "`max_fds` = %d which should be in [1, %d]", max_fds,
+            kMaxFdsPerMessage));
+    }
+
+    ReceivedFds out;
+    out.data.resize(count);
+    struct iovec iov;
+    iov.iov_base = out.data.data();
+    iov.iov_len = count;
+    std::vector<char> control(CMSG_SPACE(sizeof(int) * max_fds));
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.data();
+    msg.msg_controllen = control.size();
+
+    ssize_t ret = recvmsg(fd_, &msg, flags | MSG_CMSG_CLOEXEC);
+    if (ret < 0) {
+        return utils::ErrnoToStatus(errno);
+    }
+    out.data.resize(ret);
+
+    for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm != NULL;
+         cm = CMSG_NXTHDR(&msg, cm)) {
+        if (cm->cmsg_level != SOL_SOCKET || cm->cmsg_type != SCM_RIGHTS) {
+            continue;
+        }
+        size_t n = (cm->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        for (size_t i = 0; i < n; i++) {
+            int fd;
+            memcpy(&fd, CMSG_DATA(cm) + i * sizeof(int), sizeof(int));
+            out.files.push_back(std::make_unique<file::File>(fd));
+        }
+    }
+    if (msg.msg_flags & MSG_CTRUNC) {
+        return absl::ResourceExhaustedError(absl::StrFormat(
+            "Received more than `max_fds` = %d descriptors", max_fds));
+    }
+    return out;
+}
+
+absl::StatusOr<std::vector<ZeroCopyCompletion>>
+NetSocket::ReadZeroCopyCompletions() {
+    RETURN_IF_ERROR(DrainErrorQueue());
+    std::vector<ZeroCopyCompletion> completions;
+    completions.swap(pending_zerocopy_);
+    return completions;
+}
+
+absl::StatusOr<std::vector<TxTimestamp>> NetSocket::ReadTxTimestamps() {
+    RETURN_IF_ERROR(DrainErrorQueue());
+    std::vector<TxTimestamp> timestamps;
+    timestamps.swap(pending_tx_timestamps_);
+    return timestamps;
+}
+
+namespace {
+
+absl::optional<absl::Time> TimespecToTime(const struct timespec &ts) {
+    if (ts.tv_sec == 0 && ts.tv_nsec == 0) {
+        return absl::nullopt;
+    }
+    return absl::TimeFromTimespec(ts);
+}
+
+}  // namespace
+
+absl::Status NetSocket::DrainErrorQueue() {
+    char control[512];
+    while (true) {
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        ssize_t ret = recvmsg(fd_, &msg, MSG_ERRQUEUE | MSG_DONTWAIT);
+        if (ret < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return absl::OkStatus();
+            }
+            return utils::ErrnoToStatus(errno);
+        }
+
+        const struct scm_timestamping *timestamping = nullptr;
+        const struct sock_extended_err *serr = nullptr;
+        for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm != NULL;
+             cm = CMSG_NXTHDR(&msg, cm)) {
+            if (cm->cmsg_level == SOL_SOCKET &&
+                cm->cmsg_type == SCM_TIMESTAMPING) {
+                timestamping = (const struct scm_timestamping *)CMSG_DATA(cm);
+            } else if ((cm->cmsg_level == SOL_IP &&
+                        cm->cmsg_type == IP_RECVERR) ||
+                       (cm->cmsg_level == SOL_IPV6 &&
+                        cm->cmsg_type == IPV6_RECVERR)) {
+                serr = (const struct sock_extended_err *)CMSG_DATA(cm);
+            }
+        }
+        if (serr == nullptr) {
+            continue;
+        }
+        if (serr->ee_errno == 0 && serr->ee_origin == SO_EE_ORIGIN_ZEROCOPY) {
+            ZeroCopyCompletion completion;
+            completion.lo = serr->ee_info;
+            completion.hi = serr->ee_data;
+            completion.copied =
+                (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) != 0;
+            pending_zerocopy_.push_back(completion);
+        } else if (serr->ee_errno == ENOMSG &&
+                   serr->ee_origin == SO_EE_ORIGIN_TIMESTAMPING &&
+                   timestamping != nullptr) {
+            TxTimestamp timestamp;
+            timestamp.id = serr->ee_data;
+            timestamp.type = serr->ee_info;
+            timestamp.software_timestamp = TimespecToTime(timestamping->ts[0]);
+            timestamp.hardware_timestamp = TimespecToTime(timestamping->ts[2]);
+            pending_tx_timestamps_.push_back(std::move(timestamp));
+        }
+    }
+}
+
+absl::Status NetSocket::EnableTimestamping(uint32_t flags) {
+    return SetSockOpt<int>(SOL_SOCKET, SO_TIMESTAMPING, flags);
+}
+
+absl::StatusOr<ReceivedMessage> NetSocket::RecvMsg(size_t count, int flags) {
+    ReceivedMessage out;
+    RETURN_IF_ERROR(RecvMsgTo(out, count, flags));
+    return out;
+}
+absl::Status NetSocket::RecvMsgTo(ReceivedMessage &out, size_t count,
+                                  int flags) {
+    if (count <= 0) {
+        return absl::InvalidArgumentError(
+            absl::StrFormat("`count` = %d which should > 0", count));
+    }
+
+    out.data.resize(count);
+    out.software_timestamp = absl::nullopt;
+    out.hardware_timestamp = absl::nullopt;
+
+    struct iovec iov;
+    iov.iov_base = out.data.data();
+    iov.iov_len = count;
+    char control[256];
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t ret = recvmsg(fd_, &msg, flags);
+    if (ret < 0) {
+        return utils::ErrnoToStatus(errno);
+    }
+    out.data.resize(ret);
+
+    for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm != NULL;
+         cm = CMSG_NXTHDR(&msg, cm)) {
+        if (cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SCM_TIMESTAMPING) {
+            const struct scm_timestamping *timestamping =
+                (const struct scm_timestamping *)CMSG_DATA(cm);
+            out.software_timestamp = TimespecToTime(timestamping->ts[0]);
+            out.hardware_timestamp = TimespecToTime(timestamping->ts[2]);
+        }
+    }
+    return absl::OkStatus();
+}
+
+absl::StatusOr<TcpInfo> NetSocket::GetTcpInfo() {
+    ASSIGN_OR_RETURN(struct tcp_info info,
+                     GetSockOpt<struct tcp_info>(IPPROTO_TCP, TCP_INFO));
+    TcpInfo out;
+    out.rtt = absl::Microseconds(info.tcpi_rtt);
+    out.rtt_var = absl::Microseconds(info.tcpi_rttvar);
+    out.rto = absl::Microseconds(info.tcpi_rto);
+    out.retransmits = info.tcpi_retransmits;
+    out.total_retransmits = info.tcpi_total_retrans;
+    out.lost = info.tcpi_lost;
+    out.unacked = info.tcpi_unacked;
+    out.congestion_window = info.tcpi_snd_cwnd;
+    out.slow_start_threshold = info.tcpi_snd_ssthresh;
+    out.send_mss = info.tcpi_snd_mss;
+    return out;
+}
+
 absl::StatusOr<std::string> NetSocket::Recv(size_t count, int flags) {
     std::string out;
     RETURN_IF_ERROR(RecvTo(out, count, flags));
@@ -203,9 +619,10 @@ absl::Status NetSocket::RecvTo(std::string &out, size_t count, int flags) {
         return absl::OkStatus();
     }
     if (ret < 0) {
-        return absl::InternalError(strerror(errno));
+        return utils::ErrnoToStatus(errno);
     }
     out.resize(ret);
+    recv_bytes->Add(ret);
 
     return absl::OkStatus();
 }
@@ -231,8 +648,9 @@ absl::StatusOr<size_t> NetSocket::SendTo(const uint8_t *data, size_t count,
                      dest_addr->len());
     }
     if (ret < 0) {
-        return absl::InternalError(strerror(errno));
+        return utils::ErrnoToStatus(errno);
     }
+    send_bytes->Add(ret);
     return ret;
 }
 
@@ -254,9 +672,13 @@ absl::Status NetSocket::RecvFromTo(std::string &out, size_t count, int flags,
     if (src_addr == NULL || src_addr == nullptr) {
         ret = recvfrom(fd_, out.data(), count, flags, NULL, NULL);
     } else {
-        socklen_t len = src_addr->storage_len();
-        ret = recvfrom(fd_, out.data(), count, flags, src_addr->mutable_addr(),
+        struct sockaddr_storage addr;
+        socklen_t len = sizeof(addr);
+        ret = recvfrom(fd_, out.data(), count, flags, (struct sockaddr *)&addr,
                        &len);
+        if (ret >= 0) {
+            *src_addr = SocketAddr(addr, len);
+        }
     }
 
     if (ret == 0) {
@@ -264,9 +686,10 @@ absl::Status NetSocket::RecvFromTo(std::string &out, size_t count, int flags,
         return absl::OkStatus();
     }
     if (ret < 0) {
-        return absl::InternalError(strerror(errno));
+        return utils::ErrnoToStatus(errno);
     }
     out.resize(ret);
+    recv_bytes->Add(ret);
 
     return absl::OkStatus();
 }
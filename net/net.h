@@ -7,6 +7,11 @@
 //  ASSIGN_OR_RETURN(auto socket, server->Accept());
 //  RETURN_IF_ERROR(socket->Write("Hello World"));
 //
+// Unix domain server example, SOCK_SEQPACKET keeps message boundaries:
+//  ASSIGN_OR_RETURN(auto server, Socket(AF_UNIX, SOCK_SEQPACKET, 0));
+//  RETURN_IF_ERROR(server->Bind(*SocketAddr::NewAbstractUnix("sidecar")));
+//  RETURN_IF_ERROR(server->Listen(1024));
+//
 // TCP client example:
 //  ASSIGN_OR_RETURN(auto client, Socket(AF_INET, SOCK_STREAM, 0));
 //  RETURN_IF_ERROR(client->Connect(*SocketAddr::NewIPv4(...)));
@@ -20,21 +25,35 @@
 // UDP client example:
 //  ASSIGN_OR_RETURN(auto client, Socket(AF_INET, SOCK_DGRAM, 0));
 //  RETURN_IF_ERROR(client->SendTo("Hello World", 0, &to_addr));
+//
+// Tuned TCP server example:
+//  ASSIGN_OR_RETURN(auto server, Socket(AF_INET, SOCK_STREAM, 0,
+//                                       SocketOptions::LowLatency()));
+//  ...
+//  // Accepted sockets get the per-connection options of `server`.
+//  ASSIGN_OR_RETURN(auto socket, server->Accept());
 
 #ifndef TOOLBASE_NET_NET_H_
 #define TOOLBASE_NET_NET_H_
 
 #include <arpa/inet.h>
+#include <linux/net_tstamp.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <sys/socket.h>
 #include <sys/un.h>
 
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
 #include "file/file.h"
+#include "utils/errno_status.h"
 
 namespace net {
 
@@ -45,9 +64,18 @@ class SocketAddr {
         addr_.ss_family = AF_UNSPEC;
     }
     explicit SocketAddr(struct sockaddr_storage addr) : addr_(addr) {}
+    // `len` is the actual length of `addr`, as returned by accept/recvfrom.
+    SocketAddr(struct sockaddr_storage addr, socklen_t len)
+        : addr_(addr), len_(len) {}
 
     bool IsValid() const { return addr_.ss_family != AF_UNSPEC; }
 
+    // Returns true for AF_UNIX addresses in the abstract namespace.
+    bool IsAbstractUnix() const {
+        return addr_.ss_family == AF_UNIX && len_ > sizeof(sa_family_t) &&
+               ((const struct sockaddr_un*)&addr_)->sun_path[0] == '\0';
+    }
+
     absl::StatusOr<std::string> ip() const;
     absl::StatusOr<uint16_t> port() const;
     absl::StatusOr<std::string> ToString() const;
@@ -59,6 +87,9 @@ class SocketAddr {
         return (struct sockaddr*)&addr_;
     }
     socklen_t len() const {
+        if (len_ > 0) {
+            return len_;
+        }
         if (addr_.ss_family == AF_INET) {
             return sizeof(struct sockaddr_in);
         } else if (addr_.ss_family == AF_INET6) {
@@ -76,9 +107,121 @@ class SocketAddr {
     static absl::StatusOr<SocketAddr> NewIPv6(absl::string_view ip,
                                               uint16_t port);
     static absl::StatusOr<SocketAddr> NewUnix(absl::string_view path);
+    // Creates an address in the Linux abstract namespace, which does not
+    // exist in the filesystem and goes away with the last socket using it.
+    // `ip()` and `ToString()` of the address return "@" + `name`.
+    static absl::StatusOr<SocketAddr> NewAbstractUnix(absl::string_view name);
 
    private:
     struct sockaddr_storage addr_;
+    // The actual length of `addr_`, 0 means computing it from the family.
+    socklen_t len_ = 0;
+};
+
+// A declarative set of socket tunings. Unset fields keep the kernel defaults.
+// Options are applied when the socket is created by `Socket(...)`, the
+// per-connection subset (TCP_NODELAY, TCP_QUICKACK, SO_BUSY_POLL, SO_ZEROCOPY)
+// is applied again to every socket returned by `Accept`, and TCP_QUICKACK is
+// re-armed after `Connect` because the kernel does not keep it sticky.
+struct SocketOptions {
+    // SO_REUSEADDR
+    absl::optional<bool> reuse_addr;
+    // SO_REUSEPORT, lets several sockets bind the same address.
+    absl::optional<bool> reuse_port;
+    // TCP_NODELAY, disables Nagle's algorithm.
+    absl::optional<bool> no_delay;
+    // TCP_QUICKACK, sends ACKs immediately instead of delaying them.
+    absl::optional<bool> quick_ack;
+    // SO_SNDBUF / SO_RCVBUF in bytes, the kernel doubles the value.
+    absl::optional<int> send_buffer_size;
+    absl::optional<int> recv_buffer_size;
+    // SO_BUSY_POLL in microseconds. Raising it needs CAP_NET_ADMIN.
+    absl::optional<int> busy_poll_us;
+    // TCP_FASTOPEN queue length, for listening sockets.
+    absl::optional<int> fast_open_queue;
+    // TCP_FASTOPEN_CONNECT, for client sockets.
+    absl::optional<bool> fast_open_connect;
+    // TCP_DEFER_ACCEPT in seconds, wakes `Accept` only once data arrived.
+    absl::optional<int> defer_accept_secs;
+    // SO_ZEROCOPY, required by `NetSocket::SendZeroCopy`.
+    absl::optional<bool> zero_copy;
+
+    // Small request/response traffic: no Nagle, no delayed ACKs.
+    static SocketOptions LowLatency();
+    // Large transfers: big kernel buffers, Nagle kept for full segments.
+    static SocketOptions BulkThroughput();
+};
+
+// A completed range of `SendZeroCopy` calls, ids in [lo, hi] are done and
+// their buffers can be reused.
+struct ZeroCopyCompletion {
+    uint32_t lo;
+    uint32_t hi;
+    // The kernel fell back to copying the data, zerocopy brought no gain.
+    bool copied;
+};
+
+// Result of a `SendZeroCopy` call.
+struct ZeroCopySend {
+    size_t bytes;
+    // The id reported back by `ReadZeroCopyCompletions`.
+    uint32_t id;
+};
+
+// Flags for `NetSocket::EnableTimestamping`.
+// Software RX and TX timestamps, TX timestamps are reported when the packet
+// left the stack and carry the byte offset of the send as id.
+constexpr uint32_t kSoftwareTimestamping =
+    SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_TX_SOFTWARE |
+    SOF_TIMESTAMPING_SOFTWARE | SOF_TIMESTAMPING_OPT_ID |
+    SOF_TIMESTAMPING_OPT_TSONLY;
+// Hardware RX and TX timestamps, needs a NIC with timestamping enabled via
+// SIOCSHWTSTAMP.
+constexpr uint32_t kHardwareTimestamping =
+    SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_TX_HARDWARE |
+    SOF_TIMESTAMPING_RAW_HARDWARE | SOF_TIMESTAMPING_OPT_ID |
+    SOF_TIMESTAMPING_OPT_TSONLY;
+
+// Data received by `NetSocket::RecvMsg` with the kernel timestamps of it.
+struct ReceivedMessage {
+    std::string data;
+    // Set if RX timestamping is enabled.
+    absl::optional<absl::Time> software_timestamp;
+    absl::optional<absl::Time> hardware_timestamp;
+};
+
+// Data and file descriptors received by `NetSocket::RecvFds`.
+struct ReceivedFds {
+    std::string data;
+    // The received descriptors, opened with O_CLOEXEC.
+    std::vector<std::unique_ptr<file::File>> files;
+};
+
+// A TX timestamp read from the socket error queue.
+struct TxTimestamp {
+    // For TCP, the byte offset of the last byte of the timestamped send.
+    uint32_t id;
+    // SCM_TSTAMP_SND, SCM_TSTAMP_SCHED or SCM_TSTAMP_ACK.
+    uint32_t type;
+    absl::optional<absl::Time> software_timestamp;
+    absl::optional<absl::Time> hardware_timestamp;
+};
+
+// A snapshot of TCP_INFO.
+struct TcpInfo {
+    absl::Duration rtt;
+    absl::Duration rtt_var;
+    absl::Duration rto;
+    // Retransmits of the current unrecovered loss.
+    uint32_t retransmits;
+    // Retransmits in the lifetime of the connection.
+    uint32_t total_retransmits;
+    uint32_t lost;
+    uint32_t unacked;
+    // In packets.
+    uint32_t congestion_window;
+    uint32_t slow_start_threshold;
+    uint32_t send_mss;
 };
 
 class NetSocket : public file::File {
@@ -95,6 +238,63 @@ class NetSocket : public file::File {
         return SetSockOpt<int>(SOL_SOCKET, SO_REUSEADDR, 1);
     }
 
+    // Sets SO_REUSEPORT, must be done before bind.
+    absl::Status SetReusePort() {
+        return SetSockOpt<int>(SOL_SOCKET, SO_REUSEPORT, 1);
+    }
+
+    absl::Status SetNoDelay(bool enable) {
+        return SetSockOpt<int>(IPPROTO_TCP, TCP_NODELAY, enable ? 1 : 0);
+    }
+
+    // TCP_QUICKACK is not permanent, the kernel may leave quickack mode later.
+    absl::Status SetQuickAck(bool enable) {
+        return SetSockOpt<int>(IPPROTO_TCP, TCP_QUICKACK, enable ? 1 : 0);
+    }
+
+    absl::Status SetSendBufferSize(int bytes) {
+        return SetSockOpt<int>(SOL_SOCKET, SO_SNDBUF, bytes);
+    }
+
+    absl::Status SetRecvBufferSize(int bytes) {
+        return SetSockOpt<int>(SOL_SOCKET, SO_RCVBUF, bytes);
+    }
+
+    absl::Status SetBusyPoll(int usec) {
+        return SetSockOpt<int>(SOL_SOCKET, SO_BUSY_POLL, usec);
+    }
+
+    // Enables TCP Fast Open on a listening socket, `queue` limits the number
+    // of pending TFO requests.
+    absl::Status SetFastOpen(int queue) {
+        return SetSockOpt<int>(IPPROTO_TCP, TCP_FASTOPEN, queue);
+    }
+
+    // Enables TCP Fast Open on a client socket, data of the first write will
+    // be sent in the SYN.
+    absl::Status SetFastOpenConnect(bool enable) {
+        return SetSockOpt<int>(IPPROTO_TCP, TCP_FASTOPEN_CONNECT,
+                               enable ? 1 : 0);
+    }
+
+    absl::Status SetDeferAccept(int secs) {
+        return SetSockOpt<int>(IPPROTO_TCP, TCP_DEFER_ACCEPT, secs);
+    }
+
+    absl::Status SetZeroCopy(bool enable) {
+        absl::Status status =
+            SetSockOpt<int>(SOL_SOCKET, SO_ZEROCOPY, enable ? 1 : 0);
+        if (status.ok()) {
+            zero_copy_ = enable;
+        }
+        return status;
+    }
+
+    // Applies all the set fields of `options`, and remembers them so that
+    // sockets returned by `Accept` get the per-connection options.
+    absl::Status ApplyOptions(const SocketOptions& options);
+    const SocketOptions& options() const { return options_; }
+
     absl::Status Bind(const SocketAddr& addr);
 
     // Masks the socket as a passive socket.
@@ -107,6 +307,17 @@ class NetSocket : public file::File {
     // Will set `local_addr` as bound addr.
     absl::StatusOr<std::unique_ptr<NetSocket>> Accept();
 
+    // Drains up to `max` pending connections with accept4, the returned
+    // sockets are created with SOCK_NONBLOCK | SOCK_CLOEXEC so they can be
+    // wrapped by the `file::NonblockingIO` constructor directly.
+    // Addresses are set like `Accept`, without extra syscalls.
+    // The listening socket should be nonblocking, then an empty vector means
+    // no connection is pending; a blocking listener blocks until `max`
+    // connections have been accepted.
+    absl::StatusOr<std::vector<std::unique_ptr<NetSocket>>> AcceptMany(
+        int max);
+
+    // Connects to `addr`, re-arms TCP_QUICKACK if it is set in `options`.
     absl::Status Connect(const SocketAddr& addr);
 
     absl::StatusOr<size_t> Send(absl::string_view data, int flags);
@@ -130,6 +341,50 @@ class NetSocket : public file::File {
     absl::Status RecvFromTo(std::string& out, size_t count, int flags,
                             SocketAddr* src_addr);
 
+    // Sends with MSG_ZEROCOPY, the kernel pins `data` instead of copying it.
+    // `data` must stay unchanged until a completion covering the returned id
+    // is reported by `ReadZeroCopyCompletions`. Returns FailedPrecondition
+    // without `SetZeroCopy(true)`: the kernel would copy the data without
+    // reporting a completion.
+    absl::StatusOr<ZeroCopySend> SendZeroCopy(absl::string_view data,
+                                              int flags);
+
+    // Drains zerocopy completion notifications from the socket error queue.
+    // Never blocks, returns an empty vector if nothing completed yet.
+    absl::StatusOr<std::vector<ZeroCopyCompletion>> ReadZeroCopyCompletions();
+
+    // Sends `data` together with `fds` through a AF_UNIX socket (SCM_RIGHTS),
+    // the receiver gets duplicates of the descriptors. `data` should not be
+    // empty, stream sockets do not deliver descriptors without data.
+    // At most `kMaxFdsPerMessage` descriptors can be sent at once.
+    absl::StatusOr<size_t> SendFds(absl::string_view data,
+                                   const std::vector<int>& fds, int flags);
+
+    // Receives up to `count` bytes and up to `max_fds` descriptors sent by
+    // `SendFds`. Empty data means eof.
+    // Returns ResourceExhausted if more than `max_fds` descriptors arrived,
+    // the kernel drops the descriptors not fitting.
+    absl::StatusOr<ReceivedFds> RecvFds(size_t count, size_t max_fds,
+                                        int flags);
+
+    // The kernel limit (SCM_MAX_FD) of descriptors in one message.
+    static constexpr size_t kMaxFdsPerMessage = 253;
+
+    // Enables SO_TIMESTAMPING, `flags` is usually `kSoftwareTimestamping` or
+    // `kHardwareTimestamping`.
+    absl::Status EnableTimestamping(uint32_t flags);
+
+    // Receives data like `Recv`, with the RX timestamps of the data.
+    // Empty data means eof.
+    absl::StatusOr<ReceivedMessage> RecvMsg(size_t count, int flags);
+    absl::Status RecvMsgTo(ReceivedMessage& out, size_t count, int flags);
+
+    // Drains TX timestamps from the socket error queue. Never blocks.
+    absl::StatusOr<std::vector<TxTimestamp>> ReadTxTimestamps();
+
+    // Returns a TCP_INFO snapshot, only valid for TCP sockets.
+    absl::StatusOr<TcpInfo> GetTcpInfo();
+
     template <class T>
     absl::StatusOr<T> GetSockOpt(int level, int optname) {
         T optval;
@@ -137,7 +392,7 @@ class NetSocket : public file::File {
         if (getsockopt(fd_, level, optname, &optval, &len) == 0) {
             return optval;
         }
-        return absl::InternalError(strerror(errno));
+        return utils::ErrnoToStatus(errno);
     }
 
     template <class T>
@@ -145,13 +400,31 @@ class NetSocket : public file::File {
         if (setsockopt(fd_, level, optname, &optval, sizeof(optval)) == 0) {
             return absl::OkStatus();
         }
-        return absl::InternalError(strerror(errno));
+        return utils::ErrnoToStatus(errno);
     }
 
    protected:
+    // Applies the options which are not inherited from a listening socket.
+    absl::Status ApplyConnectionOptions(const SocketOptions& options);
+
+    // Reads all notifications from the error queue into `pending_*`, the
+    // queue is shared by zerocopy completions and TX timestamps.
+    absl::Status DrainErrorQueue();
+
+    // Wraps an accepted `fd` coming from `addr`.
+    absl::StatusOr<std::unique_ptr<NetSocket>> NewAcceptedSocket(
+        int fd, const struct sockaddr_storage& addr, socklen_t len);
+
     SocketAddr bound_addr_;
     SocketAddr remote_addr_;
     SocketAddr local_addr_;
+    SocketOptions options_;
+    // Set by `SetZeroCopy`.
+    bool zero_copy_ = false;
+    // The id of the next successful `SendZeroCopy`.
+    uint32_t zerocopy_next_id_ = 0;
+    std::vector<ZeroCopyCompletion> pending_zerocopy_;
+    std::vector<TxTimestamp> pending_tx_timestamps_;
 };
 
 // Creates a socket.
@@ -171,6 +444,21 @@ class NetSocket : public file::File {
 absl::StatusOr<std::unique_ptr<NetSocket>> Socket(int domain, int type,
                                                   int protocol);
 
+// Creates a pair of connected sockets, `domain` is usually AF_UNIX.
+// Common used `type`: SOCK_STREAM, SOCK_DGRAM and SOCK_SEQPACKET, which keeps
+// message boundaries like SOCK_DGRAM while being reliable and connected.
+absl::StatusOr<
+    std::pair<std::unique_ptr<NetSocket>, std::unique_ptr<NetSocket>>>
+SocketPair(int domain, int type, int protocol);
+
+// Creates a socket and applies `options` to it.
+// Example:
+//  Low latency TCP socket:
+//    Socket(AF_INET, SOCK_STREAM, 0, SocketOptions::LowLatency())
+absl::StatusOr<std::unique_ptr<NetSocket>> Socket(int domain, int type,
+                                                  int protocol,
+                                                  const SocketOptions& options);
+
 }  // namespace net
 
 #endif  // TOOLBASE_NET_NET_H_
\ No newline at end of file
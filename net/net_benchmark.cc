@@ -0,0 +1,261 @@
+#include <thread>
+
+#include "absl/strings/str_cat.h"
+#include "benchmark/benchmark.h"
+#include "net/net.h"
+
+namespace net {
+namespace {
+
+constexpr uint16_t kBasePort = 62800;
+
+SocketOptions ProfileOptions(int profile) {
+    switch (profile) {
+        case 1:
+            return SocketOptions::LowLatency();
+        case 2:
+            return SocketOptions::BulkThroughput();
+        default:
+            return SocketOptions();
+    }
+}
+
+const char* ProfileName(int profile) {
+    switch (profile) {
+        case 1:
+            return "low_latency";
+        case 2:
+            return "bulk_throughput";
+        default:
+            return "default";
+    }
+}
+
+// Reads exactly `count` bytes, returns false on eof or error.
+bool RecvAll(NetSocket* socket, std::string& buf, size_t count) {
+    std::string chunk;
+    buf.clear();
+    while (buf.size() < count) {
+        if (!socket->RecvTo(chunk, count - buf.size(), 0).ok() ||
+            chunk.empty()) {
+            return false;
+        }
+        buf.append(chunk);
+    }
+    return true;
+}
+
+// Round trip of a `message_size` message over loopback TCP, both ends use
+// the same profile. The server writes the request in two parts, which is
+// the pattern where Nagle and delayed ACKs hurt.
+void BM_TCPRoundTrip(benchmark::State& state) {
+    const int profile = state.range(0);
+    const size_t message_size = state.range(1);
+    const uint16_t port = kBasePort + profile;
+    SocketOptions options = ProfileOptions(profile);
+    options.reuse_addr = true;
+
+    auto server = *Socket(AF_INET, SOCK_STREAM, 0, options);
+    auto addr = *SocketAddr::NewIPv4("127.0.0.1", port);
+    if (!server->Bind(addr).ok() || !server->Listen(16).ok()) {
+        state.SkipWithError("cannot listen");
+        return;
+    }
+
+    std::thread echo([&server, message_size]() {
+        auto socket = server->Accept();
+        if (!socket.ok()) {
+            return;
+        }
+        std::string buf;
+        while (RecvAll(socket->get(), buf, message_size)) {
+            (*socket)->Send(buf.substr(0, message_size / 2), 0).IgnoreError();
+            (*socket)->Send(buf.substr(message_size / 2), 0).IgnoreError();
+        }
+    });
+
+    auto client = *Socket(AF_INET, SOCK_STREAM, 0, options);
+    if (!client->Connect(addr).ok()) {
+        state.SkipWithError("cannot connect");
+        shutdown(server->fd(), SHUT_RDWR);
+        echo.join();
+        return;
+    }
+    std::string request(message_size, 'x');
+    std::string response;
+    for (auto _ : state) {
+        client->Send(request.substr(0, message_size / 2), 0).IgnoreError();
+        client->Send(request.substr(message_size / 2), 0).IgnoreError();
+        if (!RecvAll(client.get(), response, message_size)) {
+            state.SkipWithError("connection closed");
+            break;
+        }
+    }
+    state.SetLabel(ProfileName(profile));
+    state.SetBytesProcessed(state.iterations() * message_size * 2);
+
+    client.reset();
+    echo.join();
+}
+BENCHMARK(BM_TCPRoundTrip)
+    ->ArgsProduct({{0, 1, 2}, {64, 4096, 256 << 10}})
+    ->UseRealTime();
+
+// Address for the UDS vs TCP comparison, `unix_domain` selects an abstract
+// AF_UNIX address instead of a loopback TCP one.
+SocketAddr LocalAddr(bool unix_domain, uint16_t port) {
+    if (unix_domain) {
+        return *SocketAddr::NewAbstractUnix(
+            absl::StrCat("toolbase_net_benchmark_", port));
+    }
+    return *SocketAddr::NewIPv4("127.0.0.1", port);
+}
+
+// Round trip latency of a `message_size` message over a local stream socket.
+void BM_LocalRoundTrip(benchmark::State& state) {
+    const bool unix_domain = state.range(0);
+    const size_t message_size = state.range(1);
+    const int domain = unix_domain ? AF_UNIX : AF_INET;
+    SocketOptions options;
+    if (!unix_domain) {
+        options = SocketOptions::LowLatency();
+        options.reuse_addr = true;
+    }
+    auto addr = LocalAddr(unix_domain, kBasePort + 10);
+
+    auto server = *Socket(domain, SOCK_STREAM, 0, options);
+    if (!server->Bind(addr).ok() || !server->Listen(16).ok()) {
+        state.SkipWithError("cannot listen");
+        return;
+    }
+    std::thread echo([&server, message_size]() {
+        auto socket = server->Accept();
+        if (!socket.ok()) {
+            return;
+        }
+        std::string buf;
+        while (RecvAll(socket->get(), buf, message_size)) {
+            (*socket)->Send(buf, 0).IgnoreError();
+        }
+    });
+
+    auto client = *Socket(domain, SOCK_STREAM, 0, options);
+    if (!client->Connect(addr).ok()) {
+        state.SkipWithError("cannot connect");
+        shutdown(server->fd(), SHUT_RDWR);
+        echo.join();
+        return;
+    }
+    std::string request(message_size, 'x');
+    std::string response;
+    for (auto _ : state) {
+        client->Send(request, 0).IgnoreError();
+        if (!RecvAll(client.get(), response, message_size)) {
+            state.SkipWithError("connection closed");
+            break;
+        }
+    }
+    state.SetLabel(unix_domain ? "unix" : "tcp");
+    state.SetBytesProcessed(state.iterations() * message_size * 2);
+
+    client.reset();
+    echo.join();
+}
+BENCHMARK(BM_LocalRoundTrip)
+    ->ArgsProduct({{0, 1}, {64, 4096}})
+    ->UseRealTime();
+
+// One way throughput of a local stream socket with `chunk_size` writes.
+void BM_LocalThroughput(benchmark::State& state) {
+    const bool unix_domain = state.range(0);
+    const size_t chunk_size = state.range(1);
+    const int domain = unix_domain ? AF_UNIX : AF_INET;
+    SocketOptions options;
+    if (!unix_domain) {
+        options = SocketOptions::BulkThroughput();
+        options.reuse_addr = true;
+    }
+    auto addr = LocalAddr(unix_domain, kBasePort + 11);
+
+    auto server = *Socket(domain, SOCK_STREAM, 0, options);
+    if (!server->Bind(addr).ok() || !server->Listen(16).ok()) {
+        state.SkipWithError("cannot listen");
+        return;
+    }
+    std::thread sink([&server, chunk_size]() {
+        auto socket = server->Accept();
+        if (!socket.ok()) {
+            return;
+        }
+        std::string buf;
+        while ((*socket)->RecvTo(buf, chunk_size, 0).ok() && !buf.empty()) {
+        }
+    });
+
+    auto client = *Socket(domain, SOCK_STREAM, 0, options);
+    if (!client->Connect(addr).ok()) {
+        state.SkipWithError("cannot connect");
+        shutdown(server->fd(), SHUT_RDWR);
+        sink.join();
+        return;
+    }
+    std::string chunk(chunk_size, 'x');
+    for (auto _ : state) {
+        if (!client->WriteAll(chunk).ok()) {
+            state.SkipWithError("write failed");
+            break;
+        }
+    }
+    state.SetLabel(unix_domain ? "unix" : "tcp");
+    state.SetBytesProcessed(state.iterations() * chunk_size);
+
+    client.reset();
+    sink.join();
+}
+BENCHMARK(BM_LocalThroughput)
+    ->ArgsProduct({{0, 1}, {4096, 64 << 10}})
+    ->UseRealTime();
+
+// Round trip of a `message_size` datagram over loopback UDP.
+void BM_UDPRoundTrip(benchmark::State& state) {
+    const size_t message_size = state.range(0);
+    SocketOptions options;
+    options.reuse_addr = true;
+    auto server_addr = *SocketAddr::NewIPv4("127.0.0.1", kBasePort + 20);
+    auto client_addr = *SocketAddr::NewIPv4("127.0.0.1", kBasePort + 21);
+    auto server = *Socket(AF_INET, SOCK_DGRAM, 0, options);
+    auto client = *Socket(AF_INET, SOCK_DGRAM, 0, options);
+    if (!server->Bind(server_addr).ok() || !client->Bind(client_addr).ok()) {
+        state.SkipWithError("cannot bind");
+        return;
+    }
+
+    // An empty datagram stops the echo.
+    std::thread echo([&server, message_size]() {
+        std::string buf;
+        SocketAddr from;
+        while (server->RecvFromTo(buf, message_size, 0, &from).ok() &&
+               !buf.empty()) {
+            server->SendTo(buf, 0, &from).IgnoreError();
+        }
+    });
+
+    std::string request(message_size, 'x');
+    std::string response;
+    for (auto _ : state) {
+        client->SendTo(request, 0, &server_addr).IgnoreError();
+        if (!client->RecvTo(response, message_size, 0).ok()) {
+            state.SkipWithError("recv failed");
+            break;
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * message_size * 2);
+
+    // `SendTo` rejects empty data.
+    sendto(client->fd(), "", 0, 0, server_addr.addr(), server_addr.len());
+    echo.join();
+}
+BENCHMARK(BM_UDPRoundTrip)->Arg(64)->Arg(1024)->Arg(8192)->UseRealTime();
+
+}  // namespace
+}  // namespace net
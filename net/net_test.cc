@@ -1,5 +1,10 @@
 #include "net/net.h"
 
+#include <fcntl.h>
+#include <stddef.h>
+#include <linux/errqueue.h>
+#include <unistd.h>
+
 #include "gtest/gtest.h"
 #include "utils/testing.h"
 
@@ -31,6 +36,18 @@ TEST(SocketAddr, IPv6) {
                 StatusIs(absl::StatusCode::kInvalidArgument));
 }
 
+TEST(SocketAddr, AbstractUnix) {
+    auto addr = SocketAddr::NewAbstractUnix("toolbase_test");
+    EXPECT_OK(addr);
+    EXPECT_TRUE(addr->IsAbstractUnix());
+    EXPECT_EQ(addr->len(), offsetof(struct sockaddr_un, sun_path) + 14);
+    EXPECT_THAT(addr->ToString(), IsOkAndHolds("@toolbase_test"));
+
+    EXPECT_FALSE(SocketAddr::NewUnix("/tmp/socket")->IsAbstractUnix());
+    EXPECT_THAT(SocketAddr::NewAbstractUnix(std::string(108, 'x')),
+                StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
 TEST(Socket, TestTCPOpen) { EXPECT_OK(Socket(AF_INET, SOCK_STREAM, 0)); }
 
 TEST(Socket, TestUDPOpen) { EXPECT_OK(Socket(AF_INET6, SOCK_DGRAM, 0)); }
@@ -90,5 +107,282 @@ TEST(Socket, TestUDP) {
     EXPECT_THAT(src_addr.ip(), IsOkAndHolds("127.0.0.1"));
 }
 
+TEST(Socket, TestOptions) {
+    SocketOptions options;
+    options.reuse_addr = true;
+    options.reuse_port = true;
+    options.no_delay = true;
+    options.recv_buffer_size = 64 << 10;
+    options.defer_accept_secs = 1;
+
+    auto server = Socket(AF_INET, SOCK_STREAM, 0, options);
+    EXPECT_OK(server);
+    EXPECT_THAT((*server)->GetSockOpt<int>(SOL_SOCKET, SO_REUSEADDR),
+                IsOkAndHolds(1));
+    EXPECT_THAT((*server)->GetSockOpt<int>(SOL_SOCKET, SO_REUSEPORT),
+                IsOkAndHolds(1));
+    EXPECT_THAT((*server)->GetSockOpt<int>(IPPROTO_TCP, TCP_NODELAY),
+                IsOkAndHolds(1));
+    // The kernel doubles the requested buffer size.
+    EXPECT_THAT((*server)->GetSockOpt<int>(SOL_SOCKET, SO_RCVBUF),
+                IsOkAndHolds(128 << 10));
+
+    EXPECT_THAT(Socket(AF_INET, SOCK_DGRAM, 0, SocketOptions::LowLatency()),
+                StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST(Socket, TestOptionsOnAccept) {
+    auto server = Socket(AF_INET, SOCK_STREAM, 0, SocketOptions::LowLatency());
+    EXPECT_OK(server);
+    EXPECT_OK((*server)->SetReuseAddr());
+    EXPECT_OK((*server)->Bind(*SocketAddr::NewIPv4("127.0.0.1", 62782)));
+    EXPECT_OK((*server)->Listen(10));
+
+    auto client = Socket(AF_INET, SOCK_STREAM, 0, SocketOptions::LowLatency());
+    EXPECT_OK(client);
+    EXPECT_OK((*client)->Connect(*SocketAddr::NewIPv4("127.0.0.1", 62782)));
+
+    auto socket = (*server)->Accept();
+    EXPECT_OK(socket);
+    EXPECT_THAT((*socket)->GetSockOpt<int>(IPPROTO_TCP, TCP_NODELAY),
+                IsOkAndHolds(1));
+    EXPECT_EQ((*socket)->options().quick_ack, true);
+}
+
+TEST(Socket, TestZeroCopy) {
+    SocketOptions options;
+    options.reuse_addr = true;
+    options.zero_copy = true;
+
+    auto server = Socket(AF_INET, SOCK_STREAM, 0, options);
+    EXPECT_OK(server);
+    EXPECT_OK((*server)->Bind(*SocketAddr::NewIPv4("127.0.0.1", 62783)));
+    EXPECT_OK((*server)->Listen(10));
+
+    auto client = Socket(AF_INET, SOCK_STREAM, 0, options);
+    EXPECT_OK(client);
+    EXPECT_OK((*client)->Connect(*SocketAddr::NewIPv4("127.0.0.1", 62783)));
+    auto socket = (*server)->Accept();
+    EXPECT_OK(socket);
+
+    // Without SO_ZEROCOPY no completion would come, no id is taken.
+    EXPECT_OK((*client)->SetZeroCopy(false));
+    EXPECT_THAT((*client)->SendZeroCopy("x", 0),
+                StatusIs(absl::StatusCode::kFailedPrecondition));
+    EXPECT_OK((*client)->SetZeroCopy(true));
+
+    EXPECT_THAT((*client)->ReadZeroCopyCompletions(),
+                IsOkAndHolds(::testing::IsEmpty()));
+
+    std::string data(4096, 'x');
+    auto sent = (*client)->SendZeroCopy(data, 0);
+    EXPECT_OK(sent);
+    EXPECT_EQ(sent->bytes, data.size());
+    EXPECT_EQ(sent->id, 0);
+
+    size_t received = 0;
+    while (received < data.size()) {
+        auto recv = (*socket)->Recv(data.size() - received, 0);
+        EXPECT_OK(recv);
+        received += recv->size();
+    }
+
+    std::vector<ZeroCopyCompletion> completions;
+    for (int i = 0; i < 100 && completions.empty(); i++) {
+        auto result = (*client)->ReadZeroCopyCompletions();
+        EXPECT_OK(result);
+        completions = *result;
+        if (completions.empty()) {
+            usleep(1000);
+        }
+    }
+    ASSERT_EQ(completions.size(), 1);
+    EXPECT_EQ(completions[0].lo, 0);
+    EXPECT_EQ(completions[0].hi, 0);
+}
+
+TEST(Socket, TestAcceptMany) {
+    auto server = Socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    EXPECT_OK(server);
+    EXPECT_OK((*server)->SetReuseAddr());
+    EXPECT_OK((*server)->Bind(*SocketAddr::NewIPv4("127.0.0.1", 62784)));
+    EXPECT_OK((*server)->Listen(10));
+
+    EXPECT_THAT((*server)->AcceptMany(0),
+                StatusIs(absl::StatusCode::kInvalidArgument));
+    EXPECT_THAT((*server)->AcceptMany(10), IsOkAndHolds(::testing::IsEmpty()));
+
+    std::vector<std::unique_ptr<NetSocket>> clients;
+    for (int i = 0; i < 3; i++) {
+        auto client = Socket(AF_INET, SOCK_STREAM, 0);
+        EXPECT_OK(client);
+        EXPECT_OK((*client)->Connect(*SocketAddr::NewIPv4("127.0.0.1", 62784)));
+        clients.push_back(std::move(*client));
+    }
+
+    auto sockets = (*server)->AcceptMany(2);
+    EXPECT_OK(sockets);
+    ASSERT_EQ(sockets->size(), 2);
+    for (auto& socket : *sockets) {
+        EXPECT_TRUE(fcntl(socket->fd(), F_GETFL) & O_NONBLOCK);
+        EXPECT_TRUE(fcntl(socket->fd(), F_GETFD) & FD_CLOEXEC);
+        EXPECT_THAT(socket->remote_addr().ip(), IsOkAndHolds("127.0.0.1"));
+        EXPECT_THAT(socket->local_addr().ToString(),
+                    IsOkAndHolds("127.0.0.1:62784"));
+    }
+
+    sockets = (*server)->AcceptMany(10);
+    EXPECT_OK(sockets);
+    EXPECT_EQ(sockets->size(), 1);
+}
+
+TEST(Socket, TestAcceptManyOptionsFailure) {
+    SocketOptions options;
+    options.no_delay = true;
+    auto server = Socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0, options);
+    ASSERT_OK(server);
+    // A unix listener behind the TCP options, TCP_NODELAY fails on every
+    // accepted socket.
+    auto listener = Socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    ASSERT_OK(listener);
+    const auto addr = *SocketAddr::NewAbstractUnix("test_accept_many");
+    ASSERT_OK((*listener)->Bind(addr));
+    ASSERT_OK((*listener)->Listen(10));
+    ASSERT_GE(dup2((*listener)->fd(), (*server)->fd()), 0);
+
+    std::vector<std::unique_ptr<NetSocket>> clients;
+    for (int i = 0; i < 2; i++) {
+        auto client = Socket(AF_UNIX, SOCK_STREAM, 0);
+        ASSERT_OK(client);
+        ASSERT_OK((*client)->Connect(addr));
+        clients.push_back(std::move(*client));
+    }
+
+    const int lowest_fd = dup(0);
+    close(lowest_fd);
+    // Nothing accepted before the failure, the error is returned and the
+    // failed socket closed.
+    EXPECT_FALSE((*server)->AcceptMany(10).ok());
+    EXPECT_FALSE((*server)->AcceptMany(10).ok());
+    EXPECT_THAT((*server)->AcceptMany(10), IsOkAndHolds(::testing::IsEmpty()));
+    const int fd = dup(0);
+    EXPECT_EQ(fd, lowest_fd);
+    close(fd);
+}
+
+TEST(Socket, TestTimestamping) {
+    auto server = Socket(AF_INET, SOCK_DGRAM, 0);
+    EXPECT_OK(server);
+    EXPECT_OK((*server)->EnableTimestamping(kSoftwareTimestamping));
+    EXPECT_OK((*server)->Bind(*SocketAddr::NewIPv4("127.0.0.1", 62785)));
+
+    auto client = Socket(AF_INET, SOCK_DGRAM, 0);
+    EXPECT_OK(client);
+    EXPECT_OK((*client)->EnableTimestamping(kSoftwareTimestamping));
+    EXPECT_OK((*client)->Connect(*SocketAddr::NewIPv4("127.0.0.1", 62785)));
+
+    absl::Time before = absl::Now();
+    EXPECT_THAT((*client)->Send("Hello World", 0), IsOkAndHolds(11));
+
+    auto message = (*server)->RecvMsg(1024, 0);
+    EXPECT_OK(message);
+    EXPECT_EQ(message->data, "Hello World");
+    ASSERT_TRUE(message->software_timestamp.has_value());
+    EXPECT_GE(*message->software_timestamp, before);
+    EXPECT_LE(*message->software_timestamp, absl::Now());
+    EXPECT_FALSE(message->hardware_timestamp.has_value());
+
+    std::vector<TxTimestamp> timestamps;
+    for (int i = 0; i < 100 && timestamps.empty(); i++) {
+        auto result = (*client)->ReadTxTimestamps();
+        EXPECT_OK(result);
+        timestamps = *result;
+        if (timestamps.empty()) {
+            usleep(1000);
+        }
+    }
+    ASSERT_EQ(timestamps.size(), 1);
+    EXPECT_EQ(timestamps[0].id, 0);
+    EXPECT_EQ(timestamps[0].type, SCM_TSTAMP_SND);
+    ASSERT_TRUE(timestamps[0].software_timestamp.has_value());
+    EXPECT_GE(*timestamps[0].software_timestamp, before);
+}
+
+TEST(Socket, TestTcpInfo) {
+    auto server = Socket(AF_INET, SOCK_STREAM, 0);
+    EXPECT_OK(server);
+    EXPECT_OK((*server)->SetReuseAddr());
+    EXPECT_OK((*server)->Bind(*SocketAddr::NewIPv4("127.0.0.1", 62786)));
+    EXPECT_OK((*server)->Listen(10));
+
+    auto client = Socket(AF_INET, SOCK_STREAM, 0);
+    EXPECT_OK(client);
+    EXPECT_OK((*client)->Connect(*SocketAddr::NewIPv4("127.0.0.1", 62786)));
+
+    auto info = (*client)->GetTcpInfo();
+    EXPECT_OK(info);
+    EXPECT_GT(info->congestion_window, 0);
+    EXPECT_GT(info->send_mss, 0);
+    EXPECT_EQ(info->total_retransmits, 0);
+
+    auto udp = Socket(AF_INET, SOCK_DGRAM, 0);
+    EXPECT_OK(udp);
+    EXPECT_THAT((*udp)->GetTcpInfo(),
+                StatusIs(absl::StatusCode::kUnimplemented));
+}
+
+TEST(Socket, TestUnixSeqPacket) {
+    auto addr = *SocketAddr::NewAbstractUnix("toolbase_test_seqpacket");
+    auto server = Socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    EXPECT_OK(server);
+    EXPECT_OK((*server)->Bind(addr));
+    EXPECT_OK((*server)->Listen(10));
+
+    auto client = Socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    EXPECT_OK(client);
+    EXPECT_OK((*client)->Connect(addr));
+    auto socket = (*server)->Accept();
+    EXPECT_OK(socket);
+    EXPECT_THAT((*socket)->local_addr().ToString(),
+                IsOkAndHolds("@toolbase_test_seqpacket"));
+
+    EXPECT_THAT((*client)->Send("Hello", 0), IsOkAndHolds(5));
+    EXPECT_THAT((*client)->Send("World", 0), IsOkAndHolds(5));
+    EXPECT_THAT((*socket)->Recv(1024, 0), IsOkAndHolds("Hello"));
+    EXPECT_THAT((*socket)->Recv(1024, 0), IsOkAndHolds("World"));
+}
+
+TEST(Socket, TestSendRecvFds) {
+    auto pair = SocketPair(AF_UNIX, SOCK_STREAM, 0);
+    EXPECT_OK(pair);
+    auto& [sender, receiver] = *pair;
+
+    int pipefd[2];
+    ASSERT_EQ(pipe(pipefd), 0);
+    file::File read_end(pipefd[0]);
+    file::File write_end(pipefd[1]);
+
+    EXPECT_THAT(sender->SendFds("", {pipefd[1]}, 0),
+                StatusIs(absl::StatusCode::kInvalidArgument));
+    EXPECT_THAT(sender->SendFds("fd", {pipefd[1]}, 0), IsOkAndHolds(2));
+
+    auto received = receiver->RecvFds(1024, 4, 0);
+    EXPECT_OK(received);
+    EXPECT_EQ(received->data, "fd");
+    ASSERT_EQ(received->files.size(), 1);
+    EXPECT_NE(received->files[0]->fd(), pipefd[1]);
+    EXPECT_TRUE(fcntl(received->files[0]->fd(), F_GETFD) & FD_CLOEXEC);
+
+    // Writes to the received duplicate, reads from the original pipe.
+    EXPECT_THAT(received->files[0]->Write("hello"), IsOkAndHolds(5));
+    EXPECT_THAT(read_end.Read(1024), IsOkAndHolds("hello"));
+
+    EXPECT_THAT(
+        sender->SendFds("fds", {pipefd[0], pipefd[1], pipefd[0], pipefd[1]}, 0),
+        IsOkAndHolds(3));
+    EXPECT_THAT(receiver->RecvFds(1024, 1, 0),
+                StatusIs(absl::StatusCode::kResourceExhausted));
+}
+
 }  // namespace
 }  // namespace net
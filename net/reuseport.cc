@@ -0,0 +1,122 @@
+#include "net/reuseport.h"
+
+#include <sched.h>
+
+#include <thread>
+
+#include "absl/strings/str_format.h"
+#include "absl/synchronization/blocking_counter.h"
+#include "absl/synchronization/notification.h"
+#include "utils/errno_status.h"
+#include "utils/numa.h"
+#include "utils/status_macros.h"
+
+namespace net {
+
+std::vector<struct sock_filter> ReusePortGroup::SteeringProgram(
+    const std::vector<int>& cpus) {
+    std::vector<struct sock_filter> program;
+    // A = the CPU running the program, i.e. receiving the SYN.
+    program.push_back(BPF_STMT(BPF_LD | BPF_W | BPF_ABS,
+                               static_cast<uint32_t>(SKF_AD_OFF + SKF_AD_CPU)));
+    bool identity = true;
+    for (size_t i = 0; i < cpus.size(); i++) {
+        identity = identity && cpus[i] == static_cast<int>(i);
+    }
+    if (identity) {
+        // Worker i on CPU i, the CPUs past the group fall back to the hash.
+        program.push_back(BPF_STMT(BPF_RET | BPF_A, 0));
+        return program;
+    }
+    for (size_t i = 0; i < cpus.size(); i++) {
+        // if (A == cpus[i]) return i;
+        program.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
+                                   static_cast<uint32_t>(cpus[i]), 0, 1));
+        program.push_back(BPF_STMT(BPF_RET | BPF_K, static_cast<uint32_t>(i)));
+    }
+    program.push_back(
+        BPF_STMT(BPF_RET | BPF_K, static_cast<uint32_t>(cpus.size())));
+    return program;
+}
+
+absl::StatusOr<std::unique_ptr<ReusePortGroup>> ReusePortGroup::Create(
+    const SocketAddr& addr, const Options& options) {
+    std::vector<int> cpus = options.cpus;
+    if (cpus.empty()) {
+        ASSIGN_OR_RETURN(cpus, utils::AllowedCpus());
+    }
+    for (int cpu : cpus) {
+        if (cpu < 0 || cpu >= CPU_SETSIZE) {
+            return absl::InvalidArgumentError(
+                absl::StrFormat("invalid cpu %d", cpu));
+        }
+    }
+    auto program = SteeringProgram(cpus);
+    if (options.steer_by_cpu && program.size() > BPF_MAXINSNS) {
+        return absl::InvalidArgumentError(absl::StrFormat(
+            "%d workers do not fit a steering program", cpus.size()));
+    }
+
+    SocketOptions socket_options = options.socket_options;
+    socket_options.reuse_port = true;
+    SocketAddr bound = addr;
+    std::vector<std::unique_ptr<NetSocket>> listeners;
+    // The group indexes the listeners in the order they listen.
+    for (size_t i = 0; i < cpus.size(); i++) {
+        ASSIGN_OR_RETURN(auto listener,
+                         Socket(addr.addr()->sa_family,
+                                SOCK_STREAM | SOCK_CLOEXEC, 0, socket_options));
+        RETURN_IF_ERROR(listener->Bind(bound));
+        if (i == 0) {
+            struct sockaddr_storage storage;
+            socklen_t len = sizeof(storage);
+            if (getsockname(listener->fd(), (struct sockaddr*)&storage,
+                            &len) != 0) {
+                return utils::ErrnoToStatus(errno);
+            }
+            bound = SocketAddr(storage, len);
+        }
+        RETURN_IF_ERROR(listener->Listen(options.backlog));
+        listeners.push_back(std::move(listener));
+    }
+    if (options.steer_by_cpu) {
+        struct sock_fprog fprog;
+        fprog.len = program.size();
+        fprog.filter = program.data();
+        RETURN_IF_ERROR(listeners[0]->SetSockOpt(
+            SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, fprog));
+    }
+    return std::unique_ptr<ReusePortGroup>(
+        new ReusePortGroup(bound, std::move(cpus), std::move(listeners)));
+}
+
+absl::Status ReusePortGroup::Run(const std::function<void(int)>& worker) {
+    std::vector<absl::Status> pinned(size());
+    absl::BlockingCounter all_pinned(size());
+    absl::Notification start;
+    bool ok = true;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < size(); i++) {
+        threads.emplace_back([&, i]() {
+            pinned[i] = utils::Numa::PinThreadToCpu(cpus_[i]);
+            all_pinned.DecrementCount();
+            start.WaitForNotification();
+            if (ok) {
+                worker(i);
+            }
+        });
+    }
+    all_pinned.Wait();
+    absl::Status status;
+    for (int i = 0; i < size(); i++) {
+        status.Update(pinned[i]);
+    }
+    ok = status.ok();
+    start.Notify();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    return status;
+}
+
+}  // namespace net
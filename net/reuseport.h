@@ -0,0 +1,93 @@
+#ifndef TOOLBASE_NET_REUSEPORT_H_
+#define TOOLBASE_NET_REUSEPORT_H_
+
+#include <linux/filter.h>
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "net/net.h"
+
+namespace net {
+
+// Listeners of one address, one per worker, bound with SO_REUSEPORT. A
+// classic BPF program attached to the group (SO_ATTACH_REUSEPORT_CBPF)
+// steers each connection to the worker of the CPU which received its SYN,
+// and the workers run pinned to their CPU: with the NIC queues (RSS, or
+// RPS) spread over the same CPUs, the packets of a connection are
+// processed, accepted and served on one CPU, without the cache misses of
+// a handoff. Connections received on a CPU without a worker are spread by
+// the kernel hash of the 4-tuple.
+// Example:
+//  ReusePortGroup::Options options;
+//  options.socket_options = SocketOptions::LowLatency();
+//  ASSIGN_OR_RETURN(auto group, ReusePortGroup::Create(addr, options));
+//  RETURN_IF_ERROR(group->Run([&](int worker) {
+//      auto loop = file::EventLoop::Create().value();
+//      auto listener = AsyncListener::Create(
+//          loop.get(), group->TakeListener(worker)).value();
+//      loop->Spawn(Serve(loop.get(), listener.get()));
+//      loop->Run().IgnoreError();
+//  }));
+class ReusePortGroup {
+   public:
+    struct Options {
+        // The CPU of each worker, empty means one worker per CPU the
+        // process may run on. A CPU listed twice steers to its first worker.
+        std::vector<int> cpus;
+        int backlog = 1024;
+        // Applied to every listener, SO_REUSEPORT is always set.
+        SocketOptions socket_options;
+        // Attaches the steering program, else the kernel hash spreads the
+        // connections.
+        bool steer_by_cpu = true;
+    };
+
+    // Binds the listeners to `addr`. A port 0 is resolved by the first
+    // listener, see `addr()`.
+    static absl::StatusOr<std::unique_ptr<ReusePortGroup>> Create(
+        const SocketAddr& addr, const Options& options);
+
+    ReusePortGroup(const ReusePortGroup&) = delete;
+    ReusePortGroup& operator=(const ReusePortGroup&) = delete;
+
+    int size() const { return cpus_.size(); }
+    int cpu(int worker) const { return cpus_[worker]; }
+    const SocketAddr& addr() const { return addr_; }
+
+    // Returns nullptr once taken. Closing a listener drops its pending
+    // connections, the kernel steers the next ones to the others.
+    NetSocket* listener(int worker) { return listeners_[worker].get(); }
+    std::unique_ptr<NetSocket> TakeListener(int worker) {
+        return std::move(listeners_[worker]);
+    }
+
+    // Runs `worker(i)` for every worker on a thread pinned to `cpu(i)`,
+    // returns once all returned. Returns an error, without running
+    // `worker`, if the threads cannot be pinned.
+    absl::Status Run(const std::function<void(int)>& worker);
+
+    // The steering program of workers on `cpus`: the index of the first
+    // worker of the receiving CPU, or an index out of the group for the
+    // kernel to fall back to its hash.
+    static std::vector<struct sock_filter> SteeringProgram(
+        const std::vector<int>& cpus);
+
+   private:
+    ReusePortGroup(SocketAddr addr, std::vector<int> cpus,
+                   std::vector<std::unique_ptr<NetSocket>> listeners)
+        : addr_(addr),
+          cpus_(std::move(cpus)),
+          listeners_(std::move(listeners)) {}
+
+    const SocketAddr addr_;
+    const std::vector<int> cpus_;
+    std::vector<std::unique_ptr<NetSocket>> listeners_;
+};
+
+}  // namespace net
+
+#endif  // TOOLBASE_NET_REUSEPORT_H_
@@ -0,0 +1,73 @@
+#include <fcntl.h>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "net/reuseport.h"
+
+namespace net {
+namespace {
+
+constexpr int kConnections = 1000;
+
+// Each worker, one per CPU, connects `kConnections` loopback clients and
+// accepts from its own listener until all the connections of the group
+// were accepted. Steered (`range(0)` = 1), the connections of a worker
+// come back to it on its CPU; hashed, most of them are accepted on
+// another CPU than the one which processed the handshake.
+void BM_ConnectAccept(benchmark::State& state) {
+    ReusePortGroup::Options options;
+    options.steer_by_cpu = state.range(0);
+    auto group = ReusePortGroup::Create(*SocketAddr::NewIPv4("127.0.0.1", 0),
+                                        options);
+    if (!group.ok()) {
+        state.SkipWithError("cannot create the group");
+        return;
+    }
+    const int num_workers = (*group)->size();
+    for (int i = 0; i < num_workers; i++) {
+        fcntl((*group)->listener(i)->fd(), F_SETFL, O_NONBLOCK);
+    }
+
+    for (auto _ : state) {
+        std::atomic<int> accepted{0};
+        std::atomic<bool> failed{false};
+        auto status = (*group)->Run([&](int worker) {
+            std::vector<std::unique_ptr<NetSocket>> sockets;
+            int connected = 0;
+            while (accepted < num_workers * kConnections && !failed) {
+                if (connected < kConnections) {
+                    auto client = Socket(AF_INET, SOCK_STREAM, 0);
+                    if (!client.ok() ||
+                        !(*client)->Connect((*group)->addr()).ok()) {
+                        failed = true;
+                        break;
+                    }
+                    sockets.push_back(std::move(*client));
+                    connected++;
+                }
+                auto conns = (*group)->listener(worker)->AcceptMany(16);
+                if (!conns.ok()) {
+                    failed = true;
+                    break;
+                }
+                accepted += conns->size();
+                for (auto& conn : *conns) {
+                    sockets.push_back(std::move(conn));
+                }
+            }
+        });
+        if (!status.ok() || failed) {
+            state.SkipWithError("cannot run the workers");
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * num_workers * kConnections);
+    state.counters["workers"] = num_workers;
+}
+BENCHMARK(BM_ConnectAccept)->Arg(0)->Arg(1)->UseRealTime();
+
+}  // namespace
+}  // namespace net
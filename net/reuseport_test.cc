@@ -0,0 +1,106 @@
+#include "net/reuseport.h"
+
+#include <fcntl.h>
+#include <sched.h>
+
+#include <atomic>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "utils/testing.h"
+
+namespace net {
+namespace {
+
+using ::utils::testing::IsOkAndHolds;
+
+// The first CPU the test may run on.
+int FirstCpu() {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    EXPECT_EQ(sched_getaffinity(0, sizeof(set), &set), 0);
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &set)) {
+            return cpu;
+        }
+    }
+    return 0;
+}
+
+TEST(ReusePortGroup, SteeringProgram) {
+    // Worker i on CPU i returns the CPU.
+    EXPECT_EQ(ReusePortGroup::SteeringProgram({0, 1, 2, 3}).size(), 2);
+    // Otherwise a comparison and a return per worker, and the fallback.
+    auto program = ReusePortGroup::SteeringProgram({4, 6});
+    ASSERT_EQ(program.size(), 6);
+    EXPECT_EQ(program[1].k, 4);
+    EXPECT_EQ(program[2].k, 0);
+    EXPECT_EQ(program[3].k, 6);
+    EXPECT_EQ(program[4].k, 1);
+    EXPECT_EQ(program[5].k, 2);
+}
+
+TEST(ReusePortGroup, SteersToTheWorkerOfTheCpu) {
+    // Two workers on the CPU of the test, the first one gets all the
+    // connections, which loopback receives on the connecting CPU.
+    const int cpu = FirstCpu();
+    cpu_set_t old_set;
+    ASSERT_EQ(sched_getaffinity(0, sizeof(old_set), &old_set), 0);
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    ASSERT_EQ(sched_setaffinity(0, sizeof(set), &set), 0);
+
+    ReusePortGroup::Options options;
+    options.cpus = {cpu, cpu};
+    auto group = ReusePortGroup::Create(*SocketAddr::NewIPv4("127.0.0.1", 0),
+                                        options);
+    ASSERT_OK(group);
+    EXPECT_EQ((*group)->size(), 2);
+    EXPECT_NE(*(*group)->addr().port(), 0);
+
+    std::vector<std::unique_ptr<NetSocket>> clients;
+    for (int i = 0; i < 20; i++) {
+        auto client = Socket(AF_INET, SOCK_STREAM, 0);
+        ASSERT_OK(client);
+        ASSERT_OK((*client)->Connect((*group)->addr()));
+        clients.push_back(std::move(*client));
+    }
+    for (int i = 0; i < 2; i++) {
+        ASSERT_EQ(fcntl((*group)->listener(i)->fd(), F_SETFL, O_NONBLOCK),
+                  0);
+    }
+    EXPECT_THAT((*group)->listener(0)->AcceptMany(32),
+                IsOkAndHolds(::testing::SizeIs(20)));
+    EXPECT_THAT((*group)->listener(1)->AcceptMany(32),
+                IsOkAndHolds(::testing::IsEmpty()));
+
+    ASSERT_EQ(sched_setaffinity(0, sizeof(old_set), &old_set), 0);
+}
+
+TEST(ReusePortGroup, Run) {
+    const int cpu = FirstCpu();
+    ReusePortGroup::Options options;
+    options.cpus = {cpu, cpu, cpu};
+    options.steer_by_cpu = false;
+    auto group = ReusePortGroup::Create(*SocketAddr::NewIPv4("127.0.0.1", 0),
+                                        options);
+    ASSERT_OK(group);
+
+    std::atomic<int> pinned{0};
+    std::vector<std::unique_ptr<NetSocket>> taken(3);
+    ASSERT_OK((*group)->Run([&](int worker) {
+        if (sched_getcpu() == cpu) {
+            pinned++;
+        }
+        taken[worker] = (*group)->TakeListener(worker);
+    }));
+    EXPECT_EQ(pinned, 3);
+    for (int i = 0; i < 3; i++) {
+        EXPECT_NE(taken[i], nullptr);
+        EXPECT_EQ((*group)->listener(i), nullptr);
+    }
+}
+
+}  // namespace
+}  // namespace net
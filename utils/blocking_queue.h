@@ -0,0 +1,159 @@
+#ifndef TOOLBASE_UTILS_BLOCKING_QUEUE_H_
+#define TOOLBASE_UTILS_BLOCKING_QUEUE_H_
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include "absl/base/optimization.h"
+#include "utils/futex.h"
+#include "utils/mpmc_queue.h"
+
+namespace utils {
+
+// Adds blocking `Push` and `Pop` to a lock-free `MpmcQueue` or `SpscRing`.
+// A blocked call first spins `spin_count` times, then parks on a futex. The
+// other side only makes a syscall to wake it when a thread is parked, so
+// the fast path stays lock-free.
+// Example:
+//  BlockingQueue<Connection> queue(1024);
+//  // Accept thread.
+//  queue.Push(std::move(connection));
+//  // Workers.
+//  Connection connection;
+//  while (queue.Pop(connection)) { ... }
+//  // Shutdown.
+//  queue.Close();
+template <typename T, typename Queue = MpmcQueue<T>>
+class BlockingQueue {
+   public:
+    explicit BlockingQueue(size_t capacity, int spin_count = 128)
+        : queue_(capacity), spin_count_(spin_count) {}
+
+    BlockingQueue(const BlockingQueue&) = delete;
+    BlockingQueue& operator=(const BlockingQueue&) = delete;
+
+    // Blocks while the queue is full. Returns false if the queue is closed.
+    bool Push(T item) {
+        // Checks `closed` before each attempt, a push succeeding after
+        // `Close` could be missed by the consumers already drained.
+        auto push = [&]() {
+            return !closed() && queue_.TryPush(std::move(item));
+        };
+        if (!Await(not_full_, push)) {
+            return false;
+        }
+        Notify(not_empty_);
+        return true;
+    }
+
+    // Blocks while the queue is empty. Returns false once the queue is
+    // closed and drained.
+    bool Pop(T& item) { return PopBatch(&item, 1) == 1; }
+
+    // Like `Pop`, but moves up to `count` available items, returns 0 once
+    // the queue is closed and drained.
+    size_t PopBatch(T* items, size_t count) {
+        size_t n = 0;
+        Await(not_empty_,
+              [&]() { return (n = queue_.TryPopBatch(items, count)) > 0; });
+        if (n > 0) {
+            // Each freed slot can take the item of one blocked push.
+            Notify(not_full_, n);
+        }
+        return n;
+    }
+
+    // Non blocking variants, they wake up the blocked threads as needed.
+    bool TryPush(T&& item) {
+        if (closed() || !queue_.TryPush(std::move(item))) {
+            return false;
+        }
+        Notify(not_empty_);
+        return true;
+    }
+    bool TryPop(T& item) {
+        if (!queue_.TryPop(item)) {
+            return false;
+        }
+        Notify(not_full_);
+        return true;
+    }
+
+    // Fails the later pushes and wakes up all the blocked threads, the
+    // items already queued can still be popped.
+    void Close() {
+        closed_.store(true, std::memory_order_seq_cst);
+        for (Waiters* waiters : {&not_empty_, &not_full_}) {
+            waiters->epoch.fetch_add(1, std::memory_order_seq_cst);
+            FutexWake(&waiters->epoch, INT_MAX);
+        }
+    }
+
+    bool closed() const { return closed_.load(std::memory_order_acquire); }
+    size_t size() const { return queue_.size(); }
+
+   private:
+    struct alignas(ABSL_CACHELINE_SIZE) Waiters {
+        // Bumped on each wakeup, the futex word.
+        std::atomic<uint32_t> epoch{0};
+        std::atomic<uint32_t> count{0};
+    };
+
+    // Retries `op` until it succeeds, returns false if the queue is closed
+    // first. `op` is tried once more after the close, for the pops to drain
+    // the queue.
+    template <typename Op>
+    bool Await(Waiters& waiters, Op op) {
+        for (int i = 0; i < spin_count_; i++) {
+            if (op()) {
+                return true;
+            }
+            if (closed()) {
+                return op();
+            }
+            CpuRelax();
+        }
+        while (true) {
+            // Registers before the last check, so that a thread making
+            // progress after it sees the waiter and bumps the epoch.
+            waiters.count.fetch_add(1, std::memory_order_seq_cst);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            uint32_t epoch = waiters.epoch.load(std::memory_order_acquire);
+            if (op()) {
+                waiters.count.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+            if (closed()) {
+                waiters.count.fetch_sub(1, std::memory_order_relaxed);
+                return op();
+            }
+            FutexWait(&waiters.epoch, epoch);
+            waiters.count.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    // Wakes up to `n` blocked threads.
+    void Notify(Waiters& waiters, size_t n = 1) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        uint32_t count = waiters.count.load(std::memory_order_relaxed);
+        if (count > 0) {
+            waiters.epoch.fetch_add(1, std::memory_order_release);
+            FutexWake(&waiters.epoch,
+                      static_cast<int>(std::min<size_t>(n, count)));
+        }
+    }
+
+    Queue queue_;
+    const int spin_count_;
+    std::atomic<bool> closed_{false};
+    Waiters not_empty_;
+    Waiters not_full_;
+};
+
+}  // namespace utils
+
+#endif  // TOOLBASE_UTILS_BLOCKING_QUEUE_H_
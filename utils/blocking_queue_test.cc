@@ -0,0 +1,151 @@
+#include "utils/blocking_queue.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "absl/time/clock.h"
+#include "gtest/gtest.h"
+#include "utils/spsc_ring.h"
+
+namespace utils {
+namespace {
+
+TEST(BlockingQueue, PopBlocksUntilPush) {
+    BlockingQueue<int> queue(4, /*spin_count=*/0);
+    std::thread consumer([&]() {
+        int item;
+        ASSERT_TRUE(queue.Pop(item));
+        EXPECT_EQ(item, 42);
+    });
+    absl::SleepFor(absl::Milliseconds(10));
+    EXPECT_TRUE(queue.Push(42));
+    consumer.join();
+}
+
+TEST(BlockingQueue, PushBlocksWhileFull) {
+    BlockingQueue<int> queue(2, /*spin_count=*/0);
+    EXPECT_TRUE(queue.Push(1));
+    EXPECT_TRUE(queue.Push(2));
+    EXPECT_FALSE(queue.TryPush(3));
+    std::thread producer([&]() { EXPECT_TRUE(queue.Push(3)); });
+    absl::SleepFor(absl::Milliseconds(10));
+    int items[4];
+    size_t n = queue.PopBatch(items, 4);
+    producer.join();
+    EXPECT_EQ(n, 2);
+    EXPECT_EQ(items[0], 1);
+    ASSERT_TRUE(queue.TryPop(items[0]));
+    EXPECT_EQ(items[0], 3);
+}
+
+TEST(BlockingQueue, PopBatchWakesUpProducers) {
+    BlockingQueue<int> queue(4, /*spin_count=*/0);
+    for (int i = 0; i < 4; i++) {
+        EXPECT_TRUE(queue.Push(i));
+    }
+    std::vector<std::thread> producers;
+    for (int i = 0; i < 4; i++) {
+        producers.emplace_back([&]() { EXPECT_TRUE(queue.Push(42)); });
+    }
+    absl::SleepFor(absl::Milliseconds(10));
+    int items[4];
+    EXPECT_EQ(queue.PopBatch(items, 4), 4);
+    // All the producers get a freed slot, without more pops.
+    for (auto& thread : producers) {
+        thread.join();
+    }
+    EXPECT_EQ(queue.size(), 4);
+}
+
+TEST(BlockingQueue, CloseWakesUpAndDrains) {
+    BlockingQueue<int> queue(4);
+    std::thread consumer([&]() {
+        int item;
+        EXPECT_FALSE(queue.Pop(item));
+    });
+    absl::SleepFor(absl::Milliseconds(10));
+    queue.Close();
+    consumer.join();
+
+    BlockingQueue<int> drained(4);
+    drained.Push(1);
+    drained.Close();
+    EXPECT_FALSE(drained.Push(2));
+    int item;
+    EXPECT_TRUE(drained.Pop(item));
+    EXPECT_FALSE(drained.Pop(item));
+}
+
+TEST(BlockingQueue, CloseFailsBlockedPush) {
+    for (int i = 0; i < 20; i++) {
+        BlockingQueue<int> queue(2, /*spin_count=*/0);
+        EXPECT_TRUE(queue.Push(1));
+        EXPECT_TRUE(queue.Push(2));
+        std::thread producer([&]() { EXPECT_FALSE(queue.Push(3)); });
+        absl::SleepFor(absl::Milliseconds(1));
+        queue.Close();
+        // Frees a slot right after the close, the woken up push must not
+        // take it.
+        int item;
+        EXPECT_TRUE(queue.TryPop(item));
+        producer.join();
+        EXPECT_TRUE(queue.Pop(item));
+        EXPECT_EQ(item, 2);
+        EXPECT_FALSE(queue.Pop(item));
+    }
+}
+
+TEST(BlockingQueue, ManyProducersAndConsumers) {
+    constexpr int kThreads = 4;
+    constexpr int kItemsPerThread = 50000;
+    BlockingQueue<int> queue(16, /*spin_count=*/16);
+    std::vector<std::thread> producers;
+    std::vector<std::thread> consumers;
+    std::atomic<int64_t> sum{0};
+    for (int t = 0; t < kThreads; t++) {
+        producers.emplace_back([&]() {
+            for (int i = 0; i < kItemsPerThread; i++) {
+                ASSERT_TRUE(queue.Push(i));
+            }
+        });
+        consumers.emplace_back([&]() {
+            int item;
+            while (queue.Pop(item)) {
+                sum += item;
+            }
+        });
+    }
+    for (auto& thread : producers) {
+        thread.join();
+    }
+    queue.Close();
+    for (auto& thread : consumers) {
+        thread.join();
+    }
+    EXPECT_EQ(sum, int64_t{kThreads} * kItemsPerThread *
+                       (kItemsPerThread - 1) / 2);
+}
+
+TEST(BlockingQueue, SpscRing) {
+    constexpr int kItems = 100000;
+    BlockingQueue<int, SpscRing<int>> queue(8, /*spin_count=*/0);
+    std::thread producer([&]() {
+        for (int i = 0; i < kItems; i++) {
+            queue.Push(i);
+        }
+        queue.Close();
+    });
+    int expected = 0;
+    int batch[4];
+    while (size_t n = queue.PopBatch(batch, 4)) {
+        for (size_t i = 0; i < n; i++) {
+            ASSERT_EQ(batch[i], expected++);
+        }
+    }
+    producer.join();
+    EXPECT_EQ(expected, kItems);
+}
+
+}  // namespace
+}  // namespace utils
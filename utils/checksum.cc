@@ -0,0 +1,228 @@
+#include "utils/checksum.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "crc32c/crc32c.h"
+
+namespace utils {
+namespace {
+
+// The reflected CRC32C polynomial.
+constexpr uint32_t kCrc32cPoly = 0x82f63b78;
+
+// Multiplies `a` by `b` modulo the polynomial, both reflected.
+uint32_t MultiplyModPoly(uint32_t a, uint32_t b) {
+    uint32_t m = 1u << 31;
+    uint32_t product = 0;
+    while (true) {
+        if (a & m) {
+            product ^= b;
+            if ((a & (m - 1)) == 0) {
+                break;
+            }
+        }
+        m >>= 1;
+        b = (b & 1) ? (b >> 1) ^ kCrc32cPoly : b >> 1;
+    }
+    return product;
+}
+
+struct PowerTable {
+    // x^(2^n) modulo the polynomial.
+    uint32_t x2n[32];
+
+    PowerTable() {
+        uint32_t p = 1u << 30;  // x^1
+        x2n[0] = p;
+        for (int n = 1; n < 32; n++) {
+            x2n[n] = p = MultiplyModPoly(p, p);
+        }
+    }
+};
+
+// Returns x^(n * 2^k) modulo the polynomial.
+uint32_t PowerModPoly(size_t n, int k) {
+    static const PowerTable table;
+    uint32_t p = 1u << 31;  // x^0
+    while (n) {
+        if (n & 1) {
+            p = MultiplyModPoly(table.x2n[k & 31], p);
+        }
+        n >>= 1;
+        k++;
+    }
+    return p;
+}
+
+constexpr uint64_t kPrime1 = 0x9e3779b185ebca87;
+constexpr uint64_t kPrime2 = 0xc2b2ae3d27d4eb4f;
+constexpr uint64_t kPrime3 = 0x165667b19e3779f9;
+constexpr uint64_t kPrime4 = 0x85ebca77c2b2ae63;
+constexpr uint64_t kPrime5 = 0x27d4eb2f165667c5;
+
+inline uint64_t Rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+// Loads in little endian, the byte order of all the supported targets.
+inline uint64_t Load64(const char* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint32_t Load32(const char* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint64_t Round(uint64_t acc, uint64_t input) {
+    acc += input * kPrime2;
+    acc = Rotl(acc, 31);
+    return acc * kPrime1;
+}
+
+inline uint64_t MergeRound(uint64_t acc, uint64_t lane) {
+    acc ^= Round(0, lane);
+    return acc * kPrime1 + kPrime4;
+}
+
+}  // namespace
+
+void Crc32c::Update(const void* data, size_t size) {
+    crc_ = crc32c::Extend(crc_, static_cast<const uint8_t*>(data), size);
+}
+
+uint32_t ComputeCrc32c(absl::string_view data) {
+    return crc32c::Crc32c(data.data(), data.size());
+}
+
+uint32_t Crc32cCombine(uint32_t crc1, uint32_t crc2, size_t size2) {
+    return MultiplyModPoly(PowerModPoly(size2, 3), crc1) ^ crc2;
+}
+
+uint32_t ComputeCrc32cParallel(const void* data, size_t size,
+                               int parallelism) {
+    constexpr size_t kMinChunkSize = 1 << 20;
+    const char* bytes = static_cast<const char*>(data);
+    size_t chunks = std::min<size_t>(std::max(parallelism, 1),
+                                     std::max<size_t>(size / kMinChunkSize, 1));
+    if (chunks == 1) {
+        return ComputeCrc32c(absl::string_view(bytes, size));
+    }
+
+    size_t chunk_size = (size + chunks - 1) / chunks;
+    std::vector<uint32_t> crcs(chunks);
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < chunks; i++) {
+        threads.emplace_back([&crcs, bytes, size, chunk_size, i]() {
+            size_t begin = i * chunk_size;
+            size_t end = std::min(size, begin + chunk_size);
+            crcs[i] = ComputeCrc32c(absl::string_view(bytes + begin,
+                                                      end - begin));
+        });
+    }
+    crcs[0] = ComputeCrc32c(absl::string_view(bytes, chunk_size));
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    uint32_t crc = crcs[0];
+    for (size_t i = 1; i < chunks; i++) {
+        size_t begin = i * chunk_size;
+        size_t end = std::min(size, begin + chunk_size);
+        crc = Crc32cCombine(crc, crcs[i], end - begin);
+    }
+    return crc;
+}
+
+void Hash64::Reset(uint64_t seed) {
+    seed_ = seed;
+    total_size_ = 0;
+    lanes_[0] = seed + kPrime1 + kPrime2;
+    lanes_[1] = seed + kPrime2;
+    lanes_[2] = seed;
+    lanes_[3] = seed - kPrime1;
+    buffered_ = 0;
+}
+
+void Hash64::Update(const void* data, size_t size) {
+    const char* p = static_cast<const char*>(data);
+    const char* end = p + size;
+    total_size_ += size;
+
+    if (buffered_ + size < kStripeSize) {
+        memcpy(buffer_ + buffered_, p, size);
+        buffered_ += size;
+        return;
+    }
+    if (buffered_ > 0) {
+        size_t fill = kStripeSize - buffered_;
+        memcpy(buffer_ + buffered_, p, fill);
+        for (int i = 0; i < 4; i++) {
+            lanes_[i] = Round(lanes_[i], Load64(buffer_ + i * 8));
+        }
+        p += fill;
+        buffered_ = 0;
+    }
+
+    // The four independent lanes keep the multipliers of the CPU busy.
+    uint64_t v1 = lanes_[0], v2 = lanes_[1], v3 = lanes_[2], v4 = lanes_[3];
+    for (; end - p >= static_cast<ptrdiff_t>(kStripeSize); p += kStripeSize) {
+        v1 = Round(v1, Load64(p));
+        v2 = Round(v2, Load64(p + 8));
+        v3 = Round(v3, Load64(p + 16));
+        v4 = Round(v4, Load64(p + 24));
+    }
+    lanes_[0] = v1, lanes_[1] = v2, lanes_[2] = v3, lanes_[3] = v4;
+
+    buffered_ = end - p;
+    memcpy(buffer_, p, buffered_);
+}
+
+uint64_t Hash64::Digest() const {
+    uint64_t h;
+    if (total_size_ >= kStripeSize) {
+        h = Rotl(lanes_[0], 1) + Rotl(lanes_[1], 7) + Rotl(lanes_[2], 12) +
+            Rotl(lanes_[3], 18);
+        for (int i = 0; i < 4; i++) {
+            h = MergeRound(h, lanes_[i]);
+        }
+    } else {
+        h = seed_ + kPrime5;
+    }
+    h += total_size_;
+
+    const char* p = buffer_;
+    const char* end = buffer_ + buffered_;
+    for (; end - p >= 8; p += 8) {
+        h ^= Round(0, Load64(p));
+        h = Rotl(h, 27) * kPrime1 + kPrime4;
+    }
+    if (end - p >= 4) {
+        h ^= static_cast<uint64_t>(Load32(p)) * kPrime1;
+        h = Rotl(h, 23) * kPrime2 + kPrime3;
+        p += 4;
+    }
+    for (; p < end; p++) {
+        h ^= static_cast<uint8_t>(*p) * kPrime5;
+        h = Rotl(h, 11) * kPrime1;
+    }
+
+    h ^= h >> 33;
+    h *= kPrime2;
+    h ^= h >> 29;
+    h *= kPrime3;
+    h ^= h >> 32;
+    return h;
+}
+
+uint64_t ComputeHash64(absl::string_view data, uint64_t seed) {
+    Hash64 hash(seed);
+    hash.Update(data);
+    return hash.Digest();
+}
+
+}  // namespace utils
@@ -0,0 +1,78 @@
+#ifndef TOOLBASE_UTILS_CHECKSUM_H_
+#define TOOLBASE_UTILS_CHECKSUM_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/strings/string_view.h"
+
+namespace utils {
+
+// Streaming CRC32C (Castagnoli). The crc32c library picks the SSE4.2 or the
+// ARMv8 CRC instructions at runtime when the CPU has them.
+// Example:
+//  Crc32c crc;
+//  crc.Update("hello ");
+//  crc.Update("world");
+//  crc.value();  // == ComputeCrc32c("hello world")
+class Crc32c {
+   public:
+    Crc32c() = default;
+    // Continues from the CRC32C of the preceding data.
+    explicit Crc32c(uint32_t crc) : crc_(crc) {}
+
+    void Update(absl::string_view data) { Update(data.data(), data.size()); }
+    void Update(const void* data, size_t size);
+
+    uint32_t value() const { return crc_; }
+    void Reset() { crc_ = 0; }
+
+   private:
+    uint32_t crc_ = 0;
+};
+
+uint32_t ComputeCrc32c(absl::string_view data);
+
+// Returns the CRC32C of the concatenation A + B, where `crc1` is the CRC32C
+// of A, `crc2` the one of B and `size2` the length of B. Takes O(log(size2))
+// time, so that chunks checksummed in parallel can be combined.
+uint32_t Crc32cCombine(uint32_t crc1, uint32_t crc2, size_t size2);
+
+// Computes the CRC32C of a large buffer with `parallelism` threads, each
+// thread checksums a contiguous chunk of at least 1MB.
+uint32_t ComputeCrc32cParallel(const void* data, size_t size,
+                               int parallelism);
+
+// Streaming 64 bits non-cryptographic hash, compatible with XXH64.
+// Example:
+//  Hash64 hash;
+//  hash.Update("hello ");
+//  hash.Update("world");
+//  hash.Digest();  // == ComputeHash64("hello world")
+class Hash64 {
+   public:
+    explicit Hash64(uint64_t seed = 0) { Reset(seed); }
+
+    void Update(absl::string_view data) { Update(data.data(), data.size()); }
+    void Update(const void* data, size_t size);
+
+    // Returns the hash of the data so far, more data can be added after.
+    uint64_t Digest() const;
+    void Reset(uint64_t seed = 0);
+
+   private:
+    static constexpr size_t kStripeSize = 32;
+
+    uint64_t seed_;
+    uint64_t total_size_;
+    uint64_t lanes_[4];
+    // The pending bytes of an incomplete stripe.
+    char buffer_[kStripeSize];
+    size_t buffered_;
+};
+
+uint64_t ComputeHash64(absl::string_view data, uint64_t seed = 0);
+
+}  // namespace utils
+
+#endif  // TOOLBASE_UTILS_CHECKSUM_H_
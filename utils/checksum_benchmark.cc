@@ -0,0 +1,47 @@
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "utils/checksum.h"
+
+namespace utils {
+namespace {
+
+void BM_Crc32c(benchmark::State& state) {
+    std::string data(state.range(0), 'x');
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(ComputeCrc32c(data));
+    }
+    state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_Crc32c)->Range(64, 16 << 20);
+
+void BM_Hash64(benchmark::State& state) {
+    std::string data(state.range(0), 'x');
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(ComputeHash64(data));
+    }
+    state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_Hash64)->Range(64, 16 << 20);
+
+void BM_Crc32cCombine(benchmark::State& state) {
+    size_t size = state.range(0);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(Crc32cCombine(0x12345678, 0x9abcdef0, size));
+    }
+}
+BENCHMARK(BM_Crc32cCombine)->Range(1 << 10, 1 << 30);
+
+// Checksums 256MB with `range(0)` threads.
+void BM_Crc32cParallel(benchmark::State& state) {
+    std::string data(256 << 20, 'x');
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+            ComputeCrc32cParallel(data.data(), data.size(), state.range(0)));
+    }
+    state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_Crc32cParallel)->RangeMultiplier(2)->Range(1, 16)->UseRealTime();
+
+}  // namespace
+}  // namespace utils
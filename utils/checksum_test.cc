@@ -0,0 +1,86 @@
+#include "utils/checksum.h"
+
+#include <string>
+
+#include "gtest/gtest.h"
+
+namespace utils {
+namespace {
+
+std::string TestData(size_t size) {
+    std::string data(size, '\0');
+    uint32_t x = 12345;
+    for (auto& c : data) {
+        x = x * 1103515245 + 12345;
+        c = static_cast<char>(x >> 16);
+    }
+    return data;
+}
+
+TEST(Crc32c, KnownValues) {
+    EXPECT_EQ(ComputeCrc32c(""), 0);
+    EXPECT_EQ(ComputeCrc32c("123456789"), 0xe3069283);
+    EXPECT_EQ(ComputeCrc32c(std::string(32, '\0')), 0x8a9136aa);
+}
+
+TEST(Crc32c, Streaming) {
+    std::string data = TestData(10000);
+    for (size_t step : {1, 7, 64, 4096}) {
+        Crc32c crc;
+        for (size_t pos = 0; pos < data.size(); pos += step) {
+            crc.Update(absl::string_view(data).substr(pos, step));
+        }
+        EXPECT_EQ(crc.value(), ComputeCrc32c(data));
+    }
+
+    Crc32c crc(ComputeCrc32c("hello "));
+    crc.Update("world");
+    EXPECT_EQ(crc.value(), ComputeCrc32c("hello world"));
+}
+
+TEST(Crc32c, Combine) {
+    std::string data = TestData(100000);
+    for (size_t split : {0, 1, 3, 1000, 65536, 99999, 100000}) {
+        auto a = absl::string_view(data).substr(0, split);
+        auto b = absl::string_view(data).substr(split);
+        EXPECT_EQ(
+            Crc32cCombine(ComputeCrc32c(a), ComputeCrc32c(b), b.size()),
+            ComputeCrc32c(data))
+            << split;
+    }
+}
+
+TEST(Crc32c, Parallel) {
+    std::string data = TestData((5 << 20) + 123);
+    for (int parallelism : {1, 2, 3, 8}) {
+        EXPECT_EQ(ComputeCrc32cParallel(data.data(), data.size(), parallelism),
+                  ComputeCrc32c(data));
+    }
+    EXPECT_EQ(ComputeCrc32cParallel("", 0, 4), 0);
+}
+
+TEST(Hash64, KnownValues) {
+    EXPECT_EQ(ComputeHash64(""), 0xef46db3751d8e999);
+    EXPECT_EQ(ComputeHash64("a"), 0xd24ec4f1a98c6e5b);
+    EXPECT_EQ(ComputeHash64("abc"), 0x44bc2cf5ad770999);
+    EXPECT_EQ(ComputeHash64("Nobody inspects the spammish repetition"),
+              0xfbcea83c8a378bf1);
+    EXPECT_NE(ComputeHash64("abc", 1), ComputeHash64("abc"));
+}
+
+TEST(Hash64, Streaming) {
+    std::string data = TestData(10000);
+    for (size_t step : {1, 7, 31, 32, 33, 4096}) {
+        Hash64 hash(42);
+        for (size_t pos = 0; pos < data.size(); pos += step) {
+            hash.Update(absl::string_view(data).substr(pos, step));
+            EXPECT_EQ(hash.Digest(),
+                      ComputeHash64(absl::string_view(data).substr(
+                                        0, std::min(pos + step, data.size())),
+                                    42));
+        }
+    }
+}
+
+}  // namespace
+}  // namespace utils
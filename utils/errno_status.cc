@@ -0,0 +1,65 @@
+#include "utils/errno_status.h"
+
+#include <errno.h>
+#include <string.h>
+
+#include <atomic>
+#include <string>
+
+#include "absl/strings/cord.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+
+namespace utils {
+namespace {
+
+// Linux errnos are below 134, larger values are not cached.
+constexpr int kNumCachedErrnos = 256;
+
+std::atomic<const absl::Status*> cached_statuses[kNumCachedErrnos];
+
+absl::Status NewErrnoStatus(int error_number) {
+    char buf[256];
+    // The GNU strerror_r, which is thread-safe and may ignore `buf`.
+    const char* description = strerror_r(error_number, buf, sizeof(buf));
+    absl::Status status(absl::ErrnoToStatusCode(error_number), description);
+    status.SetPayload(kErrnoPayloadUrl, absl::Cord(absl::StrCat(error_number)));
+    return status;
+}
+
+}  // namespace
+
+absl::Status ErrnoToStatus(int error_number) {
+    if (error_number == 0) {
+        return absl::OkStatus();
+    }
+    if (error_number < 0 || error_number >= kNumCachedErrnos) {
+        return NewErrnoStatus(error_number);
+    }
+    std::atomic<const absl::Status*>& slot = cached_statuses[error_number];
+    const absl::Status* status = slot.load(std::memory_order_acquire);
+    if (status == nullptr) {
+        // Racing threads may both build the status, one of them is kept.
+        // The cached statuses are never freed.
+        auto* new_status = new absl::Status(NewErrnoStatus(error_number));
+        if (slot.compare_exchange_strong(status, new_status,
+                                         std::memory_order_acq_rel)) {
+            status = new_status;
+        } else {
+            delete new_status;
+        }
+    }
+    return *status;
+}
+
+int StatusErrno(const absl::Status& status) {
+    auto payload = status.GetPayload(kErrnoPayloadUrl);
+    int error_number;
+    if (!payload.has_value() ||
+        !absl::SimpleAtoi(std::string(*payload), &error_number)) {
+        return 0;
+    }
+    return error_number;
+}
+
+}  // namespace utils
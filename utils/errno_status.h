@@ -0,0 +1,31 @@
+#ifndef TOOLBASE_UTILS_ERRNO_STATUS_H_
+#define TOOLBASE_UTILS_ERRNO_STATUS_H_
+
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+
+namespace utils {
+
+// Type URL of the payload carrying the errno of the statuses returned by
+// `ErrnoToStatus`, as a decimal number.
+inline constexpr absl::string_view kErrnoPayloadUrl = "toolbase/errno";
+
+// Returns a status with the canonical code of `error_number`, as mapped by
+// `absl::ErrnoToStatusCode` (e.g. NotFound for ENOENT, Unavailable for
+// EAGAIN, ECONNRESET or EINTR), its description as the message and the errno
+// as payload.
+// The status of an errno is built once, at its first use, and shared: the
+// returned copy costs a reference count increment and no allocation, so
+// expected errors on hot paths stay cheap.
+// Example:
+//  if (read(fd, buf, count) < 0) {
+//      return utils::ErrnoToStatus(errno);
+//  }
+absl::Status ErrnoToStatus(int error_number);
+
+// Returns the errno carried by `status`, 0 if it does not carry one.
+int StatusErrno(const absl::Status& status);
+
+}  // namespace utils
+
+#endif  // TOOLBASE_UTILS_ERRNO_STATUS_H_
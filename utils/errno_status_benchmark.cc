@@ -0,0 +1,59 @@
+#include <errno.h>
+#include <string.h>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "benchmark/benchmark.h"
+#include "utils/errno_status.h"
+#include "utils/status_macros.h"
+
+namespace utils {
+namespace {
+
+template <typename MakeStatus>
+void RunErrorPath(benchmark::State& state, MakeStatus make_status) {
+    // Warms up the cache of `ErrnoToStatus`.
+    benchmark::DoNotOptimize(make_status(ECONNRESET));
+    for (auto _ : state) {
+        absl::Status status = make_status(ECONNRESET);
+        benchmark::DoNotOptimize(status);
+    }
+}
+
+// The status previously built for every failed syscall.
+void BM_StrerrorStatus(benchmark::State& state) {
+    RunErrorPath(state, [](int error_number) {
+        return absl::InternalError(strerror(error_number));
+    });
+}
+BENCHMARK(BM_StrerrorStatus);
+
+void BM_ErrnoToStatus(benchmark::State& state) {
+    RunErrorPath(state, [](int error_number) {
+        return ErrnoToStatus(error_number);
+    });
+}
+BENCHMARK(BM_ErrnoToStatus);
+
+absl::StatusOr<size_t> Syscall(int error_number) {
+    return ErrnoToStatus(error_number);
+}
+
+absl::StatusOr<size_t> Layer1(int error_number) {
+    ASSIGN_OR_RETURN(size_t size, Syscall(error_number));
+    return size;
+}
+
+absl::Status Layer2(int error_number) {
+    RETURN_IF_ERROR(Layer1(error_number));
+    return absl::OkStatus();
+}
+
+// An error propagated through the macros.
+void BM_PropagateError(benchmark::State& state) {
+    RunErrorPath(state, [](int error_number) { return Layer2(error_number); });
+}
+BENCHMARK(BM_PropagateError);
+
+}  // namespace
+}  // namespace utils
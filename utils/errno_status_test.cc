@@ -0,0 +1,84 @@
+#include "utils/errno_status.h"
+
+#include <errno.h>
+
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "utils/status_macros.h"
+#include "utils/testing.h"
+
+namespace utils {
+namespace {
+
+using ::utils::testing::StatusIs;
+
+TEST(ErrnoStatus, StatusCode) {
+    EXPECT_THAT(ErrnoToStatus(ENOENT), StatusIs(absl::StatusCode::kNotFound));
+    for (int error_number : {EAGAIN, EINTR, ECONNRESET}) {
+        EXPECT_THAT(ErrnoToStatus(error_number),
+                    StatusIs(absl::StatusCode::kUnavailable));
+    }
+    EXPECT_THAT(ErrnoToStatus(EEXIST),
+                StatusIs(absl::StatusCode::kAlreadyExists));
+    EXPECT_THAT(ErrnoToStatus(EACCES),
+                StatusIs(absl::StatusCode::kPermissionDenied));
+    EXPECT_THAT(ErrnoToStatus(EBADF),
+                StatusIs(absl::StatusCode::kFailedPrecondition));
+    EXPECT_THAT(ErrnoToStatus(ENOSPC),
+                StatusIs(absl::StatusCode::kResourceExhausted));
+    EXPECT_THAT(ErrnoToStatus(EIO), StatusIs(absl::StatusCode::kUnknown));
+}
+
+TEST(ErrnoStatus, ErrnoToStatus) {
+    EXPECT_OK(ErrnoToStatus(0));
+
+    absl::Status status = ErrnoToStatus(ENOENT);
+    EXPECT_THAT(status, StatusIs(absl::StatusCode::kNotFound));
+    EXPECT_EQ(status.message(), "No such file or directory");
+    EXPECT_EQ(StatusErrno(status), ENOENT);
+    EXPECT_EQ(status, ErrnoToStatus(ENOENT));
+
+    // Not cached.
+    EXPECT_EQ(StatusErrno(ErrnoToStatus(100000)), 100000);
+
+    EXPECT_EQ(StatusErrno(absl::OkStatus()), 0);
+    EXPECT_EQ(StatusErrno(absl::NotFoundError("no errno")), 0);
+}
+
+TEST(ErrnoStatus, Concurrent) {
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; i++) {
+        threads.emplace_back([]() {
+            for (int e = 1; e < 200; e++) {
+                EXPECT_EQ(StatusErrno(ErrnoToStatus(e)), e);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+absl::Status Fail(int error_number) { return ErrnoToStatus(error_number); }
+
+absl::StatusOr<int> FailOr(int error_number) {
+    RETURN_IF_ERROR(Fail(error_number));
+    return 1;
+}
+
+absl::Status Propagate(int error_number) {
+    ASSIGN_OR_RETURN(int value, FailOr(error_number));
+    return value == 1 ? absl::OkStatus() : absl::InternalError("unexpected");
+}
+
+TEST(ErrnoStatus, Propagate) {
+    EXPECT_OK(Propagate(0));
+    absl::Status status = Propagate(ECONNRESET);
+    EXPECT_THAT(status, StatusIs(absl::StatusCode::kUnavailable));
+    EXPECT_EQ(StatusErrno(status), ECONNRESET);
+}
+
+}  // namespace
+}  // namespace utils
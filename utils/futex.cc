@@ -0,0 +1,24 @@
+#include "utils/futex.h"
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace utils {
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+              "futex words are 32 bits");
+
+void FutexWait(std::atomic<uint32_t>* word, uint32_t expected) {
+    // EAGAIN (the value changed) and EINTR are both spurious wakeups for the
+    // callers, which recheck their condition.
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT_PRIVATE,
+            expected, nullptr, nullptr, 0);
+}
+
+void FutexWake(std::atomic<uint32_t>* word, int count) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE_PRIVATE,
+            count, nullptr, nullptr, 0);
+}
+
+}  // namespace utils
@@ -0,0 +1,27 @@
+#ifndef TOOLBASE_UTILS_FUTEX_H_
+#define TOOLBASE_UTILS_FUTEX_H_
+
+#include <atomic>
+#include <cstdint>
+
+namespace utils {
+
+// Blocks while `*word` == `expected`, may return spuriously. The futex is
+// private to the process.
+void FutexWait(std::atomic<uint32_t>* word, uint32_t expected);
+
+// Wakes up to `count` threads blocked on `word`.
+void FutexWake(std::atomic<uint32_t>* word, int count);
+
+// Hints the CPU that the thread is busy waiting.
+inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+}  // namespace utils
+
+#endif  // TOOLBASE_UTILS_FUTEX_H_
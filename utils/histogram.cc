@@ -0,0 +1,143 @@
+#include "utils/histogram.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "absl/strings/str_format.h"
+
+namespace utils {
+namespace {
+
+void AtomicMin(std::atomic<uint64_t>& target, uint64_t value) {
+    uint64_t current = target.load(std::memory_order_relaxed);
+    while (value < current &&
+           !target.compare_exchange_weak(current, value,
+                                         std::memory_order_relaxed)) {
+    }
+}
+
+void AtomicMax(std::atomic<uint64_t>& target, uint64_t value) {
+    uint64_t current = target.load(std::memory_order_relaxed);
+    while (value > current &&
+           !target.compare_exchange_weak(current, value,
+                                         std::memory_order_relaxed)) {
+    }
+}
+
+}  // namespace
+
+int LatencyHistogram::BucketIndex(uint64_t nanos) {
+    if (nanos < kSubBuckets) {
+        return nanos;
+    }
+    int exponent = 63 - __builtin_clzll(nanos);
+    int shift = exponent - kSubBucketBits;
+    int sub = (nanos >> shift) - kSubBuckets;
+    return (shift + 1) * kSubBuckets + sub;
+}
+
+uint64_t LatencyHistogram::BucketLowerBound(int index) {
+    if (index < kSubBuckets) {
+        return index;
+    }
+    int shift = index / kSubBuckets - 1;
+    uint64_t sub = index % kSubBuckets;
+    return (kSubBuckets + sub) << shift;
+}
+
+uint64_t LatencyHistogram::BucketUpperBound(int index) {
+    if (index < kSubBuckets) {
+        return index;
+    }
+    int shift = index / kSubBuckets - 1;
+    return BucketLowerBound(index) + ((uint64_t(1) << shift) - 1);
+}
+
+void LatencyHistogram::RecordNanos(int64_t nanos) {
+    uint64_t value = nanos < 0 ? 0 : nanos;
+    buckets_[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+    AtomicMin(min_, value);
+    AtomicMax(max_, value);
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+    for (int i = 0; i < kNumBuckets; i++) {
+        uint64_t count = other.BucketCount(i);
+        if (count > 0) {
+            buckets_[i].fetch_add(count, std::memory_order_relaxed);
+        }
+    }
+    count_.fetch_add(other.count_.load(std::memory_order_relaxed),
+                     std::memory_order_relaxed);
+    sum_.fetch_add(other.sum_.load(std::memory_order_relaxed),
+                   std::memory_order_relaxed);
+    AtomicMin(min_, other.min_.load(std::memory_order_relaxed));
+    AtomicMax(max_, other.max_.load(std::memory_order_relaxed));
+}
+
+void LatencyHistogram::Reset() {
+    for (int i = 0; i < kNumBuckets; i++) {
+        buckets_[i].store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    min_.store(std::numeric_limits<uint64_t>::max(), std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+absl::Duration LatencyHistogram::Min() const {
+    if (Count() == 0) {
+        return absl::ZeroDuration();
+    }
+    return absl::Nanoseconds(min_.load(std::memory_order_relaxed));
+}
+
+absl::Duration LatencyHistogram::Max() const {
+    return absl::Nanoseconds(max_.load(std::memory_order_relaxed));
+}
+
+absl::Duration LatencyHistogram::Mean() const {
+    uint64_t count = Count();
+    if (count == 0) {
+        return absl::ZeroDuration();
+    }
+    return absl::Nanoseconds(sum_.load(std::memory_order_relaxed) / count);
+}
+
+absl::Duration LatencyHistogram::Percentile(double percentile) const {
+    uint64_t count = Count();
+    if (count == 0) {
+        return absl::ZeroDuration();
+    }
+    uint64_t rank = percentile / 100 * count;
+    if (rank >= count) {
+        rank = count - 1;
+    }
+    uint64_t seen = 0;
+    for (int i = 0; i < kNumBuckets; i++) {
+        seen += BucketCount(i);
+        if (seen > rank) {
+            // Clamps to the observed range, the bucket bounds can be far away
+            // from the real values in sparse histograms.
+            uint64_t value = BucketUpperBound(i);
+            value = std::min(value, max_.load(std::memory_order_relaxed));
+            value = std::max(value, min_.load(std::memory_order_relaxed));
+            return absl::Nanoseconds(value);
+        }
+    }
+    return Max();
+}
+
+std::string LatencyHistogram::ToString() const {
+    return absl::StrFormat(
+        "count=%d min=%s mean=%s p50=%s p90=%s p99=%s p999=%s max=%s", Count(),
+        absl::FormatDuration(Min()), absl::FormatDuration(Mean()),
+        absl::FormatDuration(Percentile(50)),
+        absl::FormatDuration(Percentile(90)),
+        absl::FormatDuration(Percentile(99)),
+        absl::FormatDuration(Percentile(99.9)), absl::FormatDuration(Max()));
+}
+
+}  // namespace utils
@@ -0,0 +1,78 @@
+#ifndef TOOLBASE_UTILS_HISTOGRAM_H_
+#define TOOLBASE_UTILS_HISTOGRAM_H_
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "absl/time/time.h"
+
+namespace utils {
+
+// A lock-free latency histogram with log-linear buckets: every power of two
+// range is split into `kSubBuckets` equal buckets, so the relative error of
+// a reported percentile is below 1 / kSubBuckets (~6%).
+// `Record` may be called from any thread, readers see a consistent enough
+// snapshot for monitoring purposes.
+// Example:
+//  LatencyHistogram histogram;
+//  histogram.Record(absl::Microseconds(12));
+//  LOG(INFO) << histogram.Percentile(99);
+class LatencyHistogram {
+   public:
+    static constexpr int kSubBucketBits = 4;
+    static constexpr int kSubBuckets = 1 << kSubBucketBits;
+    static constexpr int kNumBuckets = (64 - kSubBucketBits + 1) * kSubBuckets;
+
+    LatencyHistogram() { Reset(); }
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    // Records a value, negative values are recorded as 0.
+    void Record(absl::Duration latency) {
+        RecordNanos(absl::ToInt64Nanoseconds(latency));
+    }
+    void RecordNanos(int64_t nanos);
+
+    // Adds all the recorded values of `other` to this histogram.
+    void Merge(const LatencyHistogram& other);
+
+    void Reset();
+
+    uint64_t Count() const { return count_.load(std::memory_order_relaxed); }
+    absl::Duration Min() const;
+    absl::Duration Max() const;
+    absl::Duration Mean() const;
+    absl::Duration Sum() const {
+        return absl::Nanoseconds(sum_.load(std::memory_order_relaxed));
+    }
+
+    // Returns the value at `percentile`, which should be in [0, 100].
+    // Returns zero if nothing has been recorded.
+    absl::Duration Percentile(double percentile) const;
+
+    // Returns a one line summary, e.g.
+    //  "count=10 min=1us mean=3us p50=2us p90=8us p99=9us p999=9us max=9us"
+    std::string ToString() const;
+
+    // Bucket accessors, for exporting the full distribution.
+    uint64_t BucketCount(int index) const {
+        return buckets_[index].load(std::memory_order_relaxed);
+    }
+    // Returns the smallest value in nanoseconds which falls into `index`.
+    static uint64_t BucketLowerBound(int index);
+    // Returns the largest value in nanoseconds which falls into `index`.
+    static uint64_t BucketUpperBound(int index);
+    static int BucketIndex(uint64_t nanos);
+
+   private:
+    std::atomic<uint64_t> buckets_[kNumBuckets];
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> sum_;
+    std::atomic<uint64_t> min_;
+    std::atomic<uint64_t> max_;
+};
+
+}  // namespace utils
+
+#endif  // TOOLBASE_UTILS_HISTOGRAM_H_
@@ -0,0 +1,79 @@
+#include "utils/histogram.h"
+
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace utils {
+namespace {
+
+TEST(LatencyHistogram, Empty) {
+    LatencyHistogram histogram;
+    EXPECT_EQ(histogram.Count(), 0);
+    EXPECT_EQ(histogram.Min(), absl::ZeroDuration());
+    EXPECT_EQ(histogram.Max(), absl::ZeroDuration());
+    EXPECT_EQ(histogram.Mean(), absl::ZeroDuration());
+    EXPECT_EQ(histogram.Percentile(99), absl::ZeroDuration());
+}
+
+TEST(LatencyHistogram, Buckets) {
+    for (uint64_t value : {0ull, 1ull, 15ull, 16ull, 17ull, 1000ull,
+                           123456789ull, ~0ull}) {
+        int index = LatencyHistogram::BucketIndex(value);
+        EXPECT_LT(index, LatencyHistogram::kNumBuckets);
+        EXPECT_LE(LatencyHistogram::BucketLowerBound(index), value);
+        EXPECT_GE(LatencyHistogram::BucketUpperBound(index), value);
+    }
+    for (int i = 1; i < LatencyHistogram::kNumBuckets; i++) {
+        EXPECT_EQ(LatencyHistogram::BucketLowerBound(i),
+                  LatencyHistogram::BucketUpperBound(i - 1) + 1);
+    }
+}
+
+TEST(LatencyHistogram, Percentile) {
+    LatencyHistogram histogram;
+    for (int i = 1; i <= 1000; i++) {
+        histogram.Record(absl::Microseconds(i));
+    }
+    EXPECT_EQ(histogram.Count(), 1000);
+    EXPECT_EQ(histogram.Min(), absl::Microseconds(1));
+    EXPECT_EQ(histogram.Max(), absl::Microseconds(1000));
+    EXPECT_NEAR(absl::ToDoubleMicroseconds(histogram.Mean()), 500.5, 0.01);
+    EXPECT_NEAR(absl::ToDoubleMicroseconds(histogram.Percentile(50)), 500, 35);
+    EXPECT_NEAR(absl::ToDoubleMicroseconds(histogram.Percentile(99)), 990, 65);
+    EXPECT_EQ(histogram.Percentile(100), absl::Microseconds(1000));
+}
+
+TEST(LatencyHistogram, MergeAndReset) {
+    LatencyHistogram a;
+    LatencyHistogram b;
+    a.Record(absl::Nanoseconds(10));
+    b.Record(absl::Nanoseconds(20));
+    a.Merge(b);
+    EXPECT_EQ(a.Count(), 2);
+    EXPECT_EQ(a.Min(), absl::Nanoseconds(10));
+    EXPECT_EQ(a.Max(), absl::Nanoseconds(20));
+
+    a.Reset();
+    EXPECT_EQ(a.Count(), 0);
+}
+
+TEST(LatencyHistogram, Concurrent) {
+    LatencyHistogram histogram;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&histogram]() {
+            for (int i = 0; i < 10000; i++) {
+                histogram.RecordNanos(i);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(histogram.Count(), 40000);
+}
+
+}  // namespace
+}  // namespace utils
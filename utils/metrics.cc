@@ -0,0 +1,163 @@
+#include "utils/metrics.h"
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_replace.h"
+#include "nlohmann/json.hpp"
+
+namespace utils {
+
+namespace internal {
+std::atomic<bool> metrics_enabled{false};
+}  // namespace internal
+
+void SetMetricsEnabled(bool enabled) {
+    internal::metrics_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+int Counter::ShardIndex() {
+    static std::atomic<int> next_index{0};
+    thread_local int index =
+        next_index.fetch_add(1, std::memory_order_relaxed) % kNumShards;
+    return index;
+}
+
+int64_t Counter::Value() const {
+    int64_t sum = 0;
+    for (const auto& shard : shards_) {
+        sum += shard.value.load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+void Counter::Reset() {
+    for (auto& shard : shards_) {
+        shard.value.store(0, std::memory_order_relaxed);
+    }
+}
+
+MetricsRegistry& MetricsRegistry::Global() {
+    static MetricsRegistry* registry = new MetricsRegistry();
+    return *registry;
+}
+
+MetricsRegistry::Metric& MetricsRegistry::GetMetric(absl::string_view name,
+                                                    absl::string_view help) {
+    auto it = metrics_.find(name);
+    if (it == metrics_.end()) {
+        it = metrics_.emplace(std::string(name), Metric()).first;
+        it->second.help = std::string(help);
+    }
+    return it->second;
+}
+
+Counter* MetricsRegistry::GetCounter(absl::string_view name,
+                                     absl::string_view help) {
+    absl::MutexLock lock(&mu_);
+    Metric& metric = GetMetric(name, help);
+    if (!metric.counter) {
+        metric.counter = std::make_unique<Counter>();
+    }
+    return metric.counter.get();
+}
+
+Gauge* MetricsRegistry::GetGauge(absl::string_view name,
+                                 absl::string_view help) {
+    absl::MutexLock lock(&mu_);
+    Metric& metric = GetMetric(name, help);
+    if (!metric.gauge) {
+        metric.gauge = std::make_unique<Gauge>();
+    }
+    return metric.gauge.get();
+}
+
+LatencyHistogram* MetricsRegistry::GetHistogram(absl::string_view name,
+                                                absl::string_view help) {
+    absl::MutexLock lock(&mu_);
+    Metric& metric = GetMetric(name, help);
+    if (!metric.histogram) {
+        metric.histogram = std::make_unique<LatencyHistogram>();
+    }
+    return metric.histogram.get();
+}
+
+std::string MetricsRegistry::ToJson() const {
+    nlohmann::json json = nlohmann::json::object();
+    absl::MutexLock lock(&mu_);
+    for (const auto& [name, metric] : metrics_) {
+        if (metric.counter) {
+            json[name] = metric.counter->Value();
+        } else if (metric.gauge) {
+            json[name] = metric.gauge->Value();
+        } else if (metric.histogram) {
+            const LatencyHistogram& h = *metric.histogram;
+            json[name] = {
+                {"count", h.Count()},
+                {"min_ns", absl::ToInt64Nanoseconds(h.Min())},
+                {"mean_ns", absl::ToInt64Nanoseconds(h.Mean())},
+                {"p50_ns", absl::ToInt64Nanoseconds(h.Percentile(50))},
+                {"p90_ns", absl::ToInt64Nanoseconds(h.Percentile(90))},
+                {"p99_ns", absl::ToInt64Nanoseconds(h.Percentile(99))},
+                {"p999_ns", absl::ToInt64Nanoseconds(h.Percentile(99.9))},
+                {"max_ns", absl::ToInt64Nanoseconds(h.Max())},
+            };
+        }
+    }
+    return json.dump();
+}
+
+std::string MetricsRegistry::ToPrometheus() const {
+    std::string out;
+    absl::MutexLock lock(&mu_);
+    for (const auto& [name, metric] : metrics_) {
+        if (!metric.help.empty()) {
+            const std::string help = absl::StrReplaceAll(
+                metric.help, {{"\\", "\\\\"}, {"\n", "\\n"}});
+            absl::StrAppend(&out, "# HELP ", name, " ", help, "\n");
+        }
+        if (metric.counter) {
+            absl::StrAppend(&out, "# TYPE ", name, " counter\n", name, " ",
+                            metric.counter->Value(), "\n");
+        } else if (metric.gauge) {
+            absl::StrAppend(&out, "# TYPE ", name, " gauge\n", name, " ",
+                            metric.gauge->Value(), "\n");
+        } else if (metric.histogram) {
+            const LatencyHistogram& h = *metric.histogram;
+            absl::StrAppend(&out, "# TYPE ", name, " histogram\n");
+            // Buckets are cumulative, and the same at every scrape: one
+            // per power of two, at the end of its sub-buckets.
+            uint64_t cumulative = 0;
+            for (int i = 0; i < LatencyHistogram::kNumBuckets; i++) {
+                cumulative += h.BucketCount(i);
+                if (i % LatencyHistogram::kSubBuckets !=
+                    LatencyHistogram::kSubBuckets - 1) {
+                    continue;
+                }
+                absl::StrAppendFormat(
+                    &out, "%s_bucket{le=\"%g\"} %d\n", name,
+                    LatencyHistogram::BucketUpperBound(i) * 1e-9, cumulative);
+            }
+            uint64_t count = h.Count();
+            absl::StrAppendFormat(&out, "%s_bucket{le=\"+Inf\"} %d\n", name,
+                                  count);
+            absl::StrAppendFormat(&out, "%s_sum %g\n", name,
+                                  absl::ToDoubleSeconds(h.Sum()));
+            absl::StrAppendFormat(&out, "%s_count %d\n", name, count);
+        }
+    }
+    return out;
+}
+
+void MetricsRegistry::Reset() {
+    absl::MutexLock lock(&mu_);
+    for (auto& [name, metric] : metrics_) {
+        if (metric.counter) {
+            metric.counter->Reset();
+        }
+        if (metric.histogram) {
+            metric.histogram->Reset();
+        }
+    }
+}
+
+}  // namespace utils
@@ -0,0 +1,175 @@
+#ifndef TOOLBASE_UTILS_METRICS_H_
+#define TOOLBASE_UTILS_METRICS_H_
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "absl/base/optimization.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "utils/histogram.h"
+
+namespace utils {
+
+namespace internal {
+extern std::atomic<bool> metrics_enabled;
+}  // namespace internal
+
+// Metrics are disabled by default, recording then costs a relaxed load and
+// a branch, except `Gauge::Add` which is always applied. Metrics registered
+// before enabling are kept.
+inline bool MetricsEnabled() {
+    return internal::metrics_enabled.load(std::memory_order_relaxed);
+}
+void SetMetricsEnabled(bool enabled);
+
+// A monotonic counter. Increments go to one of several cache line sized
+// shards picked per thread, so that threads do not contend on a hot
+// counter; reads sum the shards.
+class Counter {
+   public:
+    static constexpr int kNumShards = 16;
+
+    Counter() = default;
+    Counter(const Counter&) = delete;
+    Counter& operator=(const Counter&) = delete;
+
+    void Add(int64_t value) {
+        if (ABSL_PREDICT_FALSE(MetricsEnabled())) {
+            shards_[ShardIndex()].value.fetch_add(value,
+                                                  std::memory_order_relaxed);
+        }
+    }
+    void Increment() { Add(1); }
+
+    int64_t Value() const;
+    void Reset();
+
+   private:
+    struct alignas(ABSL_CACHELINE_SIZE) Shard {
+        std::atomic<int64_t> value{0};
+    };
+
+    static int ShardIndex();
+
+    Shard shards_[kNumShards];
+};
+
+// A value which goes up and down, e.g. the number of open connections.
+class Gauge {
+   public:
+    Gauge() = default;
+    Gauge(const Gauge&) = delete;
+    Gauge& operator=(const Gauge&) = delete;
+
+    void Set(int64_t value) {
+        if (ABSL_PREDICT_FALSE(MetricsEnabled())) {
+            value_.store(value, std::memory_order_relaxed);
+        }
+    }
+    // Always applied: a level built of deltas would drift if metrics were
+    // enabled between an increment and its decrement.
+    void Add(int64_t value) {
+        value_.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    int64_t Value() const { return value_.load(std::memory_order_relaxed); }
+
+   private:
+    std::atomic<int64_t> value_{0};
+};
+
+// Records the lifetime of the scope into `histogram`, does not read the
+// clock when metrics are disabled.
+// Example:
+//  {
+//      ScopedLatency latency(wait_latency);
+//      ret = epoll_wait(...);
+//  }
+class ScopedLatency {
+   public:
+    explicit ScopedLatency(LatencyHistogram* histogram)
+        : histogram_(MetricsEnabled() ? histogram : nullptr) {
+        if (ABSL_PREDICT_FALSE(histogram_ != nullptr)) {
+            start_ = absl::Now();
+        }
+    }
+    ~ScopedLatency() {
+        if (ABSL_PREDICT_FALSE(histogram_ != nullptr)) {
+            histogram_->Record(absl::Now() - start_);
+        }
+    }
+
+    ScopedLatency(const ScopedLatency&) = delete;
+    ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+   private:
+    LatencyHistogram* histogram_;
+    absl::Time start_;
+};
+
+// Owns the metrics of a process by name, and exports them.
+// Metrics are created once, usually into globals of the instrumented
+// module, and live as long as the registry.
+// Example:
+//  utils::Counter* const bytes_written =
+//      utils::MetricsRegistry::Global().GetCounter(
+//          "file_write_bytes_total", "Bytes written by File::Write.");
+//  bytes_written->Add(ret);
+//  ...
+//  utils::SetMetricsEnabled(true);
+//  std::string text = utils::MetricsRegistry::Global().ToPrometheus();
+class MetricsRegistry {
+   public:
+    MetricsRegistry() = default;
+    MetricsRegistry(const MetricsRegistry&) = delete;
+    MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+    // The registry of the toolbase modules.
+    static MetricsRegistry& Global();
+
+    // Return the metric named `name`, created if needed. The name should
+    // follow the Prometheus conventions, e.g. "net_send_bytes_total", and
+    // not be reused for a metric of another type.
+    Counter* GetCounter(absl::string_view name, absl::string_view help = "");
+    Gauge* GetGauge(absl::string_view name, absl::string_view help = "");
+    // Latencies are exported in seconds.
+    LatencyHistogram* GetHistogram(absl::string_view name,
+                                   absl::string_view help = "");
+
+    // Returns an object of the metrics by name: counters and gauges as
+    // numbers, histograms as objects with the count, the min, mean, max
+    // and percentiles in nanoseconds.
+    std::string ToJson() const;
+    // Returns the metrics in the Prometheus text exposition format,
+    // histograms with the same buckets on every export, one per power of
+    // two nanoseconds.
+    std::string ToPrometheus() const;
+
+    // Resets the counters and histograms, e.g. between benchmark runs.
+    void Reset();
+
+   private:
+    struct Metric {
+        std::string help;
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<Gauge> gauge;
+        std::unique_ptr<LatencyHistogram> histogram;
+    };
+
+    Metric& GetMetric(absl::string_view name, absl::string_view help)
+        ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+    mutable absl::Mutex mu_;
+    // Sorted by name, for stable exports.
+    std::map<std::string, Metric, std::less<>> metrics_ ABSL_GUARDED_BY(mu_);
+};
+
+}  // namespace utils
+
+#endif  // TOOLBASE_UTILS_METRICS_H_
@@ -0,0 +1,131 @@
+#include "utils/metrics.h"
+
+#include <thread>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "nlohmann/json.hpp"
+
+namespace utils {
+namespace {
+
+using ::testing::HasSubstr;
+
+class Metrics : public ::testing::Test {
+   protected:
+    void SetUp() override { SetMetricsEnabled(true); }
+    void TearDown() override { SetMetricsEnabled(false); }
+
+    MetricsRegistry registry_;
+};
+
+TEST_F(Metrics, Counter) {
+    Counter* counter = registry_.GetCounter("requests_total", "Requests.");
+    EXPECT_EQ(registry_.GetCounter("requests_total"), counter);
+    counter->Increment();
+    counter->Add(41);
+    EXPECT_EQ(counter->Value(), 42);
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 8; i++) {
+        threads.emplace_back([counter]() {
+            for (int j = 0; j < 10000; j++) {
+                counter->Increment();
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(counter->Value(), 80042);
+}
+
+TEST_F(Metrics, Disabled) {
+    Counter* counter = registry_.GetCounter("counter");
+    Gauge* gauge = registry_.GetGauge("gauge");
+    LatencyHistogram* histogram = registry_.GetHistogram("histogram");
+    SetMetricsEnabled(false);
+    counter->Increment();
+    gauge->Set(3);
+    { ScopedLatency latency(histogram); }
+    EXPECT_EQ(counter->Value(), 0);
+    EXPECT_EQ(gauge->Value(), 0);
+    EXPECT_EQ(histogram->Count(), 0);
+
+    SetMetricsEnabled(true);
+    { ScopedLatency latency(histogram); }
+    EXPECT_EQ(histogram->Count(), 1);
+}
+
+TEST_F(Metrics, GaugeAddWhileDisabled) {
+    Gauge* gauge = registry_.GetGauge("buffered");
+    SetMetricsEnabled(false);
+    gauge->Add(100);
+    SetMetricsEnabled(true);
+    gauge->Add(-100);
+    EXPECT_EQ(gauge->Value(), 0);
+}
+
+TEST_F(Metrics, Json) {
+    registry_.GetCounter("a_total")->Add(3);
+    registry_.GetGauge("b")->Set(-2);
+    LatencyHistogram* histogram = registry_.GetHistogram("c_seconds");
+    histogram->Record(absl::Microseconds(10));
+    histogram->Record(absl::Microseconds(30));
+
+    auto json = nlohmann::json::parse(registry_.ToJson());
+    EXPECT_EQ(json["a_total"], 3);
+    EXPECT_EQ(json["b"], -2);
+    EXPECT_EQ(json["c_seconds"]["count"], 2);
+    EXPECT_EQ(json["c_seconds"]["min_ns"], 10000);
+    EXPECT_EQ(json["c_seconds"]["mean_ns"], 20000);
+}
+
+TEST_F(Metrics, Prometheus) {
+    registry_.GetCounter("a_total", "Some help.")->Add(3);
+    registry_.GetGauge("b")->Set(7);
+    LatencyHistogram* histogram = registry_.GetHistogram("c_seconds");
+    histogram->Record(absl::Microseconds(10));
+    histogram->Record(absl::Milliseconds(1));
+
+    std::string text = registry_.ToPrometheus();
+    EXPECT_THAT(text, HasSubstr("# HELP a_total Some help.\n"
+                                "# TYPE a_total counter\n"
+                                "a_total 3\n"));
+    EXPECT_THAT(text, HasSubstr("# TYPE b gauge\nb 7\n"));
+    EXPECT_THAT(text, HasSubstr("# TYPE c_seconds histogram\n"));
+    EXPECT_THAT(text, HasSubstr("c_seconds_bucket{le=\"+Inf\"} 2\n"));
+    EXPECT_THAT(text, HasSubstr("c_seconds_sum 0.00101\n"));
+    EXPECT_THAT(text, HasSubstr("c_seconds_count 2\n"));
+
+    registry_.Reset();
+    EXPECT_THAT(registry_.ToPrometheus(), HasSubstr("a_total 0\n"));
+}
+
+TEST_F(Metrics, PrometheusStableBuckets) {
+    registry_.GetCounter("d_total", "Line one\\two\nthree.");
+    LatencyHistogram* histogram = registry_.GetHistogram("e_seconds");
+    const std::string empty = registry_.ToPrometheus();
+    EXPECT_THAT(empty,
+                HasSubstr("# HELP d_total Line one\\\\two\\nthree.\n"));
+    // The bucket of every power of two is listed, empty or not.
+    EXPECT_THAT(empty, HasSubstr("e_seconds_bucket{le=\"1.5e-08\"} 0\n"));
+
+    histogram->Record(absl::Microseconds(10));
+    const std::string recorded = registry_.ToPrometheus();
+    auto count_buckets = [](const std::string& text) {
+        int count = 0;
+        for (size_t pos = text.find("_bucket{"); pos != std::string::npos;
+             pos = text.find("_bucket{", pos + 1)) {
+            count++;
+        }
+        return count;
+    };
+    EXPECT_EQ(count_buckets(recorded), count_buckets(empty));
+    EXPECT_THAT(recorded,
+                HasSubstr("e_seconds_bucket{le=\"1.6383e-05\"} 1\n"));
+}
+
+}  // namespace
+}  // namespace utils
@@ -0,0 +1,162 @@
+#ifndef TOOLBASE_UTILS_MPMC_QUEUE_H_
+#define TOOLBASE_UTILS_MPMC_QUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+
+#include "absl/base/optimization.h"
+
+namespace utils {
+
+// A bounded lock-free queue for any number of producers and consumers
+// (Dmitry Vyukov's design). Each slot carries a sequence number telling
+// whether it is free or full for the current lap, so producers and
+// consumers only contend on their own position counter.
+// Example:
+//  MpmcQueue<Task> queue(1024);
+//  if (!queue.TryPush(std::move(task))) { ... full ... }
+//  Task task;
+//  if (queue.TryPop(task)) { ... }
+template <typename T>
+class MpmcQueue {
+   public:
+    // `capacity` is rounded up to a power of two.
+    explicit MpmcQueue(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) {
+            size *= 2;
+        }
+        mask_ = size - 1;
+        cells_ = std::make_unique<Cell[]>(size);
+        for (size_t i = 0; i < size; i++) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ~MpmcQueue() {
+        T item;
+        while (TryPop(item)) {
+        }
+    }
+
+    MpmcQueue(const MpmcQueue&) = delete;
+    MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+    // Returns false if the queue is full, `item` is then left untouched.
+    bool TryPush(T&& item) { return TryPushBatch(&item, 1) == 1; }
+    bool TryPush(const T& item) {
+        T copy(item);
+        return TryPush(std::move(copy));
+    }
+
+    // Returns false if the queue is empty.
+    bool TryPop(T& item) { return TryPopBatch(&item, 1) == 1; }
+
+    // Moves up to `count` items from `items` into the queue with a single
+    // update of the shared position, returns the number pushed.
+    size_t TryPushBatch(T* items, size_t count) {
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        size_t n;
+        while (true) {
+            n = ReadySlots(pos, count, 0);
+            if (n == 0) {
+                if (Lag(pos, 0) < 0) {
+                    return 0;
+                }
+                // Another producer took the slot, retry at the new
+                // position.
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+                continue;
+            }
+            if (enqueue_pos_.compare_exchange_weak(
+                    pos, pos + n, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        // The claimed slots are ours until their sequence is published.
+        for (size_t i = 0; i < n; i++) {
+            Cell& cell = cells_[(pos + i) & mask_];
+            new (cell.storage) T(std::move(items[i]));
+            cell.sequence.store(pos + i + 1, std::memory_order_release);
+        }
+        return n;
+    }
+
+    // Moves up to `count` items into `items`, returns the number popped.
+    size_t TryPopBatch(T* items, size_t count) {
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        size_t n;
+        while (true) {
+            n = ReadySlots(pos, count, 1);
+            if (n == 0) {
+                if (Lag(pos, 1) < 0) {
+                    return 0;
+                }
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+                continue;
+            }
+            if (dequeue_pos_.compare_exchange_weak(
+                    pos, pos + n, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        for (size_t i = 0; i < n; i++) {
+            Cell& cell = cells_[(pos + i) & mask_];
+            T* item = reinterpret_cast<T*>(cell.storage);
+            items[i] = std::move(*item);
+            item->~T();
+            cell.sequence.store(pos + i + mask_ + 1,
+                                std::memory_order_release);
+        }
+        return n;
+    }
+
+    // Approximate when called concurrently with pushes or pops.
+    size_t size() const {
+        size_t dequeue = dequeue_pos_.load(std::memory_order_acquire);
+        size_t enqueue = enqueue_pos_.load(std::memory_order_acquire);
+        return enqueue > dequeue ? enqueue - dequeue : 0;
+    }
+    bool empty() const { return size() == 0; }
+    size_t capacity() const { return mask_ + 1; }
+
+   private:
+    struct Cell {
+        // For slot `pos` of the current lap: `pos` when free, `pos` + 1 when
+        // full.
+        std::atomic<size_t> sequence;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    // Difference between the sequence of the slot at `pos` and the one
+    // meaning ready: negative if the slot is a lap behind (the queue is full
+    // for producers, empty for consumers), positive if another thread
+    // already took it.
+    intptr_t Lag(size_t pos, size_t ready) const {
+        size_t sequence =
+            cells_[pos & mask_].sequence.load(std::memory_order_acquire);
+        return static_cast<intptr_t>(sequence - (pos + ready));
+    }
+
+    // Returns how many consecutive slots from `pos` are ready, up to
+    // `count`.
+    size_t ReadySlots(size_t pos, size_t count, size_t ready) const {
+        size_t n = 0;
+        while (n < count && n <= mask_ && Lag(pos + n, ready) == 0) {
+            n++;
+        }
+        return n;
+    }
+
+    size_t mask_;
+    std::unique_ptr<Cell[]> cells_;
+    alignas(ABSL_CACHELINE_SIZE) std::atomic<size_t> enqueue_pos_{0};
+    alignas(ABSL_CACHELINE_SIZE) std::atomic<size_t> dequeue_pos_{0};
+};
+
+}  // namespace utils
+
+#endif  // TOOLBASE_UTILS_MPMC_QUEUE_H_
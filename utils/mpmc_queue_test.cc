@@ -0,0 +1,111 @@
+#include "utils/mpmc_queue.h"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace utils {
+namespace {
+
+TEST(MpmcQueue, PushPop) {
+    MpmcQueue<std::unique_ptr<int>> queue(3);
+    EXPECT_EQ(queue.capacity(), 4);
+    EXPECT_TRUE(queue.empty());
+    for (int i = 0; i < 4; i++) {
+        EXPECT_TRUE(queue.TryPush(std::make_unique<int>(i)));
+    }
+    auto extra = std::make_unique<int>(4);
+    EXPECT_FALSE(queue.TryPush(std::move(extra)));
+    // Left untouched on failure.
+    ASSERT_NE(extra, nullptr);
+    EXPECT_EQ(queue.size(), 4);
+
+    std::unique_ptr<int> item;
+    for (int i = 0; i < 4; i++) {
+        ASSERT_TRUE(queue.TryPop(item));
+        EXPECT_EQ(*item, i);
+    }
+    EXPECT_FALSE(queue.TryPop(item));
+}
+
+TEST(MpmcQueue, Batch) {
+    MpmcQueue<int> queue(8);
+    int in[10] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+    EXPECT_EQ(queue.TryPushBatch(in, 5), 5);
+    EXPECT_EQ(queue.TryPushBatch(in + 5, 5), 3);
+
+    int out[10];
+    EXPECT_EQ(queue.TryPopBatch(out, 6), 6);
+    EXPECT_EQ(queue.TryPopBatch(out + 6, 6), 2);
+    for (int i = 0; i < 8; i++) {
+        EXPECT_EQ(out[i], i);
+    }
+    EXPECT_EQ(queue.TryPopBatch(out, 6), 0);
+    // Wraps around.
+    EXPECT_EQ(queue.TryPushBatch(in, 7), 7);
+    EXPECT_EQ(queue.TryPopBatch(out, 10), 7);
+    EXPECT_EQ(out[6], 6);
+}
+
+TEST(MpmcQueue, DestroysQueuedItems) {
+    auto item = std::make_shared<int>(0);
+    {
+        MpmcQueue<std::shared_ptr<int>> queue(4);
+        queue.TryPush(item);
+        queue.TryPush(item);
+        EXPECT_EQ(item.use_count(), 3);
+    }
+    EXPECT_EQ(item.use_count(), 1);
+}
+
+TEST(MpmcQueue, Concurrent) {
+    constexpr int kThreads = 4;
+    constexpr int kItemsPerThread = 20000;
+    MpmcQueue<int> queue(64);
+    std::vector<std::thread> threads;
+    std::vector<int64_t> sums(kThreads);
+    for (int t = 0; t < kThreads; t++) {
+        threads.emplace_back([&, t]() {
+            int batch[4];
+            for (int i = 0; i < kItemsPerThread; i += 4) {
+                for (int j = 0; j < 4; j++) {
+                    batch[j] = i + j;
+                }
+                for (size_t done = 0; done < 4;) {
+                    size_t n = queue.TryPushBatch(batch + done, 4 - done);
+                    if (n == 0) {
+                        std::this_thread::yield();
+                    }
+                    done += n;
+                }
+            }
+        });
+        threads.emplace_back([&, t]() {
+            int item;
+            for (int i = 0; i < kItemsPerThread;) {
+                if (i % 2 == 0 ? queue.TryPopBatch(&item, 1) == 1
+                               : queue.TryPop(item)) {
+                    sums[t] += item;
+                    i++;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    int64_t sum = 0;
+    for (int64_t s : sums) {
+        sum += s;
+    }
+    EXPECT_EQ(sum, int64_t{kThreads} * kItemsPerThread *
+                       (kItemsPerThread - 1) / 2);
+    EXPECT_TRUE(queue.empty());
+}
+
+}  // namespace
+}  // namespace utils
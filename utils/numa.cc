@@ -0,0 +1,247 @@
+#include "utils/numa.h"
+
+#include <dirent.h>
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "absl/strings/ascii.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/strip.h"
+#include "utils/errno_status.h"
+#include "utils/status_macros.h"
+
+namespace utils {
+namespace {
+
+constexpr int kBitsPerWord = 8 * sizeof(unsigned long);
+
+// A node mask for the memory policy syscalls.
+struct NodeMask {
+    unsigned long words[Numa::kMaxNodes / kBitsPerWord] = {};
+
+    // The kernel reads one bit less than told.
+    static constexpr unsigned long kMaxNode = Numa::kMaxNodes + 1;
+};
+
+absl::StatusOr<NodeMask> MaskOf(int node) {
+    if (node < 0 || node >= Numa::kMaxNodes) {
+        return absl::InvalidArgumentError(
+            absl::StrFormat("invalid NUMA node %d", node));
+    }
+    NodeMask mask;
+    mask.words[node / kBitsPerWord] |= 1UL << (node % kBitsPerWord);
+    return mask;
+}
+
+absl::Status PinThread(const std::vector<int>& cpus) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        if (cpu < 0 || cpu >= CPU_SETSIZE) {
+            return absl::InvalidArgumentError(
+                absl::StrFormat("invalid cpu %d", cpu));
+        }
+        CPU_SET(cpu, &set);
+    }
+    // Returns the error number instead of setting errno.
+    int ret = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (ret != 0) {
+        return ErrnoToStatus(ret);
+    }
+    return absl::OkStatus();
+}
+
+}  // namespace
+
+absl::StatusOr<std::vector<int>> ParseCpuList(absl::string_view list) {
+    std::vector<int> cpus;
+    for (absl::string_view range :
+         absl::StrSplit(absl::StripAsciiWhitespace(list), ',',
+                        absl::SkipEmpty())) {
+        std::vector<absl::string_view> bounds = absl::StrSplit(range, '-');
+        int first;
+        int last;
+        if (bounds.size() > 2 || !absl::SimpleAtoi(bounds[0], &first) ||
+            !absl::SimpleAtoi(bounds.back(), &last) || first < 0 ||
+            last < first) {
+            return absl::InvalidArgumentError(
+                absl::StrFormat("invalid cpu list \"%s\"", list));
+        }
+        for (int cpu = first; cpu <= last; cpu++) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+absl::StatusOr<std::vector<int>> AllowedCpus() {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) {
+        return ErrnoToStatus(errno);
+    }
+    std::vector<int> cpus;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &set)) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+Numa::Numa(std::vector<NumaNode> nodes) : nodes_(std::move(nodes)) {
+    for (const auto& node : nodes_) {
+        for (int cpu : node.cpus) {
+            if (cpu >= static_cast<int>(cpu_to_node_.size())) {
+                cpu_to_node_.resize(cpu + 1, -1);
+            }
+            cpu_to_node_[cpu] = node.id;
+        }
+    }
+}
+
+absl::StatusOr<Numa> Numa::Discover(absl::string_view root) {
+    const std::string root_str(root);
+    DIR* dir = opendir(root_str.c_str());
+    if (dir == nullptr) {
+        return ErrnoToStatus(errno);
+    }
+    std::vector<int> ids;
+    while (struct dirent* entry = readdir(dir)) {
+        absl::string_view name = entry->d_name;
+        int id;
+        if (absl::ConsumePrefix(&name, "node") &&
+            absl::SimpleAtoi(name, &id)) {
+            ids.push_back(id);
+        }
+    }
+    closedir(dir);
+    if (ids.empty()) {
+        return absl::NotFoundError(
+            absl::StrFormat("no NUMA node in %s", root));
+    }
+    std::sort(ids.begin(), ids.end());
+
+    std::vector<NumaNode> nodes;
+    for (int id : ids) {
+        const std::string path =
+            absl::StrFormat("%s/node%d/cpulist", root, id);
+        std::ifstream in(path);
+        if (!in) {
+            return absl::NotFoundError(
+                absl::StrFormat("cannot read %s", path));
+        }
+        std::stringstream content;
+        content << in.rdbuf();
+        ASSIGN_OR_RETURN(std::vector<int> cpus, ParseCpuList(content.str()));
+        nodes.push_back(NumaNode{id, std::move(cpus)});
+    }
+    return Numa(std::move(nodes));
+}
+
+const Numa& Numa::Get() {
+    static const Numa* const numa = []() {
+        auto discovered = Discover("/sys/devices/system/node");
+        if (discovered.ok()) {
+            return new Numa(*std::move(discovered));
+        }
+        auto cpus = AllowedCpus();
+        return new Numa(
+            {NumaNode{0, cpus.ok() ? *std::move(cpus) : std::vector<int>()}});
+    }();
+    return *numa;
+}
+
+const NumaNode* Numa::node(int id) const {
+    for (const auto& node : nodes_) {
+        if (node.id == id) {
+            return &node;
+        }
+    }
+    return nullptr;
+}
+
+int Numa::NodeOfCpu(int cpu) const {
+    if (cpu < 0 || cpu >= static_cast<int>(cpu_to_node_.size())) {
+        return -1;
+    }
+    return cpu_to_node_[cpu];
+}
+
+int Numa::CurrentNode() const { return NodeOfCpu(sched_getcpu()); }
+
+absl::Status Numa::PinThreadToCpu(int cpu) { return PinThread({cpu}); }
+
+absl::Status Numa::PinThreadToNode(int id) const {
+    const NumaNode* numa_node = node(id);
+    if (numa_node == nullptr || numa_node->cpus.empty()) {
+        return absl::InvalidArgumentError(
+            absl::StrFormat("no CPU on NUMA node %d", id));
+    }
+    return PinThread(numa_node->cpus);
+}
+
+absl::Status Numa::Apply(const NumaPolicy& policy) const {
+    if (!policy.enabled()) {
+        return absl::OkStatus();
+    }
+    if (policy.pin_threads) {
+        RETURN_IF_ERROR(PinThreadToNode(policy.node));
+    }
+    return PreferNode(policy.node);
+}
+
+absl::Status Numa::PreferNode(int node) {
+    ASSIGN_OR_RETURN(NodeMask mask, MaskOf(node));
+    if (syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask.words,
+                NodeMask::kMaxNode) != 0) {
+        return ErrnoToStatus(errno);
+    }
+    return absl::OkStatus();
+}
+
+absl::Status Numa::ResetMemoryPolicy() {
+    if (syscall(SYS_set_mempolicy, MPOL_DEFAULT, nullptr, 0) != 0) {
+        return ErrnoToStatus(errno);
+    }
+    return absl::OkStatus();
+}
+
+absl::Status Numa::BindMemory(void* addr, size_t length, int node) {
+    ASSIGN_OR_RETURN(NodeMask mask, MaskOf(node));
+    if (syscall(SYS_mbind, addr, length, MPOL_BIND, mask.words,
+                NodeMask::kMaxNode, MPOL_MF_MOVE) != 0) {
+        return ErrnoToStatus(errno);
+    }
+    return absl::OkStatus();
+}
+
+absl::StatusOr<void*> Numa::Allocate(size_t size, int node) {
+    void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED) {
+        return ErrnoToStatus(errno);
+    }
+    // Bound before the first touch, the pages are allocated on the node.
+    absl::Status status = BindMemory(data, size, node);
+    if (!status.ok()) {
+        munmap(data, size);
+        return status;
+    }
+    return data;
+}
+
+void Numa::Free(void* data, size_t size) { munmap(data, size); }
+
+}  // namespace utils
@@ -0,0 +1,108 @@
+#ifndef TOOLBASE_UTILS_NUMA_H_
+#define TOOLBASE_UTILS_NUMA_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+
+namespace utils {
+
+struct NumaNode {
+    int id;
+    std::vector<int> cpus;
+};
+
+// Where a component, e.g. a thread pool or a buffer pool, runs its threads
+// and allocates its memory. The default leaves both to the kernel.
+struct NumaPolicy {
+    // -1 means no placement.
+    int node = -1;
+    // Pins the threads to the CPUs of `node`, else only their memory
+    // prefers the node.
+    bool pin_threads = true;
+
+    static NumaPolicy OnNode(int node) {
+        NumaPolicy policy;
+        policy.node = node;
+        return policy;
+    }
+
+    bool enabled() const { return node >= 0; }
+};
+
+// The NUMA topology of the machine, and the placement of threads and memory
+// on its nodes. Memory touched by a thread of another node costs a remote
+// access on every miss: a loop, its threads and its buffers should stay on
+// one node.
+// Example:
+//  const utils::Numa& numa = utils::Numa::Get();
+//  for (const auto& node : numa.nodes()) {
+//      threads.emplace_back([&numa, id = node.id]() {
+//          numa.Apply(utils::NumaPolicy::OnNode(id)).IgnoreError();
+//          ...
+//      });
+//  }
+class Numa {
+   public:
+    // Node ids up to which the memory policies can be set.
+    static constexpr int kMaxNodes = 1024;
+
+    // The topology of this machine, read once from /sys. A machine without
+    // NUMA, or without /sys, is one node 0 with the CPUs the process may
+    // run on.
+    static const Numa& Get();
+
+    // Reads the topology from `root`, usually "/sys/devices/system/node".
+    static absl::StatusOr<Numa> Discover(absl::string_view root);
+
+    const std::vector<NumaNode>& nodes() const { return nodes_; }
+    int num_nodes() const { return nodes_.size(); }
+    // Returns nullptr for an unknown node.
+    const NumaNode* node(int id) const;
+    // Returns -1 for an unknown CPU.
+    int NodeOfCpu(int cpu) const;
+    // The node of the CPU the calling thread runs on.
+    int CurrentNode() const;
+
+    // Pins the calling thread.
+    static absl::Status PinThreadToCpu(int cpu);
+    absl::Status PinThreadToNode(int node) const;
+
+    // Pins the calling thread as `policy` says, and makes its allocations
+    // prefer the memory of the node.
+    absl::Status Apply(const NumaPolicy& policy) const;
+
+    // Sets the memory policy of the calling thread (set_mempolicy): the
+    // pages it touches first are allocated on `node` while it has memory.
+    static absl::Status PreferNode(int node);
+    // Back to the default policy, allocating on the node of the CPU.
+    static absl::Status ResetMemoryPolicy();
+
+    // Allocates the pages of [addr, addr + length) on `node` (mbind), the
+    // pages already touched are moved. `addr` should be page aligned.
+    static absl::Status BindMemory(void* addr, size_t length, int node);
+
+    // Maps `size` bytes of memory on `node`, to be freed by `Free`.
+    static absl::StatusOr<void*> Allocate(size_t size, int node);
+    static void Free(void* data, size_t size);
+
+   private:
+    explicit Numa(std::vector<NumaNode> nodes);
+
+    std::vector<NumaNode> nodes_;
+    // Indexed by CPU, -1 for the CPUs of no node.
+    std::vector<int> cpu_to_node_;
+};
+
+// Parses a sysfs CPU list, e.g. "0-3,8,10-11".
+absl::StatusOr<std::vector<int>> ParseCpuList(absl::string_view list);
+
+// The CPUs the calling thread may run on (sched_getaffinity), ascending.
+absl::StatusOr<std::vector<int>> AllowedCpus();
+
+}  // namespace utils
+
+#endif  // TOOLBASE_UTILS_NUMA_H_
@@ -0,0 +1,64 @@
+#include <sched.h>
+
+#include <cstdint>
+#include <cstring>
+
+#include "benchmark/benchmark.h"
+#include "utils/numa.h"
+
+namespace utils {
+namespace {
+
+constexpr size_t kBufferSize = 256 << 20;
+
+// Streams through a buffer from a thread pinned to the first node, the
+// buffer on the same node (`range(0)` = 0) or on the next one. Needs two
+// nodes for the remote case, e.g. a dual socket host.
+void BM_BufferThroughput(benchmark::State& state) {
+    const Numa& numa = Numa::Get();
+    const bool remote = state.range(0);
+    if (remote && numa.num_nodes() < 2) {
+        state.SkipWithError("needs two NUMA nodes");
+        return;
+    }
+    const int cpu_node = numa.nodes()[0].id;
+    const int memory_node = numa.nodes()[remote ? 1 : 0].id;
+
+    cpu_set_t old_set;
+    sched_getaffinity(0, sizeof(old_set), &old_set);
+    if (!numa.PinThreadToNode(cpu_node).ok()) {
+        state.SkipWithError("cannot pin the thread");
+        return;
+    }
+    auto buffer = Numa::Allocate(kBufferSize, memory_node);
+    if (!buffer.ok()) {
+        state.SkipWithError("cannot allocate on the node");
+        return;
+    }
+    uint64_t* data = static_cast<uint64_t*>(*buffer);
+    const size_t words = kBufferSize / sizeof(uint64_t);
+    memset(data, 1, kBufferSize);
+
+    for (auto _ : state) {
+        // A read and a write pass, as a loop filling and parsing a buffer.
+        uint64_t sum = 0;
+        for (size_t i = 0; i < words; i++) {
+            sum += data[i];
+        }
+        benchmark::DoNotOptimize(sum);
+        memset(data, static_cast<int>(sum), kBufferSize);
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * 2 * kBufferSize);
+
+    Numa::Free(*buffer, kBufferSize);
+    sched_setaffinity(0, sizeof(old_set), &old_set);
+}
+BENCHMARK(BM_BufferThroughput)
+    ->ArgName("remote")
+    ->Arg(0)
+    ->Arg(1)
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
+}  // namespace utils
@@ -0,0 +1,94 @@
+#include "utils/numa.h"
+
+#include <sched.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "utils/testing.h"
+
+namespace utils {
+namespace {
+
+using ::testing::ElementsAre;
+using ::utils::testing::IsOkAndHolds;
+using ::utils::testing::StatusIs;
+
+TEST(ParseCpuList, ParseCpuList) {
+    EXPECT_THAT(ParseCpuList("0-3,8,10-11\n"),
+                IsOkAndHolds(ElementsAre(0, 1, 2, 3, 8, 10, 11)));
+    EXPECT_THAT(ParseCpuList("5"), IsOkAndHolds(ElementsAre(5)));
+    // A node without CPU.
+    EXPECT_THAT(ParseCpuList("\n"), IsOkAndHolds(ElementsAre()));
+    EXPECT_THAT(ParseCpuList("3-1"),
+                StatusIs(absl::StatusCode::kInvalidArgument));
+    EXPECT_THAT(ParseCpuList("a"),
+                StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST(AllowedCpus, AllowedCpus) {
+    auto cpus = AllowedCpus();
+    ASSERT_OK(cpus);
+    cpu_set_t set;
+    ASSERT_EQ(sched_getaffinity(0, sizeof(set), &set), 0);
+    EXPECT_EQ(cpus->size(), static_cast<size_t>(CPU_COUNT(&set)));
+    EXPECT_TRUE(std::is_sorted(cpus->begin(), cpus->end()));
+}
+
+TEST(Numa, Discover) {
+    // A dual socket machine, with a memory only node.
+    const std::string root = "/tmp/test_numa_sysfs";
+    const char* lists[] = {"0-1,4-5\n", "2-3,6-7\n", "\n"};
+    mkdir(root.c_str(), 0755);
+    for (int i = 0; i < 3; i++) {
+        const std::string dir = root + "/node" + std::to_string(i);
+        mkdir(dir.c_str(), 0755);
+        std::ofstream(dir + "/cpulist") << lists[i];
+    }
+    mkdir((root + "/power").c_str(), 0755);
+
+    auto numa = Numa::Discover(root);
+    ASSERT_OK(numa);
+    ASSERT_EQ(numa->num_nodes(), 3);
+    EXPECT_THAT(numa->nodes()[1].cpus, ElementsAre(2, 3, 6, 7));
+    EXPECT_EQ(numa->NodeOfCpu(5), 0);
+    EXPECT_EQ(numa->NodeOfCpu(6), 1);
+    EXPECT_EQ(numa->NodeOfCpu(8), -1);
+    EXPECT_NE(numa->node(2), nullptr);
+    EXPECT_EQ(numa->node(3), nullptr);
+    EXPECT_THAT(numa->PinThreadToNode(2),
+                StatusIs(absl::StatusCode::kInvalidArgument));
+
+    EXPECT_THAT(Numa::Discover("/notexists"),
+                StatusIs(absl::StatusCode::kNotFound));
+}
+
+TEST(Numa, PinAndAllocate) {
+    const Numa& numa = Numa::Get();
+    ASSERT_GE(numa.num_nodes(), 1);
+    const int node = numa.nodes()[0].id;
+
+    cpu_set_t old_set;
+    ASSERT_EQ(sched_getaffinity(0, sizeof(old_set), &old_set), 0);
+    ASSERT_OK(numa.Apply(NumaPolicy::OnNode(node)));
+    EXPECT_EQ(numa.CurrentNode(), node);
+    EXPECT_OK(Numa::ResetMemoryPolicy());
+    ASSERT_EQ(sched_setaffinity(0, sizeof(old_set), &old_set), 0);
+
+    auto data = Numa::Allocate(1 << 20, node);
+    ASSERT_OK(data);
+    memset(*data, 'x', 1 << 20);
+    Numa::Free(*data, 1 << 20);
+
+    EXPECT_THAT(Numa::Allocate(1 << 20, Numa::kMaxNodes),
+                StatusIs(absl::StatusCode::kInvalidArgument));
+    // No placement.
+    EXPECT_OK(numa.Apply(NumaPolicy()));
+}
+
+}  // namespace
+}  // namespace utils
@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <deque>
+#include <thread>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "benchmark/benchmark.h"
+#include "utils/blocking_queue.h"
+#include "utils/mpmc_queue.h"
+#include "utils/spsc_ring.h"
+
+namespace utils {
+namespace {
+
+constexpr int kItems = 1 << 20;
+
+// A mutex and condition queue, as the baseline.
+class MutexQueue {
+   public:
+    explicit MutexQueue(size_t capacity) : capacity_(capacity) {}
+
+    void Push(int item) {
+        absl::MutexLock lock(&mu_);
+        auto not_full = [this]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+            return queue_.size() < capacity_;
+        };
+        mu_.Await(absl::Condition(&not_full));
+        queue_.push_back(item);
+    }
+
+    int Pop() {
+        absl::MutexLock lock(&mu_);
+        auto not_empty = [this]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+            return !queue_.empty();
+        };
+        mu_.Await(absl::Condition(&not_empty));
+        int item = queue_.front();
+        queue_.pop_front();
+        return item;
+    }
+
+   private:
+    const size_t capacity_;
+    absl::Mutex mu_;
+    std::deque<int> queue_ ABSL_GUARDED_BY(mu_);
+};
+
+// Hands `kItems` over from `range(0)` producers to as many consumers.
+void BM_MutexQueue(benchmark::State& state) {
+    const int num_threads = state.range(0);
+    for (auto _ : state) {
+        MutexQueue queue(1024);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < num_threads; t++) {
+            threads.emplace_back([&]() {
+                for (int i = 0; i < kItems / num_threads; i++) {
+                    queue.Push(i);
+                }
+            });
+            threads.emplace_back([&]() {
+                for (int i = 0; i < kItems / num_threads; i++) {
+                    benchmark::DoNotOptimize(queue.Pop());
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kItems);
+}
+BENCHMARK(BM_MutexQueue)->RangeMultiplier(2)->Range(1, 8)->UseRealTime();
+
+void BM_BlockingQueue(benchmark::State& state) {
+    const int num_threads = state.range(0);
+    for (auto _ : state) {
+        BlockingQueue<int> queue(1024);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < num_threads; t++) {
+            threads.emplace_back([&]() {
+                for (int i = 0; i < kItems / num_threads; i++) {
+                    queue.Push(i);
+                }
+            });
+            threads.emplace_back([&]() {
+                int item;
+                for (int i = 0; i < kItems / num_threads; i++) {
+                    queue.Pop(item);
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kItems);
+}
+BENCHMARK(BM_BlockingQueue)->RangeMultiplier(2)->Range(1, 8)->UseRealTime();
+
+// One producer and one consumer, moving `range(0)` items per call.
+template <typename Queue>
+void BM_SpinBatch(benchmark::State& state) {
+    const size_t batch_size = state.range(0);
+    for (auto _ : state) {
+        Queue queue(1024);
+        std::thread producer([&]() {
+            std::vector<int> batch(batch_size);
+            for (int i = 0; i < kItems;) {
+                size_t n = queue.TryPushBatch(
+                    batch.data(), std::min<size_t>(batch_size, kItems - i));
+                if (n == 0) {
+                    std::this_thread::yield();
+                }
+                i += n;
+            }
+        });
+        std::vector<int> batch(batch_size);
+        for (int i = 0; i < kItems;) {
+            size_t n = queue.TryPopBatch(batch.data(), batch_size);
+            if (n == 0) {
+                std::this_thread::yield();
+            }
+            i += n;
+        }
+        producer.join();
+    }
+    state.SetItemsProcessed(state.iterations() * kItems);
+}
+BENCHMARK_TEMPLATE(BM_SpinBatch, MpmcQueue<int>)
+    ->RangeMultiplier(4)
+    ->Range(1, 64)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_SpinBatch, SpscRing<int>)
+    ->RangeMultiplier(4)
+    ->Range(1, 64)
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace utils
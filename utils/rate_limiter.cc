@@ -0,0 +1,213 @@
+#include "utils/rate_limiter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "absl/time/clock.h"
+#include "utils/metrics.h"
+
+namespace utils {
+namespace {
+
+Counter* const throttled_total = MetricsRegistry::Global().GetCounter(
+    "rate_limiter_throttled_total",
+    "Operations delayed or refused by a RateLimiter.");
+LatencyHistogram* const throttle_latency =
+    MetricsRegistry::Global().GetHistogram(
+        "rate_limiter_wait_seconds",
+        "Time operations delayed by a RateLimiter waited.");
+
+}  // namespace
+
+TokenBucket::TokenBucket(double rate, double burst)
+    : rate_(rate),
+      ns_per_token_(1e9 / rate),
+      burst_ns_(static_cast<int64_t>(burst * 1e9 / rate)) {}
+
+bool TokenBucket::TryTake(double tokens, int64_t now_ns) {
+    const int64_t cost = std::llround(tokens * ns_per_token_);
+    int64_t full_at = full_at_ns_.load(std::memory_order_relaxed);
+    while (true) {
+        const int64_t base = std::max(full_at, now_ns);
+        if (full_at > now_ns && base + cost - now_ns > burst_ns_) {
+            return false;
+        }
+        if (full_at_ns_.compare_exchange_weak(full_at, base + cost,
+                                              std::memory_order_relaxed)) {
+            return true;
+        }
+    }
+}
+
+int64_t TokenBucket::Take(double tokens, int64_t now_ns) {
+    const int64_t cost = std::llround(tokens * ns_per_token_);
+    int64_t full_at = full_at_ns_.load(std::memory_order_relaxed);
+    while (true) {
+        const int64_t next = std::max(full_at, now_ns) + cost;
+        if (full_at_ns_.compare_exchange_weak(full_at, next,
+                                              std::memory_order_relaxed)) {
+            return std::max<int64_t>(0, next - now_ns - burst_ns_);
+        }
+    }
+}
+
+void TokenBucket::Refund(double tokens) {
+    full_at_ns_.fetch_sub(std::llround(tokens * ns_per_token_),
+                          std::memory_order_relaxed);
+}
+
+double TokenBucket::Available(int64_t now_ns) const {
+    const int64_t full_at = full_at_ns_.load(std::memory_order_relaxed);
+    const int64_t deficit = std::max<int64_t>(0, full_at - now_ns);
+    return std::max<int64_t>(0, burst_ns_ - deficit) / ns_per_token_;
+}
+
+int64_t TokenBucket::TimeUntilAvailable(double tokens, int64_t now_ns) const {
+    const int64_t full_at = full_at_ns_.load(std::memory_order_relaxed);
+    const int64_t cost = std::llround(tokens * ns_per_token_);
+    return std::max<int64_t>(
+        0, std::max(full_at, now_ns) + cost - burst_ns_ - now_ns);
+}
+
+RateLimiter::RateLimiter(const Options& options, RateLimiter* parent)
+    : parent_(parent) {
+    const double burst_seconds = absl::ToDoubleSeconds(options.burst);
+    // The burst holds at least one operation, or some would never pass.
+    if (options.bytes_per_second > 0) {
+        bytes_ = std::make_unique<TokenBucket>(
+            options.bytes_per_second,
+            std::max(1.0, options.bytes_per_second * burst_seconds));
+    }
+    if (options.ops_per_second > 0) {
+        ops_ = std::make_unique<TokenBucket>(
+            options.ops_per_second,
+            std::max(1.0, options.ops_per_second * burst_seconds));
+    }
+}
+
+int64_t RateLimiter::Take(size_t bytes, int64_t now_ns) {
+    ops_count_.fetch_add(1, std::memory_order_relaxed);
+    bytes_count_.fetch_add(bytes, std::memory_order_relaxed);
+    int64_t wait_ns = 0;
+    if (bytes_ != nullptr && bytes > 0) {
+        wait_ns = std::max(wait_ns, bytes_->Take(bytes, now_ns));
+    }
+    if (ops_ != nullptr) {
+        wait_ns = std::max(wait_ns, ops_->Take(1, now_ns));
+    }
+    if (parent_ != nullptr) {
+        wait_ns = std::max(wait_ns, parent_->Take(bytes, now_ns));
+    }
+    return wait_ns;
+}
+
+bool RateLimiter::TryTake(size_t bytes, int64_t now_ns) {
+    if (bytes_ != nullptr && bytes > 0 && !bytes_->TryTake(bytes, now_ns)) {
+        return false;
+    }
+    if (ops_ != nullptr && !ops_->TryTake(1, now_ns)) {
+        if (bytes_ != nullptr && bytes > 0) {
+            bytes_->Refund(bytes);
+        }
+        return false;
+    }
+    if (parent_ != nullptr && !parent_->TryTake(bytes, now_ns)) {
+        Refund(bytes);
+        return false;
+    }
+    ops_count_.fetch_add(1, std::memory_order_relaxed);
+    bytes_count_.fetch_add(bytes, std::memory_order_relaxed);
+    return true;
+}
+
+void RateLimiter::Refund(size_t bytes) {
+    if (bytes_ != nullptr && bytes > 0) {
+        bytes_->Refund(bytes);
+    }
+    if (ops_ != nullptr) {
+        ops_->Refund(1);
+    }
+}
+
+void RateLimiter::Acquire(size_t bytes) {
+    absl::Duration wait = Reserve(bytes);
+    if (wait > absl::ZeroDuration()) {
+        absl::SleepFor(wait);
+    }
+}
+
+bool RateLimiter::TryAcquire(size_t bytes) {
+    if (TryTake(bytes, absl::GetCurrentTimeNanos())) {
+        return true;
+    }
+    RecordThrottled(absl::ZeroDuration());
+    return false;
+}
+
+absl::Duration RateLimiter::Reserve(size_t bytes) {
+    absl::Duration wait =
+        absl::Nanoseconds(Take(bytes, absl::GetCurrentTimeNanos()));
+    if (wait > absl::ZeroDuration()) {
+        RecordThrottled(wait);
+    }
+    return wait;
+}
+
+size_t RateLimiter::AvailableBytes() const {
+    const int64_t now_ns = absl::GetCurrentTimeNanos();
+    size_t available = std::numeric_limits<size_t>::max();
+    for (const RateLimiter* limiter = this; limiter != nullptr;
+         limiter = limiter->parent_) {
+        if (limiter->ops_ != nullptr && limiter->ops_->Available(now_ns) < 1) {
+            return 0;
+        }
+        if (limiter->bytes_ != nullptr) {
+            available = std::min<size_t>(
+                available, limiter->bytes_->Available(now_ns));
+        }
+    }
+    return available;
+}
+
+absl::Duration RateLimiter::TimeUntilAvailable() const {
+    const int64_t now_ns = absl::GetCurrentTimeNanos();
+    int64_t wait_ns = 0;
+    for (const RateLimiter* limiter = this; limiter != nullptr;
+         limiter = limiter->parent_) {
+        if (limiter->ops_ != nullptr) {
+            wait_ns = std::max(wait_ns,
+                               limiter->ops_->TimeUntilAvailable(1, now_ns));
+        }
+        if (limiter->bytes_ != nullptr) {
+            wait_ns = std::max(
+                wait_ns, limiter->bytes_->TimeUntilAvailable(1, now_ns));
+        }
+    }
+    return absl::Nanoseconds(wait_ns);
+}
+
+void RateLimiter::RecordThrottled(absl::Duration waited) {
+    throttled_total->Increment();
+    if (waited > absl::ZeroDuration()) {
+        throttle_latency->Record(waited);
+    }
+    const int64_t waited_ns = absl::ToInt64Nanoseconds(waited);
+    for (RateLimiter* limiter = this; limiter != nullptr;
+         limiter = limiter->parent_) {
+        limiter->throttled_ops_.fetch_add(1, std::memory_order_relaxed);
+        limiter->throttled_ns_.fetch_add(waited_ns, std::memory_order_relaxed);
+    }
+}
+
+RateLimiter::Stats RateLimiter::GetStats() const {
+    Stats stats;
+    stats.ops = ops_count_.load(std::memory_order_relaxed);
+    stats.bytes = bytes_count_.load(std::memory_order_relaxed);
+    stats.throttled_ops = throttled_ops_.load(std::memory_order_relaxed);
+    stats.throttled_time =
+        absl::Nanoseconds(throttled_ns_.load(std::memory_order_relaxed));
+    return stats;
+}
+
+}  // namespace utils
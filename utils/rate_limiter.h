@@ -0,0 +1,135 @@
+#ifndef TOOLBASE_UTILS_RATE_LIMITER_H_
+#define TOOLBASE_UTILS_RATE_LIMITER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "absl/time/time.h"
+
+namespace utils {
+
+// A token bucket of `rate` tokens per second holding up to `burst` tokens.
+// The bucket is refilled lazily from the clock: its whole state is the
+// time at which it would be full again (the "theoretical arrival time" of
+// GCRA), so taking tokens is a CAS, with no lock and no refill thread.
+// Thread-safe.
+class TokenBucket {
+   public:
+    TokenBucket(double rate, double burst);
+
+    TokenBucket(const TokenBucket&) = delete;
+    TokenBucket& operator=(const TokenBucket&) = delete;
+
+    // Takes `tokens` if available at `now_ns`. A full bucket gives more
+    // than `burst` tokens at once, going in debt, so that an operation
+    // larger than the burst is not refused forever.
+    bool TryTake(double tokens, int64_t now_ns);
+    // Takes `tokens` even if not available, the bucket goes in debt.
+    // Returns the nanoseconds until the debt is paid, i.e. how long the
+    // caller should wait before using the tokens.
+    int64_t Take(double tokens, int64_t now_ns);
+    // Returns tokens taken but not used.
+    void Refund(double tokens);
+
+    // Tokens available at `now_ns`, 0 when in debt.
+    double Available(int64_t now_ns) const;
+    // Nanoseconds from `now_ns` until `tokens` are available.
+    int64_t TimeUntilAvailable(double tokens, int64_t now_ns) const;
+
+    double rate() const { return rate_; }
+
+   private:
+    const double rate_;
+    const double ns_per_token_;
+    // The time the burst takes to refill.
+    const int64_t burst_ns_;
+    // The bucket is full at `full_at_ns_` and holds
+    // (now - full_at_ns_ + burst_ns_) / ns_per_token_ tokens before.
+    std::atomic<int64_t> full_at_ns_{0};
+};
+
+// Caps the bandwidth and the IOPS of a class of IO, e.g. compactions or
+// backups, so that bulk work does not take the disk or the network from
+// the latency sensitive traffic. Limiters form a hierarchy: an operation
+// takes from its limiter and from all its ancestors, e.g. a parent capping
+// the disk and a child per class. Thread-safe, the limits are lock-free
+// token buckets.
+// Example:
+//  utils::RateLimiter::Options options;
+//  options.bytes_per_second = 400 << 20;
+//  utils::RateLimiter disk(options);
+//  options.bytes_per_second = 100 << 20;
+//  options.ops_per_second = 1000;
+//  utils::RateLimiter compaction(options, &disk);
+//  file->set_rate_limiter(&compaction);
+class RateLimiter {
+   public:
+    struct Options {
+        // 0 means no limit.
+        double bytes_per_second = 0;
+        double ops_per_second = 0;
+        // The time of traffic at full rate which may go at once after the
+        // limiter was idle.
+        absl::Duration burst = absl::Milliseconds(100);
+    };
+
+    // Counts the operations of the limiter and of its descendants.
+    struct Stats {
+        int64_t ops = 0;
+        int64_t bytes = 0;
+        // Operations delayed or refused by this limiter or an ancestor, and
+        // the time the delayed ones waited.
+        int64_t throttled_ops = 0;
+        absl::Duration throttled_time;
+    };
+
+    // `parent` (not owned, nullptr for a root) should outlive the object.
+    explicit RateLimiter(const Options& options,
+                         RateLimiter* parent = nullptr);
+
+    RateLimiter(const RateLimiter&) = delete;
+    RateLimiter& operator=(const RateLimiter&) = delete;
+
+    // Blocks until an operation of `bytes` may proceed.
+    void Acquire(size_t bytes);
+    // Admits an operation of `bytes` only if it may proceed now.
+    bool TryAcquire(size_t bytes);
+    // Admits an operation of `bytes`, returns how long the caller should
+    // wait before doing it, e.g. on a timer of an event loop.
+    absl::Duration Reserve(size_t bytes);
+
+    // For nonblocking IO, which moves what it can: the bytes an operation
+    // may move now, 0 if it should wait `TimeUntilAvailable`. The operation
+    // then reports what it moved with `Reserve`.
+    size_t AvailableBytes() const;
+    absl::Duration TimeUntilAvailable() const;
+
+    // Counts a throttled operation, for callers of `AvailableBytes`.
+    void RecordThrottled(absl::Duration waited);
+
+    Stats GetStats() const;
+
+    RateLimiter* parent() const { return parent_; }
+
+   private:
+    // Returns the nanoseconds to wait.
+    int64_t Take(size_t bytes, int64_t now_ns);
+    bool TryTake(size_t bytes, int64_t now_ns);
+    void Refund(size_t bytes);
+
+    RateLimiter* const parent_;
+    // nullptr when not limited.
+    std::unique_ptr<TokenBucket> bytes_;
+    std::unique_ptr<TokenBucket> ops_;
+
+    std::atomic<int64_t> ops_count_{0};
+    std::atomic<int64_t> bytes_count_{0};
+    std::atomic<int64_t> throttled_ops_{0};
+    std::atomic<int64_t> throttled_ns_{0};
+};
+
+}  // namespace utils
+
+#endif  // TOOLBASE_UTILS_RATE_LIMITER_H_
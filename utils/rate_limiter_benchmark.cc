@@ -0,0 +1,77 @@
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "utils/rate_limiter.h"
+
+namespace utils {
+namespace {
+
+constexpr int kAcquires = 100000;
+
+RateLimiter::Options FastOptions() {
+    // Never throttles, measures the cost of the accounting.
+    RateLimiter::Options options;
+    options.bytes_per_second = 1e15;
+    options.ops_per_second = 1e12;
+    return options;
+}
+
+// An operation admitted by a child and its parent, the overhead added to
+// every rate limited IO.
+void BM_TryAcquire(benchmark::State& state) {
+    RateLimiter parent(FastOptions());
+    RateLimiter child(FastOptions(), &parent);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(child.TryAcquire(4096));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TryAcquire);
+
+// `kAcquires` from each of `range(0)` threads sharing a parent, the buckets
+// are CAS loops on one cache line each.
+void BM_TryAcquireContended(benchmark::State& state) {
+    const int num_threads = state.range(0);
+    RateLimiter parent(FastOptions());
+    std::vector<std::unique_ptr<RateLimiter>> children;
+    for (int t = 0; t < num_threads; t++) {
+        children.push_back(
+            std::make_unique<RateLimiter>(FastOptions(), &parent));
+    }
+    for (auto _ : state) {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < num_threads; t++) {
+            threads.emplace_back([&, t]() {
+                for (int i = 0; i < kAcquires; i++) {
+                    benchmark::DoNotOptimize(children[t]->TryAcquire(4096));
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * num_threads * kAcquires);
+}
+BENCHMARK(BM_TryAcquireContended)->Arg(1)->Arg(4)->Arg(16)->UseRealTime();
+
+// The accuracy of the pacing: 10MB in 4KB operations at 100MB/s should take
+// 100ms.
+void BM_AcquirePaced(benchmark::State& state) {
+    RateLimiter::Options options;
+    options.bytes_per_second = 100 << 20;
+    options.burst = absl::Milliseconds(1);
+    RateLimiter limiter(options);
+    for (auto _ : state) {
+        for (int i = 0; i < 2560; i++) {
+            limiter.Acquire(4096);
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * (10 << 20));
+}
+BENCHMARK(BM_AcquirePaced)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+}  // namespace
+}  // namespace utils
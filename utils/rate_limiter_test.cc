@@ -0,0 +1,144 @@
+#include "utils/rate_limiter.h"
+
+#include <limits>
+#include <thread>
+#include <vector>
+
+#include "absl/time/clock.h"
+#include "gtest/gtest.h"
+
+namespace utils {
+namespace {
+
+constexpr int64_t kSecond = 1000000000;
+
+TEST(TokenBucket, Refill) {
+    // 100 tokens per second, up to 10.
+    TokenBucket bucket(100, 10);
+    const int64_t start = 100 * kSecond;
+    EXPECT_DOUBLE_EQ(bucket.Available(start), 10);
+    EXPECT_TRUE(bucket.TryTake(10, start));
+    EXPECT_DOUBLE_EQ(bucket.Available(start), 0);
+    EXPECT_FALSE(bucket.TryTake(1, start));
+    EXPECT_EQ(bucket.TimeUntilAvailable(1, start), kSecond / 100);
+
+    // A token every 10ms, never more than the burst.
+    EXPECT_TRUE(bucket.TryTake(5, start + kSecond / 20));
+    EXPECT_FALSE(bucket.TryTake(1, start + kSecond / 20));
+    EXPECT_DOUBLE_EQ(bucket.Available(start + 10 * kSecond), 10);
+
+    bucket.Refund(5);
+    EXPECT_DOUBLE_EQ(bucket.Available(start + kSecond / 20), 5);
+}
+
+TEST(TokenBucket, Debt) {
+    TokenBucket bucket(100, 10);
+    const int64_t start = 100 * kSecond;
+    // A full bucket admits more than the burst.
+    EXPECT_TRUE(bucket.TryTake(20, start));
+    EXPECT_FALSE(bucket.TryTake(1, start + kSecond / 20));
+    EXPECT_EQ(bucket.TimeUntilAvailable(1, start),
+              kSecond / 10 + kSecond / 100);
+
+    // The debt is paid by waiting.
+    EXPECT_EQ(bucket.Take(10, start), kSecond / 5);
+    EXPECT_DOUBLE_EQ(bucket.Available(start + kSecond / 5), 0);
+    EXPECT_DOUBLE_EQ(bucket.Available(start + kSecond / 5 + kSecond / 10),
+                     10);
+}
+
+TEST(RateLimiter, Unlimited) {
+    RateLimiter limiter({});
+    for (int i = 0; i < 1000; i++) {
+        EXPECT_TRUE(limiter.TryAcquire(1 << 20));
+    }
+    EXPECT_EQ(limiter.Reserve(1 << 30), absl::ZeroDuration());
+    EXPECT_EQ(limiter.AvailableBytes(), std::numeric_limits<size_t>::max());
+    RateLimiter::Stats stats = limiter.GetStats();
+    EXPECT_EQ(stats.ops, 1001);
+    EXPECT_EQ(stats.bytes, 1000 * (1 << 20) + (int64_t{1} << 30));
+    EXPECT_EQ(stats.throttled_ops, 0);
+}
+
+TEST(RateLimiter, Bandwidth) {
+    RateLimiter::Options options;
+    options.bytes_per_second = 1 << 20;
+    options.burst = absl::Milliseconds(10);
+    RateLimiter limiter(options);
+
+    const absl::Time start = absl::Now();
+    for (int i = 0; i < 10; i++) {
+        limiter.Acquire(10 << 10);
+    }
+    // 100KB at 1MB/s, less the burst.
+    EXPECT_GE(absl::Now() - start, absl::Milliseconds(80));
+    RateLimiter::Stats stats = limiter.GetStats();
+    EXPECT_EQ(stats.ops, 10);
+    EXPECT_EQ(stats.bytes, 100 << 10);
+    EXPECT_GT(stats.throttled_ops, 0);
+    EXPECT_GT(stats.throttled_time, absl::ZeroDuration());
+}
+
+TEST(RateLimiter, Iops) {
+    RateLimiter::Options options;
+    options.ops_per_second = 10;
+    options.burst = absl::Milliseconds(200);
+    RateLimiter limiter(options);
+    EXPECT_TRUE(limiter.TryAcquire(1 << 30));
+    EXPECT_TRUE(limiter.TryAcquire(1 << 30));
+    EXPECT_FALSE(limiter.TryAcquire(0));
+    EXPECT_EQ(limiter.AvailableBytes(), 0);
+    EXPECT_GT(limiter.TimeUntilAvailable(), absl::Milliseconds(50));
+    EXPECT_EQ(limiter.GetStats().throttled_ops, 1);
+}
+
+TEST(RateLimiter, Hierarchy) {
+    RateLimiter::Options options;
+    // Bursts of 1000 and 600 bytes, refilled slowly enough for the test.
+    options.bytes_per_second = 100;
+    options.burst = absl::Seconds(10);
+    RateLimiter parent(options);
+    options.bytes_per_second = 60;
+    RateLimiter bulk(options, &parent);
+    RateLimiter other(options, &parent);
+
+    EXPECT_EQ(bulk.AvailableBytes(), 600);
+    EXPECT_TRUE(bulk.TryAcquire(500));
+    EXPECT_FALSE(bulk.TryAcquire(200));
+    EXPECT_EQ(other.AvailableBytes(), 500);
+    EXPECT_TRUE(other.TryAcquire(400));
+    // `other` has tokens left but the parent does not, nothing is taken.
+    EXPECT_FALSE(other.TryAcquire(150));
+    EXPECT_EQ(other.AvailableBytes(), 100);
+
+    EXPECT_EQ(parent.GetStats().ops, 2);
+    EXPECT_EQ(parent.GetStats().bytes, 900);
+    EXPECT_EQ(parent.GetStats().throttled_ops, 2);
+    EXPECT_EQ(bulk.GetStats().throttled_ops, 1);
+}
+
+TEST(RateLimiter, Concurrent) {
+    RateLimiter::Options options;
+    options.ops_per_second = 1000;
+    options.burst = absl::Milliseconds(10);
+    RateLimiter limiter(options);
+
+    const absl::Time start = absl::Now();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&]() {
+            for (int i = 0; i < 50; i++) {
+                limiter.Acquire(0);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    // 200 operations at 1000/s, less the burst.
+    EXPECT_GE(absl::Now() - start, absl::Milliseconds(180));
+    EXPECT_EQ(limiter.GetStats().ops, 200);
+}
+
+}  // namespace
+}  // namespace utils
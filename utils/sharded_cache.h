@@ -0,0 +1,320 @@
+#ifndef TOOLBASE_UTILS_SHARDED_CACHE_H_
+#define TOOLBASE_UTILS_SHARDED_CACHE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/base/optimization.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/hash/hash.h"
+#include "absl/synchronization/mutex.h"
+
+namespace utils {
+
+// A concurrent cache, split into shards guarded by their own lock so that
+// threads working on different keys rarely contend. Lookups only take the
+// shard lock in shared mode.
+//
+// Entries are charged with a caller provided size (e.g. the byte size of
+// the value) against the capacity, and evicted with the CLOCK algorithm: a
+// looked up entry gets a second chance, so a scan of one-off keys does not
+// flush the hot ones. Entries referenced by a `Handle` are pinned, they are
+// not evicted until all their handles are released.
+// Example:
+//  ShardedCache<std::string, std::string>::Options options;
+//  options.capacity = 64 << 20;
+//  ShardedCache<std::string, std::string> cache(options);
+//  auto handle = cache.Lookup(path);
+//  if (!handle) {
+//      ASSIGN_OR_RETURN(std::string contents, file::GetContents(path));
+//      size_t charge = contents.size();
+//      handle = cache.Insert(path, std::move(contents), charge);
+//  }
+//  Use(handle.value());
+template <typename K, typename V, typename Hash = absl::Hash<K>,
+          typename Eq = std::equal_to<K>>
+class ShardedCache {
+    struct Entry;
+
+   public:
+    struct Options {
+        // Sum of the charges of the cached entries, split evenly between the
+        // shards.
+        size_t capacity = 1 << 20;
+        // Rounded up to a power of two.
+        int num_shards = 16;
+    };
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t insertions = 0;
+        uint64_t evictions = 0;
+        size_t entries = 0;
+        size_t usage = 0;
+    };
+
+    // A reference to a cached value, which keeps the entry pinned. Empty
+    // handles are returned by failed lookups.
+    class Handle {
+       public:
+        Handle() = default;
+        ~Handle() { Release(); }
+
+        Handle(Handle&& other) : entry_(other.entry_) {
+            other.entry_ = nullptr;
+        }
+        Handle& operator=(Handle&& other) {
+            if (this != &other) {
+                Release();
+                entry_ = other.entry_;
+                other.entry_ = nullptr;
+            }
+            return *this;
+        }
+
+        Handle(const Handle&) = delete;
+        Handle& operator=(const Handle&) = delete;
+
+        explicit operator bool() const { return entry_ != nullptr; }
+        const K& key() const { return entry_->key; }
+        const V& value() const { return entry_->value; }
+        const V& operator*() const { return entry_->value; }
+        const V* operator->() const { return &entry_->value; }
+
+        // Unpins the entry, the handle becomes empty.
+        void Release() {
+            if (entry_ != nullptr) {
+                Unref(entry_);
+                entry_ = nullptr;
+            }
+        }
+
+       private:
+        friend class ShardedCache;
+        explicit Handle(Entry* entry) : entry_(entry) {}
+
+        Entry* entry_ = nullptr;
+    };
+
+    explicit ShardedCache(const Options& options) {
+        int num_shards = 1;
+        while (num_shards < options.num_shards) {
+            num_shards *= 2;
+        }
+        shard_mask_ = num_shards - 1;
+        size_t shard_capacity =
+            (options.capacity + num_shards - 1) / num_shards;
+        shards_ = std::make_unique<Shard[]>(num_shards);
+        for (int i = 0; i < num_shards; i++) {
+            shards_[i].capacity = shard_capacity;
+        }
+    }
+
+    // Values still referenced by handles are deleted on release.
+    ~ShardedCache() { Clear(); }
+
+    ShardedCache(const ShardedCache&) = delete;
+    ShardedCache& operator=(const ShardedCache&) = delete;
+
+    // Inserts or replaces the value of `key`, then evicts unpinned entries
+    // until the shard fits its capacity. Returns a handle to the new entry,
+    // which may be evicted as soon as the handle is released if `charge`
+    // exceeds the capacity.
+    Handle Insert(const K& key, V value, size_t charge = 1) {
+        Entry* entry = new Entry(key, std::move(value), charge);
+        std::vector<Entry*> removed;
+        Shard& shard = ShardOf(key);
+        {
+            absl::MutexLock lock(&shard.mu);
+            auto [it, inserted] = shard.map.try_emplace(entry->key, entry);
+            if (!inserted) {
+                removed.push_back(it->second);
+                shard.Remove(it->second);
+                it->second = entry;
+            }
+            shard.Add(entry);
+            shard.insertions.fetch_add(1, std::memory_order_relaxed);
+            shard.Evict(removed);
+        }
+        for (Entry* e : removed) {
+            Unref(e);
+        }
+        return Handle(entry);
+    }
+
+    // Returns an empty handle if `key` is not cached.
+    Handle Lookup(const K& key) {
+        Shard& shard = ShardOf(key);
+        absl::ReaderMutexLock lock(&shard.mu);
+        auto it = shard.map.find(key);
+        if (it == shard.map.end()) {
+            shard.misses.fetch_add(1, std::memory_order_relaxed);
+            return Handle();
+        }
+        Entry* entry = it->second;
+        entry->refs.fetch_add(1, std::memory_order_relaxed);
+        // Only written if needed, to keep the cache line shared between
+        // readers of a hot entry.
+        if (!entry->referenced.load(std::memory_order_relaxed)) {
+            entry->referenced.store(true, std::memory_order_relaxed);
+        }
+        shard.hits.fetch_add(1, std::memory_order_relaxed);
+        return Handle(entry);
+    }
+
+    // Removes `key`, returns false if it was not cached. The value is
+    // deleted when its last handle is released.
+    bool Erase(const K& key) {
+        Entry* entry;
+        Shard& shard = ShardOf(key);
+        {
+            absl::MutexLock lock(&shard.mu);
+            auto it = shard.map.find(key);
+            if (it == shard.map.end()) {
+                return false;
+            }
+            entry = it->second;
+            shard.map.erase(it);
+            shard.Remove(entry);
+        }
+        Unref(entry);
+        return true;
+    }
+
+    // Removes all the entries.
+    void Clear() {
+        for (size_t i = 0; i <= shard_mask_; i++) {
+            Shard& shard = shards_[i];
+            std::vector<Entry*> removed;
+            {
+                absl::MutexLock lock(&shard.mu);
+                removed.swap(shard.clock);
+                shard.map.clear();
+                shard.hand = 0;
+                shard.usage = 0;
+            }
+            for (Entry* entry : removed) {
+                Unref(entry);
+            }
+        }
+    }
+
+    // Sums the statistics of the shards.
+    Stats GetStats() const {
+        Stats stats;
+        for (size_t i = 0; i <= shard_mask_; i++) {
+            const Shard& shard = shards_[i];
+            absl::ReaderMutexLock lock(&shard.mu);
+            stats.hits += shard.hits.load(std::memory_order_relaxed);
+            stats.misses += shard.misses.load(std::memory_order_relaxed);
+            stats.insertions +=
+                shard.insertions.load(std::memory_order_relaxed);
+            stats.evictions += shard.evictions.load(std::memory_order_relaxed);
+            stats.entries += shard.clock.size();
+            stats.usage += shard.usage;
+        }
+        return stats;
+    }
+
+    int num_shards() const { return shard_mask_ + 1; }
+
+   private:
+    struct Entry {
+        Entry(const K& key, V value, size_t charge)
+            : key(key), value(std::move(value)), charge(charge) {}
+
+        const K key;
+        const V value;
+        const size_t charge;
+        // One reference for the cache, one per handle.
+        std::atomic<uint32_t> refs{2};
+        // CLOCK bit, set by lookups and cleared by the hand.
+        std::atomic<bool> referenced{false};
+        // Position in `Shard::clock`.
+        size_t index = 0;
+    };
+
+    struct alignas(ABSL_CACHELINE_SIZE) Shard {
+        // Appends `entry` to the clock, behind the hand.
+        void Add(Entry* entry) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu) {
+            entry->index = clock.size();
+            clock.push_back(entry);
+            usage += entry->charge;
+        }
+
+        // Removes `entry` from the clock, the last entry takes its slot.
+        void Remove(Entry* entry) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu) {
+            Entry* last = clock.back();
+            clock[entry->index] = last;
+            last->index = entry->index;
+            clock.pop_back();
+            usage -= entry->charge;
+        }
+
+        // Evicts entries into `removed` until `usage` fits the capacity. The
+        // hand sweeps at most twice around the clock, the first sweep may
+        // only clear the referenced bits.
+        void Evict(std::vector<Entry*>& removed)
+            ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu) {
+            for (size_t steps = 2 * clock.size();
+                 usage > capacity && steps > 0 && !clock.empty(); steps--) {
+                if (hand >= clock.size()) {
+                    hand = 0;
+                }
+                Entry* entry = clock[hand];
+                // Handles are only created under the lock, a pinned entry
+                // can only become unpinned meanwhile.
+                if (entry->refs.load(std::memory_order_acquire) > 1) {
+                    hand++;
+                    continue;
+                }
+                if (entry->referenced.load(std::memory_order_relaxed)) {
+                    entry->referenced.store(false, std::memory_order_relaxed);
+                    hand++;
+                    continue;
+                }
+                map.erase(entry->key);
+                Remove(entry);
+                removed.push_back(entry);
+                evictions.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        mutable absl::Mutex mu;
+        absl::flat_hash_map<K, Entry*, Hash, Eq> map ABSL_GUARDED_BY(mu);
+        std::vector<Entry*> clock ABSL_GUARDED_BY(mu);
+        size_t hand ABSL_GUARDED_BY(mu) = 0;
+        size_t usage ABSL_GUARDED_BY(mu) = 0;
+        size_t capacity = 0;
+
+        std::atomic<uint64_t> hits{0};
+        std::atomic<uint64_t> misses{0};
+        std::atomic<uint64_t> insertions{0};
+        std::atomic<uint64_t> evictions{0};
+    };
+
+    static void Unref(Entry* entry) {
+        if (entry->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete entry;
+        }
+    }
+
+    Shard& ShardOf(const K& key) {
+        // The high bits, the low ones select the slot in the shard map.
+        return shards_[(Hash()(key) >> 32) & shard_mask_];
+    }
+
+    size_t shard_mask_;
+    std::unique_ptr<Shard[]> shards_;
+};
+
+}  // namespace utils
+
+#endif  // TOOLBASE_UTILS_SHARDED_CACHE_H_
@@ -0,0 +1,86 @@
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "benchmark/benchmark.h"
+#include "utils/sharded_cache.h"
+
+namespace utils {
+namespace {
+
+constexpr int kNumKeys = 1 << 16;
+
+// Runs `op(i)` for the benchmark iterations split between `num_threads`
+// threads.
+template <typename Op>
+void RunThreads(benchmark::State& state, int num_threads, Op op) {
+    for (auto _ : state) {
+        std::atomic<int64_t> next{0};
+        constexpr int64_t kBatch = 1024;
+        const int64_t total = 1 << 20;
+        std::vector<std::thread> threads;
+        for (int t = 0; t < num_threads; t++) {
+            threads.emplace_back([&]() {
+                for (int64_t begin = next.fetch_add(kBatch); begin < total;
+                     begin = next.fetch_add(kBatch)) {
+                    for (int64_t i = begin; i < begin + kBatch; i++) {
+                        op(i);
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        state.SetItemsProcessed(state.items_processed() + total);
+    }
+}
+
+uint64_t KeyOf(int64_t i) {
+    // Scatters consecutive operations over the key space.
+    return (static_cast<uint64_t>(i) * 0x9e3779b97f4a7c15ull) % kNumKeys;
+}
+
+// Lookups with a 1/16 insert on miss, on a cache holding half of the keys.
+// range(0) is the number of threads.
+void BM_ShardedCache(benchmark::State& state) {
+    ShardedCache<uint64_t, std::string>::Options options;
+    options.capacity = kNumKeys / 2;
+    options.num_shards = 64;
+    ShardedCache<uint64_t, std::string> cache(options);
+    RunThreads(state, state.range(0), [&](int64_t i) {
+        uint64_t key = KeyOf(i);
+        auto handle = cache.Lookup(key);
+        if (!handle) {
+            cache.Insert(key, "value");
+        }
+        benchmark::DoNotOptimize(handle);
+    });
+    auto stats = cache.GetStats();
+    state.counters["hit_ratio"] =
+        static_cast<double>(stats.hits) / (stats.hits + stats.misses);
+}
+BENCHMARK(BM_ShardedCache)->RangeMultiplier(2)->Range(1, 64)->UseRealTime();
+
+// The baseline: one map behind one lock, without eviction.
+void BM_MutexMap(benchmark::State& state) {
+    absl::Mutex mu;
+    absl::flat_hash_map<uint64_t, std::string> map;
+    RunThreads(state, state.range(0), [&](int64_t i) {
+        uint64_t key = KeyOf(i);
+        absl::MutexLock lock(&mu);
+        auto it = map.find(key);
+        if (it == map.end()) {
+            map.emplace(key, "value");
+        } else {
+            benchmark::DoNotOptimize(it->second);
+        }
+    });
+}
+BENCHMARK(BM_MutexMap)->RangeMultiplier(2)->Range(1, 64)->UseRealTime();
+
+}  // namespace
+}  // namespace utils
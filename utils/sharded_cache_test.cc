@@ -0,0 +1,137 @@
+#include "utils/sharded_cache.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace utils {
+namespace {
+
+using Cache = ShardedCache<int, std::string>;
+
+Cache::Options SingleShard(size_t capacity) {
+    Cache::Options options;
+    options.capacity = capacity;
+    options.num_shards = 1;
+    return options;
+}
+
+TEST(ShardedCache, InsertLookupErase) {
+    Cache cache(Cache::Options{});
+    EXPECT_EQ(cache.num_shards(), 16);
+    EXPECT_FALSE(cache.Lookup(1));
+    EXPECT_EQ(*cache.Insert(1, "one"), "one");
+
+    auto handle = cache.Lookup(1);
+    ASSERT_TRUE(handle);
+    EXPECT_EQ(handle.key(), 1);
+    EXPECT_EQ(handle.value(), "one");
+    EXPECT_EQ(handle->size(), 3);
+
+    cache.Insert(1, "uno");
+    EXPECT_EQ(*cache.Lookup(1), "uno");
+    // The replaced value lives until released.
+    EXPECT_EQ(handle.value(), "one");
+
+    EXPECT_TRUE(cache.Erase(1));
+    EXPECT_FALSE(cache.Erase(1));
+    EXPECT_FALSE(cache.Lookup(1));
+
+    auto stats = cache.GetStats();
+    EXPECT_EQ(stats.hits, 2);
+    EXPECT_EQ(stats.misses, 2);
+    EXPECT_EQ(stats.insertions, 2);
+    EXPECT_EQ(stats.entries, 0);
+    EXPECT_EQ(stats.usage, 0);
+}
+
+TEST(ShardedCache, ChargeEviction) {
+    Cache cache(SingleShard(100));
+    cache.Insert(1, "a", 40);
+    cache.Insert(2, "b", 40);
+    cache.Insert(3, "c", 40);
+    auto stats = cache.GetStats();
+    EXPECT_EQ(stats.entries, 2);
+    EXPECT_EQ(stats.usage, 80);
+    EXPECT_EQ(stats.evictions, 1);
+    EXPECT_FALSE(cache.Lookup(1));
+}
+
+TEST(ShardedCache, ClockSecondChance) {
+    Cache cache(SingleShard(3));
+    cache.Insert(1, "a");
+    cache.Insert(2, "b");
+    cache.Insert(3, "c");
+    // 1 is referenced, the hand skips it and evicts 2.
+    cache.Lookup(1);
+    cache.Insert(4, "d");
+    EXPECT_TRUE(cache.Lookup(1));
+    EXPECT_FALSE(cache.Lookup(2));
+    EXPECT_TRUE(cache.Lookup(3));
+    EXPECT_TRUE(cache.Lookup(4));
+}
+
+TEST(ShardedCache, PinnedEntriesAreNotEvicted) {
+    Cache cache(SingleShard(2));
+    auto pinned = cache.Insert(1, "a");
+    cache.Insert(2, "b");
+    cache.Insert(3, "c");
+    cache.Insert(4, "d");
+    EXPECT_TRUE(cache.Lookup(1));
+
+    // Nothing can be evicted while everything is pinned.
+    auto a = cache.Lookup(1);
+    auto d = cache.Lookup(4);
+    cache.Insert(5, "e");
+    EXPECT_EQ(cache.GetStats().usage, 3);
+
+    pinned.Release();
+    a.Release();
+    EXPECT_FALSE(pinned);
+    cache.Insert(6, "f");
+    EXPECT_LE(cache.GetStats().usage, 2);
+    EXPECT_EQ(d.value(), "d");
+}
+
+TEST(ShardedCache, HandleOutlivesCache) {
+    Cache::Handle handle;
+    {
+        Cache cache(Cache::Options{});
+        handle = cache.Insert(1, "one");
+    }
+    EXPECT_EQ(handle.value(), "one");
+}
+
+TEST(ShardedCache, Concurrent) {
+    Cache cache(SingleShard(64));
+    std::vector<std::thread> threads;
+    std::atomic<int> mismatches{0};
+    for (int t = 0; t < 8; t++) {
+        threads.emplace_back([&, t]() {
+            for (int i = 0; i < 10000; i++) {
+                int key = (i * 7 + t) % 128;
+                auto handle = cache.Lookup(key);
+                if (!handle) {
+                    handle = cache.Insert(key, std::to_string(key));
+                }
+                if (handle.value() != std::to_string(key)) {
+                    mismatches++;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(mismatches, 0);
+    auto stats = cache.GetStats();
+    EXPECT_EQ(stats.hits + stats.misses, 80000);
+    EXPECT_LE(stats.usage, 64);
+}
+
+}  // namespace
+}  // namespace utils
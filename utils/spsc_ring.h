@@ -0,0 +1,127 @@
+#ifndef TOOLBASE_UTILS_SPSC_RING_H_
+#define TOOLBASE_UTILS_SPSC_RING_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+
+#include "absl/base/optimization.h"
+
+namespace utils {
+
+// A bounded lock-free ring for exactly one producer thread and one consumer
+// thread. The head and tail are on their own cache lines, and each side
+// keeps a cached copy of the other side's index, so it only reads the
+// shared one when the ring looks full (or empty).
+// Example:
+//  SpscRing<Event> ring(4096);
+//  // Producer.
+//  ring.TryPush(std::move(event));
+//  // Consumer.
+//  Event events[64];
+//  size_t n = ring.TryPopBatch(events, 64);
+template <typename T>
+class SpscRing {
+   public:
+    // `capacity` is rounded up to a power of two.
+    explicit SpscRing(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) {
+            size *= 2;
+        }
+        mask_ = size - 1;
+        slots_ = std::make_unique<Slot[]>(size);
+    }
+
+    ~SpscRing() {
+        size_t head = head_.load(std::memory_order_relaxed);
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        for (; head != tail; head++) {
+            Item(head)->~T();
+        }
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Producer side. Returns false if the ring is full, `item` is then left
+    // untouched.
+    bool TryPush(T&& item) { return TryPushBatch(&item, 1) == 1; }
+    bool TryPush(const T& item) {
+        T copy(item);
+        return TryPush(std::move(copy));
+    }
+
+    // Producer side. Moves up to `count` items from `items`, publishes them
+    // at once and returns the number pushed.
+    size_t TryPushBatch(T* items, size_t count) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t free = mask_ + 1 - (tail - cached_head_);
+        if (free < count) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            free = mask_ + 1 - (tail - cached_head_);
+        }
+        size_t n = std::min(free, count);
+        for (size_t i = 0; i < n; i++) {
+            new (Item(tail + i)) T(std::move(items[i]));
+        }
+        tail_.store(tail + n, std::memory_order_release);
+        return n;
+    }
+
+    // Consumer side. Returns false if the ring is empty.
+    bool TryPop(T& item) { return TryPopBatch(&item, 1) == 1; }
+
+    // Consumer side. Moves up to `count` items into `items`, returns the
+    // number popped.
+    size_t TryPopBatch(T* items, size_t count) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        size_t available = cached_tail_ - head;
+        if (available < count) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            available = cached_tail_ - head;
+        }
+        size_t n = std::min(available, count);
+        for (size_t i = 0; i < n; i++) {
+            T* item = Item(head + i);
+            items[i] = std::move(*item);
+            item->~T();
+        }
+        head_.store(head + n, std::memory_order_release);
+        return n;
+    }
+
+    // Exact from either side when the other side is idle.
+    size_t size() const {
+        return tail_.load(std::memory_order_acquire) -
+               head_.load(std::memory_order_acquire);
+    }
+    bool empty() const { return size() == 0; }
+    size_t capacity() const { return mask_ + 1; }
+
+   private:
+    struct Slot {
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    T* Item(size_t index) {
+        return reinterpret_cast<T*>(slots_[index & mask_].storage);
+    }
+
+    size_t mask_;
+    std::unique_ptr<Slot[]> slots_;
+
+    // Written by the consumer.
+    alignas(ABSL_CACHELINE_SIZE) std::atomic<size_t> head_{0};
+    size_t cached_tail_ = 0;
+    // Written by the producer.
+    alignas(ABSL_CACHELINE_SIZE) std::atomic<size_t> tail_{0};
+    size_t cached_head_ = 0;
+};
+
+}  // namespace utils
+
+#endif  // TOOLBASE_UTILS_SPSC_RING_H_
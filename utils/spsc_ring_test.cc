@@ -0,0 +1,86 @@
+#include "utils/spsc_ring.h"
+
+#include <algorithm>
+#include <memory>
+#include <thread>
+
+#include "gtest/gtest.h"
+
+namespace utils {
+namespace {
+
+TEST(SpscRing, PushPop) {
+    SpscRing<std::unique_ptr<int>> ring(4);
+    EXPECT_EQ(ring.capacity(), 4);
+    for (int i = 0; i < 4; i++) {
+        EXPECT_TRUE(ring.TryPush(std::make_unique<int>(i)));
+    }
+    auto extra = std::make_unique<int>(4);
+    EXPECT_FALSE(ring.TryPush(std::move(extra)));
+    ASSERT_NE(extra, nullptr);
+
+    std::unique_ptr<int> item;
+    for (int i = 0; i < 4; i++) {
+        ASSERT_TRUE(ring.TryPop(item));
+        EXPECT_EQ(*item, i);
+    }
+    EXPECT_FALSE(ring.TryPop(item));
+    EXPECT_TRUE(ring.empty());
+}
+
+TEST(SpscRing, Batch) {
+    SpscRing<int> ring(8);
+    int in[10] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+    EXPECT_EQ(ring.TryPushBatch(in, 10), 8);
+    int out[10];
+    EXPECT_EQ(ring.TryPopBatch(out, 3), 3);
+    EXPECT_EQ(ring.TryPushBatch(in + 8, 2), 2);
+    EXPECT_EQ(ring.TryPopBatch(out + 3, 10), 7);
+    for (int i = 0; i < 10; i++) {
+        EXPECT_EQ(out[i], i);
+    }
+}
+
+TEST(SpscRing, DestroysQueuedItems) {
+    auto item = std::make_shared<int>(0);
+    {
+        SpscRing<std::shared_ptr<int>> ring(4);
+        ring.TryPush(item);
+        EXPECT_EQ(item.use_count(), 2);
+    }
+    EXPECT_EQ(item.use_count(), 1);
+}
+
+TEST(SpscRing, Concurrent) {
+    constexpr int kItems = 100000;
+    SpscRing<int> ring(128);
+    std::thread producer([&]() {
+        int batch[16];
+        for (int i = 0; i < kItems;) {
+            int n = std::min(16, kItems - i);
+            for (int j = 0; j < n; j++) {
+                batch[j] = i + j;
+            }
+            size_t pushed = ring.TryPushBatch(batch, n);
+            if (pushed == 0) {
+                std::this_thread::yield();
+            }
+            i += pushed;
+        }
+    });
+    int expected = 0;
+    int batch[16];
+    while (expected < kItems) {
+        size_t n = ring.TryPopBatch(batch, 16);
+        if (n == 0) {
+            std::this_thread::yield();
+        }
+        for (size_t i = 0; i < n; i++) {
+            ASSERT_EQ(batch[i], expected++);
+        }
+    }
+    producer.join();
+}
+
+}  // namespace
+}  // namespace utils
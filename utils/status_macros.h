@@ -1,38 +1,75 @@
 #ifndef TOOLBASE_UTILS_STATUS_MACROS_H_
 #define TOOLBASE_UTILS_STATUS_MACROS_H_
 
+#include <utility>
+
+#include "absl/base/optimization.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 
 namespace status_macros_internal {
+// Returns the status of an error to propagate, moved out of temporaries so
+// that returning it does not touch the reference count.
 inline const ::absl::Status& GetStatus(const ::absl::Status& status) {
     return status;
 }
+inline ::absl::Status GetStatus(::absl::Status&& status) {
+    return std::move(status);
+}
 
 template <typename T>
 inline const ::absl::Status& GetStatus(const ::absl::StatusOr<T>& status) {
     return status.status();
 }
+template <typename T>
+inline ::absl::Status GetStatus(::absl::StatusOr<T>&& status) {
+    return std::move(status).status();
+}
 
 }  // namespace status_macros_internal
 
-#define RETURN_IF_ERROR(expr)                        \
-    do {                                             \
-        const ::absl::Status _status =               \
-            status_macros_internal::GetStatus(expr); \
-        if (!_status.ok()) return _status;           \
+#define RETURN_IF_ERROR(expr)                              \
+    do {                                                   \
+        auto&& _status = (expr);                           \
+        if (ABSL_PREDICT_FALSE(!_status.ok())) {           \
+            return status_macros_internal::GetStatus(      \
+                std::forward<decltype(_status)>(_status)); \
+        }                                                  \
     } while (0)
 
 #define STATUS_MACROS_CONCAT_NAME_INNER(x, y) x##y
 #define STATUS_MACROS_CONCAT_NAME(x, y) STATUS_MACROS_CONCAT_NAME_INNER(x, y)
 
-#define ASSIGN_OR_RETURN_IMPL(rvalue, lhs, rexpr)      \
-    auto rvalue = (rexpr);                             \
-    if (!rvalue.status().ok()) return rvalue.status(); \
-    lhs = std::move(rvalue.value())
+#define ASSIGN_OR_RETURN_IMPL(rvalue, lhs, rexpr) \
+    auto rvalue = (rexpr);                        \
+    if (ABSL_PREDICT_FALSE(!rvalue.ok())) {       \
+        return std::move(rvalue).status();        \
+    }                                             \
+    lhs = std::move(rvalue).value()
 
 #define ASSIGN_OR_RETURN(lhs, rexpr) \
     ASSIGN_OR_RETURN_IMPL(           \
         STATUS_MACROS_CONCAT_NAME(_status_or_value, __COUNTER__), lhs, rexpr);
 
+// Variants of the macros above for coroutines returning a status.
+#define CO_RETURN_IF_ERROR(expr)                           \
+    do {                                                   \
+        auto&& _status = (expr);                           \
+        if (ABSL_PREDICT_FALSE(!_status.ok())) {           \
+            co_return status_macros_internal::GetStatus(   \
+                std::forward<decltype(_status)>(_status)); \
+        }                                                  \
+    } while (0)
+
+#define CO_ASSIGN_OR_RETURN_IMPL(rvalue, lhs, rexpr) \
+    auto rvalue = (rexpr);                           \
+    if (ABSL_PREDICT_FALSE(!rvalue.ok())) {          \
+        co_return std::move(rvalue).status();        \
+    }                                                \
+    lhs = std::move(rvalue).value()
+
+#define CO_ASSIGN_OR_RETURN(lhs, rexpr) \
+    CO_ASSIGN_OR_RETURN_IMPL(           \
+        STATUS_MACROS_CONCAT_NAME(_status_or_value, __COUNTER__), lhs, rexpr);
+
 #endif  // TOOLBASE_UTILS_STATUS_MACROS_H_
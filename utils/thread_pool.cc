@@ -0,0 +1,54 @@
+#include "utils/thread_pool.h"
+
+#include "glog/logging.h"
+
+namespace utils {
+
+ThreadPool::ThreadPool(int num_threads)
+    : ThreadPool(num_threads, NumaPolicy()) {}
+
+ThreadPool::ThreadPool(int num_threads, const NumaPolicy& numa) {
+    for (int i = 0; i < num_threads; i++) {
+        threads_.emplace_back(&ThreadPool::WorkLoop, this, numa);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        absl::MutexLock lock(&mu_);
+        stopping_ = true;
+    }
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+void ThreadPool::Schedule(std::function<void()> task) {
+    absl::MutexLock lock(&mu_);
+    queue_.push_back(std::move(task));
+}
+
+void ThreadPool::WorkLoop(const NumaPolicy& numa) {
+    absl::Status placed = Numa::Get().Apply(numa);
+    if (!placed.ok()) {
+        LOG(ERROR) << placed;
+    }
+    auto has_work = [this]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        return !queue_.empty() || stopping_;
+    };
+    while (true) {
+        std::function<void()> task;
+        {
+            absl::MutexLock lock(&mu_);
+            mu_.Await(absl::Condition(&has_work));
+            if (queue_.empty()) {
+                return;
+            }
+            task = std::move(queue_.front());
+            queue_.pop_front();
+        }
+        task();
+    }
+}
+
+}  // namespace utils
@@ -0,0 +1,46 @@
+#ifndef TOOLBASE_UTILS_THREAD_POOL_H_
+#define TOOLBASE_UTILS_THREAD_POOL_H_
+
+#include <deque>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "utils/numa.h"
+
+namespace utils {
+
+// A fixed size pool of threads running tasks in FIFO order.
+// Example:
+//  ThreadPool pool(4);
+//  pool.Schedule([]() { ... });
+class ThreadPool {
+   public:
+    explicit ThreadPool(int num_threads);
+    // The threads apply `numa` when they start, a placement failure leaves
+    // them unplaced.
+    ThreadPool(int num_threads, const NumaPolicy& numa);
+    // Runs the tasks still queued, then joins the threads.
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void Schedule(std::function<void()> task);
+
+    int num_threads() const { return threads_.size(); }
+
+   private:
+    void WorkLoop(const NumaPolicy& numa);
+
+    absl::Mutex mu_;
+    std::deque<std::function<void()>> queue_ ABSL_GUARDED_BY(mu_);
+    bool stopping_ ABSL_GUARDED_BY(mu_) = false;
+    std::vector<std::thread> threads_;
+};
+
+}  // namespace utils
+
+#endif  // TOOLBASE_UTILS_THREAD_POOL_H_
@@ -0,0 +1,56 @@
+#include "utils/thread_pool.h"
+
+#include <sched.h>
+
+#include <atomic>
+
+#include "gtest/gtest.h"
+
+namespace utils {
+namespace {
+
+TEST(ThreadPool, RunsAllTasks) {
+    std::atomic<int> sum{0};
+    {
+        ThreadPool pool(4);
+        EXPECT_EQ(pool.num_threads(), 4);
+        for (int i = 1; i <= 1000; i++) {
+            pool.Schedule([&sum, i]() { sum += i; });
+        }
+    }
+    EXPECT_EQ(sum, 500500);
+}
+
+TEST(ThreadPool, SingleThreadIsFifo) {
+    std::vector<int> order;
+    {
+        ThreadPool pool(1);
+        for (int i = 0; i < 100; i++) {
+            pool.Schedule([&order, i]() { order.push_back(i); });
+        }
+    }
+    ASSERT_EQ(order.size(), 100);
+    for (int i = 0; i < 100; i++) {
+        EXPECT_EQ(order[i], i);
+    }
+}
+
+TEST(ThreadPool, NumaPolicy) {
+    const Numa& numa = Numa::Get();
+    const int node = numa.nodes()[0].id;
+    std::atomic<int> on_node{0};
+    {
+        ThreadPool pool(2, NumaPolicy::OnNode(node));
+        for (int i = 0; i < 10; i++) {
+            pool.Schedule([&]() {
+                if (numa.CurrentNode() == node) {
+                    on_node++;
+                }
+            });
+        }
+    }
+    EXPECT_EQ(on_node, 10);
+}
+
+}  // namespace
+}  // namespace utils
@@ -0,0 +1,245 @@
+#include "utils/trace.h"
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <memory>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "nlohmann/json.hpp"
+
+namespace utils {
+namespace internal {
+
+std::atomic<bool> tracing_enabled{false};
+
+}  // namespace internal
+
+namespace {
+
+constexpr size_t kMask = kTraceBufferSize - 1;
+static_assert((kTraceBufferSize & kMask) == 0, "must be a power of two");
+
+// A ring written by its thread only. The slots are atomics so that the
+// collector can read them concurrently, the relaxed stores compile to plain
+// moves.
+struct ThreadBuffer {
+    struct Slot {
+        std::atomic<const char*> name{nullptr};
+        std::atomic<uint64_t> start{0};
+        std::atomic<uint64_t> end{0};
+    };
+
+    int tid = 0;
+    // Number of spans ever recorded.
+    std::atomic<uint64_t> head{0};
+    // Guarded by the registry lock, as `collected`.
+    bool exited = false;
+    // Spans before it were returned by a previous collection.
+    uint64_t collected = 0;
+    Slot slots[kTraceBufferSize];
+};
+
+struct Registry {
+    absl::Mutex mu;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers ABSL_GUARDED_BY(mu);
+};
+
+Registry& GetRegistry() {
+    static Registry* registry = new Registry();
+    return *registry;
+}
+
+// Registers the buffer of a thread on its first span. On thread exit, the
+// buffer is dropped if collected, or flagged so that it is dropped once
+// collected.
+class ThreadBufferHolder {
+   public:
+    ThreadBufferHolder() : buffer_(std::make_shared<ThreadBuffer>()) {
+        buffer_->tid = syscall(SYS_gettid);
+        Registry& registry = GetRegistry();
+        absl::MutexLock lock(&registry.mu);
+        registry.buffers.push_back(buffer_);
+    }
+    ~ThreadBufferHolder() {
+        Registry& registry = GetRegistry();
+        absl::MutexLock lock(&registry.mu);
+        buffer_->exited = true;
+        // From the newest, keeps the first `kMaxExitedTraceBuffers` exited
+        // buffers with spans to collect.
+        auto& buffers = registry.buffers;
+        size_t exited = 0;
+        for (size_t i = buffers.size(); i-- > 0;) {
+            const ThreadBuffer& buffer = *buffers[i];
+            if (!buffer.exited) {
+                continue;
+            }
+            if (buffer.collected ==
+                    buffer.head.load(std::memory_order_relaxed) ||
+                ++exited > kMaxExitedTraceBuffers) {
+                buffers.erase(buffers.begin() + i);
+            }
+        }
+    }
+
+    ThreadBuffer* buffer() { return buffer_.get(); }
+
+   private:
+    std::shared_ptr<ThreadBuffer> buffer_;
+};
+
+// Maps timestamp counter values to the wall clock, from two reference
+// points: the first use, and the conversion time.
+struct TscClock {
+    uint64_t tsc;
+    int64_t ns;
+
+    static TscClock Now() {
+        return {internal::ReadTsc(), absl::GetCurrentTimeNanos()};
+    }
+};
+
+const TscClock& StartClock() {
+    static const TscClock start = TscClock::Now();
+    return start;
+}
+
+std::atomic<uint32_t> sample_one_in{1};
+
+// The sampling state of a thread, the top-level spans decide for the spans
+// nested in them.
+struct SpanSampler {
+    // Number of open spans.
+    int depth = 0;
+    bool sampled = false;
+    // Top-level spans to skip before the next sampled one.
+    uint32_t countdown = 0;
+};
+
+thread_local SpanSampler span_sampler;
+
+}  // namespace
+
+void SetTracingEnabled(bool enabled) {
+    StartClock();
+    internal::tracing_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void SetTraceSampling(uint32_t one_in) {
+    sample_one_in.store(std::max<uint32_t>(one_in, 1),
+                        std::memory_order_relaxed);
+}
+
+namespace internal {
+
+bool BeginSpan() {
+    SpanSampler& sampler = span_sampler;
+    if (sampler.depth++ == 0) {
+        uint32_t one_in = sample_one_in.load(std::memory_order_relaxed);
+        if (sampler.countdown == 0 || sampler.countdown > one_in) {
+            sampler.countdown = one_in;
+        }
+        sampler.sampled = --sampler.countdown == 0;
+    }
+    return sampler.sampled;
+}
+
+void EndSpan() { span_sampler.depth--; }
+
+void RecordSpan(const char* name, uint64_t start_tsc, uint64_t end_tsc) {
+    thread_local ThreadBufferHolder holder;
+    ThreadBuffer* buffer = holder.buffer();
+    uint64_t index = buffer->head.load(std::memory_order_relaxed);
+    // Orders the previous `head` store before the slot stores, for the
+    // collector to detect overwritten slots.
+    std::atomic_thread_fence(std::memory_order_release);
+    ThreadBuffer::Slot& slot = buffer->slots[index & kMask];
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.start.store(start_tsc, std::memory_order_relaxed);
+    slot.end.store(end_tsc, std::memory_order_relaxed);
+    buffer->head.store(index + 1, std::memory_order_release);
+}
+
+}  // namespace internal
+
+std::vector<TraceEvent> CollectTraceEvents() {
+    const TscClock& start = StartClock();
+    TscClock now = TscClock::Now();
+    if (now.ns - start.ns < 1000000) {
+        // Too close for a precise rate.
+        absl::SleepFor(absl::Milliseconds(1));
+        now = TscClock::Now();
+    }
+    const double ns_per_tick =
+        static_cast<double>(now.ns - start.ns) / (now.tsc - start.tsc);
+    auto to_ns = [&](uint64_t tsc) {
+        return start.ns + static_cast<int64_t>(
+                              static_cast<double>(
+                                  static_cast<int64_t>(tsc - start.tsc)) *
+                              ns_per_tick);
+    };
+
+    std::vector<TraceEvent> events;
+    Registry& registry = GetRegistry();
+    absl::MutexLock lock(&registry.mu);
+    for (auto& buffer : registry.buffers) {
+        uint64_t head = buffer->head.load(std::memory_order_acquire);
+        uint64_t begin = std::max(
+            buffer->collected,
+            head > kTraceBufferSize ? head - kTraceBufferSize : 0);
+        size_t first = events.size();
+        for (uint64_t i = begin; i < head; i++) {
+            const ThreadBuffer::Slot& slot = buffer->slots[i & kMask];
+            uint64_t start_tsc = slot.start.load(std::memory_order_relaxed);
+            uint64_t end_tsc = slot.end.load(std::memory_order_relaxed);
+            events.push_back({slot.name.load(std::memory_order_relaxed),
+                              buffer->tid, to_ns(start_tsc),
+                              to_ns(end_tsc) - to_ns(start_tsc)});
+        }
+        // The slots of the spans recorded meanwhile, and of the one being
+        // recorded, may have been overwritten.
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t new_head = buffer->head.load(std::memory_order_relaxed);
+        if (new_head + 1 > begin + kTraceBufferSize) {
+            uint64_t overwritten = new_head + 1 - kTraceBufferSize - begin;
+            events.erase(events.begin() + first,
+                         events.begin() + first +
+                             std::min<uint64_t>(overwritten, head - begin));
+        }
+        buffer->collected = head;
+    }
+    registry.buffers.erase(
+        std::remove_if(registry.buffers.begin(), registry.buffers.end(),
+                       [](const std::shared_ptr<ThreadBuffer>& buffer) {
+                           return buffer->exited &&
+                                  buffer->collected ==
+                                      buffer->head.load(
+                                          std::memory_order_relaxed);
+                       }),
+        registry.buffers.end());
+    return events;
+}
+
+std::string TraceEventsToChromeJson(const std::vector<TraceEvent>& events) {
+    nlohmann::json trace_events = nlohmann::json::array();
+    const int pid = getpid();
+    for (const auto& event : events) {
+        // Complete events, in microseconds.
+        trace_events.push_back({
+            {"name", event.name},
+            {"ph", "X"},
+            {"ts", event.start_ns / 1e3},
+            {"dur", event.duration_ns / 1e3},
+            {"pid", pid},
+            {"tid", event.tid},
+        });
+    }
+    nlohmann::json json = {{"traceEvents", std::move(trace_events)},
+                           {"displayTimeUnit", "ns"}};
+    return json.dump();
+}
+
+}  // namespace utils
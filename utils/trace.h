@@ -0,0 +1,130 @@
+#ifndef TOOLBASE_UTILS_TRACE_H_
+#define TOOLBASE_UTILS_TRACE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/base/optimization.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace utils {
+
+namespace internal {
+
+extern std::atomic<bool> tracing_enabled;
+
+// Reads the CPU timestamp counter, or a monotonic clock in nanoseconds on
+// the other architectures.
+inline uint64_t ReadTsc() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t ticks;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+#endif
+}
+
+// Counts a span opened on the calling thread, returns whether it is
+// sampled.
+bool BeginSpan();
+// Counts a span closed on the calling thread.
+void EndSpan();
+
+// Appends a span to the buffer of the calling thread.
+void RecordSpan(const char* name, uint64_t start_tsc, uint64_t end_tsc);
+
+}  // namespace internal
+
+// Tracing is disabled by default, a span then costs a relaxed load and a
+// branch. Enabled, a span costs two timestamp counter reads and a few
+// stores into the buffer of its thread, without locks or allocations.
+inline bool TracingEnabled() {
+    return internal::tracing_enabled.load(std::memory_order_relaxed);
+}
+void SetTracingEnabled(bool enabled);
+
+// Records the spans of one in `one_in` top-level spans of each thread, with
+// all the spans nested in them, so that tracing can stay enabled in
+// production. A span not sampled costs a thread local counter update. The
+// default 1 records all the spans.
+void SetTraceSampling(uint32_t one_in);
+
+// Records the scope as a span named `name`, which must be a string literal
+// (or outlive the collection). Spans nest by their timestamps.
+// Example:
+//  {
+//      utils::TraceSpan span("HandleRequest");
+//      ...
+//  }
+class TraceSpan {
+   public:
+    explicit TraceSpan(const char* name) {
+        if (ABSL_PREDICT_FALSE(TracingEnabled())) {
+            counted_ = true;
+            if (internal::BeginSpan()) {
+                name_ = name;
+                start_ = internal::ReadTsc();
+            }
+        }
+    }
+    ~TraceSpan() {
+        if (ABSL_PREDICT_FALSE(counted_)) {
+            if (name_ != nullptr) {
+                internal::RecordSpan(name_, start_, internal::ReadTsc());
+            }
+            internal::EndSpan();
+        }
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+   private:
+    // Null if the span is not recorded.
+    const char* name_ = nullptr;
+    uint64_t start_ = 0;
+    // Whether the span was counted by the sampling.
+    bool counted_ = false;
+};
+
+struct TraceEvent {
+    const char* name;
+    // Thread id, as shown by `ps -L`.
+    int tid;
+    // Since the epoch.
+    int64_t start_ns;
+    int64_t duration_ns;
+};
+
+// Each thread keeps its last `kTraceBufferSize` - 1 spans, older ones are
+// overwritten.
+constexpr size_t kTraceBufferSize = 1 << 14;
+
+// The buffers of up to `kMaxExitedTraceBuffers` exited threads are kept
+// until collected, the buffers of the threads started first are dropped
+// beyond. The buffer of a thread exiting with all its spans collected is
+// freed at once.
+constexpr size_t kMaxExitedTraceBuffers = 64;
+
+// Returns the spans recorded since the previous collection, by thread.
+// Collecting concurrently with the recording threads is safe, spans being
+// overwritten during the collection are dropped.
+std::vector<TraceEvent> CollectTraceEvents();
+
+// Formats `events` in the Chrome trace event format, which can be loaded
+// into chrome://tracing or https://ui.perfetto.dev.
+std::string TraceEventsToChromeJson(const std::vector<TraceEvent>& events);
+
+}  // namespace utils
+
+#endif  // TOOLBASE_UTILS_TRACE_H_
@@ -0,0 +1,57 @@
+#include "benchmark/benchmark.h"
+#include "utils/trace.h"
+
+namespace utils {
+namespace {
+
+void BM_TraceSpanDisabled(benchmark::State& state) {
+    SetTracingEnabled(false);
+    for (auto _ : state) {
+        TraceSpan span("span");
+        benchmark::ClobberMemory();
+    }
+}
+BENCHMARK(BM_TraceSpanDisabled);
+
+void BM_TraceSpanEnabled(benchmark::State& state) {
+    SetTracingEnabled(true);
+    for (auto _ : state) {
+        TraceSpan span("span");
+        benchmark::ClobberMemory();
+    }
+    SetTracingEnabled(false);
+    CollectTraceEvents();
+}
+BENCHMARK(BM_TraceSpanEnabled);
+
+void BM_TraceSpanSampled(benchmark::State& state) {
+    SetTracingEnabled(true);
+    SetTraceSampling(100);
+    for (auto _ : state) {
+        TraceSpan span("span");
+        benchmark::ClobberMemory();
+    }
+    SetTraceSampling(1);
+    SetTracingEnabled(false);
+    CollectTraceEvents();
+}
+BENCHMARK(BM_TraceSpanSampled);
+
+// Collects the full buffer of one thread.
+void BM_CollectTraceEvents(benchmark::State& state) {
+    SetTracingEnabled(true);
+    for (auto _ : state) {
+        state.PauseTiming();
+        for (size_t i = 0; i < kTraceBufferSize; i++) {
+            TraceSpan span("span");
+        }
+        state.ResumeTiming();
+        benchmark::DoNotOptimize(CollectTraceEvents());
+    }
+    SetTracingEnabled(false);
+    state.SetItemsProcessed(state.iterations() * kTraceBufferSize);
+}
+BENCHMARK(BM_CollectTraceEvents);
+
+}  // namespace
+}  // namespace utils
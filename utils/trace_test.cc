@@ -0,0 +1,139 @@
+#include "utils/trace.h"
+
+#include <unistd.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/time/clock.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "nlohmann/json.hpp"
+
+namespace utils {
+namespace {
+
+using ::testing::Field;
+using ::testing::IsEmpty;
+using ::testing::SizeIs;
+using ::testing::StrEq;
+
+class Trace : public ::testing::Test {
+   protected:
+    void SetUp() override {
+        SetTracingEnabled(true);
+        CollectTraceEvents();
+    }
+    void TearDown() override { SetTracingEnabled(false); }
+};
+
+TEST_F(Trace, NestedSpans) {
+    {
+        TraceSpan outer("outer");
+        absl::SleepFor(absl::Milliseconds(2));
+        { TraceSpan inner("inner"); }
+    }
+    auto events = CollectTraceEvents();
+    ASSERT_THAT(events, SizeIs(2));
+    // In completion order.
+    EXPECT_STREQ(events[0].name, "inner");
+    EXPECT_STREQ(events[1].name, "outer");
+    EXPECT_EQ(events[0].tid, events[1].tid);
+    EXPECT_GE(events[1].duration_ns, 2000000);
+    EXPECT_LE(events[1].start_ns, events[0].start_ns);
+    EXPECT_GE(events[1].start_ns + events[1].duration_ns,
+              events[0].start_ns + events[0].duration_ns);
+    int64_t now = absl::GetCurrentTimeNanos();
+    EXPECT_NEAR(events[1].start_ns, now, 1e9);
+
+    // Collected once.
+    EXPECT_THAT(CollectTraceEvents(), IsEmpty());
+}
+
+TEST_F(Trace, Disabled) {
+    SetTracingEnabled(false);
+    { TraceSpan span("span"); }
+    EXPECT_THAT(CollectTraceEvents(), IsEmpty());
+}
+
+TEST_F(Trace, KeepsTheLastSpans) {
+    for (size_t i = 0; i < kTraceBufferSize + 10; i++) {
+        TraceSpan span(i < 10 ? "old" : "new");
+    }
+    auto events = CollectTraceEvents();
+    // The oldest slot is the next one written, it is not returned.
+    EXPECT_EQ(events.size(), kTraceBufferSize - 1);
+    EXPECT_THAT(events,
+                ::testing::Each(Field(&TraceEvent::name, StrEq("new"))));
+}
+
+TEST_F(Trace, Threads) {
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; i++) {
+        threads.emplace_back([]() {
+            for (int j = 0; j < 100; j++) {
+                TraceSpan span("work");
+            }
+        });
+    }
+    // Collects concurrently, then after the threads exited.
+    size_t count = CollectTraceEvents().size();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    count += CollectTraceEvents().size();
+    EXPECT_EQ(count, 400);
+}
+
+TEST_F(Trace, Sampling) {
+    SetTraceSampling(4);
+    for (int i = 0; i < 100; i++) {
+        TraceSpan outer("outer");
+        { TraceSpan inner("inner"); }
+    }
+    SetTraceSampling(1);
+    // The nested spans follow their top-level span.
+    auto events = CollectTraceEvents();
+    ASSERT_THAT(events, SizeIs(50));
+    for (size_t i = 0; i < events.size(); i += 2) {
+        EXPECT_STREQ(events[i].name, "inner");
+        EXPECT_STREQ(events[i + 1].name, "outer");
+    }
+}
+
+TEST_F(Trace, ExitedThreadsAreBounded) {
+    for (size_t i = 0; i < kMaxExitedTraceBuffers + 10; i++) {
+        std::thread([]() { TraceSpan span("work"); }).join();
+    }
+    // The buffers of the first threads were dropped.
+    EXPECT_THAT(CollectTraceEvents(), SizeIs(kMaxExitedTraceBuffers));
+
+    // A thread exiting collected drops its buffer at once.
+    for (size_t i = 0; i < kMaxExitedTraceBuffers + 10; i++) {
+        std::thread([]() {
+            { TraceSpan span("work"); }
+            CollectTraceEvents();
+        }).join();
+    }
+    std::thread([]() { TraceSpan span("last"); }).join();
+    auto events = CollectTraceEvents();
+    ASSERT_THAT(events, SizeIs(1));
+    EXPECT_STREQ(events[0].name, "last");
+}
+
+TEST_F(Trace, ChromeJson) {
+    std::vector<TraceEvent> events = {{"read", 12, 5000, 1500}};
+    auto json = nlohmann::json::parse(TraceEventsToChromeJson(events));
+    ASSERT_EQ(json["traceEvents"].size(), 1);
+    auto event = json["traceEvents"][0];
+    EXPECT_EQ(event["name"], "read");
+    EXPECT_EQ(event["ph"], "X");
+    EXPECT_EQ(event["ts"], 5.0);
+    EXPECT_EQ(event["dur"], 1.5);
+    EXPECT_EQ(event["tid"], 12);
+    EXPECT_EQ(event["pid"], getpid());
+}
+
+}  // namespace
+}  // namespace utils